@@ -23,6 +23,7 @@
 #include "qgsgeometry.h"
 #include "qgsproject.h"
 #include "qgsexpressioncontextutils.h"
+#include "qgsfeaturebatch.h"
 #include "qgsexpression_p.h"
 
 // from parser
@@ -52,6 +53,7 @@ void QgsExpression::setExpression( const QString &expression )
   d->mEvalErrorString = QString();
   d->mExp = expression;
   d->mIsPrepared = false;
+  d->mBytecode.reset();
 }
 
 QString QgsExpression::expression() const
@@ -340,7 +342,13 @@ bool QgsExpression::prepare( const QgsExpressionContext *context )
 
   initGeomCalculator( context );
   d->mIsPrepared = true;
-  return d->mRootNode->prepare( this, context );
+  d->mBytecode.reset();
+  if ( !d->mRootNode->prepare( this, context ) )
+    return false;
+
+  // lower the prepared tree to a program, evaluated faster than the tree
+  d->mBytecode = QgsExpressionBytecode::compile( d->mRootNode, context );
+  return true;
 }
 
 QVariant QgsExpression::evaluate()
@@ -368,9 +376,60 @@ QVariant QgsExpression::evaluate( const QgsExpressionContext *context )
   {
     prepare( context );
   }
+  if ( d->mBytecode )
+    return d->mBytecode->evaluate( this, context );
   return d->mRootNode->eval( this, context );
 }
 
+QVector<QVariant> QgsExpression::evaluateBatch( const QgsFeatureBatch &batch, QgsExpressionContext *context )
+{
+  QVector<QVariant> values;
+  if ( !d->mRootNode )
+  {
+    d->mEvalErrorString = tr( "No root node! Parsing failed?" );
+    values.resize( batch.size() );
+    return values;
+  }
+  d->mEvalErrorString = QString();
+
+  if ( !d->mIsPrepared && !batch.isEmpty() )
+  {
+    // as when evaluating the features one by one, prepare for the first one
+    context->setFeature( batch.feature( 0 ) );
+    prepare( context );
+  }
+
+  QBitArray remainingRows;
+  if ( d->mBytecode )
+  {
+    d->mBytecode->evaluateBatch( batch, values, remainingRows );
+  }
+  else
+  {
+    values.resize( batch.size() );
+    remainingRows = QBitArray( batch.size(), true );
+  }
+
+  QString error;
+  for ( int row = 0; row < batch.size(); ++row )
+  {
+    if ( !remainingRows.testBit( row ) )
+      continue;
+
+    context->setFeature( batch.feature( row ) );
+    values[row] = evaluate( context );
+    if ( hasEvalError() && error.isNull() )
+      error = d->mEvalErrorString;
+  }
+  d->mEvalErrorString = error;
+  return values;
+}
+
+bool QgsExpression::canEvaluateByColumns() const
+{
+  return d->mBytecode && d->mBytecode->isNumeric();
+}
+
 bool QgsExpression::hasEvalError() const
 {
   return !d->mEvalErrorString.isNull();
@@ -24,6 +24,7 @@
 #include <QDomDocument>
 #include <QCoreApplication>
 #include <QSet>
+#include <QVector>
 #include <functional>
 
 #include "qgis.h"
@@ -32,6 +33,7 @@
 #include "qgsexpressionnode.h"
 
 class QgsFeature;
+class QgsFeatureBatch;
 class QgsGeometry;
 class QgsOgcUtils;
 class QgsVectorLayer;
@@ -318,6 +320,34 @@ class CORE_EXPORT QgsExpression
      */
     QVariant evaluate( const QgsExpressionContext *context );
 
+    /**
+     * Evaluates the expression for all the features of \a batch and returns their
+     * values, in the order of the batch.
+     *
+     * Expressions made of numeric operations are evaluated column by column over the
+     * typed columns of the batch. The other ones, and the features for which a value
+     * is not a finite number, are evaluated one by one with the feature of \a context
+     * set to each feature of the batch in turn. Either way the values are the same as
+     * the ones returned by evaluate() for each feature.
+     *
+     * If the evaluation fails for some features, their value is NULL and hasEvalError()
+     * returns TRUE, with the error of the first failing feature.
+     *
+     * \note not available in Python bindings
+     * \since QGIS 3.16
+     */
+    QVector<QVariant> evaluateBatch( const QgsFeatureBatch &batch, QgsExpressionContext *context ) SIP_SKIP;
+
+    /**
+     * Returns TRUE if the prepared expression is made of numeric operations only,
+     * which evaluateBatch() evaluates column by column. For the other expressions,
+     * evaluateBatch() evaluates the features one by one.
+     *
+     * \note not available in Python bindings
+     * \since QGIS 3.16
+     */
+    bool canEvaluateByColumns() const SIP_SKIP;
+
     //! Returns TRUE if an error occurred when evaluating last input
     bool hasEvalError() const;
     //! Returns evaluation error
@@ -24,6 +24,7 @@
 #include "qgsdistancearea.h"
 #include "qgsunittypes.h"
 #include "qgsexpressionnode.h"
+#include "qgsexpressionbytecode.h"
 
 ///@cond
 
@@ -81,6 +82,9 @@ class QgsExpressionPrivate
     //! Whether prepare() has been called before evaluate()
     bool mIsPrepared = false;
 
+    //! Program compiled from the prepared tree, NULLPTR to evaluate the tree
+    std::unique_ptr<QgsExpressionBytecode> mBytecode;
+
     QgsExpressionPrivate &operator= ( const QgsExpressionPrivate & ) = delete;
 };
 
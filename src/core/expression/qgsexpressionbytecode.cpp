@@ -0,0 +1,1385 @@
+/***************************************************************************
+                               qgsexpressionbytecode.cpp
+                             -------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsexpressionbytecode.h"
+#include "qgsexpressionutils.h"
+#include "qgsexpression.h"
+#include "qgsexpressioncontext.h"
+#include "qgsfeaturebatch.h"
+
+#include <QVarLengthArray>
+
+#include <cmath>
+
+///@cond PRIVATE
+
+void QgsExpressionBytecode::Value::setVariant( const QVariant &value )
+{
+  variant = value;
+  boxed = true;
+
+  if ( value.isNull() )
+  {
+    kind = Null;
+    return;
+  }
+
+  switch ( value.type() )
+  {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+      kind = Integer;
+      integer = value.toLongLong();
+      number = value.toDouble();
+      break;
+
+    case QVariant::Double:
+      number = value.toDouble();
+      // NaN and infinity are not valid numbers for the expressions, leave them to the tree
+      kind = std::isfinite( number ) ? Double : Other;
+      break;
+
+    case QVariant::String:
+      kind = String;
+      string = value.toString();
+      break;
+
+    default:
+      kind = Other;
+      break;
+  }
+}
+
+void QgsExpressionBytecode::Value::setNull()
+{
+  kind = Null;
+  boxed = true;
+  variant = QVariant();
+}
+
+void QgsExpressionBytecode::Value::setInteger( qlonglong value, QVariant::Type type )
+{
+  kind = Integer;
+  boxed = false;
+  integerType = type;
+  integer = value;
+  number = static_cast< double >( value );
+}
+
+void QgsExpressionBytecode::Value::setDouble( double value )
+{
+  if ( std::isfinite( value ) )
+  {
+    kind = Double;
+    boxed = false;
+    number = value;
+  }
+  else
+  {
+    setVariant( QVariant( value ) );
+  }
+}
+
+void QgsExpressionBytecode::Value::setLogical( int tvl )
+{
+  switch ( tvl )
+  {
+    case QgsExpressionUtils::True:
+      setInteger( 1, QVariant::Int );
+      break;
+    case QgsExpressionUtils::False:
+      setInteger( 0, QVariant::Int );
+      break;
+    default:
+      setNull();
+      break;
+  }
+}
+
+QVariant QgsExpressionBytecode::Value::toVariant() const
+{
+  if ( boxed )
+    return variant;
+
+  switch ( kind )
+  {
+    case Integer:
+      return integerType == QVariant::Int ? QVariant( static_cast< int >( integer ) ) : QVariant( integer );
+    case Double:
+      return QVariant( number );
+    case String:
+      return QVariant( string );
+    case Null:
+    case Other:
+      break;
+  }
+  return variant;
+}
+
+void QgsExpressionBytecode::Column::resize( int size )
+{
+  kinds.resize( size );
+  types.resize( size );
+  integers.resize( size );
+  numbers.resize( size );
+}
+
+void QgsExpressionBytecode::Column::setNull( int row, int type )
+{
+  kinds[row] = Null;
+  types[row] = type;
+}
+
+void QgsExpressionBytecode::Column::setInteger( int row, qlonglong value, double number, int type )
+{
+  kinds[row] = Integer;
+  types[row] = type;
+  integers[row] = value;
+  numbers[row] = number;
+}
+
+bool QgsExpressionBytecode::Column::setDouble( int row, double value )
+{
+  if ( !std::isfinite( value ) )
+    return false;
+
+  kinds[row] = Double;
+  types[row] = QVariant::Double;
+  numbers[row] = value;
+  return true;
+}
+
+void QgsExpressionBytecode::Column::setLogical( int row, int tvl )
+{
+  switch ( tvl )
+  {
+    case QgsExpressionUtils::True:
+      setInteger( row, 1, 1., QVariant::Int );
+      break;
+    case QgsExpressionUtils::False:
+      setInteger( row, 0, 0., QVariant::Int );
+      break;
+    default:
+      setNull( row );
+      break;
+  }
+}
+
+int QgsExpressionBytecode::Column::logicalValue( int row ) const
+{
+  switch ( kinds.at( row ) )
+  {
+    case Integer:
+      return numbers.at( row ) != 0 ? QgsExpressionUtils::True : QgsExpressionUtils::False;
+    case Double:
+      return !qgsDoubleNear( numbers.at( row ), 0.0 ) ? QgsExpressionUtils::True : QgsExpressionUtils::False;
+    default:
+      return QgsExpressionUtils::Unknown;
+  }
+}
+
+QVariant QgsExpressionBytecode::Column::toVariant( int row ) const
+{
+  switch ( kinds.at( row ) )
+  {
+    case Integer:
+    {
+      const qlonglong value = integers.at( row );
+      switch ( types.at( row ) )
+      {
+        case QVariant::Int:
+          return static_cast< int >( value );
+        case QVariant::UInt:
+          return static_cast< uint >( value );
+        case QVariant::ULongLong:
+          return static_cast< qulonglong >( value );
+        default:
+          return value;
+      }
+    }
+    case Double:
+      return numbers.at( row );
+    default:
+      return QVariant( static_cast< QVariant::Type >( types.at( row ) ) );
+  }
+}
+
+/**
+ * Lowers the nodes of a prepared tree to the instructions of a program.
+ * Each node writes its value to the register it is compiled for, and
+ * the static kind of this value is inferred from the types of the fields
+ * and of the literals.
+ */
+class QgsExpressionBytecode::Compiler
+{
+  public:
+    Compiler( QgsExpressionBytecode &program, const QgsExpressionContext *context )
+      : mProgram( program )
+      , mContext( context )
+    {
+      if ( context && context->hasVariable( QgsExpressionContext::EXPR_FIELDS ) )
+        mFields = qvariant_cast<QgsFields>( context->variable( QgsExpressionContext::EXPR_FIELDS ) );
+    }
+
+    int newRegister()
+    {
+      return mProgram.mRegisterCount++;
+    }
+
+    Kind compile( QgsExpressionNode *node, int target );
+
+  private:
+    int addInstruction( const Instruction &instruction )
+    {
+      mProgram.mInstructions.append( instruction );
+      return mProgram.mInstructions.count() - 1;
+    }
+
+    //! Makes the jump of \a instruction point to the next instruction
+    void patchJump( int instruction )
+    {
+      mProgram.mInstructions[ instruction ].jump = mProgram.mInstructions.count();
+    }
+
+    Kind compileConstant( const QVariant &value, int target );
+    Kind compileColumnRef( QgsExpressionNodeColumnRef *node, int target );
+    Kind compileUnaryOperator( QgsExpressionNodeUnaryOperator *node, int target );
+    Kind compileBinaryOperator( QgsExpressionNodeBinaryOperator *node, int target );
+    Kind compileInOperator( QgsExpressionNodeInOperator *node, int target );
+    Kind compileCondition( QgsExpressionNodeCondition *node, int target );
+    Kind compileFallback( QgsExpressionNode *node, int target );
+
+    static bool isNumber( Kind kind ) { return kind == Integer || kind == Double; }
+
+    QgsExpressionBytecode &mProgram;
+    const QgsExpressionContext *mContext = nullptr;
+    QgsFields mFields;
+};
+
+QgsExpressionBytecode::Kind QgsExpressionBytecode::Compiler::compile( QgsExpressionNode *node, int target )
+{
+  if ( node->hasCachedStaticValue() )
+    return compileConstant( node->cachedStaticValue(), target );
+
+  switch ( node->nodeType() )
+  {
+    case QgsExpressionNode::ntLiteral:
+      return compileConstant( static_cast<QgsExpressionNodeLiteral *>( node )->value(), target );
+    case QgsExpressionNode::ntColumnRef:
+      return compileColumnRef( static_cast<QgsExpressionNodeColumnRef *>( node ), target );
+    case QgsExpressionNode::ntUnaryOperator:
+      return compileUnaryOperator( static_cast<QgsExpressionNodeUnaryOperator *>( node ), target );
+    case QgsExpressionNode::ntBinaryOperator:
+      return compileBinaryOperator( static_cast<QgsExpressionNodeBinaryOperator *>( node ), target );
+    case QgsExpressionNode::ntInOperator:
+      return compileInOperator( static_cast<QgsExpressionNodeInOperator *>( node ), target );
+    case QgsExpressionNode::ntCondition:
+      return compileCondition( static_cast<QgsExpressionNodeCondition *>( node ), target );
+    case QgsExpressionNode::ntFunction:
+    case QgsExpressionNode::ntIndexOperator:
+      break;
+  }
+  return compileFallback( node, target );
+}
+
+QgsExpressionBytecode::Kind QgsExpressionBytecode::Compiler::compileConstant( const QVariant &value, int target )
+{
+  Value constant;
+  constant.setVariant( value );
+  mProgram.mConstants.append( constant );
+
+  Instruction instruction;
+  instruction.opCode = LoadConstant;
+  instruction.dest = target;
+  instruction.a = mProgram.mConstants.count() - 1;
+  addInstruction( instruction );
+  return constant.kind;
+}
+
+QgsExpressionBytecode::Kind QgsExpressionBytecode::Compiler::compileColumnRef( QgsExpressionNodeColumnRef *node, int target )
+{
+  // same lookup as QgsExpressionNodeColumnRef::prepareNode()
+  int index = mFields.lookupField( node->name() );
+  if ( index == -1 && mContext && mContext->hasFeature() )
+    index = mContext->feature().fieldNameIndex( node->name() );
+  if ( index == -1 )
+    return compileFallback( node, target );
+
+  Instruction instruction;
+  instruction.opCode = LoadField;
+  instruction.dest = target;
+  instruction.a = index;
+  instruction.node = node;
+  addInstruction( instruction );
+
+  if ( index >= mFields.count() )
+    return Other;
+
+  switch ( mFields.at( index ).type() )
+  {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+      return Integer;
+    case QVariant::Double:
+      return Double;
+    case QVariant::String:
+      return String;
+    default:
+      return Other;
+  }
+}
+
+QgsExpressionBytecode::Kind QgsExpressionBytecode::Compiler::compileUnaryOperator( QgsExpressionNodeUnaryOperator *node, int target )
+{
+  const int operand = newRegister();
+  const Kind kind = compile( node->operand(), operand );
+
+  Instruction instruction;
+  instruction.opCode = node->op() == QgsExpressionNodeUnaryOperator::uoNot ? Not : Negate;
+  instruction.dest = target;
+  instruction.a = operand;
+  addInstruction( instruction );
+
+  if ( instruction.opCode == Not )
+    return Integer;
+  return isNumber( kind ) ? kind : Other;
+}
+
+QgsExpressionBytecode::Kind QgsExpressionBytecode::Compiler::compileBinaryOperator( QgsExpressionNodeBinaryOperator *node, int target )
+{
+  const QgsExpressionNodeBinaryOperator::BinaryOperator op = node->op();
+  switch ( op )
+  {
+    case QgsExpressionNodeBinaryOperator::boAnd:
+    case QgsExpressionNodeBinaryOperator::boOr:
+    {
+      const int left = newRegister();
+      compile( node->opLeft(), left );
+
+      Instruction shortCircuit;
+      shortCircuit.opCode = ShortCircuit;
+      shortCircuit.dest = target;
+      shortCircuit.a = left;
+      shortCircuit.op = op;
+      const int shortCircuitIndex = addInstruction( shortCircuit );
+
+      const int right = newRegister();
+      compile( node->opRight(), right );
+
+      Instruction logical;
+      logical.opCode = Logical;
+      logical.dest = target;
+      logical.a = left;
+      logical.b = right;
+      logical.op = op;
+      addInstruction( logical );
+
+      patchJump( shortCircuitIndex );
+      return Integer;
+    }
+
+    case QgsExpressionNodeBinaryOperator::boPlus:
+    case QgsExpressionNodeBinaryOperator::boMinus:
+    case QgsExpressionNodeBinaryOperator::boMul:
+    case QgsExpressionNodeBinaryOperator::boDiv:
+    case QgsExpressionNodeBinaryOperator::boIntDiv:
+    case QgsExpressionNodeBinaryOperator::boMod:
+    case QgsExpressionNodeBinaryOperator::boPow:
+    case QgsExpressionNodeBinaryOperator::boEQ:
+    case QgsExpressionNodeBinaryOperator::boNE:
+    case QgsExpressionNodeBinaryOperator::boLE:
+    case QgsExpressionNodeBinaryOperator::boGE:
+    case QgsExpressionNodeBinaryOperator::boLT:
+    case QgsExpressionNodeBinaryOperator::boGT:
+    case QgsExpressionNodeBinaryOperator::boIs:
+    case QgsExpressionNodeBinaryOperator::boIsNot:
+      break;
+
+    case QgsExpressionNodeBinaryOperator::boRegexp:
+    case QgsExpressionNodeBinaryOperator::boLike:
+    case QgsExpressionNodeBinaryOperator::boNotLike:
+    case QgsExpressionNodeBinaryOperator::boILike:
+    case QgsExpressionNodeBinaryOperator::boNotILike:
+    case QgsExpressionNodeBinaryOperator::boConcat:
+      return compileFallback( node, target );
+  }
+
+  const int left = newRegister();
+  const Kind leftKind = compile( node->opLeft(), left );
+  const int right = newRegister();
+  const Kind rightKind = compile( node->opRight(), right );
+  const bool numbers = isNumber( leftKind ) && isNumber( rightKind );
+
+  Instruction instruction;
+  instruction.dest = target;
+  instruction.a = left;
+  instruction.b = right;
+  instruction.op = op;
+
+  switch ( op )
+  {
+    case QgsExpressionNodeBinaryOperator::boIs:
+    case QgsExpressionNodeBinaryOperator::boIsNot:
+      instruction.opCode = Is;
+      addInstruction( instruction );
+      return Integer;
+
+    case QgsExpressionNodeBinaryOperator::boEQ:
+    case QgsExpressionNodeBinaryOperator::boNE:
+    case QgsExpressionNodeBinaryOperator::boLE:
+    case QgsExpressionNodeBinaryOperator::boGE:
+    case QgsExpressionNodeBinaryOperator::boLT:
+    case QgsExpressionNodeBinaryOperator::boGT:
+      if ( numbers )
+        instruction.opCode = CompareNumbers;
+      else if ( leftKind == String && rightKind == String )
+        instruction.opCode = CompareStrings;
+      else
+        instruction.opCode = Compare;
+      addInstruction( instruction );
+      return Integer;
+
+    default:
+      instruction.opCode = numbers ? ArithmeticNumbers : Arithmetic;
+      addInstruction( instruction );
+      break;
+  }
+
+  if ( !numbers )
+    return Other;
+  switch ( op )
+  {
+    case QgsExpressionNodeBinaryOperator::boIntDiv:
+      return Integer;
+    case QgsExpressionNodeBinaryOperator::boDiv:
+    case QgsExpressionNodeBinaryOperator::boPow:
+      return Double;
+    default:
+      return leftKind == Integer && rightKind == Integer ? Integer : Double;
+  }
+}
+
+QgsExpressionBytecode::Kind QgsExpressionBytecode::Compiler::compileInOperator( QgsExpressionNodeInOperator *node, int target )
+{
+  const QList<QgsExpressionNode *> list = node->list()->list();
+  if ( list.isEmpty() )
+    return compileConstant( node->isNotIn() ? TVL_True : TVL_False, target );
+
+  const int value = newRegister();
+  compile( node->node(), value );
+  const int nullFlag = newRegister();
+
+  QList<int> jumps;
+  Instruction start;
+  start.opCode = InStart;
+  start.dest = target;
+  start.a = value;
+  start.b = nullFlag;
+  jumps << addInstruction( start );
+
+  for ( QgsExpressionNode *item : list )
+  {
+    const int itemRegister = newRegister();
+    compile( item, itemRegister );
+
+    Instruction test;
+    test.opCode = InTest;
+    test.dest = target;
+    test.a = value;
+    test.b = itemRegister;
+    test.c = nullFlag;
+    test.op = node->isNotIn();
+    jumps << addInstruction( test );
+  }
+
+  Instruction end;
+  end.opCode = InEnd;
+  end.dest = target;
+  end.a = nullFlag;
+  end.op = node->isNotIn();
+  addInstruction( end );
+
+  for ( int jump : qgis::as_const( jumps ) )
+    patchJump( jump );
+  return Integer;
+}
+
+QgsExpressionBytecode::Kind QgsExpressionBytecode::Compiler::compileCondition( QgsExpressionNodeCondition *node, int target )
+{
+  QList<int> endJumps;
+  QList<Kind> kinds;
+  const QgsExpressionNodeCondition::WhenThenList conditions = node->conditions();
+  for ( QgsExpressionNodeCondition::WhenThen *condition : conditions )
+  {
+    const int when = newRegister();
+    compile( condition->whenExp(), when );
+
+    Instruction skip;
+    skip.opCode = JumpIfNotTrue;
+    skip.a = when;
+    const int skipIndex = addInstruction( skip );
+
+    kinds << compile( condition->thenExp(), target );
+
+    Instruction jump;
+    jump.opCode = Jump;
+    endJumps << addInstruction( jump );
+
+    patchJump( skipIndex );
+  }
+
+  if ( node->elseExp() )
+    kinds << compile( node->elseExp(), target );
+  else
+    compileConstant( QVariant(), target );
+
+  for ( int jump : qgis::as_const( endJumps ) )
+    patchJump( jump );
+
+  // the typed instructions handle NULL values, so only the kinds of the non NULL branches matter
+  Kind kind = Null;
+  for ( Kind branchKind : qgis::as_const( kinds ) )
+  {
+    if ( branchKind == Null || branchKind == kind )
+      continue;
+    if ( kind != Null )
+      return Other;
+    kind = branchKind;
+  }
+  return kind;
+}
+
+QgsExpressionBytecode::Kind QgsExpressionBytecode::Compiler::compileFallback( QgsExpressionNode *node, int target )
+{
+  Instruction instruction;
+  instruction.opCode = EvaluateNode;
+  instruction.dest = target;
+  instruction.node = node;
+  addInstruction( instruction );
+  mProgram.mFallbackCount++;
+  return Other;
+}
+
+std::unique_ptr<QgsExpressionBytecode> QgsExpressionBytecode::compile( QgsExpressionNode *root, const QgsExpressionContext *context )
+{
+  if ( !root )
+    return nullptr;
+
+  std::unique_ptr<QgsExpressionBytecode> program( new QgsExpressionBytecode() );
+  Compiler compiler( *program, context );
+  compiler.compile( root, compiler.newRegister() );
+
+  // a single constant or node is as fast to evaluate with the tree
+  if ( program->mInstructions.count() <= 1 )
+    return nullptr;
+
+  program->mNumeric = program->mFallbackCount == 0;
+  for ( const Value &constant : qgis::as_const( program->mConstants ) )
+  {
+    // NULL strings are concatenated as empty strings, leave them to the rows
+    if ( ( constant.kind == Null && constant.variant.type() == QVariant::String )
+         || ( constant.kind != Null && !constant.isNumber() ) )
+      program->mNumeric = false;
+  }
+
+  return program;
+}
+
+QVariant QgsExpressionBytecode::evaluate( QgsExpression *parent, const QgsExpressionContext *context ) const
+{
+  QVarLengthArray<Value, 32> registers( mRegisterCount );
+
+  // the feature is fetched once, until a node evaluated by the tree possibly changes the context
+  QgsFeature feature;
+  bool featureFetched = false;
+
+  const Instruction *instructions = mInstructions.constData();
+  const int count = mInstructions.count();
+  int pc = 0;
+  while ( pc < count )
+  {
+    const Instruction &instruction = instructions[pc++];
+    switch ( instruction.opCode )
+    {
+      case LoadConstant:
+        registers[instruction.dest] = mConstants.at( instruction.a );
+        break;
+
+      case LoadField:
+        if ( !featureFetched && context )
+        {
+          feature = context->feature();
+          featureFetched = true;
+        }
+        if ( featureFetched && feature.isValid() )
+          registers[instruction.dest].setVariant( feature.attribute( instruction.a ) );
+        else
+          registers[instruction.dest].setVariant( instruction.node->eval( parent, context ) );
+        break;
+
+      case EvaluateNode:
+        registers[instruction.dest].setVariant( instruction.node->eval( parent, context ) );
+        featureFetched = false;
+        break;
+
+      case ArithmeticNumbers:
+      case Arithmetic:
+      {
+        const Value &left = registers[instruction.a];
+        const Value &right = registers[instruction.b];
+        Value &result = registers[instruction.dest];
+        if ( left.isNumber() && right.isNumber() )
+        {
+          switch ( instruction.op )
+          {
+            case QgsExpressionNodeBinaryOperator::boIntDiv:
+              if ( right.number == 0. )
+                result.setNull();
+              else
+                result.setInteger( static_cast< qlonglong >( std::floor( left.number / right.number ) ) );
+              break;
+
+            case QgsExpressionNodeBinaryOperator::boPow:
+              result.setDouble( std::pow( left.number, right.number ) );
+              break;
+
+            case QgsExpressionNodeBinaryOperator::boDiv:
+              if ( right.number == 0. )
+                result.setNull();
+              else
+                result.setDouble( left.number / right.number );
+              break;
+
+            case QgsExpressionNodeBinaryOperator::boMod:
+              if ( left.kind == Integer && right.kind == Integer )
+              {
+                if ( right.integer == 0 )
+                  result.setNull();
+                else
+                  result.setInteger( left.integer % right.integer );
+              }
+              else if ( right.number == 0. )
+                result.setNull();
+              else
+                result.setDouble( std::fmod( left.number, right.number ) );
+              break;
+
+            case QgsExpressionNodeBinaryOperator::boPlus:
+              if ( left.kind == Integer && right.kind == Integer )
+                result.setInteger( left.integer + right.integer );
+              else
+                result.setDouble( left.number + right.number );
+              break;
+
+            case QgsExpressionNodeBinaryOperator::boMinus:
+              if ( left.kind == Integer && right.kind == Integer )
+                result.setInteger( left.integer - right.integer );
+              else
+                result.setDouble( left.number - right.number );
+              break;
+
+            case QgsExpressionNodeBinaryOperator::boMul:
+              if ( left.kind == Integer && right.kind == Integer )
+                result.setInteger( left.integer * right.integer );
+              else
+                result.setDouble( left.number * right.number );
+              break;
+          }
+        }
+        else if ( ( left.kind == Null || right.kind == Null )
+                  && instruction.op != QgsExpressionNodeBinaryOperator::boIntDiv
+                  // NULL strings are concatenated as empty strings
+                  && ( instruction.op != QgsExpressionNodeBinaryOperator::boPlus
+                       || left.toVariant().type() != QVariant::String || right.toVariant().type() != QVariant::String ) )
+        {
+          result.setNull();
+        }
+        else
+        {
+          result.setVariant( evaluateBinary( instruction.op, left, right, parent, context ) );
+        }
+        break;
+      }
+
+      case CompareNumbers:
+      case CompareStrings:
+      case Compare:
+      {
+        const Value &left = registers[instruction.a];
+        const Value &right = registers[instruction.b];
+        Value &result = registers[instruction.dest];
+        if ( left.kind == Null || right.kind == Null )
+          result.setNull();
+        else if ( left.isNumber() && right.isNumber() )
+          result.setLogical( compareDiff( instruction.op, left.number - right.number ) ? QgsExpressionUtils::True : QgsExpressionUtils::False );
+        else if ( left.kind == String && right.kind == String )
+          result.setLogical( compareDiff( instruction.op, QString::compare( left.string, right.string ) ) ? QgsExpressionUtils::True : QgsExpressionUtils::False );
+        else
+          result.setVariant( evaluateBinary( instruction.op, left, right, parent, context ) );
+        break;
+      }
+
+      case Is:
+      {
+        const Value &left = registers[instruction.a];
+        const Value &right = registers[instruction.b];
+        Value &result = registers[instruction.dest];
+        const bool is = instruction.op == QgsExpressionNodeBinaryOperator::boIs;
+        if ( left.kind == Null || right.kind == Null )
+          result.setLogical( ( left.kind == right.kind ) == is ? QgsExpressionUtils::True : QgsExpressionUtils::False );
+        else if ( left.isNumber() && right.isNumber() )
+          result.setLogical( qgsDoubleNear( left.number, right.number ) == is ? QgsExpressionUtils::True : QgsExpressionUtils::False );
+        else if ( left.kind == String && right.kind == String )
+          result.setLogical( ( left.string == right.string ) == is ? QgsExpressionUtils::True : QgsExpressionUtils::False );
+        else
+          result.setVariant( evaluateBinary( instruction.op, left, right, parent, context ) );
+        break;
+      }
+
+      case Not:
+        registers[instruction.dest].setLogical( QgsExpressionUtils::NOT[ logicalValue( registers[instruction.a], parent ) ] );
+        break;
+
+      case Negate:
+      {
+        const Value &operand = registers[instruction.a];
+        Value &result = registers[instruction.dest];
+        if ( operand.kind == Integer )
+        {
+          result.setInteger( -operand.integer );
+        }
+        else if ( operand.kind == Double )
+        {
+          result.setDouble( -operand.number );
+        }
+        else
+        {
+          QgsExpressionNodeUnaryOperator node( QgsExpressionNodeUnaryOperator::uoMinus, new QgsExpressionNodeLiteral( operand.toVariant() ) );
+          result.setVariant( node.eval( parent, context ) );
+        }
+        break;
+      }
+
+      case ShortCircuit:
+      {
+        const int tvl = logicalValue( registers[instruction.a], parent );
+        if ( instruction.op == QgsExpressionNodeBinaryOperator::boAnd && tvl == QgsExpressionUtils::False )
+        {
+          registers[instruction.dest].setLogical( QgsExpressionUtils::False );
+          pc = instruction.jump;
+        }
+        else if ( instruction.op == QgsExpressionNodeBinaryOperator::boOr && tvl == QgsExpressionUtils::True )
+        {
+          registers[instruction.dest].setLogical( QgsExpressionUtils::True );
+          pc = instruction.jump;
+        }
+        break;
+      }
+
+      case Logical:
+      {
+        const int left = logicalValue( registers[instruction.a], parent );
+        const int right = logicalValue( registers[instruction.b], parent );
+        if ( instruction.op == QgsExpressionNodeBinaryOperator::boAnd )
+          registers[instruction.dest].setLogical( QgsExpressionUtils::AND[left][right] );
+        else
+          registers[instruction.dest].setLogical( QgsExpressionUtils::OR[left][right] );
+        break;
+      }
+
+      case JumpIfNotTrue:
+        if ( logicalValue( registers[instruction.a], parent ) != QgsExpressionUtils::True )
+          pc = instruction.jump;
+        break;
+
+      case Jump:
+        pc = instruction.jump;
+        break;
+
+      case InStart:
+        if ( registers[instruction.a].kind == Null )
+        {
+          registers[instruction.dest].setNull();
+          pc = instruction.jump;
+        }
+        else
+        {
+          registers[instruction.b].setInteger( 0 );
+        }
+        break;
+
+      case InTest:
+      {
+        const Value &item = registers[instruction.b];
+        if ( item.kind == Null )
+        {
+          registers[instruction.c].setInteger( 1 );
+        }
+        else if ( inEquals( registers[instruction.a], item, parent ) )
+        {
+          registers[instruction.dest].setLogical( instruction.op ? QgsExpressionUtils::False : QgsExpressionUtils::True );
+          pc = instruction.jump;
+        }
+        break;
+      }
+
+      case InEnd:
+        if ( registers[instruction.a].integer )
+          registers[instruction.dest].setNull();
+        else
+          registers[instruction.dest].setLogical( instruction.op ? QgsExpressionUtils::True : QgsExpressionUtils::False );
+        break;
+    }
+
+    // as the tree, give up on the first error
+    if ( parent->hasEvalError() )
+      return QVariant();
+  }
+
+  return registers[0].toVariant();
+}
+
+QVariant QgsExpressionBytecode::evaluateBinary( int op, const Value &left, const Value &right, QgsExpression *parent, const QgsExpressionContext *context )
+{
+  QgsExpressionNodeBinaryOperator node( static_cast< QgsExpressionNodeBinaryOperator::BinaryOperator >( op ),
+                                        new QgsExpressionNodeLiteral( left.toVariant() ),
+                                        new QgsExpressionNodeLiteral( right.toVariant() ) );
+  return node.eval( parent, context );
+}
+
+bool QgsExpressionBytecode::compareDiff( int op, double diff )
+{
+  // same as QgsExpressionNodeBinaryOperator::compare()
+  switch ( op )
+  {
+    case QgsExpressionNodeBinaryOperator::boEQ:
+      return qgsDoubleNear( diff, 0.0 );
+    case QgsExpressionNodeBinaryOperator::boNE:
+      return !qgsDoubleNear( diff, 0.0 );
+    case QgsExpressionNodeBinaryOperator::boLT:
+      return diff < 0;
+    case QgsExpressionNodeBinaryOperator::boGT:
+      return diff > 0;
+    case QgsExpressionNodeBinaryOperator::boLE:
+      return diff <= 0;
+    case QgsExpressionNodeBinaryOperator::boGE:
+      return diff >= 0;
+    default:
+      Q_ASSERT( false );
+      return false;
+  }
+}
+
+int QgsExpressionBytecode::logicalValue( const Value &value, QgsExpression *parent )
+{
+  switch ( value.kind )
+  {
+    case Null:
+      return QgsExpressionUtils::Unknown;
+    case Integer:
+      return value.number != 0 ? QgsExpressionUtils::True : QgsExpressionUtils::False;
+    case Double:
+      return !qgsDoubleNear( value.number, 0.0 ) ? QgsExpressionUtils::True : QgsExpressionUtils::False;
+    case String:
+    case Other:
+      break;
+  }
+  return QgsExpressionUtils::getTVLValue( value.toVariant(), parent );
+}
+
+bool QgsExpressionBytecode::inEquals( const Value &left, const Value &right, QgsExpression *parent )
+{
+  if ( left.isNumber() && right.isNumber() )
+    return qgsDoubleNear( left.number, right.number );
+  if ( left.kind == String && right.kind == String )
+    return left.string == right.string;
+
+  // same as QgsExpressionNodeInOperator::evalNode()
+  const QVariant v1 = left.toVariant();
+  const QVariant v2 = right.toVariant();
+  if ( ( v1.type() != QVariant::String || v2.type() != QVariant::String ) &&
+       QgsExpressionUtils::isDoubleSafe( v1 ) && QgsExpressionUtils::isDoubleSafe( v2 ) )
+  {
+    const double f1 = QgsExpressionUtils::getDoubleValue( v1, parent );
+    if ( parent->hasEvalError() )
+      return false;
+    const double f2 = QgsExpressionUtils::getDoubleValue( v2, parent );
+    if ( parent->hasEvalError() )
+      return false;
+    return qgsDoubleNear( f1, f2 );
+  }
+  return QString::compare( QgsExpressionUtils::getStringValue( v1, parent ), QgsExpressionUtils::getStringValue( v2, parent ) ) == 0;
+}
+
+bool QgsExpressionBytecode::canEvaluateColumns( const QgsFeatureBatch &batch ) const
+{
+  if ( !mNumeric )
+    return false;
+
+  const QgsFields fields = batch.fields();
+  for ( const Instruction &instruction : mInstructions )
+  {
+    if ( instruction.opCode != LoadField )
+      continue;
+
+    const int column = batch.column( instruction.a );
+    if ( column < 0 || batch.columnType( column ) == QgsFeatureBatch::Variant
+         || fields.at( instruction.a ).type() == QVariant::Bool )
+      return false;
+  }
+  return true;
+}
+
+bool QgsExpressionBytecode::evaluateBatch( const QgsFeatureBatch &batch, QVector<QVariant> &values, QBitArray &remainingRows ) const
+{
+  const int size = batch.size();
+  values.resize( size );
+  remainingRows = QBitArray( size, true );
+  if ( !canEvaluateColumns( batch ) )
+    return false;
+  if ( size == 0 )
+    return true;
+
+  QVector<Column> registers( mRegisterCount );
+  for ( Column &column : registers )
+    column.resize( size );
+
+  // Each instruction is executed for the rows which are active at this point of
+  // the program. As all the jumps are forward, the rows taking a jump wait for
+  // its target in pending, and the rows left to the tree simply stop.
+  const int count = mInstructions.count();
+  QVector<char> active( size, 1 );
+  QVector<QVector<char>> pending( count );
+  QVector<char> fallback( size, 0 );
+
+  auto jump = [&]( int row, int target )
+  {
+    active[row] = 0;
+    if ( target >= count )
+      return;
+    if ( pending[target].isEmpty() )
+      pending[target].fill( 0, size );
+    pending[target][row] = 1;
+  };
+
+  auto leaveToTree = [&]( int row )
+  {
+    active[row] = 0;
+    fallback[row] = 1;
+  };
+
+  const QgsFields fields = batch.fields();
+  for ( int pc = 0; pc < count; ++pc )
+  {
+    if ( !pending.at( pc ).isEmpty() )
+    {
+      const char *waiting = pending.at( pc ).constData();
+      char *rows = active.data();
+      for ( int row = 0; row < size; ++row )
+        rows[row] |= waiting[row];
+      pending[pc].clear();
+    }
+
+    const Instruction &instruction = mInstructions.at( pc );
+    const char *rows = active.constData();
+    switch ( instruction.opCode )
+    {
+      case LoadConstant:
+      {
+        const Value &constant = mConstants.at( instruction.a );
+        Column &result = registers[instruction.dest];
+        for ( int row = 0; row < size; ++row )
+        {
+          if ( !rows[row] )
+            continue;
+          if ( constant.kind == Integer )
+            result.setInteger( row, constant.integer, constant.number, constant.variant.type() );
+          else if ( constant.kind == Double )
+            result.setDouble( row, constant.number );
+          else
+            result.setNull( row, constant.variant.type() );
+        }
+        break;
+      }
+
+      case LoadField:
+      {
+        const int column = batch.column( instruction.a );
+        const QVariant::Type fieldType = fields.at( instruction.a ).type();
+        const QBitArray &validity = batch.validity( column );
+        Column &result = registers[instruction.dest];
+        if ( batch.columnType( column ) == QgsFeatureBatch::Double )
+        {
+          const double *doubles = batch.doubleColumn( column ).constData();
+          for ( int row = 0; row < size; ++row )
+          {
+            if ( !rows[row] )
+              continue;
+            if ( !validity.testBit( row ) )
+              result.setNull( row, fieldType );
+            else if ( !result.setDouble( row, doubles[row] ) )
+              leaveToTree( row );
+          }
+        }
+        else
+        {
+          // same conversions as QgsFeatureBatch::value() then QVariant::toLongLong() and QVariant::toDouble()
+          const qlonglong *integers = batch.integerColumn( column ).constData();
+          for ( int row = 0; row < size; ++row )
+          {
+            if ( !rows[row] )
+              continue;
+            if ( !validity.testBit( row ) )
+            {
+              result.setNull( row, fieldType );
+              continue;
+            }
+            const qlonglong value = integers[row];
+            switch ( fieldType )
+            {
+              case QVariant::Int:
+                result.setInteger( row, static_cast< int >( value ), static_cast< int >( value ), fieldType );
+                break;
+              case QVariant::UInt:
+                result.setInteger( row, static_cast< uint >( value ), static_cast< uint >( value ), fieldType );
+                break;
+              case QVariant::ULongLong:
+                result.setInteger( row, value, static_cast< double >( static_cast< qulonglong >( value ) ), fieldType );
+                break;
+              default:
+                result.setInteger( row, value, static_cast< double >( value ), QVariant::LongLong );
+                break;
+            }
+          }
+        }
+        break;
+      }
+
+      case EvaluateNode:
+        // not part of a numeric program
+        Q_ASSERT( false );
+        break;
+
+      case ArithmeticNumbers:
+      case Arithmetic:
+      {
+        const Column &left = registers.at( instruction.a );
+        const Column &right = registers.at( instruction.b );
+        Column &result = registers[instruction.dest];
+        const quint8 *leftKinds = left.kinds.constData();
+        const quint8 *rightKinds = right.kinds.constData();
+        const qlonglong *leftIntegers = left.integers.constData();
+        const qlonglong *rightIntegers = right.integers.constData();
+        const double *leftNumbers = left.numbers.constData();
+        const double *rightNumbers = right.numbers.constData();
+        for ( int row = 0; row < size; ++row )
+        {
+          if ( !rows[row] )
+            continue;
+
+          if ( leftKinds[row] == Null || rightKinds[row] == Null )
+          {
+            // the tree fails on NULL integer divisions
+            if ( instruction.op == QgsExpressionNodeBinaryOperator::boIntDiv )
+              leaveToTree( row );
+            else
+              result.setNull( row );
+            continue;
+          }
+
+          const bool integers = leftKinds[row] == Integer && rightKinds[row] == Integer;
+          const double l = leftNumbers[row];
+          const double r = rightNumbers[row];
+          bool valid = true;
+          switch ( instruction.op )
+          {
+            case QgsExpressionNodeBinaryOperator::boIntDiv:
+              if ( r == 0. )
+                result.setNull( row );
+              else
+              {
+                const qlonglong value = static_cast< qlonglong >( std::floor( l / r ) );
+                result.setInteger( row, value, static_cast< double >( value ) );
+              }
+              break;
+
+            case QgsExpressionNodeBinaryOperator::boPow:
+              valid = result.setDouble( row, std::pow( l, r ) );
+              break;
+
+            case QgsExpressionNodeBinaryOperator::boDiv:
+              if ( r == 0. )
+                result.setNull( row );
+              else
+                valid = result.setDouble( row, l / r );
+              break;
+
+            case QgsExpressionNodeBinaryOperator::boMod:
+              if ( integers )
+              {
+                if ( rightIntegers[row] == 0 )
+                  result.setNull( row );
+                else
+                {
+                  const qlonglong value = leftIntegers[row] % rightIntegers[row];
+                  result.setInteger( row, value, static_cast< double >( value ) );
+                }
+              }
+              else if ( r == 0. )
+                result.setNull( row );
+              else
+                valid = result.setDouble( row, std::fmod( l, r ) );
+              break;
+
+            case QgsExpressionNodeBinaryOperator::boPlus:
+            case QgsExpressionNodeBinaryOperator::boMinus:
+            case QgsExpressionNodeBinaryOperator::boMul:
+              if ( integers )
+              {
+                qlonglong value = 0;
+                if ( instruction.op == QgsExpressionNodeBinaryOperator::boPlus )
+                  value = leftIntegers[row] + rightIntegers[row];
+                else if ( instruction.op == QgsExpressionNodeBinaryOperator::boMinus )
+                  value = leftIntegers[row] - rightIntegers[row];
+                else
+                  value = leftIntegers[row] * rightIntegers[row];
+                result.setInteger( row, value, static_cast< double >( value ) );
+              }
+              else if ( instruction.op == QgsExpressionNodeBinaryOperator::boPlus )
+                valid = result.setDouble( row, l + r );
+              else if ( instruction.op == QgsExpressionNodeBinaryOperator::boMinus )
+                valid = result.setDouble( row, l - r );
+              else
+                valid = result.setDouble( row, l * r );
+              break;
+          }
+
+          // infinity and NaN are returned as variants by the tree
+          if ( !valid )
+            leaveToTree( row );
+        }
+        break;
+      }
+
+      case CompareNumbers:
+      case CompareStrings:
+      case Compare:
+      {
+        const Column &left = registers.at( instruction.a );
+        const Column &right = registers.at( instruction.b );
+        Column &result = registers[instruction.dest];
+        const quint8 *leftKinds = left.kinds.constData();
+        const quint8 *rightKinds = right.kinds.constData();
+        const double *leftNumbers = left.numbers.constData();
+        const double *rightNumbers = right.numbers.constData();
+        for ( int row = 0; row < size; ++row )
+        {
+          if ( !rows[row] )
+            continue;
+          if ( leftKinds[row] == Null || rightKinds[row] == Null )
+            result.setNull( row );
+          else
+            result.setLogical( row, compareDiff( instruction.op, leftNumbers[row] - rightNumbers[row] ) ? QgsExpressionUtils::True : QgsExpressionUtils::False );
+        }
+        break;
+      }
+
+      case Is:
+      {
+        const Column &left = registers.at( instruction.a );
+        const Column &right = registers.at( instruction.b );
+        Column &result = registers[instruction.dest];
+        const bool is = instruction.op == QgsExpressionNodeBinaryOperator::boIs;
+        for ( int row = 0; row < size; ++row )
+        {
+          if ( !rows[row] )
+            continue;
+          bool equal = false;
+          if ( left.kinds.at( row ) == Null || right.kinds.at( row ) == Null )
+            equal = left.kinds.at( row ) == right.kinds.at( row );
+          else
+            equal = qgsDoubleNear( left.numbers.at( row ), right.numbers.at( row ) );
+          result.setLogical( row, equal == is ? QgsExpressionUtils::True : QgsExpressionUtils::False );
+        }
+        break;
+      }
+
+      case Not:
+      {
+        const Column &operand = registers.at( instruction.a );
+        Column &result = registers[instruction.dest];
+        for ( int row = 0; row < size; ++row )
+        {
+          if ( rows[row] )
+            result.setLogical( row, QgsExpressionUtils::NOT[ operand.logicalValue( row ) ] );
+        }
+        break;
+      }
+
+      case Negate:
+      {
+        const Column &operand = registers.at( instruction.a );
+        Column &result = registers[instruction.dest];
+        for ( int row = 0; row < size; ++row )
+        {
+          if ( !rows[row] )
+            continue;
+          switch ( operand.kinds.at( row ) )
+          {
+            case Integer:
+              result.setInteger( row, -operand.integers.at( row ), static_cast< double >( -operand.integers.at( row ) ) );
+              break;
+            case Double:
+              result.setDouble( row, -operand.numbers.at( row ) );
+              break;
+            default:
+              // the tree fails on NULL values depending on their type
+              leaveToTree( row );
+              break;
+          }
+        }
+        break;
+      }
+
+      case ShortCircuit:
+      {
+        const Column &operand = registers.at( instruction.a );
+        Column &result = registers[instruction.dest];
+        const int shortCircuitValue = instruction.op == QgsExpressionNodeBinaryOperator::boAnd ? QgsExpressionUtils::False : QgsExpressionUtils::True;
+        for ( int row = 0; row < size; ++row )
+        {
+          if ( rows[row] && operand.logicalValue( row ) == shortCircuitValue )
+          {
+            result.setLogical( row, shortCircuitValue );
+            jump( row, instruction.jump );
+          }
+        }
+        break;
+      }
+
+      case Logical:
+      {
+        const Column &left = registers.at( instruction.a );
+        const Column &right = registers.at( instruction.b );
+        Column &result = registers[instruction.dest];
+        const bool isAnd = instruction.op == QgsExpressionNodeBinaryOperator::boAnd;
+        for ( int row = 0; row < size; ++row )
+        {
+          if ( !rows[row] )
+            continue;
+          const int l = left.logicalValue( row );
+          const int r = right.logicalValue( row );
+          result.setLogical( row, isAnd ? QgsExpressionUtils::AND[l][r] : QgsExpressionUtils::OR[l][r] );
+        }
+        break;
+      }
+
+      case JumpIfNotTrue:
+      {
+        const Column &condition = registers.at( instruction.a );
+        for ( int row = 0; row < size; ++row )
+        {
+          if ( rows[row] && condition.logicalValue( row ) != QgsExpressionUtils::True )
+            jump( row, instruction.jump );
+        }
+        break;
+      }
+
+      case Jump:
+        for ( int row = 0; row < size; ++row )
+        {
+          if ( rows[row] )
+            jump( row, instruction.jump );
+        }
+        break;
+
+      case InStart:
+      {
+        const Column &value = registers.at( instruction.a );
+        Column &nullFlag = registers[instruction.b];
+        Column &result = registers[instruction.dest];
+        for ( int row = 0; row < size; ++row )
+        {
+          if ( !rows[row] )
+            continue;
+          if ( value.kinds.at( row ) == Null )
+          {
+            result.setNull( row );
+            jump( row, instruction.jump );
+          }
+          else
+          {
+            nullFlag.setInteger( row, 0, 0. );
+          }
+        }
+        break;
+      }
+
+      case InTest:
+      {
+        const Column &value = registers.at( instruction.a );
+        const Column &item = registers.at( instruction.b );
+        Column &nullFlag = registers[instruction.c];
+        Column &result = registers[instruction.dest];
+        for ( int row = 0; row < size; ++row )
+        {
+          if ( !rows[row] )
+            continue;
+          if ( item.kinds.at( row ) == Null )
+          {
+            nullFlag.setInteger( row, 1, 1. );
+          }
+          else if ( qgsDoubleNear( value.numbers.at( row ), item.numbers.at( row ) ) )
+          {
+            result.setLogical( row, instruction.op ? QgsExpressionUtils::False : QgsExpressionUtils::True );
+            jump( row, instruction.jump );
+          }
+        }
+        break;
+      }
+
+      case InEnd:
+      {
+        const Column &nullFlag = registers.at( instruction.a );
+        Column &result = registers[instruction.dest];
+        for ( int row = 0; row < size; ++row )
+        {
+          if ( !rows[row] )
+            continue;
+          if ( nullFlag.integers.at( row ) )
+            result.setNull( row );
+          else
+            result.setLogical( row, instruction.op ? QgsExpressionUtils::True : QgsExpressionUtils::False );
+        }
+        break;
+      }
+    }
+  }
+
+  const Column &result = registers.at( 0 );
+  for ( int row = 0; row < size; ++row )
+  {
+    if ( fallback.at( row ) )
+      continue;
+    values[row] = result.toVariant( row );
+    remainingRows.clearBit( row );
+  }
+  return true;
+}
+
+///@endcond
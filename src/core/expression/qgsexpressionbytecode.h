@@ -0,0 +1,208 @@
+/***************************************************************************
+                               qgsexpressionbytecode.h
+                             -------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSEXPRESSIONBYTECODE_H
+#define QGSEXPRESSIONBYTECODE_H
+
+#define SIP_NO_FILE
+
+#include "qgis_core.h"
+#include "qgsexpressionnodeimpl.h"
+
+#include <QBitArray>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+#include <memory>
+
+class QgsExpression;
+class QgsExpressionContext;
+class QgsFeatureBatch;
+
+///@cond PRIVATE
+
+/**
+ * \ingroup core
+ * A prepared expression tree lowered to a flat program for a register machine.
+ *
+ * Operators, CASE conditions, field references and static values are
+ * compiled to instructions working on unboxed numbers and strings, chosen
+ * from the types of the fields and literals. The other nodes, e.g. function
+ * calls, are evaluated by the tree itself. Whenever a value does not have the
+ * type the instruction is specialized for, the instruction falls back to the
+ * semantics of the tree, so that the results and evaluation errors are always
+ * the same as the ones of QgsExpressionNode::eval().
+ *
+ * Programs made of numeric operations only can also be evaluated by columns
+ * for a whole QgsFeatureBatch, see evaluateBatch().
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.16
+ */
+class CORE_EXPORT QgsExpressionBytecode
+{
+  public:
+
+    /**
+     * Compiles the tree under \a root, which must have been prepared with \a context.
+     * Returns NULLPTR if none of the nodes of the tree can be lowered, in which
+     * case the tree should be evaluated directly.
+     */
+    static std::unique_ptr<QgsExpressionBytecode> compile( QgsExpressionNode *root, const QgsExpressionContext *context );
+
+    /**
+     * Evaluates the program for \a context, errors are reported to \a parent.
+     */
+    QVariant evaluate( QgsExpression *parent, const QgsExpressionContext *context ) const;
+
+    /**
+     * Evaluates the program by columns for all the features of \a batch, and stores
+     * the value of each feature in \a values.
+     *
+     * The rows which cannot be evaluated by columns, e.g. because a value is not a
+     * finite number, keep their bit set in \a remainingRows and must be evaluated
+     * one by one with evaluate().
+     *
+     * Returns FALSE if the program cannot be evaluated by columns for this batch,
+     * i.e. it uses a node evaluated by the tree, a value which is not a number or
+     * a field which is not stored as numbers in the batch. All the rows are then
+     * left in \a remainingRows.
+     */
+    bool evaluateBatch( const QgsFeatureBatch &batch, QVector<QVariant> &values, QBitArray &remainingRows ) const;
+
+    //! Returns the number of instructions of the program
+    int instructionCount() const { return mInstructions.count(); }
+
+    //! Returns the number of nodes evaluated by the tree rather than by the program
+    int fallbackCount() const { return mFallbackCount; }
+
+    //! Returns TRUE if the program is made of numeric operations only, see evaluateBatch()
+    bool isNumeric() const { return mNumeric; }
+
+  private:
+
+    //! Kind of value held by a register
+    enum Kind
+    {
+      Null,
+      Integer,
+      Double,
+      String,
+      Other,
+    };
+
+    struct Value
+    {
+      Kind kind = Null;
+      //! TRUE if the value came from a variant, kept to return it unchanged
+      bool boxed = false;
+      //! Type of the variant an integer computed by the program is returned as
+      QVariant::Type integerType = QVariant::LongLong;
+      qlonglong integer = 0;
+      //! Value of integers and doubles as a double
+      double number = 0;
+      QString string;
+      QVariant variant;
+
+      void setVariant( const QVariant &value );
+      void setNull();
+      void setInteger( qlonglong value, QVariant::Type type = QVariant::LongLong );
+      void setDouble( double value );
+      void setLogical( int tvl );
+      QVariant toVariant() const;
+      bool isNumber() const { return kind == Integer || kind == Double; }
+    };
+
+    enum OpCode
+    {
+      LoadConstant, //!< dest = constants[a]
+      LoadField, //!< dest = attribute a of the feature, or the column reference node evaluated by the tree without feature
+      EvaluateNode, //!< dest = node evaluated by the tree
+      ArithmeticNumbers, //!< dest = a op b, a and b are expected to be numbers
+      Arithmetic, //!< dest = a op b
+      CompareNumbers, //!< dest = a op b, a and b are expected to be numbers
+      CompareStrings, //!< dest = a op b, a and b are expected to be strings
+      Compare, //!< dest = a op b
+      Is, //!< dest = a IS b or a IS NOT b
+      Not, //!< dest = NOT a
+      Negate, //!< dest = -a
+      ShortCircuit, //!< if a AND / OR ... is known from a alone, dest = result and jump
+      Logical, //!< dest = a AND / OR b
+      JumpIfNotTrue, //!< jump unless a is true
+      Jump, //!< jump
+      InStart, //!< if a is NULL, dest = NULL and jump, otherwise clear the NULL flag b
+      InTest, //!< if a equals b, dest = result and jump, if b is NULL set the NULL flag c
+      InEnd, //!< dest = result of a IN list which does not contain a, from the NULL flag a
+    };
+
+    struct Instruction
+    {
+      OpCode opCode = Jump;
+      int dest = -1;
+      int a = -1;
+      int b = -1;
+      int c = -1;
+      //! Target of the jump
+      int jump = -1;
+      //! Binary operator, for IN and NOT IN whether the operator is NOT IN
+      int op = 0;
+      //! Node evaluated by the tree
+      QgsExpressionNode *node = nullptr;
+    };
+
+    //! Values of a register for all the rows of a batch, only numbers and NULL values
+    struct Column
+    {
+      //! Kind of each value, Null, Integer or Double
+      QVector<quint8> kinds;
+      //! Type of the variant each value is returned as, which is also the type of a NULL value
+      QVector<int> types;
+      QVector<qlonglong> integers;
+      //! Value of integers and doubles as a double
+      QVector<double> numbers;
+
+      void resize( int size );
+      void setNull( int row, int type = QVariant::Invalid );
+      void setInteger( int row, qlonglong value, double number, int type = QVariant::LongLong );
+      //! Returns FALSE if \a value is not a finite number, which must be evaluated as a variant
+      bool setDouble( int row, double value );
+      void setLogical( int row, int tvl );
+      int logicalValue( int row ) const;
+      QVariant toVariant( int row ) const;
+    };
+
+    class Compiler;
+
+    QgsExpressionBytecode() = default;
+
+    static QVariant evaluateBinary( int op, const Value &left, const Value &right, QgsExpression *parent, const QgsExpressionContext *context );
+    static bool compareDiff( int op, double diff );
+    static int logicalValue( const Value &value, QgsExpression *parent );
+    static bool inEquals( const Value &left, const Value &right, QgsExpression *parent );
+
+    //! Returns TRUE if the program can be evaluated by columns for \a batch
+    bool canEvaluateColumns( const QgsFeatureBatch &batch ) const;
+
+    QVector<Instruction> mInstructions;
+    QVector<Value> mConstants;
+    int mRegisterCount = 0;
+    int mFallbackCount = 0;
+    //! TRUE if the program only works on numbers and NULL values, so that it can be evaluated by columns
+    bool mNumeric = false;
+};
+
+///@endcond
+
+#endif // QGSEXPRESSIONBYTECODE_H
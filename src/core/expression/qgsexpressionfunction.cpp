@@ -564,6 +564,307 @@ static QVariant fcnMin( const QVariantList &values, const QgsExpressionContext *
   return result;
 }
 
+/**
+ * Returns the key of a value for the grouped aggregates, such that two values with
+ * keys are equal with the "=" operator if and only if their keys are equal. Returns
+ * FALSE if the value cannot be compared by key, and sets a null key for NULL values.
+ */
+static bool aggregateGroupKey( const QVariant &value, QString &key )
+{
+  key = QString();
+  if ( value.isNull() )
+    return true;
+
+  switch ( value.type() )
+  {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+    case QVariant::Double:
+    {
+      // numbers are compared as doubles, with a tolerance: only integers which are exact as doubles can be keys
+      const double number = value.toDouble();
+      if ( std::floor( number ) != number || std::fabs( number ) > 9007199254740992.0 )
+        return false;
+      key = QStringLiteral( "n%1" ).arg( static_cast< qlonglong >( number ) );
+      return true;
+    }
+
+    case QVariant::String:
+      key = QStringLiteral( "s" ) + value.toString();
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+/**
+ * Calculates an aggregate of \a layer for each value of \a groupBy, as a map holding the
+ * aggregate by group key, the aggregate over no feature and whether the group values were
+ * numbers or strings. Returns an empty map if the groups cannot be calculated.
+ */
+static QVariantMap calculateGroupedAggregate( QgsVectorLayer *layer, QgsAggregateCalculator::Aggregate aggregate, const QString &subExpression,
+    const QString &groupBy, const QgsAggregateCalculator::AggregateParameters &parameters, const QgsExpressionContext *context )
+{
+  bool valid = true;
+  bool numbers = false;
+  bool strings = false;
+  auto groupKey = [&]( const QVariant & value )
+  {
+    QString key;
+    if ( !aggregateGroupKey( value, key ) )
+      valid = false;
+    else if ( key.startsWith( 'n' ) )
+      numbers = true;
+    else if ( !key.isNull() )
+      strings = true;
+    return key;
+  };
+
+  QgsAggregateCalculator calculator( layer );
+  calculator.setParameters( parameters );
+  QgsExpressionContext subContext( *context );
+  QVariant emptyResult;
+  bool ok = false;
+  const QVariantHash results = calculator.calculateGrouped( aggregate, subExpression, groupBy, groupKey, &subContext, &emptyResult, &ok );
+  if ( !ok || !valid )
+    return QVariantMap();
+
+  QVariantMap grouped;
+  grouped.insert( QStringLiteral( "results" ), results );
+  grouped.insert( QStringLiteral( "empty" ), emptyResult );
+  grouped.insert( QStringLiteral( "numbers" ), numbers );
+  grouped.insert( QStringLiteral( "strings" ), strings );
+  return grouped;
+}
+
+/**
+ * Looks up the aggregate of the features whose group equals \a value in \a grouped,
+ * calculated by calculateGroupedAggregate(). Returns FALSE if \a value cannot be looked up.
+ */
+static bool groupedAggregateValue( const QVariantMap &grouped, const QVariant &value, QVariant &result )
+{
+  if ( grouped.isEmpty() )
+    return false;
+
+  QString key;
+  if ( !aggregateGroupKey( value, key ) )
+    return false;
+
+  // NULL is not equal to any group
+  if ( key.isNull() )
+  {
+    result = grouped.value( QStringLiteral( "empty" ) );
+    return true;
+  }
+
+  // strings and numbers are compared as numbers when the strings are numbers
+  if ( grouped.value( key.startsWith( 'n' ) ? QStringLiteral( "strings" ) : QStringLiteral( "numbers" ) ).toBool() )
+    return false;
+
+  const QVariantHash results = grouped.value( QStringLiteral( "results" ) ).toHash();
+  result = results.value( key, grouped.value( QStringLiteral( "empty" ) ) );
+  return true;
+}
+
+static bool dependsOnParent( const QgsExpressionNode *node )
+{
+  const QSet<QString> variables = node->referencedVariables();
+  return variables.contains( QStringLiteral( "parent" ) ) || variables.contains( QString() );
+}
+
+//! Returns TRUE if \a node only depends on variables, e.g. attribute(@parent, 'id'), and not on the current feature
+static bool isVariableValue( const QgsExpressionNode *node )
+{
+  switch ( node->nodeType() )
+  {
+    case QgsExpressionNode::ntLiteral:
+      return true;
+
+    case QgsExpressionNode::ntUnaryOperator:
+      return isVariableValue( static_cast< const QgsExpressionNodeUnaryOperator * >( node )->operand() );
+
+    case QgsExpressionNode::ntBinaryOperator:
+    {
+      const QgsExpressionNodeBinaryOperator *binary = static_cast< const QgsExpressionNodeBinaryOperator * >( node );
+      return isVariableValue( binary->opLeft() ) && isVariableValue( binary->opRight() );
+    }
+
+    case QgsExpressionNode::ntIndexOperator:
+    {
+      const QgsExpressionNodeIndexOperator *index = static_cast< const QgsExpressionNodeIndexOperator * >( node );
+      return isVariableValue( index->container() ) && isVariableValue( index->index() );
+    }
+
+    case QgsExpressionNode::ntFunction:
+    {
+      const QgsExpressionNodeFunction *function = static_cast< const QgsExpressionNodeFunction * >( node );
+      const QString name = QgsExpression::Functions()[ function->fnIndex() ]->name();
+      const QgsExpressionNode::NodeList *args = function->args();
+      // attribute() with a single argument reads the current feature
+      if ( !( name == QLatin1String( "var" ) || ( name == QLatin1String( "attribute" ) && args && args->count() == 2 ) ) )
+        return false;
+      if ( args )
+      {
+        const QList< QgsExpressionNode * > nodes = args->list();
+        for ( const QgsExpressionNode *arg : nodes )
+        {
+          if ( !isVariableValue( arg ) )
+            return false;
+        }
+      }
+      return true;
+    }
+
+    case QgsExpressionNode::ntColumnRef:
+    case QgsExpressionNode::ntInOperator:
+    case QgsExpressionNode::ntCondition:
+      break;
+  }
+  return false;
+}
+
+/**
+ * Splits an aggregate \a filter of the form inner = outer AND ..., where outer only depends
+ * on the parent feature and the other parts do not depend on it. Returns FALSE if the
+ * filter does not have this form.
+ */
+static bool splitCorrelatedFilter( const QgsExpressionNode *filter, QString &inner, const QgsExpressionNode *&outer, QString &staticFilter )
+{
+  QList< const QgsExpressionNode * > conjuncts;
+  QList< const QgsExpressionNode * > pending { filter };
+  while ( !pending.isEmpty() )
+  {
+    const QgsExpressionNode *node = pending.takeFirst();
+    const QgsExpressionNodeBinaryOperator *binary = dynamic_cast< const QgsExpressionNodeBinaryOperator * >( node );
+    if ( binary && binary->op() == QgsExpressionNodeBinaryOperator::boAnd )
+      pending << binary->opLeft() << binary->opRight();
+    else
+      conjuncts << node;
+  }
+
+  QStringList staticParts;
+  outer = nullptr;
+  for ( const QgsExpressionNode *node : qgis::as_const( conjuncts ) )
+  {
+    if ( !dependsOnParent( node ) )
+    {
+      staticParts << QStringLiteral( "(%1)" ).arg( node->dump() );
+      continue;
+    }
+
+    const QgsExpressionNodeBinaryOperator *binary = dynamic_cast< const QgsExpressionNodeBinaryOperator * >( node );
+    if ( outer || !binary || binary->op() != QgsExpressionNodeBinaryOperator::boEQ )
+      return false;
+
+    const QgsExpressionNode *left = binary->opLeft();
+    const QgsExpressionNode *right = binary->opRight();
+    if ( dependsOnParent( left ) )
+      std::swap( left, right );
+    if ( dependsOnParent( left ) || !isVariableValue( right ) )
+      return false;
+
+    inner = left->dump();
+    outer = right;
+  }
+
+  staticFilter = staticParts.join( QStringLiteral( " AND " ) );
+  return outer;
+}
+
+/**
+ * Returns a context to evaluate the expression of the parent value of a correlated
+ * aggregate for the feature of \a context. The value of the parent usually only depends
+ * on the parent itself, in which case a context with the parent alone is enough.
+ */
+static QgsExpressionContext correlatedOuterContext( const QgsExpressionContext *context, bool fullContext )
+{
+  QgsExpressionContextScope *parentScope = new QgsExpressionContextScope();
+  parentScope->setVariable( QStringLiteral( "parent" ), context->feature() );
+  QgsExpressionContext outerContext;
+  if ( fullContext )
+    outerContext = *context;
+  outerContext.appendScope( parentScope );
+  return outerContext;
+}
+
+/**
+ * Splits the filter of a correlated aggregate and calculates the aggregates of all its
+ * groups, as a map holding the aggregates by group, the prepared expression of the parent
+ * value and whether this expression needs the whole context. Returns an empty map if the
+ * aggregate cannot be calculated by groups.
+ */
+static QVariantMap prepareCorrelatedAggregate( QgsVectorLayer *layer, QgsAggregateCalculator::Aggregate aggregate, const QString &subExpression,
+    const QgsAggregateCalculator::AggregateParameters &parameters, const QString &orderBy,
+    const QgsExpressionContext *context )
+{
+  const QgsExpression subExp( subExpression );
+  const QgsExpression filterExp( parameters.filter );
+  const QgsExpression orderByExp( orderBy );
+  if ( !subExp.rootNode() || dependsOnParent( subExp.rootNode() ) || !filterExp.rootNode()
+       || ( orderByExp.rootNode() && dependsOnParent( orderByExp.rootNode() ) ) )
+    return QVariantMap();
+
+  QString inner;
+  const QgsExpressionNode *outer = nullptr;
+  QString staticFilter;
+  if ( !splitCorrelatedFilter( filterExp.rootNode(), inner, outer, staticFilter ) )
+    return QVariantMap();
+
+  QgsAggregateCalculator::AggregateParameters groupParameters = parameters;
+  groupParameters.filter = staticFilter;
+  const QVariantMap grouped = calculateGroupedAggregate( layer, aggregate, subExpression, inner, groupParameters, context );
+  if ( grouped.isEmpty() )
+    return QVariantMap();
+
+  const QSet<QString> variables = outer->referencedVariables();
+  const bool fullContext = variables.size() > 1 || !variables.contains( QStringLiteral( "parent" ) );
+  QgsExpression outerExp( outer->dump() );
+  const QgsExpressionContext outerContext = correlatedOuterContext( context, fullContext );
+  outerExp.prepare( &outerContext );
+
+  QVariantMap correlated;
+  correlated.insert( QStringLiteral( "grouped" ), grouped );
+  correlated.insert( QStringLiteral( "outer" ), QVariant::fromValue( outerExp ) );
+  correlated.insert( QStringLiteral( "context" ), fullContext );
+  return correlated;
+}
+
+/**
+ * Calculates an aggregate with a \a filter correlated with the parent feature, e.g.
+ * "zone_id" = attribute(@parent, 'id'), by looking it up in the aggregates of all the
+ * groups. The filter is split and the groups are calculated once for the context.
+ * Returns FALSE if the aggregate cannot be calculated by groups.
+ */
+static bool correlatedAggregate( QgsVectorLayer *layer, QgsAggregateCalculator::Aggregate aggregate, const QString &subExpression,
+                                 const QgsAggregateCalculator::AggregateParameters &parameters, const QString &orderBy,
+                                 const QgsExpressionContext *context, QVariant &result )
+{
+  const QString cacheKey = QStringLiteral( "aggfcn-correlated:%1:%2:%3:%4:%5" ).arg( layer->id(), QString::number( aggregate ), subExpression, parameters.filter, orderBy );
+  QVariantMap correlated;
+  if ( context->hasCachedValue( cacheKey ) )
+  {
+    correlated = context->cachedValue( cacheKey ).toMap();
+  }
+  else
+  {
+    correlated = prepareCorrelatedAggregate( layer, aggregate, subExpression, parameters, orderBy, context );
+    context->setCachedValue( cacheKey, correlated );
+  }
+  if ( correlated.isEmpty() )
+    return false;
+
+  const QgsExpressionContext outerContext = correlatedOuterContext( context, correlated.value( QStringLiteral( "context" ) ).toBool() );
+  QgsExpression outerExp = correlated.value( QStringLiteral( "outer" ) ).value<QgsExpression>();
+  const QVariant value = outerExp.evaluate( &outerContext );
+  if ( outerExp.hasEvalError() )
+    return false;
+
+  return groupedAggregateValue( correlated.value( QStringLiteral( "grouped" ) ).toMap(), value, result );
+}
+
 static QVariant fcnAggregate( const QVariantList &values, const QgsExpressionContext *context, QgsExpression *parent, const QgsExpressionNodeFunction * )
 {
   //lazy eval, so we need to evaluate nodes now
@@ -644,6 +945,10 @@ static QVariant fcnAggregate( const QVariantList &values, const QgsExpressionCon
          || subExp.referencedVariables().contains( QStringLiteral( "parent" ) )
          || subExp.referencedVariables().contains( QString() ) )
     {
+      // a filter correlated with the parent feature is calculated for all the parents at once
+      if ( correlatedAggregate( vl, aggregate, subExpression, parameters, orderBy, context, result ) )
+        return result;
+
       cacheKey = QStringLiteral( "aggfcn:%1:%2:%3:%4:%5%6:%7" ).arg( vl->id(), QString::number( aggregate ), subExpression, parameters.filter,
                  QString::number( context->feature().id() ), QString( qHash( context->feature() ) ), orderBy );
     }
@@ -766,6 +1071,37 @@ static QVariant fcnAggregateRelation( const QVariantList &values, const QgsExpre
     return QVariant();
   QgsFeature f = context->feature();
 
+  // the related features of all the parents are aggregated at once, by value of the referencing field
+  const QList< QgsRelation::FieldPair > fieldPairs = relation.fieldPairs();
+  if ( fieldPairs.size() == 1 )
+  {
+    const QString groupBy = QgsExpression::quotedColumnRef( fieldPairs.at( 0 ).referencingField() );
+    const QVariant referencedValue = f.attribute( fieldPairs.at( 0 ).referencedField() );
+    // NULL values are matched with IS NULL
+    if ( !referencedValue.isNull() )
+    {
+      const QString groupedKey = QStringLiteral( "relagg-grouped:%1:%2:%3:%4:%5" ).arg( relation.id(),
+                                 QString::number( static_cast< int >( aggregate ) ),
+                                 subExpression,
+                                 groupBy,
+                                 orderBy );
+      QVariantMap grouped;
+      if ( context->hasCachedValue( groupedKey ) )
+      {
+        grouped = context->cachedValue( groupedKey ).toMap();
+      }
+      else
+      {
+        grouped = calculateGroupedAggregate( childLayer, aggregate, subExpression, groupBy, parameters, context );
+        context->setCachedValue( groupedKey, grouped );
+      }
+
+      QVariant result;
+      if ( groupedAggregateValue( grouped, referencedValue, result ) )
+        return result;
+    }
+  }
+
   parameters.filter = relation.getRelatedFeaturesFilter( f );
 
   QString cacheKey = QStringLiteral( "relagg:%1:%2:%3:%4:%5" ).arg( vl->id(),
@@ -271,6 +271,24 @@ class CORE_EXPORT QgsExpressionNode SIP_ABSTRACT
      */
     bool prepare( QgsExpression *parent, const QgsExpressionContext *context );
 
+    /**
+     * Returns TRUE if the node is static and its value has been cached
+     * by prepare().
+     *
+     * \see cachedStaticValue()
+     * \since QGIS 3.16
+     */
+    bool hasCachedStaticValue() const { return mHasCachedValue; }
+
+    /**
+     * Returns the value cached by prepare() for a static node. Only valid
+     * if hasCachedStaticValue() returns TRUE.
+     *
+     * \see hasCachedStaticValue()
+     * \since QGIS 3.16
+     */
+    QVariant cachedStaticValue() const { return mCachedStaticValue; }
+
     /**
      * First line in the parser this node was found.
      * \note This might not be complete for all nodes. Currently
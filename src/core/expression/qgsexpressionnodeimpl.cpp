@@ -947,6 +947,10 @@ QVariant QgsExpressionNodeFunction::evalNode( QgsExpression *parent, const QgsEx
   QString name = QgsExpression::QgsExpression::Functions()[mFnIndex]->name();
   QgsExpressionFunction *fd = context && context->hasFunction( name ) ? context->function( name ) : QgsExpression::QgsExpression::Functions()[mFnIndex];
 
+  // a variable with a static name is read from the slot resolved when preparing, without looking up its name
+  if ( mHasVariableSlot && context && fd == QgsExpression::QgsExpression::Functions()[mFnIndex] )
+    return context->variable( mVariableSlot );
+
   QVariant res = fd->run( mArgs, context, parent, this );
   ENSURE_NO_EVAL_ERROR;
 
@@ -1009,6 +1013,18 @@ bool QgsExpressionNodeFunction::prepareNode( QgsExpression *parent, const QgsExp
   QgsExpressionFunction *fd = QgsExpression::QgsExpression::Functions()[mFnIndex];
 
   bool res = fd->prepare( this, parent, context );
+
+  mHasVariableSlot = false;
+  if ( context && fd->name() == QLatin1String( "var" ) && mArgs && !mArgs->list().isEmpty() && mArgs->list().at( 0 )->nodeType() == ntLiteral )
+  {
+    const QVariant name = static_cast<QgsExpressionNodeLiteral *>( mArgs->list().at( 0 ) )->value();
+    if ( name.type() == QVariant::String )
+    {
+      mVariableSlot = context->variableSlot( name.toString() );
+      mHasVariableSlot = true;
+    }
+  }
+
   if ( mArgs && !fd->lazyEval() )
   {
     const QList< QgsExpressionNode * > nodeList = mArgs->list();
@@ -1307,9 +1323,9 @@ QVariant QgsExpressionNodeColumnRef::evalNode( QgsExpression *parent, const QgsE
   if ( index < 0 )
   {
     // have not yet found field index - first check explicitly set fields collection
-    if ( context && context->hasVariable( QgsExpressionContext::EXPR_FIELDS ) )
+    if ( context )
     {
-      QgsFields fields = qvariant_cast<QgsFields>( context->variable( QgsExpressionContext::EXPR_FIELDS ) );
+      const QgsFields fields = qvariant_cast<QgsFields>( context->variable( mFieldsSlot ) );
       index = fields.lookupField( mName );
     }
   }
@@ -18,6 +18,7 @@
 #define QGSEXPRESSIONNODEIMPL_H
 
 #include "qgsexpressionnode.h"
+#include "qgsexpressioncontext.h"
 #include "qgsinterval.h"
 
 /**
@@ -355,6 +356,9 @@ class CORE_EXPORT QgsExpressionNodeFunction : public QgsExpressionNode
   private:
     int mFnIndex;
     NodeList *mArgs = nullptr;
+    //! TRUE if the node reads a variable with a static name, through mVariableSlot
+    bool mHasVariableSlot = false;
+    QgsExpressionContext::VariableSlot mVariableSlot;
 };
 
 /**
@@ -408,6 +412,7 @@ class CORE_EXPORT QgsExpressionNodeColumnRef : public QgsExpressionNode
     QgsExpressionNodeColumnRef( const QString &name )
       : mName( name )
       , mIndex( -1 )
+      , mFieldsSlot( QgsExpressionContext::EXPR_FIELDS )
     {}
 
     //! The name of the column.
@@ -431,6 +436,8 @@ class CORE_EXPORT QgsExpressionNodeColumnRef : public QgsExpressionNode
   private:
     QString mName;
     int mIndex;
+    //! Fields of the context, for the evaluations without prepared index
+    QgsExpressionContext::VariableSlot mFieldsSlot;
 };
 
 /**
@@ -18,6 +18,7 @@ email                : morb at ozemail dot com dot au
 #include <cstdio>
 #include <cmath>
 #include <nlohmann/json.hpp>
+#include <QMutex>
 
 #include "qgis.h"
 #include "qgsgeometry.h"
@@ -48,13 +49,274 @@ email                : morb at ozemail dot com dot au
 #include "qgscircle.h"
 #include "qgscurve.h"
 
+///@cond PRIVATE
+
+namespace
+{
+  //! What is known of a WKB without parsing it
+  struct WkbSummary
+  {
+    QgsWkbTypes::Type type = QgsWkbTypes::Unknown;
+    QgsRectangle boundingBox;
+    bool isEmpty = true;
+  };
+
+  /**
+   * Scans the WKB of simple features, i.e. (multi) points, line strings and polygons,
+   * without allocating anything. Returns FALSE if the WKB is of another type, is not
+   * in the byte order of the machine, contains empty points or is truncated, in which
+   * case it must be parsed right away.
+   */
+  class WkbScanner
+  {
+    public:
+      WkbScanner( const QByteArray &wkb )
+        : mPtr( wkb.constData() )
+        , mEnd( wkb.constData() + wkb.size() )
+      {}
+
+      bool scan( WkbSummary &summary )
+      {
+        quint32 type = 0;
+        if ( !readHeader( type ) )
+          return false;
+
+        const quint32 flatType = type % 1000;
+        if ( flatType >= 4 && flatType <= 6 )
+        {
+          // parts must be of the matching single type and dimension
+          quint32 count = 0;
+          if ( !readCount( count ) )
+            return false;
+          for ( quint32 i = 0; i < count; ++i )
+          {
+            quint32 partType = 0;
+            if ( !readHeader( partType ) || partType != type - 3 || !scanGeometry( partType ) )
+              return false;
+          }
+        }
+        else if ( !scanGeometry( type ) )
+        {
+          return false;
+        }
+
+        if ( mPtr != mEnd )
+          return false;
+
+        summary.type = static_cast< QgsWkbTypes::Type >( type );
+        summary.isEmpty = mIsEmpty;
+        if ( !mIsEmpty )
+          summary.boundingBox = QgsRectangle( mXMin, mYMin, mXMax, mYMax, false );
+        return true;
+      }
+
+    private:
+
+      bool readHeader( quint32 &type )
+      {
+        const char byteOrder = QSysInfo::ByteOrder == QSysInfo::BigEndian ? 0 : 1;
+        if ( mEnd - mPtr < 5 || *mPtr != byteOrder )
+          return false;
+
+        memcpy( &type, mPtr + 1, sizeof( quint32 ) );
+        mPtr += 5;
+        if ( type >= 4000 || type % 1000 < 1 || type % 1000 > 6 )
+          return false;
+
+        const quint32 dimensions = type / 1000;
+        mDimensions = 2 + ( dimensions == 1 || dimensions == 3 ) + ( dimensions == 2 || dimensions == 3 );
+        return true;
+      }
+
+      bool readCount( quint32 &count )
+      {
+        if ( mEnd - mPtr < 4 )
+          return false;
+
+        memcpy( &count, mPtr, sizeof( quint32 ) );
+        mPtr += 4;
+        return true;
+      }
+
+      bool scanGeometry( quint32 type )
+      {
+        switch ( type % 1000 )
+        {
+          case 1:
+            return scanPoints( 1, true );
+
+          case 2:
+          {
+            quint32 count = 0;
+            return readCount( count ) && scanPoints( count, true );
+          }
+
+          case 3:
+          {
+            // the bounding box of polygons is the one of their exterior ring
+            quint32 rings = 0;
+            if ( !readCount( rings ) )
+              return false;
+            for ( quint32 i = 0; i < rings; ++i )
+            {
+              quint32 count = 0;
+              if ( !readCount( count ) || !scanPoints( count, i == 0 ) )
+                return false;
+            }
+            return true;
+          }
+
+          default:
+            return false;
+        }
+      }
+
+      bool scanPoints( quint32 count, bool extendBoundingBox )
+      {
+        const qint64 size = static_cast< qint64 >( count ) * mDimensions * sizeof( double );
+        if ( mEnd - mPtr < size )
+          return false;
+
+        if ( extendBoundingBox )
+        {
+          for ( quint32 i = 0; i < count; ++i )
+          {
+            double x, y;
+            memcpy( &x, mPtr + i * mDimensions * sizeof( double ), sizeof( double ) );
+            memcpy( &y, mPtr + ( i * mDimensions + 1 ) * sizeof( double ), sizeof( double ) );
+            if ( std::isnan( x ) || std::isnan( y ) )
+              return false;
+
+            mXMin = std::min( mXMin, x );
+            mXMax = std::max( mXMax, x );
+            mYMin = std::min( mYMin, y );
+            mYMax = std::max( mYMax, y );
+            mIsEmpty = false;
+          }
+        }
+        mPtr += size;
+        return true;
+      }
+
+      const char *mPtr = nullptr;
+      const char *mEnd = nullptr;
+      int mDimensions = 2;
+      bool mIsEmpty = true;
+      double mXMin = std::numeric_limits< double >::max();
+      double mYMin = std::numeric_limits< double >::max();
+      double mXMax = -std::numeric_limits< double >::max();
+      double mYMax = -std::numeric_limits< double >::max();
+  };
+}
+
+/**
+ * Abstract geometry of a QgsGeometry, which may still be stored as the WKB it was
+ * created from.
+ *
+ * Such a WKB is only parsed on the first access to the abstract geometry. Until then,
+ * the type, bounding box and emptiness of the geometry come from a scan of the WKB,
+ * which is returned as is by QgsGeometry::asWkb(). The private data being shared
+ * between copies of a geometry, parsing is protected by a mutex. The WKB is dropped
+ * when the geometry is detached to be changed.
+ */
+class QgsLazyGeometry
+{
+  public:
+    QgsLazyGeometry() = default;
+    QgsLazyGeometry( const QgsLazyGeometry &other ) = delete;
+    QgsLazyGeometry &operator=( const QgsLazyGeometry &other ) = delete;
+
+    QgsLazyGeometry &operator=( std::unique_ptr< QgsAbstractGeometry > geometry )
+    {
+      mGeometry = std::move( geometry );
+      clearWkb();
+      return *this;
+    }
+
+    void reset( QgsAbstractGeometry *geometry = nullptr )
+    {
+      mGeometry.reset( geometry );
+      clearWkb();
+    }
+
+    QgsAbstractGeometry *release()
+    {
+      parse();
+      clearWkb();
+      return mGeometry.release();
+    }
+
+    QgsAbstractGeometry *get() const
+    {
+      parse();
+      return mGeometry.get();
+    }
+
+    QgsAbstractGeometry *operator->() const { return get(); }
+    QgsAbstractGeometry &operator*() const { return *get(); }
+
+    explicit operator bool() const { return mUnparsed.loadAcquire() || mGeometry; }
+
+    //! Keeps \a wkb, whose \a summary comes from WkbScanner, until the geometry is needed
+    void setWkb( const QByteArray &wkb, const WkbSummary &summary )
+    {
+      mGeometry.reset();
+      mWkb = wkb;
+      mSummary = summary;
+      mUnparsed.storeRelease( 1 );
+    }
+
+    //! Returns TRUE if the geometry matches the WKB it was created from
+    bool hasWkb() const { return !mWkb.isEmpty(); }
+    const QByteArray &wkb() const { return mWkb; }
+    const WkbSummary &summary() const { return mSummary; }
+
+    //! Parses the WKB if needed and forgets it, before changing the geometry
+    void dropWkb()
+    {
+      parse();
+      clearWkb();
+    }
+
+  private:
+
+    void parse() const
+    {
+      if ( !mUnparsed.loadAcquire() )
+        return;
+
+      QMutexLocker locker( &mMutex );
+      if ( !mUnparsed.loadAcquire() )
+        return;
+
+      QgsConstWkbPtr ptr( mWkb );
+      mGeometry = QgsGeometryFactory::geomFromWkb( ptr );
+      mUnparsed.storeRelease( 0 );
+    }
+
+    void clearWkb()
+    {
+      mWkb.clear();
+      mSummary = WkbSummary();
+      mUnparsed.storeRelease( 0 );
+    }
+
+    mutable std::unique_ptr< QgsAbstractGeometry > mGeometry;
+    mutable QMutex mMutex;
+    mutable QAtomicInt mUnparsed;
+    QByteArray mWkb;
+    WkbSummary mSummary;
+};
+
 struct QgsGeometryPrivate
 {
   QgsGeometryPrivate(): ref( 1 ) {}
   QAtomicInt ref;
-  std::unique_ptr< QgsAbstractGeometry > geometry;
+  QgsLazyGeometry geometry;
 };
 
+///@endcond
+
 QgsGeometry::QgsGeometry()
   : d( new QgsGeometryPrivate() )
 {
@@ -106,7 +368,11 @@ QgsGeometry &QgsGeometry::operator=( QgsGeometry const &other )
 void QgsGeometry::detach()
 {
   if ( d->ref <= 1 )
+  {
+    // the geometry is about to change and will no longer match its WKB
+    d->geometry.dropWkb();
     return;
+  }
 
   std::unique_ptr< QgsAbstractGeometry > cGeom;
   if ( d->geometry )
@@ -331,20 +597,32 @@ QgsGeometry QgsGeometry::createWedgeBuffer( const QgsPoint &center, const double
 
 void QgsGeometry::fromWkb( unsigned char *wkb, int length )
 {
-  QgsConstWkbPtr ptr( wkb, length );
-  reset( QgsGeometryFactory::geomFromWkb( ptr ) );
+  fromWkb( QByteArray( reinterpret_cast< const char * >( wkb ), length ) );
   delete [] wkb;
 }
 
 void QgsGeometry::fromWkb( const QByteArray &wkb )
 {
+  WkbSummary summary;
+  if ( WkbScanner( wkb ).scan( summary ) )
+  {
+    // simple features are only parsed when needed
+    reset( nullptr );
+    d->geometry.setWkb( wkb, summary );
+    return;
+  }
+
   QgsConstWkbPtr ptr( wkb );
   reset( QgsGeometryFactory::geomFromWkb( ptr ) );
 }
 
 QgsWkbTypes::Type QgsGeometry::wkbType() const
 {
-  if ( !d->geometry )
+  if ( d->geometry.hasWkb() )
+  {
+    return d->geometry.summary().type;
+  }
+  else if ( !d->geometry )
   {
     return QgsWkbTypes::Unknown;
   }
@@ -361,12 +639,16 @@ QgsWkbTypes::GeometryType QgsGeometry::type() const
   {
     return QgsWkbTypes::UnknownGeometry;
   }
-  return static_cast< QgsWkbTypes::GeometryType >( QgsWkbTypes::geometryType( d->geometry->wkbType() ) );
+  return static_cast< QgsWkbTypes::GeometryType >( QgsWkbTypes::geometryType( wkbType() ) );
 }
 
 bool QgsGeometry::isEmpty() const
 {
-  if ( !d->geometry )
+  if ( d->geometry.hasWkb() )
+  {
+    return d->geometry.summary().isEmpty;
+  }
+  else if ( !d->geometry )
   {
     return true;
   }
@@ -380,7 +662,7 @@ bool QgsGeometry::isMultipart() const
   {
     return false;
   }
-  return QgsWkbTypes::isMultiType( d->geometry->wkbType() );
+  return QgsWkbTypes::isMultiType( wkbType() );
 }
 
 QgsPointXY QgsGeometry::closestVertex( const QgsPointXY &point, int &atVertex, int &beforeVertex, int &afterVertex, double &sqrDist ) const
@@ -983,7 +1265,11 @@ QgsGeometry QgsGeometry::makeDifference( const QgsGeometry &other ) const
 
 QgsRectangle QgsGeometry::boundingBox() const
 {
-  if ( d->geometry )
+  if ( d->geometry.hasWkb() )
+  {
+    return d->geometry.summary().boundingBox;
+  }
+  else if ( d->geometry )
   {
     return d->geometry->boundingBox();
   }
@@ -1121,7 +1407,7 @@ bool QgsGeometry::intersects( const QgsRectangle &r ) const
     return false;
 
   // optimise trivial case for point intersections -- the bounding box test has already given us the answer
-  if ( QgsWkbTypes::flatType( d->geometry->wkbType() ) == QgsWkbTypes::Point )
+  if ( QgsWkbTypes::flatType( wkbType() ) == QgsWkbTypes::Point )
   {
     return true;
   }
@@ -1150,13 +1436,13 @@ bool QgsGeometry::boundingBoxIntersects( const QgsRectangle &rectangle ) const
   }
 
   // optimise trivial case for point intersections
-  if ( QgsWkbTypes::flatType( d->geometry->wkbType() ) == QgsWkbTypes::Point )
+  if ( QgsWkbTypes::flatType( wkbType() ) == QgsWkbTypes::Point )
   {
-    const QgsPoint *point = qgsgeometry_cast< const QgsPoint * >( d->geometry.get() );
-    return rectangle.contains( QgsPointXY( point->x(), point->y() ) );
+    const QgsRectangle bbox = boundingBox();
+    return rectangle.contains( QgsPointXY( bbox.xMinimum(), bbox.yMinimum() ) );
   }
 
-  return d->geometry->boundingBox().intersects( rectangle );
+  return boundingBox().intersects( rectangle );
 }
 
 bool QgsGeometry::boundingBoxIntersects( const QgsGeometry &geometry ) const
@@ -1166,7 +1452,7 @@ bool QgsGeometry::boundingBoxIntersects( const QgsGeometry &geometry ) const
     return false;
   }
 
-  return d->geometry->boundingBox().intersects( geometry.constGet()->boundingBox() );
+  return boundingBox().intersects( geometry.boundingBox() );
 }
 
 bool QgsGeometry::contains( const QgsPointXY *p ) const
@@ -2494,6 +2780,10 @@ QVector<QgsPointXY> QgsGeometry::randomPointsInPolygon( int count, unsigned long
 
 QByteArray QgsGeometry::asWkb( QgsAbstractGeometry::WkbFlags flags ) const
 {
+  // flags only concern triangles, which never keep their WKB
+  if ( d->geometry.hasWkb() )
+    return d->geometry.wkb();
+
   return d->geometry ? d->geometry->asWkb( flags ) : QByteArray();
 }
 
@@ -302,6 +302,11 @@ class CORE_EXPORT QgsGeometry
 
     /**
      * Set the geometry, feeding in the buffer containing OGC Well-Known Binary
+     *
+     * Since QGIS 3.16, the WKB of (multi) points, line strings and polygons is only
+     * parsed when the geometry is first accessed or changed. Until then wkbType(),
+     * boundingBox(), isEmpty() and asWkb() are answered from the WKB itself.
+     *
      * \since QGIS 3.0
      */
     void fromWkb( const QByteArray &wkb );
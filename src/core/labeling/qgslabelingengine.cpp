@@ -275,6 +275,7 @@ void QgsLabelingEngine::registerLabels( QgsRenderContext &context )
 
   mPal->setShowPartialLabels( settings.testFlag( QgsLabelingEngineSettings::UsePartialCandidates ) );
   mPal->setPlacementVersion( settings.placementVersion() );
+  mPal->setUseParallelSolver( settings.testFlag( QgsLabelingEngineSettings::UseParallelSolver ) );
 
   // for each provider: get labels and register them in PAL
   for ( QgsAbstractLabelProvider *provider : qgis::as_const( mProviders ) )
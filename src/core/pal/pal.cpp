@@ -44,6 +44,7 @@
 #include "qgssettings.h"
 #include <cfloat>
 #include <list>
+#include <QThreadPool>
 
 using namespace pal;
 
@@ -492,7 +493,10 @@ QList<LabelPosition *> Pal::solveProblem( Problem *prob, bool displayAll, QList<
 
   try
   {
-    prob->chain_search();
+    if ( mUseParallelSolver )
+      prob->parallelChainSearch( QThreadPool::globalInstance()->maxThreadCount() );
+    else
+      prob->chain_search();
   }
   catch ( InternalException::Empty & )
   {
@@ -205,6 +205,20 @@ namespace pal
        */
       void setPlacementVersion( QgsLabelingEngineSettings::PlacementEngineVersion placementVersion );
 
+      /**
+       * Returns TRUE if independent groups of conflicting labels are solved in parallel threads.
+       *
+       * \see setUseParallelSolver()
+       */
+      bool useParallelSolver() const { return mUseParallelSolver; }
+
+      /**
+       * Sets whether independent groups of conflicting labels should be solved in parallel threads.
+       *
+       * \see useParallelSolver()
+       */
+      void setUseParallelSolver( bool enabled ) { mUseParallelSolver = enabled; }
+
       /**
        * Returns the global candidates limit for point features, or 0 if no global limit is in effect.
        *
@@ -273,6 +287,8 @@ namespace pal
 
       QgsLabelingEngineSettings::PlacementEngineVersion mPlacementVersion = QgsLabelingEngineSettings::PlacementEngineVersion2;
 
+      bool mUseParallelSolver = false;
+
       //! Callback that may be called from PAL to check whether the job has not been canceled in meanwhile
       FnIsCanceled fnIsCanceled = nullptr;
       //! Application-specific context for the cancellation check function
@@ -39,6 +39,8 @@
 #include "internalexception.h"
 #include <cfloat>
 #include <limits> //for std::numeric_limits<int>::max()
+#include <numeric>
+#include <QtConcurrentMap>
 
 #include "qgslabelingengine.h"
 
@@ -55,7 +57,8 @@ inline void delete_chain( Chain *chain )
 }
 
 Problem::Problem( const QgsRectangle &extent )
-  : mAllCandidatesIndex( extent )
+  : mExtent( extent )
+  , mAllCandidatesIndex( extent )
   , mActiveCandidatesIndex( extent )
 {
 
@@ -654,6 +657,178 @@ void Problem::chain_search()
   delete[] ok;
 }
 
+void Problem::parallelChainSearch( int threadCount )
+{
+  if ( mFeatureCount == 0 )
+    return;
+
+  if ( threadCount < 2 )
+  {
+    chain_search();
+    return;
+  }
+
+  // 1. group features whose candidates conflict, directly or through other features (union-find)
+  std::vector< int > parent( mFeatureCount );
+  std::iota( parent.begin(), parent.end(), 0 );
+  auto findRoot = [&parent]( int feature ) -> int
+  {
+    while ( parent[feature] != feature )
+    {
+      parent[feature] = parent[parent[feature]];
+      feature = parent[feature];
+    }
+    return feature;
+  };
+
+  double amin[2];
+  double amax[2];
+  for ( std::size_t i = 0; i < mFeatureCount; i++ )
+  {
+    if ( pal->isCanceled() )
+    {
+      mSol.init( mFeatureCount );
+      return;
+    }
+
+    for ( int j = 0; j < mFeatNbLp[i]; j++ )
+    {
+      const LabelPosition *lp = mLabelPositions[ mFeatStartId[i] + j ].get();
+      lp->getBoundingBox( amin, amax );
+      mAllCandidatesIndex.intersects( QgsRectangle( amin[0], amin[1], amax[0], amax[1] ), [lp, &parent, &findRoot]( const LabelPosition * lp2 ) -> bool
+      {
+        if ( lp->isInConflict( lp2 ) )
+        {
+          const int root1 = findRoot( lp->getProblemFeatureId() );
+          const int root2 = findRoot( lp2->getProblemFeatureId() );
+          // always keep the lowest feature as root, so that groups don't depend on the index traversal order
+          if ( root1 < root2 )
+            parent[root2] = root1;
+          else if ( root2 < root1 )
+            parent[root1] = root2;
+        }
+        return true;
+      } );
+    }
+  }
+
+  struct Group
+  {
+    std::vector< int > features;
+    int candidateCount = 0;
+  };
+  std::vector< Group > groups;
+  std::vector< int > groupForRoot( mFeatureCount, -1 );
+  for ( std::size_t i = 0; i < mFeatureCount; i++ )
+  {
+    const int root = findRoot( static_cast< int >( i ) );
+    if ( groupForRoot[root] < 0 )
+    {
+      groupForRoot[root] = static_cast< int >( groups.size() );
+      groups.emplace_back( Group() );
+    }
+    Group &group = groups[ groupForRoot[root] ];
+    group.features.emplace_back( static_cast< int >( i ) );
+    group.candidateCount += mFeatNbLp[i];
+  }
+
+  if ( groups.size() < 2 )
+  {
+    chain_search();
+    return;
+  }
+
+  // 2. distribute groups between sub problems, largest groups first, always filling the least loaded sub problem.
+  // Groups are ordered by their first feature, so ties are broken deterministically
+  std::vector< int > groupOrder( groups.size() );
+  std::iota( groupOrder.begin(), groupOrder.end(), 0 );
+  std::stable_sort( groupOrder.begin(), groupOrder.end(), [&groups]( int a, int b )
+  {
+    return groups[a].candidateCount > groups[b].candidateCount;
+  } );
+
+  const std::size_t subProblemCount = std::min( static_cast< std::size_t >( threadCount ), groups.size() );
+  std::vector< std::vector< int > > subProblemFeatures( subProblemCount );
+  std::vector< int > subProblemLoad( subProblemCount, 0 );
+  for ( int groupIndex : groupOrder )
+  {
+    const std::size_t target = std::min_element( subProblemLoad.begin(), subProblemLoad.end() ) - subProblemLoad.begin();
+    subProblemLoad[target] += std::max( 1, groups[groupIndex].candidateCount );
+    subProblemFeatures[target].insert( subProblemFeatures[target].end(), groups[groupIndex].features.begin(), groups[groupIndex].features.end() );
+  }
+
+  // 3. move candidates into the sub problems, renumbering them
+  std::vector< std::unique_ptr< Problem > > subProblems;
+  subProblems.reserve( subProblemCount );
+  for ( std::vector< int > &features : subProblemFeatures )
+  {
+    std::sort( features.begin(), features.end() );
+
+    std::unique_ptr< Problem > subProblem = qgis::make_unique< Problem >( mExtent );
+    subProblem->pal = pal;
+    subProblem->mDisplayAll = mDisplayAll;
+    std::copy( std::begin( mMapExtentBounds ), std::end( mMapExtentBounds ), std::begin( subProblem->mMapExtentBounds ) );
+    subProblem->mFeatureCount = features.size();
+    subProblem->mFeatStartId.resize( features.size() );
+    subProblem->mFeatNbLp.resize( features.size() );
+    subProblem->mInactiveCost.resize( features.size() );
+
+    int subLabelId = 0;
+    for ( std::size_t k = 0; k < features.size(); k++ )
+    {
+      const int feature = features[k];
+      subProblem->mFeatStartId[k] = subLabelId;
+      subProblem->mFeatNbLp[k] = mFeatNbLp[feature];
+      subProblem->mInactiveCost[k] = mInactiveCost[feature];
+      for ( int j = 0; j < mFeatNbLp[feature]; j++ )
+      {
+        std::unique_ptr< LabelPosition > &lp = mLabelPositions[ mFeatStartId[feature] + j ];
+        lp->setProblemIds( static_cast< int >( k ), subLabelId++ );
+        lp->insertIntoIndex( subProblem->mAllCandidatesIndex );
+        subProblem->mLabelPositions.emplace_back( std::move( lp ) );
+      }
+    }
+    subProblem->mTotalCandidates = subLabelId;
+    subProblem->mAllNblp = subLabelId;
+    subProblems.emplace_back( std::move( subProblem ) );
+  }
+
+  // 4. solve the sub problems
+  QtConcurrent::blockingMap( subProblems, []( std::unique_ptr< Problem > &subProblem )
+  {
+    subProblem->chain_search();
+  } );
+
+  // 5. move candidates back, and merge the sub solutions
+  mSol.init( mFeatureCount );
+  for ( std::size_t s = 0; s < subProblems.size(); s++ )
+  {
+    Problem *subProblem = subProblems[s].get();
+    const std::vector< int > &features = subProblemFeatures[s];
+
+    for ( std::size_t k = 0; k < features.size(); k++ )
+    {
+      const int feature = features[k];
+      for ( int j = 0; j < mFeatNbLp[feature]; j++ )
+      {
+        std::unique_ptr< LabelPosition > &lp = subProblem->mLabelPositions[ subProblem->mFeatStartId[k] + j ];
+        lp->setProblemIds( feature, mFeatStartId[feature] + j );
+        mLabelPositions[ mFeatStartId[feature] + j ] = std::move( lp );
+      }
+
+      const int subLabelId = subProblem->mSol.activeLabelIds[k];
+      if ( subLabelId >= 0 )
+      {
+        const int labelId = mFeatStartId[feature] + ( subLabelId - subProblem->mFeatStartId[k] );
+        mSol.activeLabelIds[feature] = labelId;
+        mLabelPositions[ labelId ]->insertIntoIndex( mActiveCandidatesIndex );
+      }
+    }
+  }
+
+  solution_cost();
+}
+
 QList<LabelPosition *> Problem::getSolution( bool returnInactive, QList<LabelPosition *> *unlabeled )
 {
   QList<LabelPosition *> finalLabelPlacements;
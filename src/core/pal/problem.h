@@ -117,6 +117,19 @@ namespace pal
        */
       void chain_search();
 
+      /**
+       * Runs chain_search(), after splitting the problem into groups of features whose candidates
+       * do not conflict with candidates from other groups. Each group is solved independently in
+       * a separate thread (using up to \a threadCount threads), and the results are merged back into
+       * this problem's solution.
+       *
+       * The result is deterministic, regardless of the order in which groups are solved. Falls back
+       * to a plain chain_search() when the problem cannot be split.
+       *
+       * \since QGIS 3.16
+       */
+      void parallelChainSearch( int threadCount );
+
       /**
        * Solves the labeling problem, selecting the best candidate locations for all labels and returns a list of these
        * calculated label positions.
@@ -154,6 +167,9 @@ namespace pal
 
     private:
 
+      //! Bounds of all coordinates stored in the spatial indices
+      QgsRectangle mExtent;
+
       /**
        * Total number of layers containing labels
        */
@@ -17,8 +17,8 @@
 
 #include "qgsgeometry.h"
 #include "qgsgeometryengine.h"
+#include "qgsfeaturebatch.h"
 #include "qgslogger.h"
-#include "qgsspatialindex.h"
 #include "qgsmessagelog.h"
 #include "qgsproject.h"
 #include "qgsexception.h"
@@ -57,29 +57,56 @@ QgsMemoryFeatureIterator::QgsMemoryFeatureIterator( QgsMemoryFeatureSource *sour
     mSelectRectEngine->prepareGeometry();
   }
 
-  // if there's spatial index, use it!
-  // (but don't use it when selection rect is not specified)
-  if ( !mFilterRect.isNull() && mSource->mSpatialIndex )
+  // only the requested attributes and geometries are read from the store
+  mFetchGeometry = !( mRequest.flags() & QgsFeatureRequest::NoGeometry )
+                   || ( mRequest.filterType() == QgsFeatureRequest::FilterExpression && mRequest.filterExpression()->needsGeometry() )
+                   || ( mSubsetExpression && mSubsetExpression->needsGeometry() );
+  if ( mRequest.flags() & QgsFeatureRequest::SubsetOfAttributes && !mSubsetExpression )
   {
-    mUsingFeatureIdList = true;
-    mFeatureIdList = mSource->mSpatialIndex->intersects( mFilterRect );
-    QgsDebugMsg( "Features returned by spatial index: " + QString::number( mFeatureIdList.count() ) );
+    QSet<int> attributeIndexes = qgis::listToSet( mRequest.subsetOfAttributes() );
+    // also need attributes required by the filter expression and the order by
+    if ( mRequest.filterType() == QgsFeatureRequest::FilterExpression )
+      attributeIndexes += mRequest.filterExpression()->referencedAttributeIndexes( mSource->mFields );
+    const auto usedAttributeIndices = mRequest.orderBy().usedAttributeIndices( mSource->mFields );
+    for ( int attrIdx : usedAttributeIndices )
+      attributeIndexes << attrIdx;
+    mAttributes = qgis::setToList( attributeIndexes );
   }
-  else if ( mRequest.filterType() == QgsFeatureRequest::FilterFid )
+  else
+  {
+    mAttributes = mSource->mFields.allAttributesList();
+  }
+
+  if ( mRequest.filterType() == QgsFeatureRequest::FilterFid )
   {
-    mUsingFeatureIdList = true;
-    QgsFeatureMap::const_iterator it = mSource->mFeatures.constFind( mRequest.filterFid() );
-    if ( it != mSource->mFeatures.constEnd() )
-      mFeatureIdList.append( mRequest.filterFid() );
+    mUsingPositionList = true;
+    const QgsMemoryFeatureStore::Position position = mSource->mFeatures.find( mRequest.filterFid() );
+    if ( position.isValid() )
+      mPositions << position;
   }
   else if ( mRequest.filterType() == QgsFeatureRequest::FilterFids )
   {
-    mUsingFeatureIdList = true;
-    mFeatureIdList = qgis::setToList( mRequest.filterFids() );
+    mUsingPositionList = true;
+    const QgsFeatureIds filterFids = mRequest.filterFids();
+    for ( QgsFeatureId id : filterFids )
+    {
+      const QgsMemoryFeatureStore::Position position = mSource->mFeatures.find( id );
+      if ( position.isValid() )
+        mPositions << position;
+    }
+    std::sort( mPositions.begin(), mPositions.end() );
+  }
+  else if ( !mFilterRect.isNull() )
+  {
+    // the store always has a spatial index
+    mUsingPositionList = true;
+    mPositionsFromSpatialIndex = true;
+    mPositions = mSource->mFeatures.intersects( mFilterRect );
+    QgsDebugMsg( "Features returned by spatial index: " + QString::number( mPositions.count() ) );
   }
   else
   {
-    mUsingFeatureIdList = false;
+    mUsingPositionList = false;
   }
 
   rewind();
@@ -97,7 +124,7 @@ bool QgsMemoryFeatureIterator::fetchFeature( QgsFeature &feature )
   if ( mClosed )
     return false;
 
-  if ( mUsingFeatureIdList )
+  if ( mUsingPositionList )
     return nextFeatureUsingList( feature );
   else
     return nextFeatureTraverseAll( feature );
@@ -106,122 +133,96 @@ bool QgsMemoryFeatureIterator::fetchFeature( QgsFeature &feature )
 
 bool QgsMemoryFeatureIterator::nextFeatureUsingList( QgsFeature &feature )
 {
-  bool hasFeature = false;
-
   // option 1: we have a list of features to traverse
-  QgsFeature candidate;
-  while ( mFeatureIdListIterator != mFeatureIdList.constEnd() )
+  while ( mPositionIndex < mPositions.size() )
   {
-    candidate = mSource->mFeatures.value( *mFeatureIdListIterator );
-    if ( !mFilterRect.isNull() )
-    {
-      if ( mRequest.flags() & QgsFeatureRequest::ExactIntersect )
-      {
-        // do exact check in case we're doing intersection
-        if ( candidate.hasGeometry() && mSelectRectEngine->intersects( candidate.geometry().constGet() ) )
-          hasFeature = true;
-      }
-      else if ( mSource->mSpatialIndex )
-      {
-        // using a spatial index - so we already know that the bounding box intersects correctly
-        hasFeature = true;
-      }
-      else
-      {
-        // do bounding box check if we aren't using a spatial index
-        if ( candidate.hasGeometry() && candidate.geometry().boundingBoxIntersects( mFilterRect ) )
-          hasFeature = true;
-      }
-    }
-    else
-      hasFeature = true;
-
-    if ( hasFeature && mSubsetExpression )
-    {
-      mSource->mExpressionContext.setFeature( candidate );
-      if ( !mSubsetExpression->evaluate( &mSource->mExpressionContext ).toBool() )
-        hasFeature = false;
-    }
-
-    if ( hasFeature )
-      break;
-
-    ++mFeatureIdListIterator;
+    const QgsMemoryFeatureStore::Position position = mPositions.at( mPositionIndex++ );
+    if ( readFeature( position, mPositionsFromSpatialIndex, feature ) )
+      return true;
   }
 
-  // copy feature
-  if ( hasFeature )
-  {
-    feature = candidate;
-    ++mFeatureIdListIterator;
-  }
-  else
-    close();
+  close();
+  return false;
+}
+
 
-  if ( hasFeature )
+bool QgsMemoryFeatureIterator::nextFeatureTraverseAll( QgsFeature &feature )
+{
+  // option 2: traversing the whole layer
+  while ( mPosition.isValid() )
   {
-    feature.setFields( mSource->mFields ); // allow name-based attribute lookups
-    geometryToDestinationCrs( feature, mTransform );
+    const QgsMemoryFeatureStore::Position position = mPosition;
+    mPosition = mSource->mFeatures.next( mPosition );
+    if ( readFeature( position, false, feature ) )
+      return true;
   }
 
-  return hasFeature;
+  close();
+  return false;
 }
 
-
-bool QgsMemoryFeatureIterator::nextFeatureTraverseAll( QgsFeature &feature )
+bool QgsMemoryFeatureIterator::readFeature( QgsMemoryFeatureStore::Position position, bool boundingBoxChecked, QgsFeature &feature )
 {
-  bool hasFeature = false;
+  const QgsMemoryFeatureStore &store = mSource->mFeatures;
 
-  // option 2: traversing the whole layer
-  while ( mSelectIterator != mSource->mFeatures.constEnd() )
+  QgsGeometry geometry;
+  if ( !mFilterRect.isNull() )
   {
-    if ( mFilterRect.isNull() )
-    {
-      // selection rect empty => using all features
-      hasFeature = true;
-    }
-    else
-    {
-      if ( mRequest.flags() & QgsFeatureRequest::ExactIntersect )
-      {
-        // using exact test when checking for intersection
-        if ( mSelectIterator->hasGeometry() && mSelectRectEngine->intersects( mSelectIterator->geometry().constGet() ) )
-          hasFeature = true;
-      }
-      else
-      {
-        // check just bounding box against rect when not using intersection
-        if ( mSelectIterator->hasGeometry() && mSelectIterator->geometry().boundingBox().intersects( mFilterRect ) )
-          hasFeature = true;
-      }
-    }
+    if ( !store.hasGeometry( position ) )
+      return false;
+
+    // check just bounding box against rect when not using intersection
+    if ( !boundingBoxChecked && !store.boundingBox( position ).intersects( mFilterRect ) )
+      return false;
 
-    if ( mSubsetExpression )
+    if ( mRequest.flags() & QgsFeatureRequest::ExactIntersect )
     {
-      mSource->mExpressionContext.setFeature( *mSelectIterator );
-      if ( !mSubsetExpression->evaluate( &mSource->mExpressionContext ).toBool() )
-        hasFeature = false;
+      // do exact check in case we're doing intersection
+      geometry = store.geometry( position );
+      if ( !mSelectRectEngine->intersects( geometry.constGet() ) )
+        return false;
     }
+  }
 
-    if ( hasFeature )
-      break;
+  QgsFeature candidate = store.feature( position, false, mAttributes );
+  if ( mFetchGeometry )
+    candidate.setGeometry( geometry.isNull() ? store.geometry( position ) : geometry );
 
-    ++mSelectIterator;
+  if ( mSubsetExpression )
+  {
+    mSource->mExpressionContext.setFeature( candidate );
+    if ( !mSubsetExpression->evaluate( &mSource->mExpressionContext ).toBool() )
+      return false;
   }
 
-  // copy feature
-  if ( hasFeature )
+  feature = candidate;
+  feature.setValid( true );
+  feature.setFields( mSource->mFields ); // allow name-based attribute lookups
+  geometryToDestinationCrs( feature, mTransform );
+  return true;
+}
+
+bool QgsMemoryFeatureIterator::fetchBatch( QgsFeatureBatch &batch, int maxSize )
+{
+  // only whole layers are read in batches, filtered features are checked one by one
+  if ( mUsingPositionList || !mFilterRect.isNull() || mSubsetExpression || mTransform.isValid() )
+    return false;
+
+  if ( mClosed )
+    return true;
+
+  // the typed columns of the store are copied without going through features
+  const QgsMemoryFeatureStore &store = mSource->mFeatures;
+  while ( batch.size() < maxSize && mPosition.isValid() )
   {
-    feature = mSelectIterator.value();
-    ++mSelectIterator;
-    feature.setValid( true );
-    feature.setFields( mSource->mFields ); // allow name-based attribute lookups
-    geometryToDestinationCrs( feature, mTransform );
+    store.appendToBatch( mPosition, batch );
+    mPosition = store.next( mPosition );
   }
-  else
+
+  if ( !mPosition.isValid() )
     close();
 
-  return hasFeature;
+  return true;
 }
 
 bool QgsMemoryFeatureIterator::rewind()
@@ -229,10 +230,10 @@ bool QgsMemoryFeatureIterator::rewind()
   if ( mClosed )
     return false;
 
-  if ( mUsingFeatureIdList )
-    mFeatureIdListIterator = mFeatureIdList.constBegin();
+  if ( mUsingPositionList )
+    mPositionIndex = 0;
   else
-    mSelectIterator = mSource->mFeatures.constBegin();
+    mPosition = mSource->mFeatures.first();
 
   return true;
 }
@@ -252,8 +253,7 @@ bool QgsMemoryFeatureIterator::close()
 
 QgsMemoryFeatureSource::QgsMemoryFeatureSource( const QgsMemoryProvider *p )
   : mFields( p->mFields )
-  , mFeatures( p->mFeatures )
-  , mSpatialIndex( p->mSpatialIndex ? qgis::make_unique< QgsSpatialIndex >( *p->mSpatialIndex ) : nullptr ) // just shallow copy
+  , mFeatures( p->mFeatures ) // implicitly shared
   , mSubsetString( p->mSubsetString )
   , mCrs( p->mCrs )
 {
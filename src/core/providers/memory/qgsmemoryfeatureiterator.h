@@ -21,15 +21,12 @@
 #include "qgsexpressioncontext.h"
 #include "qgsfields.h"
 #include "qgsgeometry.h"
+#include "qgsmemoryfeaturestore.h"
 
 ///@cond PRIVATE
 
 class QgsMemoryProvider;
 
-typedef QMap<QgsFeatureId, QgsFeature> QgsFeatureMap;
-
-class QgsSpatialIndex;
-
 
 class QgsMemoryFeatureSource final: public QgsAbstractFeatureSource
 {
@@ -40,8 +37,7 @@ class QgsMemoryFeatureSource final: public QgsAbstractFeatureSource
 
   private:
     QgsFields mFields;
-    QgsFeatureMap mFeatures;
-    std::unique_ptr< QgsSpatialIndex > mSpatialIndex;
+    QgsMemoryFeatureStore mFeatures;
     QString mSubsetString;
     QgsExpressionContext mExpressionContext;
     QgsCoordinateReferenceSystem mCrs;
@@ -63,18 +59,30 @@ class QgsMemoryFeatureIterator final: public QgsAbstractFeatureIteratorFromSourc
   protected:
 
     bool fetchFeature( QgsFeature &feature ) override;
+    bool fetchBatch( QgsFeatureBatch &batch, int maxSize ) override;
 
   private:
     bool nextFeatureUsingList( QgsFeature &feature );
     bool nextFeatureTraverseAll( QgsFeature &feature );
 
+    /**
+     * Reads the feature at \a position into \a feature if it matches the filter rectangle and
+     * the subset string. \a boundingBoxChecked is TRUE if its bounding box is known to intersect
+     * the filter rectangle.
+     */
+    bool readFeature( QgsMemoryFeatureStore::Position position, bool boundingBoxChecked, QgsFeature &feature );
+
     QgsGeometry mSelectRectGeom;
     std::unique_ptr< QgsGeometryEngine > mSelectRectEngine;
     QgsRectangle mFilterRect;
-    QgsFeatureMap::const_iterator mSelectIterator;
-    bool mUsingFeatureIdList = false;
-    QList<QgsFeatureId> mFeatureIdList;
-    QList<QgsFeatureId>::const_iterator mFeatureIdListIterator;
+    QgsMemoryFeatureStore::Position mPosition;
+    bool mUsingPositionList = false;
+    //! TRUE if the positions come from the spatial index
+    bool mPositionsFromSpatialIndex = false;
+    QVector<QgsMemoryFeatureStore::Position> mPositions;
+    int mPositionIndex = 0;
+    bool mFetchGeometry = true;
+    QgsAttributeList mAttributes;
     std::unique_ptr< QgsExpression > mSubsetExpression;
     QgsCoordinateTransform mTransform;
 
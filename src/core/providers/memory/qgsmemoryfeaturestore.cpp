@@ -0,0 +1,800 @@
+/***************************************************************************
+    qgsmemoryfeaturestore.cpp
+    ---------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsmemoryfeaturestore.h"
+
+#include "qgsfeaturebatch.h"
+#include "qgsgeometry.h"
+
+#include <QMap>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+///@cond PRIVATE
+
+namespace
+{
+  //! Returns the position of (x, y) along a Hilbert curve, for 16 bit coordinates
+  quint32 hilbert( quint32 x, quint32 y )
+  {
+    // see "Fast Hilbert curve generation, sorting, and range queries" by rawrunprotected
+    quint32 a = x ^ y;
+    quint32 b = 0xFFFF ^ a;
+    quint32 c = 0xFFFF ^ ( x | y );
+    quint32 d = x & ( y ^ 0xFFFF );
+
+    quint32 A = a | ( b >> 1 );
+    quint32 B = ( a >> 1 ) ^ a;
+    quint32 C = ( ( c >> 1 ) ^ ( b & ( d >> 1 ) ) ) ^ c;
+    quint32 D = ( ( a & ( c >> 1 ) ) ^ ( d >> 1 ) ) ^ d;
+
+    a = A;
+    b = B;
+    c = C;
+    d = D;
+    A = ( ( a & ( a >> 2 ) ) ^ ( b & ( b >> 2 ) ) );
+    B = ( ( a & ( b >> 2 ) ) ^ ( b & ( ( a ^ b ) >> 2 ) ) );
+    C ^= ( ( a & ( c >> 2 ) ) ^ ( b & ( d >> 2 ) ) );
+    D ^= ( ( b & ( c >> 2 ) ) ^ ( ( a ^ b ) & ( d >> 2 ) ) );
+
+    a = A;
+    b = B;
+    c = C;
+    d = D;
+    A = ( ( a & ( a >> 4 ) ) ^ ( b & ( b >> 4 ) ) );
+    B = ( ( a & ( b >> 4 ) ) ^ ( b & ( ( a ^ b ) >> 4 ) ) );
+    C ^= ( ( a & ( c >> 4 ) ) ^ ( b & ( d >> 4 ) ) );
+    D ^= ( ( b & ( c >> 4 ) ) ^ ( ( a ^ b ) & ( d >> 4 ) ) );
+
+    a = A;
+    b = B;
+    c = C;
+    d = D;
+    C ^= ( ( a & ( c >> 8 ) ) ^ ( b & ( d >> 8 ) ) );
+    D ^= ( ( b & ( c >> 8 ) ) ^ ( ( a ^ b ) & ( d >> 8 ) ) );
+
+    a = C ^ ( C >> 1 );
+    b = D ^ ( D >> 1 );
+
+    quint32 i0 = x ^ y;
+    quint32 i1 = b | ( 0xFFFF ^ ( i0 | a ) );
+
+    i0 = ( i0 | ( i0 << 8 ) ) & 0x00FF00FF;
+    i0 = ( i0 | ( i0 << 4 ) ) & 0x0F0F0F0F;
+    i0 = ( i0 | ( i0 << 2 ) ) & 0x33333333;
+    i0 = ( i0 | ( i0 << 1 ) ) & 0x55555555;
+
+    i1 = ( i1 | ( i1 << 8 ) ) & 0x00FF00FF;
+    i1 = ( i1 | ( i1 << 4 ) ) & 0x0F0F0F0F;
+    i1 = ( i1 | ( i1 << 2 ) ) & 0x33333333;
+    i1 = ( i1 | ( i1 << 1 ) ) & 0x55555555;
+
+    return ( i1 << 1 ) | i0;
+  }
+
+  //! Inserts a bit at \a index in \a bits
+  void insertBit( QBitArray &bits, int index, bool value )
+  {
+    const int size = bits.size();
+    bits.resize( size + 1 );
+    for ( int i = size; i > index; --i )
+      bits.setBit( i, bits.testBit( i - 1 ) );
+    bits.setBit( index, value );
+  }
+}
+
+//
+// QgsMemoryFeatureStore::SpatialIndex
+//
+
+void QgsMemoryFeatureStore::SpatialIndex::build( const QVector<QSharedDataPointer<Chunk>> &chunks )
+{
+  mItems.clear();
+  QVector<QgsRectangle> boxes;
+  QgsRectangle extent;
+  extent.setMinimal();
+  for ( int c = 0; c < chunks.size(); ++c )
+  {
+    const Chunk *chunk = chunks.at( c ).constData();
+    for ( int row = 0; row < chunk->ids.size(); ++row )
+    {
+      const QgsRectangle &box = chunk->boundingBoxes.at( row );
+      if ( chunk->wkbOffsets.at( row + 1 ) == chunk->wkbOffsets.at( row ) || box.isNull() )
+        continue;
+
+      mItems << chunk->ids.at( row );
+      boxes << box;
+      extent.combineExtentWith( box );
+    }
+  }
+
+  mBuilt = true;
+  const int count = mItems.size();
+  if ( count == 0 )
+    return;
+
+  int levelCount = count;
+  int nodeCount = count;
+  mLevelBounds << nodeCount;
+  do
+  {
+    levelCount = ( levelCount + NODE_SIZE - 1 ) / NODE_SIZE;
+    nodeCount += levelCount;
+    mLevelBounds << nodeCount;
+  }
+  while ( levelCount > 1 );
+
+  mBoxes.resize( nodeCount * 4 );
+  mIndices.resize( nodeCount );
+
+  // the leaves are sorted along a Hilbert curve, so that close boxes share their parents
+  const double width = extent.width();
+  const double height = extent.height();
+  QVector<quint32> hilbertValues( count );
+  for ( int i = 0; i < count; ++i )
+  {
+    const QgsRectangle &box = boxes.at( i );
+    const quint32 x = width > 0 ? static_cast< quint32 >( 0xFFFF * ( ( box.xMinimum() + box.xMaximum() ) / 2 - extent.xMinimum() ) / width ) : 0;
+    const quint32 y = height > 0 ? static_cast< quint32 >( 0xFFFF * ( ( box.yMinimum() + box.yMaximum() ) / 2 - extent.yMinimum() ) / height ) : 0;
+    hilbertValues[i] = hilbert( x, y );
+  }
+  QVector<int> order( count );
+  std::iota( order.begin(), order.end(), 0 );
+  std::sort( order.begin(), order.end(), [&hilbertValues]( int a, int b ) { return hilbertValues.at( a ) < hilbertValues.at( b ); } );
+
+  double *nodeBoxes = mBoxes.data();
+  for ( int i = 0; i < count; ++i )
+  {
+    const QgsRectangle &box = boxes.at( order.at( i ) );
+    nodeBoxes[4 * i] = box.xMinimum();
+    nodeBoxes[4 * i + 1] = box.yMinimum();
+    nodeBoxes[4 * i + 2] = box.xMaximum();
+    nodeBoxes[4 * i + 3] = box.yMaximum();
+    mIndices[i] = order.at( i );
+  }
+
+  // each parent node covers the next NODE_SIZE nodes of the level below
+  int position = 0;
+  int parent = count;
+  for ( int level = 0; level < mLevelBounds.size() - 1; ++level )
+  {
+    const int end = mLevelBounds.at( level );
+    while ( position < end )
+    {
+      mIndices[parent] = position;
+      double xMin = std::numeric_limits<double>::max();
+      double yMin = std::numeric_limits<double>::max();
+      double xMax = std::numeric_limits<double>::lowest();
+      double yMax = std::numeric_limits<double>::lowest();
+      for ( int j = 0; j < NODE_SIZE && position < end; ++j, ++position )
+      {
+        xMin = std::min( xMin, nodeBoxes[4 * position] );
+        yMin = std::min( yMin, nodeBoxes[4 * position + 1] );
+        xMax = std::max( xMax, nodeBoxes[4 * position + 2] );
+        yMax = std::max( yMax, nodeBoxes[4 * position + 3] );
+      }
+      nodeBoxes[4 * parent] = xMin;
+      nodeBoxes[4 * parent + 1] = yMin;
+      nodeBoxes[4 * parent + 2] = xMax;
+      nodeBoxes[4 * parent + 3] = yMax;
+      ++parent;
+    }
+  }
+}
+
+QVector<QgsFeatureId> QgsMemoryFeatureStore::SpatialIndex::intersects( const QgsRectangle &rectangle ) const
+{
+  QVector<QgsFeatureId> ids;
+  if ( mItems.isEmpty() )
+    return ids;
+
+  const double *nodeBoxes = mBoxes.constData();
+  const int leafCount = mItems.size();
+  QVector<int> stack;
+  int node = mLevelBounds.constLast() - 1;
+  while ( true )
+  {
+    // the group of nodes starting at node ends at the end of its level, at most
+    const int levelEnd = *std::upper_bound( mLevelBounds.constBegin(), mLevelBounds.constEnd(), node );
+    const int end = std::min( node + NODE_SIZE, levelEnd );
+    for ( int i = node; i < end; ++i )
+    {
+      // same test as QgsRectangle::intersects(), touching boxes intersect
+      if ( nodeBoxes[4 * i] > rectangle.xMaximum() || nodeBoxes[4 * i + 1] > rectangle.yMaximum()
+           || nodeBoxes[4 * i + 2] < rectangle.xMinimum() || nodeBoxes[4 * i + 3] < rectangle.yMinimum() )
+        continue;
+
+      if ( node < leafCount )
+        ids << mItems.at( mIndices.at( i ) );
+      else
+        stack << mIndices.at( i );
+    }
+
+    if ( stack.isEmpty() )
+      break;
+    node = stack.takeLast();
+  }
+
+  return ids;
+}
+
+//
+// QgsMemoryFeatureStore
+//
+
+QgsMemoryFeatureStore::QgsMemoryFeatureStore( const QgsFields &fields )
+  : mFields( fields )
+  , mSpatialIndex( std::make_shared< SpatialIndex >() )
+{
+}
+
+QgsMemoryFeatureStore::Position QgsMemoryFeatureStore::next( Position position ) const
+{
+  if ( position.row + 1 < mChunks.at( position.chunk ).constData()->ids.size() )
+    return Position( position.chunk, position.row + 1 );
+  if ( position.chunk + 1 < mChunks.size() )
+    return Position( position.chunk + 1, 0 );
+  return Position();
+}
+
+QgsMemoryFeatureStore::Position QgsMemoryFeatureStore::find( QgsFeatureId id ) const
+{
+  // chunks are sorted by id and never empty
+  const auto chunkIt = std::lower_bound( mChunks.constBegin(), mChunks.constEnd(), id, []( const QSharedDataPointer<Chunk> &chunk, QgsFeatureId id )
+  {
+    return chunk.constData()->ids.constLast() < id;
+  } );
+  if ( chunkIt == mChunks.constEnd() )
+    return Position();
+
+  const QVector<QgsFeatureId> &ids = chunkIt->constData()->ids;
+  const auto rowIt = std::lower_bound( ids.constBegin(), ids.constEnd(), id );
+  if ( rowIt == ids.constEnd() || *rowIt != id )
+    return Position();
+
+  return Position( static_cast< int >( chunkIt - mChunks.constBegin() ), static_cast< int >( rowIt - ids.constBegin() ) );
+}
+
+bool QgsMemoryFeatureStore::hasGeometry( Position position ) const
+{
+  const Chunk *chunk = mChunks.at( position.chunk ).constData();
+  return chunk->wkbOffsets.at( position.row + 1 ) > chunk->wkbOffsets.at( position.row );
+}
+
+QgsGeometry QgsMemoryFeatureStore::geometry( Position position ) const
+{
+  const Chunk *chunk = mChunks.at( position.chunk ).constData();
+  const int offset = chunk->wkbOffsets.at( position.row );
+  const int size = chunk->wkbOffsets.at( position.row + 1 ) - offset;
+  if ( size == 0 )
+    return QgsGeometry();
+
+  // simple geometries are only parsed when they are used
+  QgsGeometry geometry;
+  geometry.fromWkb( QByteArray( chunk->wkb.constData() + offset, size ) );
+  return geometry;
+}
+
+QVariant QgsMemoryFeatureStore::attribute( Position position, int field ) const
+{
+  return value( mChunks.at( position.chunk ).constData()->columns.at( field ), position.row );
+}
+
+QgsFeature QgsMemoryFeatureStore::feature( Position position, bool fetchGeometry, const QgsAttributeList &attributes ) const
+{
+  const Chunk *chunk = mChunks.at( position.chunk ).constData();
+
+  QgsFeature feature( mFields, chunk->ids.at( position.row ) );
+  QgsAttributes values( mFields.count() );
+  for ( int field : attributes )
+  {
+    if ( field >= 0 && field < values.size() )
+      values[ field ] = value( chunk->columns.at( field ), position.row );
+  }
+  feature.setAttributes( values );
+  if ( fetchGeometry )
+    feature.setGeometry( geometry( position ) );
+  feature.setValid( true );
+  return feature;
+}
+
+QgsFeature QgsMemoryFeatureStore::feature( Position position ) const
+{
+  return feature( position, true, mFields.allAttributesList() );
+}
+
+void QgsMemoryFeatureStore::appendToBatch( Position position, QgsFeatureBatch &batch ) const
+{
+  const Chunk *chunk = mChunks.at( position.chunk ).constData();
+  const int row = position.row;
+
+  batch.appendRow( chunk->ids.at( row ) );
+  const QgsAttributeList attributes = batch.attributes();
+  for ( int i = 0; i < attributes.size(); ++i )
+  {
+    const int field = attributes.at( i );
+    if ( field < 0 || field >= chunk->columns.size() )
+      continue;
+
+    // typed values are copied as they are, without going through a variant
+    const Column &column = chunk->columns.at( field );
+    switch ( column.storage )
+    {
+      case Doubles:
+        if ( !column.validity.testBit( row ) )
+          continue;
+        if ( batch.columnType( i ) == QgsFeatureBatch::Double )
+        {
+          batch.setDouble( i, column.doubles.at( row ) );
+          continue;
+        }
+        break;
+
+      case Integers:
+        if ( !column.validity.testBit( row ) )
+          continue;
+        if ( batch.columnType( i ) == QgsFeatureBatch::Integer )
+        {
+          batch.setInteger( i, column.integers.at( row ) );
+          continue;
+        }
+        break;
+
+      case Variants:
+        break;
+    }
+    batch.setValue( i, value( column, row ) );
+  }
+
+  const int offset = chunk->wkbOffsets.at( row );
+  batch.setWkb( chunk->wkb.constData() + offset, chunk->wkbOffsets.at( row + 1 ) - offset );
+}
+
+QVector<QgsMemoryFeatureStore::Position> QgsMemoryFeatureStore::intersects( const QgsRectangle &rectangle ) const
+{
+  const QVector<QgsFeatureId> ids = spatialIndex().intersects( rectangle );
+
+  QVector<Position> positions;
+  positions.reserve( ids.size() );
+  for ( QgsFeatureId id : ids )
+  {
+    if ( !mIndexOutdated.contains( id ) )
+      positions << find( id );
+  }
+
+  // the boxes changed since the index was built
+  for ( auto it = mIndexChanges.constBegin(); it != mIndexChanges.constEnd(); ++it )
+  {
+    if ( it.value().intersects( rectangle ) )
+      positions << find( it.key() );
+  }
+
+  std::sort( positions.begin(), positions.end() );
+  return positions;
+}
+
+QgsRectangle QgsMemoryFeatureStore::extent() const
+{
+  QgsRectangle extent;
+  extent.setMinimal();
+  for ( const QSharedDataPointer<Chunk> &c : mChunks )
+  {
+    const Chunk *chunk = c.constData();
+    for ( int row = 0; row < chunk->ids.size(); ++row )
+    {
+      if ( chunk->wkbOffsets.at( row + 1 ) > chunk->wkbOffsets.at( row ) )
+        extent.combineExtentWith( chunk->boundingBoxes.at( row ) );
+    }
+  }
+  return extent;
+}
+
+void QgsMemoryFeatureStore::buildSpatialIndex() const
+{
+  spatialIndex();
+}
+
+void QgsMemoryFeatureStore::insert( const QgsFeature &feature )
+{
+  const QgsFeatureId id = feature.id();
+  Q_ASSERT( !find( id ).isValid() );
+
+  // features are normally added with increasing ids, at the end of the last chunk
+  int chunkIndex = mChunks.size() - 1;
+  int row = 0;
+  const auto chunkIt = std::lower_bound( mChunks.constBegin(), mChunks.constEnd(), id, []( const QSharedDataPointer<Chunk> &chunk, QgsFeatureId id )
+  {
+    return chunk.constData()->ids.constLast() < id;
+  } );
+  if ( chunkIt != mChunks.constEnd() )
+  {
+    chunkIndex = static_cast< int >( chunkIt - mChunks.constBegin() );
+    const QVector<QgsFeatureId> &ids = chunkIt->constData()->ids;
+    row = static_cast< int >( std::lower_bound( ids.constBegin(), ids.constEnd(), id ) - ids.constBegin() );
+  }
+  else if ( chunkIndex >= 0 && mChunks.at( chunkIndex ).constData()->ids.size() < CHUNK_SIZE )
+  {
+    row = mChunks.at( chunkIndex ).constData()->ids.size();
+  }
+  else
+  {
+    QSharedDataPointer<Chunk> chunk( new Chunk() );
+    chunk->columns.reserve( mFields.count() );
+    for ( const QgsField &field : mFields )
+      chunk->columns << createColumn( field.type() );
+    mChunks << chunk;
+    chunkIndex = mChunks.size() - 1;
+  }
+
+  Chunk &chunk = *mChunks[ chunkIndex ];
+  chunk.ids.insert( row, id );
+
+  const QgsAttributes attributes = feature.attributes();
+  for ( int i = 0; i < chunk.columns.size(); ++i )
+  {
+    Column &column = chunk.columns[i];
+    const QVariant value = i < attributes.size() ? attributes.at( i ) : QVariant();
+    if ( column.storage != Variants && !fitsColumn( column, value ) )
+      storeAsVariants( column );
+
+    switch ( column.storage )
+    {
+      case Doubles:
+        column.doubles.insert( row, value.isNull() ? 0 : value.toDouble() );
+        insertBit( column.validity, row, !value.isNull() );
+        insertBit( column.untypedNulls, row, value.type() == QVariant::Invalid );
+        break;
+      case Integers:
+        column.integers.insert( row, value.isNull() ? 0 : value.toLongLong() );
+        insertBit( column.validity, row, !value.isNull() );
+        insertBit( column.untypedNulls, row, value.type() == QVariant::Invalid );
+        break;
+      case Variants:
+        column.variants.insert( row, value );
+        break;
+    }
+  }
+
+  QByteArray wkb;
+  QgsRectangle boundingBox;
+  if ( feature.hasGeometry() )
+  {
+    const QgsGeometry geometry = feature.geometry();
+    wkb = geometry.asWkb();
+    boundingBox = geometry.boundingBox();
+  }
+  const int offset = chunk.wkbOffsets.at( row );
+  chunk.wkb.insert( offset, wkb );
+  chunk.wkbOffsets.insert( row + 1, offset + wkb.size() );
+  for ( int i = row + 2; i < chunk.wkbOffsets.size(); ++i )
+    chunk.wkbOffsets[i] += wkb.size();
+  chunk.boundingBoxes.insert( row, boundingBox );
+
+  ++mCount;
+  updateSpatialIndex( id, boundingBox );
+}
+
+void QgsMemoryFeatureStore::remove( const QgsFeatureIds &ids )
+{
+  // rows to remove of each chunk
+  QMap<int, QBitArray> removedRows;
+  for ( QgsFeatureId id : ids )
+  {
+    const Position position = find( id );
+    if ( !position.isValid() )
+      continue;
+
+    QBitArray &removed = removedRows[ position.chunk ];
+    if ( removed.isEmpty() )
+      removed.resize( mChunks.at( position.chunk ).constData()->ids.size() );
+    removed.setBit( position.row );
+  }
+  if ( removedRows.isEmpty() )
+    return;
+
+  for ( QgsFeatureId id : ids )
+    updateSpatialIndex( id, QgsRectangle() );
+
+  // from the last chunk, so that removing an empty chunk does not move the next ones to process
+  for ( auto it = removedRows.constEnd(); it != removedRows.constBegin(); )
+  {
+    --it;
+    const int removedCount = it.value().count( true );
+    if ( removedCount == mChunks.at( it.key() ).constData()->ids.size() )
+      mChunks.remove( it.key() );
+    else
+      removeRows( *mChunks[ it.key() ], it.value() );
+    mCount -= removedCount;
+  }
+}
+
+void QgsMemoryFeatureStore::clear()
+{
+  resetSpatialIndex();
+  mChunks.clear();
+  mCount = 0;
+}
+
+void QgsMemoryFeatureStore::setGeometry( QgsFeatureId id, const QgsGeometry &geometry )
+{
+  const Position position = find( id );
+  if ( !position.isValid() )
+    return;
+
+  Chunk &chunk = *mChunks[ position.chunk ];
+  const QByteArray wkb = geometry.isNull() ? QByteArray() : geometry.asWkb();
+  const int offset = chunk.wkbOffsets.at( position.row );
+  const int delta = wkb.size() - ( chunk.wkbOffsets.at( position.row + 1 ) - offset );
+  chunk.wkb.replace( offset, chunk.wkbOffsets.at( position.row + 1 ) - offset, wkb );
+  for ( int i = position.row + 1; i < chunk.wkbOffsets.size(); ++i )
+    chunk.wkbOffsets[i] += delta;
+  chunk.boundingBoxes[ position.row ] = geometry.isNull() ? QgsRectangle() : geometry.boundingBox();
+  updateSpatialIndex( id, chunk.boundingBoxes.at( position.row ) );
+}
+
+void QgsMemoryFeatureStore::setAttribute( Position position, int field, const QVariant &value )
+{
+  // attributes are not indexed, the spatial index stays valid
+  setValue( mChunks[ position.chunk ]->columns[ field ], position.row, value );
+}
+
+void QgsMemoryFeatureStore::addField( const QgsField &field )
+{
+  mFields.append( field );
+  for ( int i = 0; i < mChunks.size(); ++i )
+  {
+    // the existing features get an untyped NULL
+    Chunk &chunk = *mChunks[i];
+    const int rowCount = chunk.ids.size();
+    Column column = createColumn( field.type() );
+    switch ( column.storage )
+    {
+      case Doubles:
+        column.doubles.fill( 0, rowCount );
+        column.validity.resize( rowCount );
+        column.untypedNulls.fill( true, rowCount );
+        break;
+      case Integers:
+        column.integers.fill( 0, rowCount );
+        column.validity.resize( rowCount );
+        column.untypedNulls.fill( true, rowCount );
+        break;
+      case Variants:
+        column.variants.fill( QVariant(), rowCount );
+        break;
+    }
+    chunk.columns << column;
+  }
+}
+
+void QgsMemoryFeatureStore::removeField( int index )
+{
+  mFields.remove( index );
+  for ( int i = 0; i < mChunks.size(); ++i )
+    mChunks[i]->columns.remove( index );
+}
+
+QgsMemoryFeatureStore::Column QgsMemoryFeatureStore::createColumn( QVariant::Type type )
+{
+  Column column;
+  column.type = type;
+  switch ( type )
+  {
+    case QVariant::Double:
+      column.storage = Doubles;
+      break;
+
+    case QVariant::Int:
+    case QVariant::LongLong:
+    case QVariant::Bool:
+      column.storage = Integers;
+      break;
+
+    default:
+      column.storage = Variants;
+      break;
+  }
+  return column;
+}
+
+QVariant QgsMemoryFeatureStore::value( const Column &column, int row )
+{
+  switch ( column.storage )
+  {
+    case Doubles:
+      if ( !column.validity.testBit( row ) )
+        return column.untypedNulls.testBit( row ) ? QVariant() : QVariant( column.type );
+      return column.doubles.at( row );
+
+    case Integers:
+    {
+      if ( !column.validity.testBit( row ) )
+        return column.untypedNulls.testBit( row ) ? QVariant() : QVariant( column.type );
+      const qlonglong value = column.integers.at( row );
+      switch ( column.type )
+      {
+        case QVariant::Int:
+          return static_cast< int >( value );
+        case QVariant::Bool:
+          return value != 0;
+        default:
+          return value;
+      }
+    }
+
+    case Variants:
+      return column.variants.at( row );
+  }
+  return QVariant();
+}
+
+void QgsMemoryFeatureStore::setValue( Column &column, int row, const QVariant &value )
+{
+  if ( column.storage != Variants && !fitsColumn( column, value ) )
+    storeAsVariants( column );
+
+  switch ( column.storage )
+  {
+    case Doubles:
+      column.doubles[row] = value.isNull() ? 0 : value.toDouble();
+      column.validity.setBit( row, !value.isNull() );
+      column.untypedNulls.setBit( row, value.type() == QVariant::Invalid );
+      break;
+    case Integers:
+      column.integers[row] = value.isNull() ? 0 : value.toLongLong();
+      column.validity.setBit( row, !value.isNull() );
+      column.untypedNulls.setBit( row, value.type() == QVariant::Invalid );
+      break;
+    case Variants:
+      column.variants[row] = value;
+      break;
+  }
+}
+
+bool QgsMemoryFeatureStore::fitsColumn( const Column &column, const QVariant &value )
+{
+  // values of another type are kept as they are, as variants
+  return value.type() == column.type || value.type() == QVariant::Invalid;
+}
+
+void QgsMemoryFeatureStore::storeAsVariants( Column &column )
+{
+  const int rowCount = column.validity.size();
+  column.variants.reserve( rowCount );
+  for ( int row = 0; row < rowCount; ++row )
+    column.variants << value( column, row );
+
+  column.storage = Variants;
+  column.doubles = QVector<double>();
+  column.integers = QVector<qlonglong>();
+  column.validity = QBitArray();
+  column.untypedNulls = QBitArray();
+}
+
+void QgsMemoryFeatureStore::removeRows( Chunk &chunk, const QBitArray &removed )
+{
+  const int rowCount = chunk.ids.size();
+
+  // kept rows are moved to the front, in place
+  QByteArray wkb;
+  wkb.reserve( chunk.wkb.size() );
+  int kept = 0;
+  for ( int row = 0; row < rowCount; ++row )
+  {
+    if ( removed.testBit( row ) )
+      continue;
+
+    chunk.ids[kept] = chunk.ids.at( row );
+    for ( Column &column : chunk.columns )
+    {
+      switch ( column.storage )
+      {
+        case Doubles:
+          column.doubles[kept] = column.doubles.at( row );
+          column.validity.setBit( kept, column.validity.testBit( row ) );
+          column.untypedNulls.setBit( kept, column.untypedNulls.testBit( row ) );
+          break;
+        case Integers:
+          column.integers[kept] = column.integers.at( row );
+          column.validity.setBit( kept, column.validity.testBit( row ) );
+          column.untypedNulls.setBit( kept, column.untypedNulls.testBit( row ) );
+          break;
+        case Variants:
+          column.variants[kept] = column.variants.at( row );
+          break;
+      }
+    }
+
+    const int offset = chunk.wkbOffsets.at( row );
+    wkb.append( chunk.wkb.constData() + offset, chunk.wkbOffsets.at( row + 1 ) - offset );
+    chunk.wkbOffsets[kept + 1] = wkb.size();
+    chunk.boundingBoxes[kept] = chunk.boundingBoxes.at( row );
+    ++kept;
+  }
+
+  chunk.ids.resize( kept );
+  for ( Column &column : chunk.columns )
+  {
+    switch ( column.storage )
+    {
+      case Doubles:
+        column.doubles.resize( kept );
+        column.validity.resize( kept );
+        column.untypedNulls.resize( kept );
+        break;
+      case Integers:
+        column.integers.resize( kept );
+        column.validity.resize( kept );
+        column.untypedNulls.resize( kept );
+        break;
+      case Variants:
+        column.variants.resize( kept );
+        break;
+    }
+  }
+  chunk.wkb = wkb;
+  chunk.wkbOffsets.resize( kept + 1 );
+  chunk.boundingBoxes.resize( kept );
+}
+
+QgsMemoryFeatureStore::SpatialIndex &QgsMemoryFeatureStore::spatialIndex() const
+{
+  // the index may be shared with copies of the store used from other threads
+  SpatialIndex &index = *mSpatialIndex;
+  QMutexLocker locker( &index.mutex );
+  if ( !index.isBuilt() )
+    index.build( mChunks );
+  return index;
+}
+
+void QgsMemoryFeatureStore::updateSpatialIndex( QgsFeatureId id, const QgsRectangle &box )
+{
+  bool built = false;
+  {
+    QMutexLocker locker( &mSpatialIndex->mutex );
+    built = mSpatialIndex->isBuilt();
+  }
+
+  if ( !built )
+  {
+    // an index which is not built yet and only used by this store is built with the change,
+    // one shared with copies of the store could be built from their features
+    if ( mSpatialIndex.use_count() > 1 )
+      mSpatialIndex = std::make_shared< SpatialIndex >();
+    return;
+  }
+
+  // the built index stays shared, only this store sees the change
+  mIndexOutdated.insert( id );
+  if ( box.isNull() )
+    mIndexChanges.remove( id );
+  else
+    mIndexChanges.insert( id, box );
+
+  // checking too many boxes one by one costs more than building the index again
+  if ( mIndexOutdated.size() > std::max( MIN_INDEX_CHANGES, mCount / 16 ) )
+    resetSpatialIndex();
+}
+
+void QgsMemoryFeatureStore::resetSpatialIndex()
+{
+  mIndexOutdated.clear();
+  mIndexChanges.clear();
+  if ( mSpatialIndex.use_count() > 1 || mSpatialIndex->isBuilt() )
+    mSpatialIndex = std::make_shared< SpatialIndex >();
+}
+
+///@endcond
@@ -0,0 +1,261 @@
+/***************************************************************************
+    qgsmemoryfeaturestore.h
+    ---------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSMEMORYFEATURESTORE_H
+#define QGSMEMORYFEATURESTORE_H
+
+#define SIP_NO_FILE
+
+#include "qgsfeature.h"
+#include "qgsfields.h"
+#include "qgsrectangle.h"
+
+#include <QBitArray>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QSharedData>
+#include <QVector>
+
+#include <memory>
+
+class QgsFeatureBatch;
+
+///@cond PRIVATE
+
+/**
+ * Storage of the features of the memory provider.
+ *
+ * Features are stored by increasing id in chunks of contiguous rows. Within a
+ * chunk, numeric and boolean attributes are stored in typed arrays, the other
+ * attributes as variants, and the geometries are packed one after the other as
+ * WKB next to their bounding boxes.
+ *
+ * The store is implicitly shared, and so is each of its chunks: a copy of the
+ * store, e.g. for a feature source, only costs a reference, and a change to the
+ * original only duplicates the chunks it touches.
+ *
+ * Spatial queries use a packed R-tree of the bounding boxes, built on first use
+ * and shared by all the copies of the store. The boxes changed afterwards are
+ * kept apart from the tree and checked one by one, until there are too many of
+ * them and the tree is built again.
+ */
+class QgsMemoryFeatureStore
+{
+  public:
+
+    //! Position of a feature in the store
+    struct Position
+    {
+      Position() = default;
+      Position( int chunk, int row )
+        : chunk( chunk )
+        , row( row )
+      {}
+
+      bool isValid() const { return chunk >= 0; }
+
+      bool operator==( const Position &other ) const { return chunk == other.chunk && row == other.row; }
+      bool operator!=( const Position &other ) const { return !( *this == other ); }
+      bool operator<( const Position &other ) const { return chunk < other.chunk || ( chunk == other.chunk && row < other.row ); }
+
+      int chunk = -1;
+      int row = -1;
+    };
+
+    //! Maximum number of features appended to a chunk
+    static const int CHUNK_SIZE = 1024;
+
+    //! Creates an empty store for features with the given \a fields
+    explicit QgsMemoryFeatureStore( const QgsFields &fields = QgsFields() );
+
+    //! Returns the number of features
+    int count() const { return mCount; }
+
+    //! Returns TRUE if there is no feature
+    bool isEmpty() const { return mCount == 0; }
+
+    //! Returns the position of the first feature, or an invalid position if the store is empty
+    Position first() const { return mChunks.isEmpty() ? Position() : Position( 0, 0 ); }
+
+    //! Returns the position of the feature following \a position, or an invalid position
+    Position next( Position position ) const;
+
+    //! Returns the position of the feature with the given \a id, or an invalid position
+    Position find( QgsFeatureId id ) const;
+
+    //! Returns the id of the feature at \a position
+    QgsFeatureId id( Position position ) const { return mChunks.at( position.chunk ).constData()->ids.at( position.row ); }
+
+    //! Returns TRUE if the feature at \a position has a geometry
+    bool hasGeometry( Position position ) const;
+
+    //! Returns the bounding box of the geometry of the feature at \a position
+    QgsRectangle boundingBox( Position position ) const { return mChunks.at( position.chunk ).constData()->boundingBoxes.at( position.row ); }
+
+    //! Returns the geometry of the feature at \a position
+    QgsGeometry geometry( Position position ) const;
+
+    //! Returns the value of the attribute \a field of the feature at \a position
+    QVariant attribute( Position position, int field ) const;
+
+    /**
+     * Returns the feature at \a position, with its geometry if \a fetchGeometry is TRUE
+     * and the attributes in \a attributes. The other attributes are left NULL.
+     */
+    QgsFeature feature( Position position, bool fetchGeometry, const QgsAttributeList &attributes ) const;
+
+    //! Returns the feature at \a position with all its attributes and geometry
+    QgsFeature feature( Position position ) const;
+
+    //! Appends the feature at \a position to \a batch, reading the typed columns directly
+    void appendToBatch( Position position, QgsFeatureBatch &batch ) const;
+
+    /**
+     * Returns the positions of the features whose bounding box intersects \a rectangle,
+     * in the order of the store.
+     */
+    QVector<Position> intersects( const QgsRectangle &rectangle ) const;
+
+    //! Returns the extent of the geometries
+    QgsRectangle extent() const;
+
+    //! Builds the spatial index now rather than on the first spatial query
+    void buildSpatialIndex() const;
+
+    /**
+     * Adds \a feature. Its id must not already exist in the store and its
+     * attributes must match the fields of the store.
+     */
+    void insert( const QgsFeature &feature );
+
+    //! Removes the features with the given \a ids
+    void remove( const QgsFeatureIds &ids );
+
+    //! Removes all the features
+    void clear();
+
+    //! Sets the geometry of the feature with the given \a id
+    void setGeometry( QgsFeatureId id, const QgsGeometry &geometry );
+
+    //! Sets the attribute \a field of the feature at \a position to \a value
+    void setAttribute( Position position, int field, const QVariant &value );
+
+    //! Appends \a field, NULL for the existing features
+    void addField( const QgsField &field );
+
+    //! Removes the field at \a index
+    void removeField( int index );
+
+  private:
+
+    //! Storage of the values of a column in a chunk
+    enum Storage
+    {
+      Doubles,
+      Integers,
+      Variants,
+    };
+
+    struct Column
+    {
+      Storage storage = Variants;
+      //! Type of the values of a typed column, other values are stored as variants
+      QVariant::Type type = QVariant::Invalid;
+      QVector<double> doubles;
+      QVector<qlonglong> integers;
+      QVector<QVariant> variants;
+      //! NULL values of a typed column, as cleared bits
+      QBitArray validity;
+      //! NULL values of a typed column which are an invalid QVariant rather than a NULL of its type
+      QBitArray untypedNulls;
+    };
+
+    struct Chunk : public QSharedData
+    {
+      QVector<QgsFeatureId> ids;
+      QVector<Column> columns;
+      //! Start of the WKB of each row in wkb, plus the end of the last one
+      QVector<int> wkbOffsets = QVector<int>() << 0;
+      QByteArray wkb;
+      QVector<QgsRectangle> boundingBoxes;
+    };
+
+    /**
+     * Packed Hilbert R-tree of the bounding boxes of the features, with all the
+     * nodes stored level by level in flat arrays.
+     */
+    class SpatialIndex
+    {
+      public:
+        void build( const QVector<QSharedDataPointer<Chunk>> &chunks );
+        bool isBuilt() const { return mBuilt; }
+        //! Returns the ids of the features whose box intersects \a rectangle, in no particular order
+        QVector<QgsFeatureId> intersects( const QgsRectangle &rectangle ) const;
+
+        QMutex mutex;
+
+      private:
+        static const int NODE_SIZE = 16;
+
+        bool mBuilt = false;
+        //! xmin, ymin, xmax, ymax of each node
+        QVector<double> mBoxes;
+        //! Item of each leaf node, first child of each parent node
+        QVector<int> mIndices;
+        //! End of each level in the nodes, starting with the leaves
+        QVector<int> mLevelBounds;
+        //! Feature id of each item, which unlike its position does not change with the store
+        QVector<QgsFeatureId> mItems;
+    };
+
+    //! Minimum number of changed boxes kept apart from the spatial index before it is built again
+    static const int MIN_INDEX_CHANGES = 1024;
+
+    static Column createColumn( QVariant::Type type );
+    static QVariant value( const Column &column, int row );
+    static void setValue( Column &column, int row, const QVariant &value );
+    //! Returns TRUE if \a value can be stored in the typed \a column
+    static bool fitsColumn( const Column &column, const QVariant &value );
+    //! Switches a typed column to variants, to store a value which does not match its type
+    static void storeAsVariants( Column &column );
+    //! Removes the rows of \a chunk whose bit in \a removed is set
+    static void removeRows( Chunk &chunk, const QBitArray &removed );
+
+    //! Returns the index, built if needed
+    SpatialIndex &spatialIndex() const;
+
+    /**
+     * Records that the bounding box of the feature \a id changes to \a box, a null
+     * box if the feature has no geometry anymore or is removed. The changes are
+     * kept apart from a built spatial index, which is only forgotten once there
+     * are too many of them.
+     */
+    void updateSpatialIndex( QgsFeatureId id, const QgsRectangle &box );
+
+    //! Forgets the spatial index and its changes
+    void resetSpatialIndex();
+
+    QgsFields mFields;
+    QVector<QSharedDataPointer<Chunk>> mChunks;
+    int mCount = 0;
+    mutable std::shared_ptr<SpatialIndex> mSpatialIndex;
+    //! Features whose box in the built spatial index is outdated
+    QSet<QgsFeatureId> mIndexOutdated;
+    //! Boxes of the features added or changed since the spatial index was built
+    QHash<QgsFeatureId, QgsRectangle> mIndexChanges;
+};
+
+///@endcond
+
+#endif // QGSMEMORYFEATURESTORE_H
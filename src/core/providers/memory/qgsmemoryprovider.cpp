@@ -20,7 +20,6 @@
 #include "qgsfields.h"
 #include "qgsgeometry.h"
 #include "qgslogger.h"
-#include "qgsspatialindex.h"
 #include "qgscoordinatereferencesystem.h"
 
 #include <QUrl>
@@ -212,10 +211,7 @@ QgsMemoryProvider::QgsMemoryProvider( const QString &uri, const ProviderOptions
 
 }
 
-QgsMemoryProvider::~QgsMemoryProvider()
-{
-  delete mSpatialIndex;
-}
+QgsMemoryProvider::~QgsMemoryProvider() = default;
 
 QString QgsMemoryProvider::providerKey()
 {
@@ -260,7 +256,7 @@ QString QgsMemoryProvider::dataSourceUri( bool expandAuthConfig ) const
     }
     query.addQueryItem( QStringLiteral( "crs" ), crsDef );
   }
-  if ( mSpatialIndex )
+  if ( mHasSpatialIndex )
   {
     query.addQueryItem( QStringLiteral( "index" ), QStringLiteral( "yes" ) );
   }
@@ -297,13 +293,8 @@ QgsRectangle QgsMemoryProvider::extent() const
     mExtent.setMinimal();
     if ( mSubsetString.isEmpty() )
     {
-      // fast way - iterate through all features
-      const auto constMFeatures = mFeatures;
-      for ( const QgsFeature &feat : constMFeatures )
-      {
-        if ( feat.hasGeometry() )
-          mExtent.combineExtentWith( feat.geometry().boundingBox() );
-      }
+      // fast way - combine the stored bounding boxes, without reading the geometries
+      mExtent = mFeatures.extent();
     }
     else
     {
@@ -453,18 +444,11 @@ bool QgsMemoryProvider::addFeatures( QgsFeatureList &flist, Flags flags )
       continue;
     }
 
-    mFeatures.insert( mNextFeatureId, *it );
+    mFeatures.insert( *it );
     addedFids.insert( mNextFeatureId );
 
-    if ( it->hasGeometry() )
-    {
-      if ( updateExtent )
-        mExtent.combineExtentWith( it->geometry().boundingBox() );
-
-      // update spatial index
-      if ( mSpatialIndex )
-        mSpatialIndex->addFeature( *it );
-    }
+    if ( it->hasGeometry() && updateExtent )
+      mExtent.combineExtentWith( it->geometry().boundingBox() );
 
     mNextFeatureId++;
   }
@@ -472,10 +456,7 @@ bool QgsMemoryProvider::addFeatures( QgsFeatureList &flist, Flags flags )
   // Roll back
   if ( ! result && flags.testFlag( QgsFeatureSink::Flag::RollBackOnErrors ) )
   {
-    for ( const QgsFeatureId &addedFid : addedFids )
-    {
-      mFeatures.remove( addedFid );
-    }
+    mFeatures.remove( addedFids );
     mExtent = oldExtent;
     mNextFeatureId = oldNextFeatureId;
   }
@@ -489,20 +470,8 @@ bool QgsMemoryProvider::addFeatures( QgsFeatureList &flist, Flags flags )
 
 bool QgsMemoryProvider::deleteFeatures( const QgsFeatureIds &id )
 {
-  for ( QgsFeatureIds::const_iterator it = id.begin(); it != id.end(); ++it )
-  {
-    QgsFeatureMap::iterator fit = mFeatures.find( *it );
-
-    // check whether such feature exists
-    if ( fit == mFeatures.end() )
-      continue;
-
-    // update spatial index
-    if ( mSpatialIndex )
-      mSpatialIndex->deleteFeature( *fit );
-
-    mFeatures.erase( fit );
-  }
+  // ids which do not exist are ignored
+  mFeatures.remove( id );
 
   updateExtents();
   clearMinMaxCache();
@@ -534,14 +503,7 @@ bool QgsMemoryProvider::addAttributes( const QList<QgsField> &attributes )
     }
     // add new field as a last one
     mFields.append( *it );
-
-    for ( QgsFeatureMap::iterator fit = mFeatures.begin(); fit != mFeatures.end(); ++fit )
-    {
-      QgsFeature &f = fit.value();
-      QgsAttributes attr = f.attributes();
-      attr.append( QVariant() );
-      f.setAttributes( attr );
-    }
+    mFeatures.addField( *it );
   }
   return true;
 }
@@ -580,14 +542,7 @@ bool QgsMemoryProvider::deleteAttributes( const QgsAttributeIds &attributes )
   {
     int idx = *it;
     mFields.remove( idx );
-
-    for ( QgsFeatureMap::iterator fit = mFeatures.begin(); fit != mFeatures.end(); ++fit )
-    {
-      QgsFeature &f = fit.value();
-      QgsAttributes attr = f.attributes();
-      attr.remove( idx );
-      f.setAttributes( attr );
-    }
+    mFeatures.removeField( idx );
   }
   clearMinMaxCache();
   return true;
@@ -602,8 +557,8 @@ bool QgsMemoryProvider::changeAttributeValues( const QgsChangedAttributesMap &at
   QString errorMessage;
   for ( QgsChangedAttributesMap::const_iterator it = attr_map.begin(); it != attr_map.end(); ++it )
   {
-    QgsFeatureMap::iterator fit = mFeatures.find( it.key() );
-    if ( fit == mFeatures.end() )
+    const QgsMemoryFeatureStore::Position position = mFeatures.find( it.key() );
+    if ( !position.isValid() )
       continue;
 
     const QgsAttributeMap &attrs = it.value();
@@ -628,8 +583,8 @@ bool QgsMemoryProvider::changeAttributeValues( const QgsChangedAttributesMap &at
         result = false;
         break;
       }
-      rollBackAttrs.insert( it2.key(), fit->attribute( it2.key() ) );
-      fit->setAttribute( it2.key(), it2.value() );
+      rollBackAttrs.insert( it2.key(), mFeatures.attribute( position, it2.key() ) );
+      mFeatures.setAttribute( position, it2.key(), it2.value() );
     }
     rollBackMap.insert( it.key(), rollBackAttrs );
   }
@@ -650,19 +605,7 @@ bool QgsMemoryProvider::changeGeometryValues( const QgsGeometryMap &geometry_map
 {
   for ( QgsGeometryMap::const_iterator it = geometry_map.begin(); it != geometry_map.end(); ++it )
   {
-    QgsFeatureMap::iterator fit = mFeatures.find( it.key() );
-    if ( fit == mFeatures.end() )
-      continue;
-
-    // update spatial index
-    if ( mSpatialIndex )
-      mSpatialIndex->deleteFeature( *fit );
-
-    fit->setGeometry( it.value() );
-
-    // update spatial index
-    if ( mSpatialIndex )
-      mSpatialIndex->addFeature( *fit );
+    mFeatures.setGeometry( it.key(), it.value() );
   }
 
   updateExtents();
@@ -699,22 +642,15 @@ bool QgsMemoryProvider::setSubsetString( const QString &theSQL, bool updateFeatu
 
 bool QgsMemoryProvider::createSpatialIndex()
 {
-  if ( !mSpatialIndex )
-  {
-    mSpatialIndex = new QgsSpatialIndex();
-
-    // add existing features to index
-    for ( QgsFeatureMap::iterator it = mFeatures.begin(); it != mFeatures.end(); ++it )
-    {
-      mSpatialIndex->addFeature( *it );
-    }
-  }
+  // the store is always indexed, the index is just built now rather than on the first spatial query
+  mHasSpatialIndex = true;
+  mFeatures.buildSpatialIndex();
   return true;
 }
 
 QgsFeatureSource::SpatialIndexPresence QgsMemoryProvider::hasSpatialIndex() const
 {
-  return mSpatialIndex ? SpatialIndexPresent : SpatialIndexNotPresent;
+  return mHasSpatialIndex ? SpatialIndexPresent : SpatialIndexNotPresent;
 }
 
 QgsVectorDataProvider::Capabilities QgsMemoryProvider::capabilities() const
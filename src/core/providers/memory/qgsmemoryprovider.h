@@ -18,11 +18,9 @@
 #include "qgsvectordataprovider.h"
 #include "qgscoordinatereferencesystem.h"
 #include "qgsfields.h"
+#include "qgsmemoryfeaturestore.h"
 
 ///@cond PRIVATE
-typedef QMap<QgsFeatureId, QgsFeature> QgsFeatureMap;
-
-class QgsSpatialIndex;
 
 class QgsMemoryFeatureIterator;
 
@@ -91,11 +89,11 @@ class QgsMemoryProvider final: public QgsVectorDataProvider
     mutable QgsRectangle mExtent;
 
     // features
-    QgsFeatureMap mFeatures;
+    QgsMemoryFeatureStore mFeatures;
     QgsFeatureId mNextFeatureId;
 
-    // indexing
-    QgsSpatialIndex *mSpatialIndex = nullptr;
+    // the store is always spatially indexed, this tells whether an index was explicitly requested
+    bool mHasSpatialIndex = false;
 
     QString mSubsetString;
 
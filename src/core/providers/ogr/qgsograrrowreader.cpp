@@ -0,0 +1,440 @@
+/***************************************************************************
+    qgsograrrowreader.cpp
+    ---------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsograrrowreader.h"
+
+#include "qgsfeaturebatch.h"
+#include "qgsgeometry.h"
+#include "qgslogger.h"
+#include "qgsogrutils.h"
+
+#include <QDate>
+#include <QTextCodec>
+#include <QtEndian>
+
+///@cond PRIVATE
+
+QgsOgrArrowReader::~QgsOgrArrowReader()
+{
+  close();
+}
+
+bool QgsOgrArrowReader::isSupported( OGRLayerH layer )
+{
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(3,6,0)
+  return layer && OGR_L_TestCapability( layer, OLCFastGetArrowStream );
+#else
+  Q_UNUSED( layer )
+  return false;
+#endif
+}
+
+QgsOgrArrowReader::Format QgsOgrArrowReader::format( const char *format )
+{
+  // see https://arrow.apache.org/docs/format/CDataInterface.html#data-type-description-format-strings
+  const QByteArray f( format );
+  if ( f == "b" )
+    return Boolean;
+  if ( f == "c" )
+    return Int8;
+  if ( f == "C" )
+    return UInt8;
+  if ( f == "s" )
+    return Int16;
+  if ( f == "S" )
+    return UInt16;
+  if ( f == "i" )
+    return Int32;
+  if ( f == "I" )
+    return UInt32;
+  if ( f == "l" )
+    return Int64;
+  if ( f == "L" )
+    return UInt64;
+  if ( f == "f" )
+    return Float32;
+  if ( f == "g" )
+    return Float64;
+  if ( f == "u" )
+    return Utf8;
+  if ( f == "U" )
+    return LargeUtf8;
+  if ( f == "z" )
+    return Binary;
+  if ( f == "Z" )
+    return LargeBinary;
+  if ( f == "tdD" )
+    return Date32;
+  return Unsupported;
+}
+
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(3,6,0)
+
+namespace
+{
+  bool isValid( const ArrowArray *array, qint64 index )
+  {
+    const uint8_t *validity = static_cast<const uint8_t *>( array->buffers[0] );
+    return array->null_count == 0 || !validity || ( validity[index / 8] >> ( index % 8 ) ) & 1;
+  }
+
+  template <typename T>
+  T value( const ArrowArray *array, qint64 index )
+  {
+    return static_cast<const T *>( array->buffers[1] )[index];
+  }
+
+  //! Returns the bytes of a variable size value and sets \a size to their size
+  template <typename OFFSET>
+  const char *bytes( const ArrowArray *array, qint64 index, int &size )
+  {
+    const OFFSET *offsets = static_cast<const OFFSET *>( array->buffers[1] );
+    size = static_cast<int>( offsets[index + 1] - offsets[index] );
+    return static_cast<const char *>( array->buffers[2] ) + offsets[index];
+  }
+}
+
+#endif
+
+bool QgsOgrArrowReader::open( OGRLayerH layer, const QgsFields &fields, bool firstFieldIsFid, QTextCodec *encoding, QgsWkbTypes::Type wkbType )
+{
+  close();
+
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(3,6,0)
+  if ( !isSupported( layer ) )
+    return false;
+
+  if ( !OGR_L_GetArrowStream( layer, &mStream, nullptr ) )
+    return false;
+
+  mOpen = true;
+  if ( mStream.get_schema( &mStream, &mSchema ) != 0 )
+  {
+    QgsDebugMsg( QStringLiteral( "Could not read the Arrow schema: %1" ).arg( mStream.get_last_error( &mStream ) ) );
+    close();
+    return false;
+  }
+
+  mFields = fields;
+  mFirstFieldIsFid = firstFieldIsFid;
+  mEncoding = encoding;
+  mPromoteToMulti = QgsWkbTypes::isMultiType( wkbType );
+
+  // the stream starts with the FID and ends with the geometry, named after their OGR columns
+  QByteArray fidName( OGR_L_GetFIDColumn( layer ) );
+  if ( fidName.isEmpty() )
+    fidName = QByteArrayLiteral( "OGC_FID" );
+  QByteArray geometryName( OGR_L_GetGeometryColumn( layer ) );
+  if ( geometryName.isEmpty() )
+    geometryName = QByteArrayLiteral( "wkb_geometry" );
+
+  for ( int i = 0; i < mSchema.n_children; ++i )
+  {
+    const ArrowSchema *child = mSchema.children[i];
+    const Format columnFormat = format( child->format );
+    mFormats << columnFormat;
+
+    const QByteArray name( child->name );
+    if ( i == 0 && name == fidName && columnFormat == Int64 )
+    {
+      mFidColumn = i;
+    }
+    else if ( mGeometryColumn < 0 && name == geometryName && ( columnFormat == Binary || columnFormat == LargeBinary ) )
+    {
+      mGeometryColumn = i;
+    }
+    else if ( columnFormat == Unsupported )
+    {
+      QgsDebugMsgLevel( QStringLiteral( "Arrow column %1 has the unsupported format %2" ).arg( QString::fromUtf8( name ), QString::fromUtf8( child->format ) ), 2 );
+      close();
+      return false;
+    }
+    else
+    {
+      mColumnByName.insert( mEncoding ? mEncoding->toUnicode( name ) : QString::fromUtf8( name ), i );
+    }
+  }
+  return true;
+#else
+  Q_UNUSED( layer )
+  Q_UNUSED( fields )
+  Q_UNUSED( firstFieldIsFid )
+  Q_UNUSED( encoding )
+  Q_UNUSED( wkbType )
+  return false;
+#endif
+}
+
+void QgsOgrArrowReader::close()
+{
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(3,6,0)
+  releaseArray();
+  if ( mSchema.release )
+    mSchema.release( &mSchema );
+  mSchema = ArrowSchema{};
+  if ( mStream.release )
+    mStream.release( &mStream );
+  mStream = ArrowArrayStream{};
+#endif
+
+  mOpen = false;
+  mFormats.clear();
+  mColumnByName.clear();
+  mFidColumn = -1;
+  mGeometryColumn = -1;
+}
+
+void QgsOgrArrowReader::releaseArray()
+{
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(3,6,0)
+  if ( mArray.release )
+    mArray.release( &mArray );
+  mArray = ArrowArray{};
+#endif
+  mRow = 0;
+}
+
+bool QgsOgrArrowReader::read( QgsFeatureBatch &batch, int maxSize )
+{
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(3,6,0)
+  if ( !mOpen )
+    return false;
+
+  // column of the stream of each column of the batch, -1 if the stream does not contain it
+  const QgsAttributeList attributes = batch.attributes();
+  QVector<int> columns;
+  columns.reserve( attributes.size() );
+  for ( int attindex : attributes )
+  {
+    if ( mFirstFieldIsFid && attindex == 0 )
+      columns << mFidColumn;
+    else if ( mFields.exists( attindex ) )
+      columns << mColumnByName.value( mFields.at( attindex ).name(), -1 );
+    else
+      columns << -1;
+  }
+  const bool readGeometry = mGeometryColumn >= 0 && batch.fetchGeometry();
+
+  while ( batch.size() < maxSize )
+  {
+    if ( !mArray.release || mRow >= mArray.length )
+    {
+      releaseArray();
+      if ( mStream.get_next( &mStream, &mArray ) != 0 )
+      {
+        QgsDebugMsg( QStringLiteral( "Could not read the Arrow stream: %1" ).arg( mStream.get_last_error( &mStream ) ) );
+        return false;
+      }
+      // a released array marks the end of the stream
+      if ( !mArray.release )
+        return false;
+      continue;
+    }
+
+    const qint64 count = std::min<qint64>( maxSize - batch.size(), mArray.length - mRow );
+    for ( qint64 i = 0; i < count; ++i, ++mRow )
+    {
+      const qint64 row = mArray.offset + mRow;
+
+      QgsFeatureId fid = FID_NULL;
+      if ( mFidColumn >= 0 )
+      {
+        const ArrowArray *child = mArray.children[ mFidColumn ];
+        fid = value<int64_t>( child, row + child->offset );
+      }
+      batch.appendRow( fid );
+
+      for ( int column = 0; column < columns.size(); ++column )
+      {
+        const int streamColumn = columns.at( column );
+        if ( streamColumn < 0 )
+          continue;
+
+        const ArrowArray *child = mArray.children[ streamColumn ];
+        const qint64 index = row + child->offset;
+        if ( !isValid( child, index ) )
+          continue;
+
+        const Format columnFormat = mFormats.at( streamColumn );
+        switch ( batch.columnType( column ) )
+        {
+          case QgsFeatureBatch::Double:
+            switch ( columnFormat )
+            {
+              case Float64:
+                batch.setDouble( column, value<double>( child, index ) );
+                continue;
+              case Float32:
+                batch.setDouble( column, value<float>( child, index ) );
+                continue;
+              case Int32:
+                batch.setDouble( column, value<int32_t>( child, index ) );
+                continue;
+              case Int64:
+                batch.setDouble( column, value<int64_t>( child, index ) );
+                continue;
+              default:
+                break;
+            }
+            break;
+
+          case QgsFeatureBatch::Integer:
+            switch ( columnFormat )
+            {
+              case Boolean:
+              {
+                const uint8_t *bits = static_cast<const uint8_t *>( child->buffers[1] );
+                batch.setInteger( column, ( bits[index / 8] >> ( index % 8 ) ) & 1 );
+                continue;
+              }
+              case Int16:
+                batch.setInteger( column, value<int16_t>( child, index ) );
+                continue;
+              case Int32:
+                batch.setInteger( column, value<int32_t>( child, index ) );
+                continue;
+              case Int64:
+                batch.setInteger( column, value<int64_t>( child, index ) );
+                continue;
+              default:
+                break;
+            }
+            break;
+
+          case QgsFeatureBatch::Variant:
+            break;
+        }
+
+        // less common combinations go through a variant
+        QVariant v;
+        int size = 0;
+        switch ( columnFormat )
+        {
+          case Boolean:
+          {
+            const uint8_t *bits = static_cast<const uint8_t *>( child->buffers[1] );
+            v = static_cast<bool>( ( bits[index / 8] >> ( index % 8 ) ) & 1 );
+            break;
+          }
+          case Int8:
+            v = static_cast<int>( value<int8_t>( child, index ) );
+            break;
+          case UInt8:
+            v = static_cast<int>( value<uint8_t>( child, index ) );
+            break;
+          case Int16:
+            v = static_cast<int>( value<int16_t>( child, index ) );
+            break;
+          case UInt16:
+            v = static_cast<int>( value<uint16_t>( child, index ) );
+            break;
+          case Int32:
+            v = static_cast<int>( value<int32_t>( child, index ) );
+            break;
+          case UInt32:
+            v = static_cast<qlonglong>( value<uint32_t>( child, index ) );
+            break;
+          case Int64:
+            v = static_cast<qlonglong>( value<int64_t>( child, index ) );
+            break;
+          case UInt64:
+            v = static_cast<qulonglong>( value<uint64_t>( child, index ) );
+            break;
+          case Float32:
+            v = static_cast<double>( value<float>( child, index ) );
+            break;
+          case Float64:
+            v = value<double>( child, index );
+            break;
+          case Utf8:
+          {
+            const char *data = bytes<int32_t>( child, index, size );
+            v = mEncoding ? mEncoding->toUnicode( data, size ) : QString::fromUtf8( data, size );
+            break;
+          }
+          case LargeUtf8:
+          {
+            const char *data = bytes<int64_t>( child, index, size );
+            v = mEncoding ? mEncoding->toUnicode( data, size ) : QString::fromUtf8( data, size );
+            break;
+          }
+          case Binary:
+          {
+            const char *data = bytes<int32_t>( child, index, size );
+            v = QByteArray( data, size );
+            break;
+          }
+          case LargeBinary:
+          {
+            const char *data = bytes<int64_t>( child, index, size );
+            v = QByteArray( data, size );
+            break;
+          }
+          case Date32:
+            v = QDate( 1970, 1, 1 ).addDays( value<int32_t>( child, index ) );
+            break;
+          case Unsupported:
+            break;
+        }
+
+        const QVariant::Type fieldType = mFields.at( attributes.at( column ) ).type();
+        if ( v.type() != fieldType && fieldType != QVariant::Invalid )
+          v.convert( fieldType );
+        batch.setValue( column, v );
+      }
+
+      if ( readGeometry )
+      {
+        const ArrowArray *child = mArray.children[ mGeometryColumn ];
+        const qint64 index = row + child->offset;
+        if ( !isValid( child, index ) )
+          continue;
+
+        int size = 0;
+        const char *wkb = mFormats.at( mGeometryColumn ) == Binary ? bytes<int32_t>( child, index, size ) : bytes<int64_t>( child, index, size );
+        if ( size < 5 )
+          continue;
+
+        const unsigned char *data = reinterpret_cast<const unsigned char *>( wkb );
+        const quint32 type = data[0] ? qFromLittleEndian<quint32>( data + 1 ) : qFromBigEndian<quint32>( data + 1 );
+        const quint32 flatType = type % 1000;
+        if ( flatType == wkbGeometryCollection || flatType == wkbPolyhedralSurface || flatType == wkbTIN
+             || ( mPromoteToMulti && !QgsWkbTypes::isMultiType( static_cast<QgsWkbTypes::Type>( type ) ) ) )
+        {
+          // same conversions as for the features read one by one
+          OGRGeometryH ogrGeometry = nullptr;
+          if ( OGR_G_CreateFromWkb( data, nullptr, &ogrGeometry, size ) != OGRERR_NONE )
+            continue;
+
+          QgsGeometry geometry = QgsOgrUtils::ogrGeometryToQgsGeometry( ogrGeometry );
+          OGR_G_DestroyGeometry( ogrGeometry );
+          if ( mPromoteToMulti && !geometry.isMultipart() )
+            geometry.convertToMultiType();
+          batch.setGeometry( geometry );
+        }
+        else
+        {
+          batch.setWkb( wkb, size );
+        }
+      }
+    }
+  }
+  return true;
+#else
+  Q_UNUSED( batch )
+  Q_UNUSED( maxSize )
+  return false;
+#endif
+}
+
+///@endcond
@@ -0,0 +1,133 @@
+/***************************************************************************
+    qgsograrrowreader.h
+    -------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSOGRARROWREADER_H
+#define QGSOGRARROWREADER_H
+
+#define SIP_NO_FILE
+
+#include "qgsfields.h"
+#include "qgswkbtypes.h"
+
+#include <QHash>
+#include <QVector>
+
+#include <gdal.h>
+#include <ogr_api.h>
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(3,6,0)
+#include <ogr_recordbatch.h>
+#endif
+
+class QgsFeatureBatch;
+class QTextCodec;
+
+///@cond PRIVATE
+
+/**
+ * Reads the features of an OGR layer from its Arrow stream, i.e. by whole column
+ * batches, instead of one OGRFeature at a time.
+ *
+ * The stream respects the ignored fields, spatial filter and attribute filter of
+ * the layer. It is only used with GDAL >= 3.6 and for the drivers with a fast
+ * implementation of the stream, such as Parquet, Arrow, FlatGeobuf or GeoPackage.
+ * The layer must not be read by other means while the reader is open.
+ */
+class QgsOgrArrowReader
+{
+  public:
+    QgsOgrArrowReader() = default;
+    ~QgsOgrArrowReader();
+
+    QgsOgrArrowReader( const QgsOgrArrowReader &other ) = delete;
+    QgsOgrArrowReader &operator=( const QgsOgrArrowReader &other ) = delete;
+
+    //! Returns TRUE if \a layer has a fast Arrow stream
+    static bool isSupported( OGRLayerH layer );
+
+    /**
+     * Starts reading the features of \a layer from the first one.
+     *
+     * \a fields are the fields of the provider, whose first one is the FID if
+     * \a firstFieldIsFid is TRUE. Strings are decoded with \a encoding. Single part
+     * geometries are converted to multi part ones if \a wkbType is a multi type.
+     *
+     * Returns FALSE if the stream is not available or contains columns which
+     * cannot be decoded, in which case the features must be read one by one.
+     */
+    bool open( OGRLayerH layer, const QgsFields &fields, bool firstFieldIsFid, QTextCodec *encoding, QgsWkbTypes::Type wkbType );
+
+    //! Returns TRUE if the reader is open
+    bool isOpen() const { return mOpen; }
+
+    //! Releases the stream
+    void close();
+
+    /**
+     * Appends the next features to \a batch, until it contains \a maxSize features.
+     * Returns FALSE if the features were all read.
+     */
+    bool read( QgsFeatureBatch &batch, int maxSize );
+
+  private:
+
+    //! Types of the Arrow columns which can be decoded
+    enum Format
+    {
+      Unsupported,
+      Boolean,
+      Int8,
+      UInt8,
+      Int16,
+      UInt16,
+      Int32,
+      UInt32,
+      Int64,
+      UInt64,
+      Float32,
+      Float64,
+      Utf8,
+      LargeUtf8,
+      Binary,
+      LargeBinary,
+      Date32,
+    };
+
+    static Format format( const char *format );
+
+    void releaseArray();
+
+    bool mOpen = false;
+    QgsFields mFields;
+    bool mFirstFieldIsFid = false;
+    QTextCodec *mEncoding = nullptr;
+    bool mPromoteToMulti = false;
+
+    //! Format of each column of the stream
+    QVector<Format> mFormats;
+    //! Column of each field of the stream, by name
+    QHash<QString, int> mColumnByName;
+    int mFidColumn = -1;
+    int mGeometryColumn = -1;
+
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(3,6,0)
+    ArrowArrayStream mStream{};
+    ArrowSchema mSchema{};
+    ArrowArray mArray{};
+#endif
+    //! Next row of mArray to read
+    qint64 mRow = 0;
+};
+
+///@endcond
+
+#endif // QGSOGRARROWREADER_H
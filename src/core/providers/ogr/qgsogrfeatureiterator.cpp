@@ -20,6 +20,7 @@
 
 #include "qgsogrutils.h"
 #include "qgsapplication.h"
+#include "qgsfeaturebatch.h"
 #include "qgsgeometry.h"
 #include "qgslogger.h"
 #include "qgsmessagelog.h"
@@ -184,7 +185,18 @@ QgsOgrFeatureIterator::QgsOgrFeatureIterator( QgsOgrFeatureSource *source, bool
     QgsSqlExpressionCompiler *compiler = nullptr;
     if ( source->mDriverName == QLatin1String( "SQLite" ) || source->mDriverName == QLatin1String( "GPKG" ) )
     {
-      compiler = new QgsSQLiteExpressionCompiler( source->mFields );
+      QgsSQLiteExpressionCompiler *sqliteCompiler = new QgsSQLiteExpressionCompiler( source->mFields );
+      // spatial predicates are prefiltered by bounding box, unless the filter is evaluated on reprojected
+      // geometries or by OGR itself for a SQL subset
+      if ( source->mDriverName == QLatin1String( "GPKG" ) && !mTransform.isValid() && ( !mOgrLayerOri || mOgrLayerOri == mOgrLayer ) )
+      {
+        const QString tableName = QString::fromUtf8( OGR_L_GetName( mOgrLayer ) );
+        const QString geometryColumn = QString::fromUtf8( OGR_L_GetGeometryColumn( mOgrLayer ) );
+        sqliteCompiler->setGeometryColumn( geometryColumn, 0, QgsSQLiteExpressionCompiler::GeoPackageFunctions );
+        if ( !geometryColumn.isEmpty() && OGR_L_TestCapability( mOgrLayer, OLCFastSpatialFilter ) )
+          sqliteCompiler->setSpatialIndex( QStringLiteral( "rtree_%1_%2" ).arg( tableName, geometryColumn ), QString::fromUtf8( OGR_L_GetFIDColumn( mOgrLayer ) ) );
+      }
+      compiler = sqliteCompiler;
     }
     else
     {
@@ -226,6 +238,16 @@ QgsOgrFeatureIterator::QgsOgrFeatureIterator( QgsOgrFeatureSource *source, bool
   }
 
 
+  // sequential reads of drivers with a fast Arrow stream fetch whole column batches
+  mUseArrowStream = ( mRequest.filterType() == QgsFeatureRequest::FilterNone || mRequest.filterType() == QgsFeatureRequest::FilterExpression )
+                    && mSource->mOgrGeometryTypeFilter == wkbUnknown
+                    && QgsOgrProviderUtils::canDriverShareSameDatasetAmongLayers( mSource->mDriverName )
+                    && QgsOgrArrowReader::isSupported( mOgrLayer );
+  if ( mUseArrowStream )
+  {
+    mArrowFeatures = QgsFeatureBatch( mSource->mFields, attrs, mFetchGeometry );
+  }
+
   //start with first feature
   rewind();
 }
@@ -345,8 +367,30 @@ bool QgsOgrFeatureIterator::fetchFeature( QgsFeature &feature )
     return false;
   }
 
+  if ( mArrowReader.isOpen() )
+  {
+    if ( fetchArrowFeature( feature ) )
+      return true;
+
+    close();
+    return false;
+  }
+
   gdal::ogr_feature_unique_ptr fet;
+  while ( nextOgrFeature( fet ) )
+  {
+    if ( checkFeature( fet, feature ) )
+    {
+      return true;
+    }
+  }
+
+  close();
+  return false;
+}
 
+bool QgsOgrFeatureIterator::nextOgrFeature( gdal::ogr_feature_unique_ptr &fet )
+{
   // OSM layers (especially large ones) need the GDALDataset::GetNextFeature() call rather than OGRLayer::GetNextFeature()
   // see more details here: https://trac.osgeo.org/gdal/wiki/rfc66_randomlayerreadwrite
 
@@ -356,27 +400,166 @@ bool QgsOgrFeatureIterator::fetchFeature( QgsFeature &feature )
     OGRLayerH nextFeatureBelongingLayer;
     while ( fet.reset( GDALDatasetGetNextFeature( mConn->ds, &nextFeatureBelongingLayer, nullptr, nullptr, nullptr ) ), fet )
     {
-      if ( nextFeatureBelongingLayer == mOgrLayer && checkFeature( fet, feature ) )
+      if ( nextFeatureBelongingLayer == mOgrLayer )
       {
         return true;
       }
     }
+    return false;
   }
-  else
 #endif
+
+  fet.reset( OGR_L_GetNextFeature( mOgrLayer ) );
+  return static_cast< bool >( fet );
+}
+
+bool QgsOgrFeatureIterator::fetchArrowFeature( QgsFeature &feature )
+{
+  while ( true )
+  {
+    if ( mArrowFeatureRow >= mArrowFeatures.size() )
+    {
+      mArrowFeatures.clear();
+      mArrowFeatureRow = 0;
+      mArrowReader.read( mArrowFeatures, ARROW_BATCH_SIZE );
+      if ( mArrowFeatures.isEmpty() )
+        return false;
+    }
+
+    feature = mArrowFeatures.feature( mArrowFeatureRow++ );
+
+    // same checks as readFeature(), on top of the spatial filter of the layer
+    if ( !mFilterRect.isNull() )
+    {
+      if ( !feature.hasGeometry() || feature.geometry().isEmpty() )
+        continue;
+      if ( mRequest.flags() & QgsFeatureRequest::ExactIntersect ? !feature.geometry().intersects( mFilterRect ) : !feature.geometry().boundingBoxIntersects( mFilterRect ) )
+        continue;
+    }
+
+    feature.setValid( true );
+    geometryToDestinationCrs( feature, mTransform );
+    return true;
+  }
+}
+
+bool QgsOgrFeatureIterator::fetchBatch( QgsFeatureBatch &batch, int maxSize )
+{
+  // features needing an exact check or a conversion of their geometry are read one by one
+  if ( mTransform.isValid() || mSource->mOgrGeometryTypeFilter != wkbUnknown
+       || ( !mFilterRect.isNull() && ( mRequest.flags() & QgsFeatureRequest::ExactIntersect ) ) )
+    return false;
+
+  QMutexLocker locker( mSharedDS ? &mSharedDS->mutex() : nullptr );
+
+  if ( mClosed || !mOgrLayer )
+    return true;
+
+  if ( mArrowReader.isOpen() )
   {
+    // the spatial filter of the layer already applies to the stream
+    while ( batch.size() < maxSize && mArrowFeatureRow < mArrowFeatures.size() )
+      batch.appendFeature( mArrowFeatures.feature( mArrowFeatureRow++ ) );
+    if ( batch.size() < maxSize )
+      mArrowReader.read( batch, maxSize );
+    if ( batch.size() < maxSize )
+      close();
+    return true;
+  }
+
+  // OGR field of each column of the batch, -1 for the FID and -2 for the fields unknown to the layer
+  const QgsAttributeList attributes = batch.attributes();
+  QVector<int> ogrFields;
+  ogrFields.reserve( attributes.size() );
+  for ( int attindex : attributes )
+  {
+    const int attindexWithoutFid = ( mFirstFieldIsFid ) ? attindex - 1 : attindex;
+    if ( mFirstFieldIsFid && attindex == 0 )
+      ogrFields << -1;
+    else if ( attindexWithoutFid >= 0 && attindexWithoutFid < mFieldsWithoutFid.count() )
+      ogrFields << attindexWithoutFid;
+    else
+      ogrFields << -2;
+  }
+
+  const bool storeGeometry = mFetchGeometry && batch.fetchGeometry();
+  const bool isMultiLayer = QgsWkbTypes::isMultiType( mSource->mWkbType );
+  QByteArray wkb;
 
-    while ( fet.reset( OGR_L_GetNextFeature( mOgrLayer ) ), fet )
+  gdal::ogr_feature_unique_ptr fet;
+  while ( batch.size() < maxSize && nextOgrFeature( fet ) )
+  {
+    OGRGeometryH geom = mFetchGeometry ? OGR_F_GetGeometryRef( fet.get() ) : nullptr;
+
+    if ( !mFilterRect.isNull() )
+    {
+      // same bounding box check as readFeature() without ExactIntersect
+      if ( !geom || OGR_G_IsEmpty( geom ) )
+        continue;
+
+      OGREnvelope envelope;
+      OGR_G_GetEnvelope( geom, &envelope );
+      if ( !mFilterRect.intersects( QgsRectangle( envelope.MinX, envelope.MinY, envelope.MaxX, envelope.MaxY ) ) )
+        continue;
+    }
+
+    const GIntBig fid = OGR_F_GetFID( fet.get() );
+    batch.appendRow( fid );
+
+    for ( int column = 0; column < ogrFields.size(); ++column )
     {
-      if ( checkFeature( fet, feature ) )
+      const int ogrField = ogrFields.at( column );
+      if ( ogrField == -1 )
       {
-        return true;
+        batch.setValue( column, static_cast<qint64>( fid ) );
+        continue;
+      }
+
+      if ( ogrField < 0 || !OGR_F_IsFieldSetAndNotNull( fet.get(), ogrField ) )
+        continue;
+
+      switch ( batch.columnType( column ) )
+      {
+        case QgsFeatureBatch::Double:
+          batch.setDouble( column, OGR_F_GetFieldAsDouble( fet.get(), ogrField ) );
+          break;
+
+        case QgsFeatureBatch::Integer:
+          batch.setInteger( column, OGR_F_GetFieldAsInteger64( fet.get(), ogrField ) );
+          break;
+
+        case QgsFeatureBatch::Variant:
+          batch.setValue( column, QgsOgrUtils::getOgrFeatureAttribute( fet.get(), mFieldsWithoutFid.at( ogrField ), ogrField, mSource->mEncoding ) );
+          break;
+      }
+    }
+
+    if ( storeGeometry && geom )
+    {
+      const OGRwkbGeometryType flatType = wkbFlatten( OGR_G_GetGeometryType( geom ) );
+      const bool needsConversion = flatType == wkbGeometryCollection || flatType == wkbTIN || flatType == wkbPolyhedralSurface
+                                   || ( isMultiLayer && !OGR_GT_IsSubClassOf( flatType, wkbGeometryCollection ) );
+      if ( needsConversion )
+      {
+        // rare geometries fixed by QgsOgrUtils, or to promote to the multi type of the layer
+        QgsGeometry g = QgsOgrUtils::ogrGeometryToQgsGeometry( geom );
+        if ( isMultiLayer && !g.isMultipart() )
+          g.convertToMultiType();
+        batch.setGeometry( g );
+      }
+      else
+      {
+        wkb.resize( OGR_G_WkbSize( geom ) );
+        OGR_G_ExportToIsoWkb( geom, wkbNDR, reinterpret_cast<unsigned char *>( wkb.data() ) );
+        batch.setWkb( wkb.constData(), wkb.size() );
       }
     }
   }
 
-  close();
-  return false;
+  if ( batch.size() < maxSize )
+    close();
+
+  return true;
 }
 
 void QgsOgrFeatureIterator::resetReading()
@@ -401,10 +584,21 @@ bool QgsOgrFeatureIterator::rewind()
   if ( mClosed || !mOgrLayer )
     return false;
 
+  mArrowReader.close();
   resetReading();
 
   mFilterFidsIt = mFilterFids.begin();
 
+  if ( mUseArrowStream )
+  {
+    mArrowFeatures.clear();
+    mArrowFeatureRow = 0;
+    // falls back to reading features one by one if the stream holds unsupported columns
+    mUseArrowStream = mArrowReader.open( mOgrLayer, mSource->mFields, mFirstFieldIsFid, mSource->mEncoding, mSource->mWkbType );
+    if ( !mUseArrowStream )
+      resetReading();
+  }
+
   return true;
 }
 
@@ -415,6 +609,8 @@ bool QgsOgrFeatureIterator::close()
   {
     iteratorClosed();
 
+    mArrowReader.close();
+
     mOgrLayer = nullptr;
     mSharedDS.reset();
     mClosed = true;
@@ -426,6 +622,8 @@ bool QgsOgrFeatureIterator::close()
 
   iteratorClosed();
 
+  mArrowReader.close();
+
   // Will for example release SQLite3 statements
   if ( mOgrLayer )
   {
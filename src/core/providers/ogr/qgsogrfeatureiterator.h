@@ -16,7 +16,9 @@
 #define QGSOGRFEATUREITERATOR_H
 
 #include "qgsfeatureiterator.h"
+#include "qgsfeaturebatch.h"
 #include "qgsogrconnpool.h"
+#include "qgsograrrowreader.h"
 #include "qgsfields.h"
 
 #include <ogr_api.h>
@@ -75,11 +77,18 @@ class QgsOgrFeatureIterator final: public QgsAbstractFeatureIteratorFromSource<Q
     bool checkFeature( gdal::ogr_feature_unique_ptr &fet, QgsFeature &feature ) ;
     bool fetchFeature( QgsFeature &feature ) override;
     bool nextFeatureFilterExpression( QgsFeature &f ) override;
+    bool fetchBatch( QgsFeatureBatch &batch, int maxSize ) override;
 
   private:
 
     bool readFeature( gdal::ogr_feature_unique_ptr fet, QgsFeature &feature ) const;
 
+    //! Reads the next feature of the layer, without any check
+    bool nextOgrFeature( gdal::ogr_feature_unique_ptr &fet );
+
+    //! Reads the next feature from the Arrow stream of the layer
+    bool fetchArrowFeature( QgsFeature &feature );
+
     //! Gets an attribute associated with a feature
     void getFeatureAttribute( OGRFeatureH ogrFet, QgsFeature &f, int attindex ) const;
 
@@ -104,6 +113,16 @@ class QgsOgrFeatureIterator final: public QgsAbstractFeatureIteratorFromSource<Q
 
     bool fetchFeatureWithId( QgsFeatureId id, QgsFeature &feature ) const;
 
+    //! Number of features read at once from the Arrow stream for fetchFeature()
+    static const int ARROW_BATCH_SIZE = 1000;
+
+    //! Whether the features are read from the Arrow stream of the layer
+    bool mUseArrowStream = false;
+    QgsOgrArrowReader mArrowReader;
+    //! Features read from the Arrow stream but not returned yet
+    QgsFeatureBatch mArrowFeatures;
+    int mArrowFeatureRow = 0;
+
     void resetReading();
 };
 
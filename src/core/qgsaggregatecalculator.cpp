@@ -17,12 +17,13 @@
 
 #include "qgsaggregatecalculator.h"
 #include "qgsfeature.h"
+#include "qgsfeaturebatch.h"
 #include "qgsfeaturerequest.h"
 #include "qgsfeatureiterator.h"
 #include "qgsgeometry.h"
 #include "qgsvectorlayer.h"
 
-
+static const int AGGREGATE_BATCH_SIZE = 4096;
 
 QgsAggregateCalculator::QgsAggregateCalculator( const QgsVectorLayer *layer )
   : mLayer( layer )
@@ -124,9 +125,194 @@ QVariant QgsAggregateCalculator::calculate( QgsAggregateCalculator::Aggregate ag
     resultType = mLayer->fields().at( attrNum ).type();
 
   QgsFeatureIterator fit = mLayer->getFeatures( request );
+
+  // the numeric statistics of a field or of a numeric expression are computed over
+  // batches of columns, as long as the iterator does not filter the features itself
+  bool statOk = false;
+  const QgsStatisticalSummary::Statistic stat = numericStatFromAggregate( aggregate, &statOk );
+  const bool numeric = resultType == QVariant::Int || resultType == QVariant::UInt || resultType == QVariant::LongLong
+                       || resultType == QVariant::ULongLong || resultType == QVariant::Double;
+  if ( statOk && numeric && request.filterType() == QgsFeatureRequest::FilterNone
+       && ( !expression || expression->canEvaluateByColumns() ) && !request.subsetOfAttributes().isEmpty() )
+  {
+    QgsFeatureBatch batch( mLayer->fields(), request.subsetOfAttributes(), expression && expression->needsGeometry() );
+    if ( ok )
+      *ok = true;
+    return calculateNumericAggregate( fit, batch, attrNum, expression.get(), context, stat );
+  }
+
   return calculate( aggregate, fit, resultType, attrNum, expression.get(), mDelimiter, context, ok );
 }
 
+///@cond PRIVATE
+
+//! Iterates over the values of a group, as features holding the value as their only attribute
+class QgsValueListIterator : public QgsAbstractFeatureIterator
+{
+  public:
+    explicit QgsValueListIterator( const QVariantList &values )
+      : QgsAbstractFeatureIterator( QgsFeatureRequest() )
+      , mValues( values )
+    {}
+
+    bool rewind() override
+    {
+      mIndex = 0;
+      return true;
+    }
+
+    bool close() override
+    {
+      mClosed = true;
+      return true;
+    }
+
+  protected:
+    bool fetchFeature( QgsFeature &f ) override
+    {
+      if ( mClosed || mIndex >= mValues.size() )
+        return false;
+      f.setId( mIndex );
+      f.setAttributes( QgsAttributes() << mValues.at( mIndex++ ) );
+      return true;
+    }
+
+  private:
+    QVariantList mValues;
+    int mIndex = 0;
+};
+
+///@endcond
+
+QHash<QString, QVariant> QgsAggregateCalculator::calculateGrouped( QgsAggregateCalculator::Aggregate aggregate, const QString &fieldOrExpression, const QString &groupByExpression,
+    const std::function< QString( const QVariant & ) > &groupKey, QgsExpressionContext *context, QVariant *emptyResult, bool *ok ) const
+{
+  QHash<QString, QVariant> results;
+  if ( ok )
+    *ok = false;
+
+  if ( !mLayer )
+    return results;
+
+  QgsExpressionContext defaultContext = mLayer->createExpressionContext();
+  context = context ? context : &defaultContext;
+  context->setFields( mLayer->fields() );
+
+  std::unique_ptr<QgsExpression> expression;
+  const int attrNum = mLayer->fields().lookupField( fieldOrExpression );
+  if ( attrNum == -1 )
+  {
+    expression.reset( new QgsExpression( fieldOrExpression ) );
+    if ( expression->hasParserError() || !expression->prepare( context ) )
+      return results;
+  }
+
+  QgsExpression groupBy( groupByExpression );
+  if ( groupBy.hasParserError() || !groupBy.prepare( context ) )
+    return results;
+
+  QSet<QString> lst = groupBy.referencedColumns();
+  if ( !expression )
+    lst.insert( fieldOrExpression );
+  else
+    lst.unite( expression->referencedColumns() );
+
+  QgsFeatureRequest request;
+  request.setFlags( ( expression && expression->needsGeometry() ) || groupBy.needsGeometry() ?
+                    QgsFeatureRequest::NoFlags :
+                    QgsFeatureRequest::NoGeometry )
+  .setSubsetOfAttributes( lst, mLayer->fields() );
+
+  if ( mFidsSet )
+    request.setFilterFids( mFidsFilter );
+
+  if ( !mOrderBy.empty() )
+    request.setOrderBy( mOrderBy );
+
+  if ( !mFilterExpression.isEmpty() )
+    request.setFilterExpression( mFilterExpression );
+  request.setExpressionContext( *context );
+
+  // split the aggregated values by group, keeping their order within each group,
+  // so that only the values are kept in memory and not the features
+  QHash<QString, int> groupIndexes;
+  QStringList keys;
+  QVector<QVariantList> groups;
+  QgsFeatureIterator fit = mLayer->getFeatures( request );
+  QgsFeature f;
+  while ( fit.nextFeature( f ) )
+  {
+    context->setFeature( f );
+    const QString key = groupKey( groupBy.evaluate( context ) );
+    if ( key.isNull() )
+      continue;
+
+    auto it = groupIndexes.constFind( key );
+    if ( it == groupIndexes.constEnd() )
+    {
+      it = groupIndexes.insert( key, groups.size() );
+      keys << key;
+      groups.append( QVariantList() );
+    }
+    groups[ it.value() ] << ( expression ? expression->evaluate( context ) : f.attribute( attrNum ) );
+  }
+
+  // same as calculate() for the values of a group
+  auto calculateGroup = [&]( const QVariantList & values, bool * groupOk ) -> QVariant
+  {
+    QVariant::Type resultType = QVariant::Double;
+    if ( expression )
+    {
+      if ( values.isEmpty() )
+      {
+        *groupOk = true;
+        return defaultValue( aggregate );
+      }
+      resultType = values.first().type();
+    }
+    else
+    {
+      resultType = mLayer->fields().at( attrNum ).type();
+    }
+
+    if ( aggregate == GeometryCollect && resultType == QVariant::UserType )
+    {
+      // the values are the evaluated geometries
+      QVector< QgsGeometry > geometries;
+      for ( const QVariant &value : values )
+      {
+        if ( value.canConvert<QgsGeometry>() )
+          geometries << value.value<QgsGeometry>();
+      }
+      *groupOk = true;
+      return QVariant::fromValue( QgsGeometry::collectGeometry( geometries ) );
+    }
+
+    QgsFeatureIterator groupIt( new QgsValueListIterator( values ) );
+    return calculate( aggregate, groupIt, resultType, 0, nullptr, mDelimiter, context, groupOk );
+  };
+
+  bool groupOk = false;
+  if ( emptyResult )
+  {
+    *emptyResult = calculateGroup( QVariantList(), &groupOk );
+    if ( !groupOk )
+      return results;
+  }
+
+  for ( int i = 0; i < groups.size(); ++i )
+  {
+    const QVariant result = calculateGroup( groups.at( i ), &groupOk );
+    if ( !groupOk )
+      return results;
+    results.insert( keys.at( i ), result );
+  }
+
+  if ( ok )
+    *ok = true;
+  return results;
+}
+
 QgsAggregateCalculator::Aggregate QgsAggregateCalculator::stringToAggregate( const QString &string, bool *ok )
 {
   QString normalized = string.trimmed().toLower();
@@ -690,6 +876,67 @@ QVariant QgsAggregateCalculator::calculateNumericAggregate( QgsFeatureIterator &
   return std::isnan( val ) ? QVariant() : val;
 }
 
+QVariant QgsAggregateCalculator::calculateNumericAggregate( QgsFeatureIterator &fit, QgsFeatureBatch &batch, int attr, QgsExpression *expression,
+    QgsExpressionContext *context, QgsStatisticalSummary::Statistic stat )
+{
+  Q_ASSERT( expression || batch.column( attr ) >= 0 );
+
+  QgsStatisticalSummary s( stat );
+
+  while ( fit.nextBatch( batch, AGGREGATE_BATCH_SIZE ) )
+  {
+    if ( expression )
+    {
+      Q_ASSERT( context );
+      const QVector<QVariant> values = expression->evaluateBatch( batch, context );
+      for ( const QVariant &v : values )
+        s.addVariant( v );
+      continue;
+    }
+
+    const int column = batch.column( attr );
+    switch ( batch.columnType( column ) )
+    {
+      case QgsFeatureBatch::Double:
+      {
+        const QVector<double> &values = batch.doubleColumn( column );
+        for ( int row = 0; row < batch.size(); ++row )
+        {
+          if ( batch.isNull( column, row ) )
+            s.addVariant( QVariant() );
+          else
+            s.addValue( values.at( row ) );
+        }
+        break;
+      }
+
+      case QgsFeatureBatch::Integer:
+      {
+        const QVector<qlonglong> &values = batch.integerColumn( column );
+        for ( int row = 0; row < batch.size(); ++row )
+        {
+          if ( batch.isNull( column, row ) )
+            s.addVariant( QVariant() );
+          else
+            s.addValue( static_cast< double >( values.at( row ) ) );
+        }
+        break;
+      }
+
+      case QgsFeatureBatch::Variant:
+      {
+        const QVector<QVariant> &values = batch.variantColumn( column );
+        for ( int row = 0; row < batch.size(); ++row )
+          s.addVariant( values.at( row ) );
+        break;
+      }
+    }
+  }
+  s.finalize();
+  double val = s.statistic( stat );
+  return std::isnan( val ) ? QVariant() : val;
+}
+
 QVariant QgsAggregateCalculator::calculateStringAggregate( QgsFeatureIterator &fit, int attr, QgsExpression *expression,
     QgsExpressionContext *context, QgsStringStatisticalSummary::Statistic stat )
 {
@@ -26,11 +26,14 @@
 #include <QVariant>
 #include "qgsfeatureid.h"
 
+#include <functional>
+
 
 class QgsFeatureIterator;
 class QgsExpression;
 class QgsVectorLayer;
 class QgsExpressionContext;
+class QgsFeatureBatch;
 
 /**
  * \ingroup core
@@ -176,6 +179,32 @@ class CORE_EXPORT QgsAggregateCalculator
     QVariant calculate( Aggregate aggregate, const QString &fieldOrExpression,
                         QgsExpressionContext *context = nullptr, bool *ok = nullptr ) const;
 
+#ifndef SIP_RUN
+
+    /**
+     * Calculates the value of an aggregate for each group of features, reading the
+     * features of the layer only once.
+     *
+     * \a groupByExpression is evaluated for each feature, and \a groupKey turns its value
+     * into the key of the group of the feature. The features whose key is a null string
+     * are not part of any group.
+     *
+     * \param aggregate aggregate to calculate
+     * \param fieldOrExpression source field or expression to use as basis for aggregated values.
+     * \param groupByExpression expression giving the group of each feature
+     * \param groupKey function returning the key of a group value
+     * \param context expression context for evaluating expressions
+     * \param emptyResult if specified, will be set to the value of the aggregate for no feature
+     * \param ok if specified, will be set to TRUE if the aggregate calculation was successful for all the groups
+     * \returns calculated aggregate value of each group, by key
+     * \note not available in Python bindings
+     * \since QGIS 3.16
+     */
+    QHash<QString, QVariant> calculateGrouped( Aggregate aggregate, const QString &fieldOrExpression, const QString &groupByExpression,
+        const std::function< QString( const QVariant & ) > &groupKey, QgsExpressionContext *context = nullptr,
+        QVariant *emptyResult = nullptr, bool *ok = nullptr ) const;
+#endif
+
     /**
      * Converts a string to a aggregate type.
      * \param string string to convert
@@ -218,6 +247,9 @@ class CORE_EXPORT QgsAggregateCalculator
     static QVariant calculateNumericAggregate( QgsFeatureIterator &fit, int attr, QgsExpression *expression,
         QgsExpressionContext *context, QgsStatisticalSummary::Statistic stat );
 
+    static QVariant calculateNumericAggregate( QgsFeatureIterator &fit, QgsFeatureBatch &batch, int attr, QgsExpression *expression,
+        QgsExpressionContext *context, QgsStatisticalSummary::Statistic stat );
+
     static QVariant calculateStringAggregate( QgsFeatureIterator &fit, int attr, QgsExpression *expression,
         QgsExpressionContext *context, QgsStringStatisticalSummary::Statistic stat );
 
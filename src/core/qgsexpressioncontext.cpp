@@ -18,6 +18,8 @@
 #include "qgsxmlutils.h"
 #include "qgsexpression.h"
 
+#include <atomic>
+
 const QString QgsExpressionContext::EXPR_FIELDS( QStringLiteral( "_fields_" ) );
 const QString QgsExpressionContext::EXPR_ORIGINAL_VALUE( QStringLiteral( "value" ) );
 const QString QgsExpressionContext::EXPR_SYMBOL_COLOR( QStringLiteral( "symbol_color" ) );
@@ -33,6 +35,12 @@ const QString QgsExpressionContext::EXPR_CLUSTER_COLOR( QStringLiteral( "cluster
 // QgsExpressionContextScope
 //
 
+quint64 QgsExpressionContextScope::newLayoutId()
+{
+  static std::atomic<quint64> sLastLayoutId( 0 );
+  return ++sLastLayoutId;
+}
+
 QgsExpressionContextScope::QgsExpressionContextScope( const QString &name )
   : mName( name )
 {
@@ -42,6 +50,8 @@ QgsExpressionContextScope::QgsExpressionContextScope( const QString &name )
 QgsExpressionContextScope::QgsExpressionContextScope( const QgsExpressionContextScope &other )
   : mName( other.mName )
   , mVariables( other.mVariables )
+  , mVariableIndexes( other.mVariableIndexes )
+  , mLayoutId( other.mLayoutId )
   , mHasFeature( other.mHasFeature )
   , mFeature( other.mFeature )
 {
@@ -56,6 +66,8 @@ QgsExpressionContextScope &QgsExpressionContextScope::operator=( const QgsExpres
 {
   mName = other.mName;
   mVariables = other.mVariables;
+  mVariableIndexes = other.mVariableIndexes;
+  mLayoutId = other.mLayoutId;
   mHasFeature = other.mHasFeature;
   mFeature = other.mFeature;
 
@@ -77,12 +89,13 @@ QgsExpressionContextScope::~QgsExpressionContextScope()
 
 void QgsExpressionContextScope::setVariable( const QString &name, const QVariant &value, bool isStatic )
 {
-  if ( mVariables.contains( name ) )
+  const int index = mVariableIndexes.value( name, -1 );
+  if ( index >= 0 )
   {
-    StaticVariable existing = mVariables.value( name );
+    // changed in place, so that resolved variable slots remain valid
+    StaticVariable &existing = mVariables[ index ];
     existing.value = value;
     existing.isStatic = isStatic;
-    addVariable( existing );
   }
   else
   {
@@ -92,27 +105,52 @@ void QgsExpressionContextScope::setVariable( const QString &name, const QVariant
 
 void QgsExpressionContextScope::addVariable( const QgsExpressionContextScope::StaticVariable &variable )
 {
-  mVariables.insert( variable.name, variable );
+  const int index = mVariableIndexes.value( variable.name, -1 );
+  if ( index >= 0 )
+  {
+    mVariables[ index ] = variable;
+    return;
+  }
+
+  mVariableIndexes.insert( variable.name, mVariables.size() );
+  mVariables.append( variable );
+  mLayoutId = newLayoutId();
 }
 
 bool QgsExpressionContextScope::removeVariable( const QString &name )
 {
-  return mVariables.remove( name ) > 0;
+  const int index = mVariableIndexes.value( name, -1 );
+  if ( index < 0 )
+    return false;
+
+  mVariables.remove( index );
+  mVariableIndexes.remove( name );
+  for ( auto it = mVariableIndexes.begin(); it != mVariableIndexes.end(); ++it )
+  {
+    if ( it.value() > index )
+      --it.value();
+  }
+  mLayoutId = newLayoutId();
+  return true;
 }
 
 bool QgsExpressionContextScope::hasVariable( const QString &name ) const
 {
-  return mVariables.contains( name );
+  return mVariableIndexes.contains( name );
 }
 
 QVariant QgsExpressionContextScope::variable( const QString &name ) const
 {
-  return hasVariable( name ) ? mVariables.value( name ).value : QVariant();
+  const int index = mVariableIndexes.value( name, -1 );
+  return index >= 0 ? mVariables.at( index ).value : QVariant();
 }
 
 QStringList QgsExpressionContextScope::variableNames() const
 {
-  QStringList names = mVariables.keys();
+  QStringList names;
+  names.reserve( mVariables.size() );
+  for ( const StaticVariable &variable : mVariables )
+    names << variable.name;
   return names;
 }
 
@@ -140,7 +178,7 @@ class QgsExpressionContextVariableCompare
 
 QStringList QgsExpressionContextScope::filteredVariableNames() const
 {
-  QStringList allVariables = mVariables.keys();
+  QStringList allVariables = variableNames();
   QStringList filtered;
   const auto constAllVariables = allVariables;
   for ( const QString &variable : constAllVariables )
@@ -158,17 +196,20 @@ QStringList QgsExpressionContextScope::filteredVariableNames() const
 
 bool QgsExpressionContextScope::isReadOnly( const QString &name ) const
 {
-  return hasVariable( name ) ? mVariables.value( name ).readOnly : false;
+  const int index = mVariableIndexes.value( name, -1 );
+  return index >= 0 ? mVariables.at( index ).readOnly : false;
 }
 
 bool QgsExpressionContextScope::isStatic( const QString &name ) const
 {
-  return hasVariable( name ) ? mVariables.value( name ).isStatic : false;
+  const int index = mVariableIndexes.value( name, -1 );
+  return index >= 0 ? mVariables.at( index ).isStatic : false;
 }
 
 QString QgsExpressionContextScope::description( const QString &name ) const
 {
-  return hasVariable( name ) ? mVariables.value( name ).description : QString();
+  const int index = mVariableIndexes.value( name, -1 );
+  return index >= 0 ? mVariables.at( index ).description : QString();
 }
 
 bool QgsExpressionContextScope::hasFunction( const QString &name ) const
@@ -211,11 +252,11 @@ void QgsExpressionContextScope::readXml( const QDomElement &element, const QgsRe
 
 bool QgsExpressionContextScope::writeXml( QDomElement &element, QDomDocument &document, const QgsReadWriteContext & ) const
 {
-  for ( auto it = mVariables.constBegin(); it != mVariables.constEnd(); ++it )
+  for ( const StaticVariable &variable : mVariables )
   {
     QDomElement varElem = document.createElement( QStringLiteral( "Variable" ) );
-    varElem.setAttribute( QStringLiteral( "name" ), it.key() );
-    QDomElement valueElem = QgsXmlUtils::writeVariant( it.value().value, document );
+    varElem.setAttribute( QStringLiteral( "name" ), variable.name );
+    QDomElement valueElem = QgsXmlUtils::writeVariant( variable.value, document );
     varElem.appendChild( valueElem );
     element.appendChild( varElem );
   }
@@ -299,6 +340,38 @@ QVariant QgsExpressionContext::variable( const QString &name ) const
   return scope ? scope->variable( name ) : QVariant();
 }
 
+QgsExpressionContext::VariableSlot QgsExpressionContext::variableSlot( const QString &name ) const
+{
+  VariableSlot slot( name );
+  slot.mLayouts.reserve( mStack.size() );
+  for ( const QgsExpressionContextScope *scope : mStack )
+    slot.mLayouts << scope->mLayoutId;
+
+  //iterate through stack backwards, so that higher priority variables take precedence
+  for ( int i = mStack.size() - 1; i >= 0; --i )
+  {
+    const int index = mStack.at( i )->mVariableIndexes.value( name, -1 );
+    if ( index >= 0 )
+    {
+      slot.mScope = i;
+      slot.mIndex = index;
+      break;
+    }
+  }
+  return slot;
+}
+
+QVariant QgsExpressionContext::variable( VariableSlot &slot ) const
+{
+  bool valid = slot.mLayouts.size() == mStack.size();
+  for ( int i = 0; valid && i < mStack.size(); ++i )
+    valid = mStack.at( i )->mLayoutId == slot.mLayouts.at( i );
+  if ( !valid )
+    slot = variableSlot( slot.mName );
+
+  return slot.mScope >= 0 ? mStack.at( slot.mScope )->mVariables.at( slot.mIndex ).value : QVariant();
+}
+
 QVariantMap QgsExpressionContext::variablesToMap() const
 {
   QStringList names = variableNames();
@@ -19,6 +19,7 @@
 #include "qgis_sip.h"
 #include <QVariant>
 #include <QHash>
+#include <QVector>
 #include <QString>
 #include <QStringList>
 #include <QSet>
@@ -346,11 +347,26 @@ class CORE_EXPORT QgsExpressionContextScope
     bool writeXml( QDomElement &element, QDomDocument &document, const QgsReadWriteContext &context ) const;
 
   private:
+
+    //! Returns a new unique id for the layout of the variables of a scope
+    static quint64 newLayoutId();
+
     QString mName;
-    QHash<QString, StaticVariable> mVariables;
+    //! Variables, by order of addition
+    QVector<StaticVariable> mVariables;
+    //! Position of each variable in mVariables
+    QHash<QString, int> mVariableIndexes;
+
+    /**
+     * Identifies the names and positions of the variables. It changes whenever a variable
+     * is added or removed, but not when the value of an existing variable is set.
+     */
+    quint64 mLayoutId = 0;
     QHash<QString, QgsScopedExpressionFunction * > mFunctions;
     bool mHasFeature = false;
     QgsFeature mFeature;
+
+    friend class QgsExpressionContext;
 };
 
 /**
@@ -411,6 +427,65 @@ class CORE_EXPORT QgsExpressionContext
      */
     QVariant variable( const QString &name ) const;
 
+#ifndef SIP_RUN
+
+    /**
+     * \ingroup core
+     * Handle on a variable of a context, resolved to the scope and position
+     * of the variable so that it can be read without looking up its name.
+     *
+     * A slot remains valid for all the contexts with the same scopes holding
+     * the same variable names, e.g. copies of the context it was resolved for,
+     * and reads the current values of the variables.
+     *
+     * \see variableSlot()
+     * \note not available in Python bindings
+     * \since QGIS 3.16
+     */
+    class VariableSlot
+    {
+      public:
+
+        //! Constructor for a slot of the variable \a name, resolved on first use
+        explicit VariableSlot( const QString &name = QString() )
+          : mName( name )
+        {}
+
+        //! Returns the name of the variable
+        QString name() const { return mName; }
+
+      private:
+        QString mName;
+        //! Layout id of each scope of the context the slot was resolved for
+        QVector<quint64> mLayouts;
+        //! Scope holding the variable, -1 if no scope has it
+        int mScope = -1;
+        //! Position of the variable in its scope
+        int mIndex = -1;
+
+        friend class QgsExpressionContext;
+    };
+#endif
+
+    /**
+     * Resolves the variable \a name to a slot, which can be read with
+     * variable( VariableSlot & ) for the next evaluations.
+     * \note not available in Python bindings
+     * \since QGIS 3.16
+     */
+    VariableSlot variableSlot( const QString &name ) const SIP_SKIP;
+
+    /**
+     * Fetches the variable resolved in \a slot. If the scopes or the variables
+     * they hold changed since \a slot was resolved, it is resolved again for
+     * this context first.
+     * \returns variable value if matching variable exists in the context, otherwise an invalid QVariant
+     * \see variableSlot()
+     * \note not available in Python bindings
+     * \since QGIS 3.16
+     */
+    QVariant variable( VariableSlot &slot ) const SIP_SKIP;
+
     /**
      * Returns a map of variable name to value representing all the expression variables
      * contained by the context.
@@ -0,0 +1,238 @@
+/***************************************************************************
+  qgsfeaturebatch.cpp
+  -------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsfeaturebatch.h"
+#include "qgsfeature.h"
+
+QgsFeatureBatch::QgsFeatureBatch( const QgsFields &fields, const QgsAttributeList &attributes, bool fetchGeometry )
+  : mFields( fields )
+  , mAttributes( attributes.isEmpty() ? fields.allAttributesList() : attributes )
+  , mFetchGeometry( fetchGeometry )
+{
+  mColumnByField.fill( -1, mFields.count() );
+  mColumns.reserve( mAttributes.size() );
+  for ( int i = 0; i < mAttributes.size(); ++i )
+  {
+    const int fieldIndex = mAttributes.at( i );
+    if ( fieldIndex >= 0 && fieldIndex < mColumnByField.size() )
+      mColumnByField[ fieldIndex ] = i;
+
+    Column column;
+    column.fieldType = mFields.exists( fieldIndex ) ? mFields.at( fieldIndex ).type() : QVariant::Invalid;
+    switch ( column.fieldType )
+    {
+      case QVariant::Double:
+        column.type = Double;
+        break;
+
+      case QVariant::Int:
+      case QVariant::UInt:
+      case QVariant::LongLong:
+      case QVariant::ULongLong:
+      case QVariant::Bool:
+        column.type = Integer;
+        break;
+
+      default:
+        column.type = Variant;
+        break;
+    }
+    mColumns << column;
+  }
+
+  mGeometryOffsets << 0;
+}
+
+void QgsFeatureBatch::clear()
+{
+  mIds.clear();
+  for ( Column &column : mColumns )
+  {
+    column.doubles.clear();
+    column.integers.clear();
+    column.variants.clear();
+    column.validity.clear();
+  }
+  mGeometryOffsets.resize( 1 );
+  mGeometries.clear();
+}
+
+QVariant QgsFeatureBatch::value( int column, int row ) const
+{
+  const Column &c = mColumns.at( column );
+  if ( !c.validity.testBit( row ) )
+    return QVariant( c.fieldType );
+
+  switch ( c.type )
+  {
+    case Double:
+      return c.doubles.at( row );
+
+    case Integer:
+    {
+      const qlonglong value = c.integers.at( row );
+      switch ( c.fieldType )
+      {
+        case QVariant::Int:
+          return static_cast< int >( value );
+        case QVariant::UInt:
+          return static_cast< uint >( value );
+        case QVariant::ULongLong:
+          return static_cast< qulonglong >( value );
+        case QVariant::Bool:
+          return value != 0;
+        default:
+          return value;
+      }
+    }
+
+    case Variant:
+      return c.variants.at( row );
+  }
+  return QVariant();
+}
+
+const char *QgsFeatureBatch::wkb( int row, int &size ) const
+{
+  if ( !hasGeometry( row ) )
+  {
+    size = 0;
+    return nullptr;
+  }
+
+  const int offset = mGeometryOffsets.at( row );
+  size = mGeometryOffsets.at( row + 1 ) - offset;
+  return mGeometries.constData() + offset;
+}
+
+QgsGeometry QgsFeatureBatch::geometry( int row ) const
+{
+  int size = 0;
+  const char *data = wkb( row, size );
+  if ( !data )
+    return QgsGeometry();
+
+  QgsGeometry geometry;
+  geometry.fromWkb( QByteArray( data, size ) );
+  return geometry;
+}
+
+QgsFeature QgsFeatureBatch::feature( int row ) const
+{
+  QgsFeature feature( mFields, mIds.at( row ) );
+  for ( int i = 0; i < mColumns.size(); ++i )
+  {
+    feature.setAttribute( mAttributes.at( i ), value( i, row ) );
+  }
+  if ( hasGeometry( row ) )
+    feature.setGeometry( geometry( row ) );
+  return feature;
+}
+
+int QgsFeatureBatch::appendRow( QgsFeatureId id )
+{
+  const int row = mIds.size();
+  mIds << id;
+  for ( Column &column : mColumns )
+  {
+    switch ( column.type )
+    {
+      case Double:
+        column.doubles << 0;
+        break;
+      case Integer:
+        column.integers << 0;
+        break;
+      case Variant:
+        column.variants << QVariant( column.fieldType );
+        break;
+    }
+    column.validity.resize( row + 1 );
+  }
+  mGeometryOffsets << mGeometries.size();
+  return row;
+}
+
+void QgsFeatureBatch::setDouble( int column, double value )
+{
+  Column &c = mColumns[ column ];
+  Q_ASSERT( c.type == Double );
+  c.doubles.last() = value;
+  c.validity.setBit( mIds.size() - 1 );
+}
+
+void QgsFeatureBatch::setInteger( int column, qlonglong value )
+{
+  Column &c = mColumns[ column ];
+  Q_ASSERT( c.type == Integer );
+  c.integers.last() = value;
+  c.validity.setBit( mIds.size() - 1 );
+}
+
+void QgsFeatureBatch::setValue( int column, const QVariant &value )
+{
+  if ( value.isNull() )
+    return;
+
+  Column &c = mColumns[ column ];
+  bool ok = true;
+  switch ( c.type )
+  {
+    case Double:
+      c.doubles.last() = value.toDouble( &ok );
+      break;
+    case Integer:
+      c.integers.last() = value.type() == QVariant::Bool ? value.toBool() : value.toLongLong( &ok );
+      break;
+    case Variant:
+      c.variants.last() = value;
+      break;
+  }
+  if ( ok )
+    c.validity.setBit( mIds.size() - 1 );
+}
+
+void QgsFeatureBatch::setWkb( const char *wkb, int size )
+{
+  if ( !mFetchGeometry || !wkb || size <= 0 )
+    return;
+
+  // only the last row can be changed, its geometry is at the end of the buffer
+  mGeometries.truncate( mGeometryOffsets.at( mGeometryOffsets.size() - 2 ) );
+  mGeometries.append( wkb, size );
+  mGeometryOffsets.last() = mGeometries.size();
+}
+
+void QgsFeatureBatch::setGeometry( const QgsGeometry &geometry )
+{
+  if ( !mFetchGeometry || geometry.isNull() )
+    return;
+
+  const QByteArray wkb = geometry.asWkb();
+  setWkb( wkb.constData(), wkb.size() );
+}
+
+void QgsFeatureBatch::appendFeature( const QgsFeature &feature )
+{
+  appendRow( feature.id() );
+  const QgsAttributes attributes = feature.attributes();
+  for ( int i = 0; i < mColumns.size(); ++i )
+  {
+    const int fieldIndex = mAttributes.at( i );
+    if ( fieldIndex >= 0 && fieldIndex < attributes.size() )
+      setValue( i, attributes.at( fieldIndex ) );
+  }
+  if ( mFetchGeometry && feature.hasGeometry() )
+    setGeometry( feature.geometry() );
+}
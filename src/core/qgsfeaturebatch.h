@@ -0,0 +1,197 @@
+/***************************************************************************
+  qgsfeaturebatch.h
+  -----------------
+  begin                : October 2020
+  copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSFEATUREBATCH_H
+#define QGSFEATUREBATCH_H
+
+#define SIP_NO_FILE
+
+#include "qgis_core.h"
+#include "qgsfeatureid.h"
+#include "qgsfields.h"
+#include "qgsgeometry.h"
+
+#include <QBitArray>
+#include <QVector>
+
+class QgsFeature;
+
+/**
+ * \ingroup core
+ * \class QgsFeatureBatch
+ * \brief A batch of features stored by columns.
+ *
+ * Each requested attribute is stored in its own column. Numeric and boolean
+ * attributes are stored in contiguous arrays of doubles or 64 bit integers, all the
+ * other attributes as variants. A validity bitmap tells which values are not NULL.
+ * Geometries are packed one after the other in a single WKB buffer.
+ *
+ * Batches are filled by QgsFeatureIterator::nextBatch(). They are meant for code
+ * reading a few attributes of many features, e.g. statistics, which can then loop
+ * over plain arrays instead of QgsFeature objects.
+ *
+ * A batch can be reused for consecutive calls to nextBatch(), its memory is kept.
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.16
+ */
+class CORE_EXPORT QgsFeatureBatch
+{
+  public:
+
+    //! Storage of the values of a column
+    enum ColumnType
+    {
+      Double, //!< Values are stored as doubles, see doubleColumn()
+      Integer, //!< Values are stored as 64 bit integers, see integerColumn()
+      Variant, //!< Values are stored as variants, see variantColumn()
+    };
+
+    /**
+     * Constructor for an empty batch.
+     *
+     * The batch stores the attributes of \a fields listed in \a attributes, or all the
+     * attributes if \a attributes is empty. Geometries are only stored if \a fetchGeometry
+     * is TRUE.
+     */
+    explicit QgsFeatureBatch( const QgsFields &fields = QgsFields(), const QgsAttributeList &attributes = QgsAttributeList(), bool fetchGeometry = true );
+
+    //! Returns the fields of the features
+    QgsFields fields() const { return mFields; }
+
+    //! Returns the indexes of the fields stored by the columns, in the column order
+    QgsAttributeList attributes() const { return mAttributes; }
+
+    //! Returns the column storing the field at \a fieldIndex, or -1 if the field is not stored
+    int column( int fieldIndex ) const { return fieldIndex >= 0 && fieldIndex < mColumnByField.size() ? mColumnByField.at( fieldIndex ) : -1; }
+
+    //! Returns the number of columns
+    int columnCount() const { return mColumns.size(); }
+
+    //! Returns TRUE if the geometries are stored
+    bool fetchGeometry() const { return mFetchGeometry; }
+
+    //! Returns the number of features in the batch
+    int size() const { return mIds.size(); }
+
+    //! Returns TRUE if the batch does not contain any feature
+    bool isEmpty() const { return mIds.isEmpty(); }
+
+    //! Removes all the features, keeping the allocated memory
+    void clear();
+
+    //! Returns the id of the feature at \a row
+    QgsFeatureId id( int row ) const { return mIds.at( row ); }
+
+    //! Returns the ids of the features
+    const QVector<QgsFeatureId> &ids() const { return mIds; }
+
+    //! Returns how the values of \a column are stored
+    ColumnType columnType( int column ) const { return mColumns.at( column ).type; }
+
+    //! Returns the validity bitmap of \a column, where a cleared bit is a NULL value
+    const QBitArray &validity( int column ) const { return mColumns.at( column ).validity; }
+
+    //! Returns TRUE if the value of \a column at \a row is NULL
+    bool isNull( int column, int row ) const { return !mColumns.at( column ).validity.testBit( row ); }
+
+    /**
+     * Returns the values of a Double \a column. NULL values are stored as 0.
+     * \see columnType()
+     */
+    const QVector<double> &doubleColumn( int column ) const { return mColumns.at( column ).doubles; }
+
+    /**
+     * Returns the values of an Integer \a column. NULL values are stored as 0.
+     * \see columnType()
+     */
+    const QVector<qlonglong> &integerColumn( int column ) const { return mColumns.at( column ).integers; }
+
+    /**
+     * Returns the values of a Variant \a column.
+     * \see columnType()
+     */
+    const QVector<QVariant> &variantColumn( int column ) const { return mColumns.at( column ).variants; }
+
+    //! Returns the value of \a column at \a row as a variant of the type of the field
+    QVariant value( int column, int row ) const;
+
+    //! Returns TRUE if the feature at \a row has a geometry
+    bool hasGeometry( int row ) const { return mFetchGeometry && mGeometryOffsets.at( row + 1 ) > mGeometryOffsets.at( row ); }
+
+    /**
+     * Returns a pointer to the WKB of the geometry of the feature at \a row, and
+     * sets \a size to its size. Returns NULLPTR if the feature has no geometry.
+     * The pointer is valid until the batch is modified.
+     */
+    const char *wkb( int row, int &size ) const;
+
+    //! Returns the geometry of the feature at \a row
+    QgsGeometry geometry( int row ) const;
+
+    //! Returns the buffer storing the WKB of all the geometries
+    const QByteArray &wkbBuffer() const { return mGeometries; }
+
+    //! Returns the feature at \a row
+    QgsFeature feature( int row ) const;
+
+    /**
+     * Appends a feature with the given \a id, with NULL attributes and no geometry.
+     * Returns the row of the feature.
+     */
+    int appendRow( QgsFeatureId id );
+
+    //! Sets the value of the Double \a column at the last row
+    void setDouble( int column, double value );
+
+    //! Sets the value of the Integer \a column at the last row
+    void setInteger( int column, qlonglong value );
+
+    //! Sets the value of \a column at the last row, converting it to the storage of the column
+    void setValue( int column, const QVariant &value );
+
+    //! Sets the geometry of the last row from the \a size bytes of \a wkb
+    void setWkb( const char *wkb, int size );
+
+    //! Sets the geometry of the last row
+    void setGeometry( const QgsGeometry &geometry );
+
+    //! Appends the attributes and geometry of \a feature
+    void appendFeature( const QgsFeature &feature );
+
+  private:
+
+    struct Column
+    {
+      ColumnType type = Variant;
+      QVariant::Type fieldType = QVariant::Invalid;
+      QVector<double> doubles;
+      QVector<qlonglong> integers;
+      QVector<QVariant> variants;
+      QBitArray validity;
+    };
+
+    QgsFields mFields;
+    QgsAttributeList mAttributes;
+    QVector<int> mColumnByField;
+    bool mFetchGeometry = true;
+
+    QVector<QgsFeatureId> mIds;
+    QVector<Column> mColumns;
+
+    //! Start of the WKB of each row in mGeometries, plus the end of the last one
+    QVector<int> mGeometryOffsets;
+    QByteArray mGeometries;
+};
+
+#endif // QGSFEATUREBATCH_H
@@ -13,6 +13,7 @@
  *                                                                         *
  ***************************************************************************/
 #include "qgsfeatureiterator.h"
+#include "qgsfeaturebatch.h"
 #include "qgslogger.h"
 
 #include "qgssimplifymethod.h"
@@ -71,6 +72,39 @@ bool QgsAbstractFeatureIterator::nextFeature( QgsFeature &f )
   return dataOk;
 }
 
+bool QgsAbstractFeatureIterator::nextBatch( QgsFeatureBatch &batch, int maxSize )
+{
+  batch.clear();
+
+  if ( mRequest.limit() >= 0 )
+    maxSize = static_cast< int >( std::min< long >( maxSize, mRequest.limit() - mFetchedCount ) );
+  if ( maxSize <= 0 )
+    return false;
+
+  // simplified geometries are only produced per feature, by the iterator itself
+  if ( !mUseCachedFeatures && mRequest.filterType() == QgsFeatureRequest::FilterNone
+       && mRequest.simplifyMethod().methodType() == QgsSimplifyMethod::NoSimplification
+       && fetchBatch( batch, maxSize ) )
+  {
+    mFetchedCount += batch.size();
+    return !batch.isEmpty();
+  }
+
+  QgsFeature f;
+  while ( batch.size() < maxSize && nextFeature( f ) )
+  {
+    batch.appendFeature( f );
+  }
+  return !batch.isEmpty();
+}
+
+bool QgsAbstractFeatureIterator::fetchBatch( QgsFeatureBatch &batch, int maxSize )
+{
+  Q_UNUSED( batch )
+  Q_UNUSED( maxSize )
+  return false;
+}
+
 bool QgsAbstractFeatureIterator::nextFeatureFilterExpression( QgsFeature &f )
 {
   while ( fetchFeature( f ) )
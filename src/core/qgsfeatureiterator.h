@@ -20,6 +20,7 @@
 #include "qgsindexedfeature.h"
 
 class QgsFeedback;
+class QgsFeatureBatch;
 
 /**
  * \ingroup core
@@ -46,6 +47,17 @@ class CORE_EXPORT QgsAbstractFeatureIterator
     //! fetch next feature, return TRUE on success
     virtual bool nextFeature( QgsFeature &f );
 
+    /**
+     * Fetches up to \a maxSize next features into the columns of \a batch.
+     * Returns TRUE if at least one feature was fetched.
+     *
+     * Iterators able to fill the batch without creating QgsFeature objects do it in
+     * fetchBatch(), otherwise the features are fetched one by one.
+     * \note not available in Python bindings
+     * \since QGIS 3.16
+     */
+    virtual bool nextBatch( QgsFeatureBatch &batch, int maxSize ) SIP_SKIP;
+
     //! reset the iterator to the starting position
     virtual bool rewind() = 0;
     //! end of iterating: free the resources / lock
@@ -102,6 +114,24 @@ class CORE_EXPORT QgsAbstractFeatureIterator
      */
     virtual bool fetchFeature( QgsFeature &f ) = 0;
 
+    /**
+     * Fetches up to \a maxSize next features directly into the columns of \a batch,
+     * which was cleared beforehand.
+     *
+     * This is only called when no filter needs to be checked on the iterator side,
+     * the features are not locally ordered and no geometry simplification is
+     * requested, so the batch holds the same geometries as nextFeature(). Iterators
+     * reading columnar data or able to skip the QgsFeature objects should implement it.
+     *
+     * Returns FALSE, without fetching any feature, if the iterator cannot fill the
+     * batch for its request, in which case the features are fetched one by one.
+     * The default implementation returns FALSE.
+     *
+     * \note not available in Python bindings
+     * \since QGIS 3.16
+     */
+    virtual bool fetchBatch( QgsFeatureBatch &batch, int maxSize ) SIP_SKIP;
+
     /**
      * By default, the iterator will fetch all features and check if the feature
      * matches the expression.
@@ -298,6 +328,28 @@ class CORE_EXPORT QgsFeatureIterator
     QgsFeatureIterator &operator=( const QgsFeatureIterator &other );
 
     bool nextFeature( QgsFeature &f );
+
+    /**
+     * Fetches up to \a maxSize next features into the columns of \a batch.
+     * Returns TRUE if at least one feature was fetched.
+     *
+     * The batch decides which attributes and whether the geometries are stored, it
+     * should match the attributes and flags of the feature request.
+     *
+     * \code{.cpp}
+     * QgsFeatureBatch batch( layer->fields(), QgsAttributeList() << fieldIndex, false );
+     * while ( it.nextBatch( batch, 10000 ) )
+     * {
+     *   const QVector<double> &values = batch.doubleColumn( 0 );
+     *   ...
+     * }
+     * \endcode
+     *
+     * \note not available in Python bindings
+     * \since QGIS 3.16
+     */
+    bool nextBatch( QgsFeatureBatch &batch, int maxSize ) SIP_SKIP;
+
     bool rewind();
     bool close();
 
@@ -375,6 +427,11 @@ inline bool QgsFeatureIterator::nextFeature( QgsFeature &f )
   return mIter ? mIter->nextFeature( f ) : false;
 }
 
+inline bool QgsFeatureIterator::nextBatch( QgsFeatureBatch &batch, int maxSize )
+{
+  return mIter ? mIter->nextBatch( batch, maxSize ) : false;
+}
+
 inline bool QgsFeatureIterator::rewind()
 {
   if ( mIter )
@@ -31,9 +31,14 @@
 #include <QSet>
 #include <QSettings>
 #include <QUrl>
+#include <QFuture>
+#include <QQueue>
+#include <QThread>
+#include <QtConcurrentRun>
 
 #include "ogr_api.h"
 
+#include <algorithm>
 #include <limits>
 
 static const char NS_SEPARATOR = '?';
@@ -272,6 +277,151 @@ QgsCoordinateReferenceSystem QgsGml::crs() const
 
 
 
+///@cond PRIVATE
+
+/**
+ * State of the document inferred from the data parsed so far, which affects
+ * how the following features are parsed.
+ */
+struct QgsGmlStreamingParser::DocumentState
+{
+  int epsg = 0;
+  QString srsName;
+  bool invertAxisOrientation = false;
+  const char *gmlNameSpaceURIPtr = nullptr;
+
+  bool operator==( const DocumentState &other ) const
+  {
+    return epsg == other.epsg && srsName == other.srsName &&
+           invertAxisOrientation == other.invertAxisOrientation &&
+           gmlNameSpaceURIPtr == other.gmlNameSpaceURIPtr;
+  }
+  bool operator!=( const DocumentState &other ) const { return !( *this == other ); }
+};
+
+/**
+ * Splits the data of a feature collection at the boundaries of its feature
+ * members, i.e. the gml:featureMember and wfs:member elements and the children
+ * of gml:featureMembers.
+ *
+ * Consecutive members are grouped in chunks, which are parsed by separate
+ * parsers on worker threads as standalone documents made of the beginning of
+ * the collection up to its root element, the members and the closing tags.
+ * Everything else is parsed by the owner parser, so that the properties of the
+ * collection (number of features, bounding box, truncated response...) are
+ * handled as usual.
+ *
+ * The features of the chunks are handed back to the owner in the order of the
+ * document. A chunk is parsed with the document state of the owner at the time
+ * it is split; if the previous chunks turn out to have changed that state, e.g.
+ * with the first srsName of the document, the chunk is parsed again.
+ */
+class QgsGmlStreamingParser::ParallelParser
+{
+  public:
+    explicit ParallelParser( QgsGmlStreamingParser *owner )
+      : mOwner( owner )
+    {}
+    ~ParallelParser();
+
+    bool processData( const QByteArray &data, bool atEnd, QString &errorMsg );
+
+    //! Hands the features of the parsed chunks to the owner, waiting for all of them if \a wait is TRUE
+    void collectChunks( bool wait );
+
+  private:
+
+    //! Target size of a chunk, in bytes
+    static const int CHUNK_SIZE = 256 * 1024;
+
+    enum Mode
+    {
+      Prologue, //!< Before the end of the root element start tag
+      Split, //!< Inside a feature collection
+      PassThrough, //!< Anything else, parsed by the owner
+    };
+
+    struct ChunkResult
+    {
+      bool ok = true;
+      QString errorMsg;
+      QVector<QgsGmlFeaturePtrGmlIdPair> features;
+      DocumentState state;
+      QgsWkbTypes::Type wkbType = QgsWkbTypes::Unknown;
+    };
+
+    struct Chunk
+    {
+      QByteArray document;
+      DocumentState state;
+      QFuture<ChunkResult> future;
+    };
+
+    //! Scans the buffer up to its last complete markup
+    void scan();
+
+    //! Returns the end of the markup starting at \a start, or -1 if it is not complete yet
+    int markupEnd( int start ) const;
+
+    //! Updates the structure with the markup between \a start and \a end
+    void handleMarkup( int start, int end );
+
+    //! Sends the unrouted data of the buffer up to \a end to the owner
+    void routeToOwner( int end );
+
+    //! Appends the unrouted data of the buffer up to \a end to the current chunk
+    void routeToChunk( int end );
+
+    //! Hands the features of \a chunk to the owner, parsing it again if its state is outdated
+    void finishChunk( const Chunk &chunk, ChunkResult result );
+    //! Parses the current chunk, on a worker thread unless this is the first one
+    void dispatchChunk();
+
+    //! Parses the data accumulated for the owner
+    void flushOwnerData( bool atEnd );
+
+    std::shared_ptr<QgsGmlStreamingParser> createChunkParser( const DocumentState &state ) const;
+    static ChunkResult parseChunk( QgsGmlStreamingParser &parser, const QByteArray &document );
+
+    void setError( const QString &errorMsg );
+
+    QgsGmlStreamingParser *mOwner = nullptr;
+    Mode mMode = Prologue;
+
+    //! Data which is not routed yet
+    QByteArray mBuffer;
+    //! Position of the next markup to scan in mBuffer
+    int mPos = 0;
+    //! Start of the data of mBuffer which is not routed yet
+    int mRouteStart = 0;
+
+    //! Number of open elements
+    int mDepth = 0;
+    //! Depth of the parent of the current feature member, -1 outside of a member
+    int mMemberDepth = -1;
+    bool mInFeatureMembers = false;
+
+    //! Beginning of the document, up to the end of the root element start tag
+    QByteArray mPrologue;
+    QByteArray mRootEndTag;
+    QByteArray mFeatureMembersStartTag;
+    QByteArray mFeatureMembersEndTag;
+
+    //! Data routed to the owner, not parsed yet
+    QByteArray mOwnerData;
+
+    //! Members of the chunk being built
+    QByteArray mChunkData;
+    bool mChunkInFeatureMembers = false;
+    bool mFirstChunkDispatched = false;
+    QQueue<Chunk> mChunks;
+
+    bool mFailed = false;
+    QString mErrorMsg;
+};
+
+///@endcond
+
 QgsGmlStreamingParser::QgsGmlStreamingParser( const QString &typeName,
     const QString &geometryAttribute,
     const QgsFields &fields,
@@ -445,6 +595,14 @@ bool QgsGmlStreamingParser::processData( const QByteArray &data, bool atEnd )
 }
 
 bool QgsGmlStreamingParser::processData( const QByteArray &data, bool atEnd, QString &errorMsg )
+{
+  if ( mParallelParser )
+    return mParallelParser->processData( data, atEnd, errorMsg );
+
+  return parse( data, atEnd, errorMsg );
+}
+
+bool QgsGmlStreamingParser::parse( const QByteArray &data, bool atEnd, QString &errorMsg )
 {
   if ( XML_Parse( mParser, data.data(), data.size(), atEnd ) == 0 )
   {
@@ -462,6 +620,9 @@ bool QgsGmlStreamingParser::processData( const QByteArray &data, bool atEnd, QSt
 
 QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> QgsGmlStreamingParser::getAndStealReadyFeatures()
 {
+  if ( mParallelParser )
+    mParallelParser->collectChunks( false );
+
   QVector<QgsGmlFeaturePtrGmlIdPair> ret = mFeatureList;
   mFeatureList.clear();
   return ret;
@@ -470,6 +631,431 @@ QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> QgsGmlStreamingParser:
 #define LOCALNAME_EQUALS(string_constant) \
   ( localNameLen == static_cast<int>(strlen( string_constant )) && memcmp(pszLocalName, string_constant, localNameLen) == 0 )
 
+void QgsGmlStreamingParser::setParallelParsingEnabled( bool enabled )
+{
+  if ( enabled && !mParallelParser )
+    mParallelParser = qgis::make_unique<ParallelParser>( this );
+  else if ( !enabled )
+    mParallelParser.reset();
+}
+
+void QgsGmlStreamingParser::copyConfiguration( const QgsGmlStreamingParser &other )
+{
+  mLayerProperties = other.mLayerProperties;
+  mMapTypeNameToProperties = other.mMapTypeNameToProperties;
+  mTypeName = other.mTypeName;
+  mTypeNameBA = other.mTypeNameBA;
+  mTypeNamePtr = other.mTypeNamePtr ? mTypeNameBA.constData() : nullptr;
+  mTypeNameUTF8Len = other.mTypeNameUTF8Len;
+  mGeometryAttribute = other.mGeometryAttribute;
+  mGeometryAttributeBA = other.mGeometryAttributeBA;
+  mGeometryAttributePtr = other.mGeometryAttributePtr ? mGeometryAttributeBA.constData() : nullptr;
+  mGeometryAttributeUTF8Len = other.mGeometryAttributeUTF8Len;
+  mFields = other.mFields;
+  mThematicAttributes = other.mThematicAttributes;
+  mAxisOrientationLogic = other.mAxisOrientationLogic;
+  mInvertAxisOrientationRequest = other.mInvertAxisOrientationRequest;
+  mInvertAxisOrientation = other.mInvertAxisOrientationRequest;
+}
+
+QgsGmlStreamingParser::DocumentState QgsGmlStreamingParser::documentState() const
+{
+  DocumentState state;
+  state.epsg = mEpsg;
+  state.srsName = mSrsName;
+  state.invertAxisOrientation = mInvertAxisOrientation;
+  state.gmlNameSpaceURIPtr = mGMLNameSpaceURIPtr;
+  return state;
+}
+
+void QgsGmlStreamingParser::setDocumentState( const DocumentState &state )
+{
+  mEpsg = state.epsg;
+  mSrsName = state.srsName;
+  mInvertAxisOrientation = state.invertAxisOrientation;
+  mGMLNameSpaceURIPtr = state.gmlNameSpaceURIPtr;
+  mGMLNameSpaceURI = mGMLNameSpaceURIPtr ? QString( mGMLNameSpaceURIPtr ) : QString();
+}
+
+///@cond PRIVATE
+
+QgsGmlStreamingParser::ParallelParser::~ParallelParser()
+{
+  // features which were never handed to the owner
+  for ( Chunk &chunk : mChunks )
+  {
+    const ChunkResult result = chunk.future.result();
+    for ( const QgsGmlFeaturePtrGmlIdPair &featPair : result.features )
+      delete featPair.first;
+  }
+}
+
+bool QgsGmlStreamingParser::ParallelParser::processData( const QByteArray &data, bool atEnd, QString &errorMsg )
+{
+  if ( mMode == PassThrough )
+  {
+    mOwnerData.append( data );
+  }
+  else
+  {
+    mBuffer.append( data );
+    // the byte scan is only valid for ASCII compatible encodings
+    if ( mMode == Prologue && mBuffer.size() >= 2 )
+    {
+      const unsigned char c0 = static_cast<unsigned char>( mBuffer.at( 0 ) );
+      const unsigned char c1 = static_cast<unsigned char>( mBuffer.at( 1 ) );
+      if ( c0 == 0 || c1 == 0 || c0 == 0xFE || c0 == 0xFF )
+        mMode = PassThrough;
+    }
+    if ( mMode != PassThrough && ( mBuffer.size() >= 2 || atEnd ) )
+      scan();
+
+    // incomplete markup is kept for the next call, unless there is none
+    const int end = atEnd || mMode == PassThrough ? mBuffer.size() : mPos;
+    if ( mMemberDepth >= 0 && mMode == Split )
+      routeToChunk( end );
+    else
+      routeToOwner( end );
+    mBuffer.remove( 0, end );
+    mPos -= end;
+    mRouteStart = 0;
+
+    if ( atEnd )
+      dispatchChunk();
+  }
+
+  collectChunks( atEnd );
+  flushOwnerData( atEnd );
+
+  if ( mFailed )
+  {
+    errorMsg = mErrorMsg;
+    return false;
+  }
+  return true;
+}
+
+void QgsGmlStreamingParser::ParallelParser::scan()
+{
+  while ( mPos < mBuffer.size() && mMode != PassThrough )
+  {
+    const int start = mBuffer.indexOf( '<', mPos );
+    if ( start < 0 )
+    {
+      mPos = mBuffer.size();
+      break;
+    }
+
+    const int end = markupEnd( start );
+    if ( end < 0 )
+    {
+      mPos = start;
+      break;
+    }
+    mPos = end;
+    handleMarkup( start, end );
+  }
+}
+
+int QgsGmlStreamingParser::ParallelParser::markupEnd( int start ) const
+{
+  const char *data = mBuffer.constData();
+  const int size = mBuffer.size();
+  if ( size - start < 2 )
+    return -1;
+
+  auto find = [this]( const char *pattern, int from ) -> int
+  {
+    const int index = mBuffer.indexOf( pattern, from );
+    return index < 0 ? -1 : index + static_cast<int>( strlen( pattern ) );
+  };
+
+  if ( data[start + 1] == '?' )
+    return find( "?>", start + 2 );
+
+  if ( data[start + 1] == '!' )
+  {
+    if ( size - start >= 4 && memcmp( data + start, "<!--", 4 ) == 0 )
+      return find( "-->", start + 4 );
+    if ( size - start < 9 )
+      return -1;
+    if ( memcmp( data + start, "<![CDATA[", 9 ) == 0 )
+      return find( "]]>", start + 9 );
+    // a document type declaration, whose internal subset could contain '>'
+    return find( ">", start + 2 );
+  }
+
+  char quote = 0;
+  for ( int i = start + 1; i < size; ++i )
+  {
+    const char c = data[i];
+    if ( quote )
+    {
+      if ( c == quote )
+        quote = 0;
+    }
+    else if ( c == '"' || c == '\'' )
+    {
+      quote = c;
+    }
+    else if ( c == '>' )
+    {
+      return i + 1;
+    }
+  }
+  return -1;
+}
+
+void QgsGmlStreamingParser::ParallelParser::handleMarkup( int start, int end )
+{
+  const char *data = mBuffer.constData();
+  if ( data[start + 1] == '?' )
+    return;
+
+  if ( data[start + 1] == '!' )
+  {
+    // comments are fine in the prologue, but entities declared in a document
+    // type declaration would not be known by the chunk parsers
+    if ( mMode == Prologue && memcmp( data + start, "<!--", 4 ) != 0 )
+      mMode = PassThrough;
+    return;
+  }
+
+  const bool isEndTag = data[start + 1] == '/';
+  const bool isEmptyElement = !isEndTag && data[end - 2] == '/';
+
+  if ( mMemberDepth >= 0 )
+  {
+    // only the depth matters inside a member
+    if ( isEndTag )
+    {
+      if ( --mDepth == mMemberDepth )
+      {
+        mMemberDepth = -1;
+        routeToChunk( end );
+        if ( !mFirstChunkDispatched || mChunkData.size() >= CHUNK_SIZE )
+          dispatchChunk();
+      }
+    }
+    else if ( !isEmptyElement )
+    {
+      ++mDepth;
+    }
+    return;
+  }
+
+  const int nameStart = start + ( isEndTag ? 2 : 1 );
+  int nameEnd = nameStart;
+  while ( nameEnd < end && !strchr( " \t\r\n/>", data[nameEnd] ) )
+    ++nameEnd;
+  const char *pszSep = static_cast<const char *>( memchr( data + nameStart, ':', nameEnd - nameStart ) );
+  const char *pszLocalName = pszSep ? pszSep + 1 : data + nameStart;
+  const int localNameLen = static_cast<int>( data + nameEnd - pszLocalName );
+
+  if ( mMode == Prologue )
+  {
+    // only feature collections are split
+    if ( isEndTag || isEmptyElement || !LOCALNAME_EQUALS( "FeatureCollection" ) )
+    {
+      mMode = PassThrough;
+      return;
+    }
+    routeToOwner( end );
+    mMode = Split;
+    mRootEndTag = "</" + QByteArray( data + nameStart, nameEnd - nameStart ) + '>';
+    mDepth = 1;
+    return;
+  }
+
+  if ( isEndTag )
+  {
+    --mDepth;
+    if ( mInFeatureMembers && mDepth == 1 )
+    {
+      mInFeatureMembers = false;
+      dispatchChunk();
+    }
+    return;
+  }
+
+  const bool isMember = mInFeatureMembers ? mDepth == 2 : mDepth == 1 && ( LOCALNAME_EQUALS( "featureMember" ) || LOCALNAME_EQUALS( "member" ) );
+  if ( isMember )
+  {
+    routeToOwner( start );
+    if ( mChunkInFeatureMembers != mInFeatureMembers )
+    {
+      dispatchChunk();
+      mChunkInFeatureMembers = mInFeatureMembers;
+    }
+    if ( isEmptyElement )
+    {
+      routeToChunk( end );
+    }
+    else
+    {
+      mMemberDepth = mDepth;
+      ++mDepth;
+    }
+    return;
+  }
+
+  if ( mDepth == 1 && !isEmptyElement && LOCALNAME_EQUALS( "featureMembers" ) )
+  {
+    mInFeatureMembers = true;
+    mFeatureMembersStartTag = mBuffer.mid( start, end - start );
+    mFeatureMembersEndTag = "</" + QByteArray( data + nameStart, nameEnd - nameStart ) + '>';
+  }
+  if ( !isEmptyElement )
+    ++mDepth;
+}
+
+void QgsGmlStreamingParser::ParallelParser::routeToOwner( int end )
+{
+  if ( end <= mRouteStart )
+    return;
+
+  const QByteArray data = mBuffer.mid( mRouteStart, end - mRouteStart );
+  mOwnerData.append( data );
+  if ( mMode == Prologue )
+    mPrologue.append( data );
+  mRouteStart = end;
+}
+
+void QgsGmlStreamingParser::ParallelParser::routeToChunk( int end )
+{
+  if ( end <= mRouteStart )
+    return;
+
+  mChunkData.append( mBuffer.constData() + mRouteStart, end - mRouteStart );
+  mRouteStart = end;
+}
+
+void QgsGmlStreamingParser::ParallelParser::dispatchChunk()
+{
+  if ( mChunkData.isEmpty() )
+    return;
+
+  Chunk chunk;
+  chunk.document = mPrologue;
+  if ( mChunkInFeatureMembers )
+    chunk.document += mFeatureMembersStartTag;
+  chunk.document += mChunkData;
+  if ( mChunkInFeatureMembers )
+    chunk.document += mFeatureMembersEndTag;
+  chunk.document += mRootEndTag;
+  mChunkData.clear();
+
+  // the owner must have seen what precedes the chunk, e.g. a srsName in the bounding box of the collection
+  flushOwnerData( false );
+  chunk.state = mOwner->documentState();
+
+  if ( !mFirstChunkDispatched )
+  {
+    // the first chunk usually sets the state of the document, it is parsed
+    // right away so that the next ones do not have to be parsed twice
+    mFirstChunkDispatched = true;
+    std::shared_ptr<QgsGmlStreamingParser> parser = createChunkParser( chunk.state );
+    finishChunk( chunk, parseChunk( *parser, chunk.document ) );
+    return;
+  }
+
+  std::shared_ptr<QgsGmlStreamingParser> parser = createChunkParser( chunk.state );
+  const QByteArray document = chunk.document;
+  chunk.future = QtConcurrent::run( [parser, document]
+  {
+    return parseChunk( *parser, document );
+  } );
+  mChunks.enqueue( chunk );
+
+  // do not get too far ahead of the workers
+  const int maxChunks = 2 * std::max( 1, QThread::idealThreadCount() );
+  while ( mChunks.size() > maxChunks )
+  {
+    const Chunk first = mChunks.dequeue();
+    finishChunk( first, first.future.result() );
+  }
+}
+
+void QgsGmlStreamingParser::ParallelParser::collectChunks( bool wait )
+{
+  while ( !mChunks.isEmpty() && ( wait || mChunks.head().future.isFinished() ) )
+  {
+    const Chunk chunk = mChunks.dequeue();
+    finishChunk( chunk, chunk.future.result() );
+  }
+}
+
+void QgsGmlStreamingParser::ParallelParser::finishChunk( const Chunk &chunk, ChunkResult result )
+{
+  if ( !mFailed && chunk.state != mOwner->documentState() )
+  {
+    for ( const QgsGmlFeaturePtrGmlIdPair &featPair : qgis::as_const( result.features ) )
+      delete featPair.first;
+    std::shared_ptr<QgsGmlStreamingParser> parser = createChunkParser( mOwner->documentState() );
+    result = parseChunk( *parser, chunk.document );
+  }
+
+  if ( mFailed )
+  {
+    // the serial parser would have stopped at the first error
+    for ( const QgsGmlFeaturePtrGmlIdPair &featPair : qgis::as_const( result.features ) )
+      delete featPair.first;
+    return;
+  }
+
+  for ( const QgsGmlFeaturePtrGmlIdPair &featPair : qgis::as_const( result.features ) )
+  {
+    featPair.first->setId( mOwner->mFeatureCount++ );
+    mOwner->mFeatureList.push_back( featPair );
+  }
+  mOwner->setDocumentState( result.state );
+  if ( result.wkbType != QgsWkbTypes::Unknown )
+    mOwner->mWkbType = result.wkbType;
+
+  if ( !result.ok )
+    setError( result.errorMsg );
+}
+
+void QgsGmlStreamingParser::ParallelParser::flushOwnerData( bool atEnd )
+{
+  if ( mFailed || ( mOwnerData.isEmpty() && !atEnd ) )
+    return;
+
+  QString errorMsg;
+  if ( !mOwner->parse( mOwnerData, atEnd, errorMsg ) )
+    setError( errorMsg );
+  mOwnerData.clear();
+}
+
+std::shared_ptr<QgsGmlStreamingParser> QgsGmlStreamingParser::ParallelParser::createChunkParser( const DocumentState &state ) const
+{
+  std::shared_ptr<QgsGmlStreamingParser> parser = std::make_shared<QgsGmlStreamingParser>( QString(), QString(), QgsFields() );
+  parser->copyConfiguration( *mOwner );
+  parser->setDocumentState( state );
+  return parser;
+}
+
+QgsGmlStreamingParser::ParallelParser::ChunkResult QgsGmlStreamingParser::ParallelParser::parseChunk( QgsGmlStreamingParser &parser, const QByteArray &document )
+{
+  ChunkResult result;
+  result.ok = parser.parse( document, true, result.errorMsg );
+  result.features = parser.getAndStealReadyFeatures();
+  result.state = parser.documentState();
+  result.wkbType = parser.mWkbType;
+  return result;
+}
+
+void QgsGmlStreamingParser::ParallelParser::setError( const QString &errorMsg )
+{
+  if ( mFailed )
+    return;
+
+  mFailed = true;
+  mErrorMsg = errorMsg;
+}
+
+///@endcond
+
 void QgsGmlStreamingParser::startElement( const XML_Char *el, const XML_Char **attr )
 {
   const int elLen = static_cast<int>( strlen( el ) );
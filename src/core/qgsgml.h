@@ -30,6 +30,7 @@
 #include <QStack>
 #include <QVector>
 
+#include <memory>
 #include <string>
 
 class QgsCoordinateReferenceSystem;
@@ -118,6 +119,20 @@ class CORE_EXPORT QgsGmlStreamingParser
     */
     QVector<QgsGmlFeaturePtrGmlIdPair> getAndStealReadyFeatures();
 
+    /**
+     * Sets whether the features are parsed on worker threads.
+     *
+     * When enabled, the data of a feature collection is split at the boundaries
+     * of its feature members, and groups of members are parsed concurrently by
+     * separate parsers. The features are still returned by getAndStealReadyFeatures()
+     * in the order of the document, but possibly after a later call to processData().
+     * Other documents, e.g. exception reports, are parsed as usual.
+     *
+     * Must be called before the first call to processData().
+     * \since QGIS 3.16
+     */
+    void setParallelParsingEnabled( bool enabled );
+
     //! Returns the EPSG code, or 0 if unknown
     int getEPSGCode() const { return mEpsg; }
 
@@ -147,6 +162,9 @@ class CORE_EXPORT QgsGmlStreamingParser
 
   private:
 
+    struct DocumentState;
+    class ParallelParser;
+
     enum ParseMode
     {
       None,
@@ -187,6 +205,16 @@ class CORE_EXPORT QgsGmlStreamingParser
       static_cast<QgsGmlStreamingParser *>( data )->characters( chars, len );
     }
 
+    //! Feeds \a data to the expat parser
+    bool parse( const QByteArray &data, bool atEnd, QString &errorMsg );
+
+    //! Copies the parameters given to the constructor of \a other
+    void copyConfiguration( const QgsGmlStreamingParser &other );
+
+    //! Returns the state inferred from the data parsed so far, used for the next features
+    DocumentState documentState() const;
+    void setDocumentState( const DocumentState &state );
+
     // Set current feature attribute
     void setAttribute( const QString &name, const QString &value );
 
@@ -342,6 +370,8 @@ class CORE_EXPORT QgsGmlStreamingParser
     std::string mGeometryString;
     //! Whether we found a unhandled geometry element
     bool mFoundUnhandledGeometryElement;
+    //! Splits the data and parses the feature members in parallel, if enabled
+    std::unique_ptr<ParallelParser> mParallelParser;
 };
 
 #endif
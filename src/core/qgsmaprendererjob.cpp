@@ -335,6 +335,12 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter *painter, QgsLabelingEn
       continue;
     }
 
+    if ( mSettings.testFlag( QgsMapSettings::SkipSymbolRendering ) && ml->type() != QgsMapLayerType::VectorLayer )
+    {
+      QgsDebugMsgLevel( QStringLiteral( "Layer not rendered because only labels are rendered" ), 3 );
+      continue;
+    }
+
     QgsRectangle r1 = mSettings.visibleExtent(), r2;
     r1.grow( mSettings.extentBuffer() );
     QgsCoordinateTransform ct;
@@ -314,6 +314,8 @@ class CORE_EXPORT QgsMapSettings : public QgsTemporalRangeObject
       RenderBlocking           = 0x800, //!< Render and load remote sources in the same thread to ensure rendering remote sources (svg and images). WARNING: this flag must NEVER be used from GUI based applications (like the main QGIS application) or crashes will result. Only for use in external scripts or QGIS server.
       LosslessImageRendering   = 0x1000, //!< Render images losslessly whenever possible, instead of the default lossy jpeg rendering used for some destination devices (e.g. PDF). This flag only works with builds based on Qt 5.13 or later.
       Render3DMap              = 0x2000, //!< Render is for a 3D map
+      SplitVectorLayerRendering = 0x4000, //!< Split the rendering of individual vector layers into horizontal bands which are rendered in parallel. Only has an effect for layers rendered to an image. Added in QGIS 3.16
+      SkipSymbolRendering      = 0x8000, //!< Disable symbol rendering while still registering and drawing labels. Layers which cannot contribute labels are skipped entirely. Added in QGIS 3.16
       // TODO: ignore scale-based visibility (overview)
     };
     Q_DECLARE_FLAGS( Flags, Flag )
@@ -23,24 +23,30 @@
 
 #include <zlib.h>
 
+// time waited for the locks of other connections writing to the same file
+static const int WRITE_BUSY_TIMEOUT_MS = 5000;
 
 QgsMbTiles::QgsMbTiles( const QString &filename )
   : mFilename( filename )
 {
 }
 
-bool QgsMbTiles::open()
+bool QgsMbTiles::open( bool readOnly )
 {
   if ( mDatabase )
     return true;  // already opened
 
   sqlite3_database_unique_ptr database;
-  int result = mDatabase.open_v2( mFilename, SQLITE_OPEN_READONLY, nullptr );
+  int result = mDatabase.open_v2( mFilename, readOnly ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE, nullptr );
   if ( result != SQLITE_OK )
   {
     QgsDebugMsg( QStringLiteral( "Can't open MBTiles database: %1" ).arg( database.errorMessage() ) );
     return false;
   }
+
+  if ( !readOnly )
+    sqlite3_busy_timeout( mDatabase.get(), WRITE_BUSY_TIMEOUT_MS );
+
   return true;
 }
 
@@ -65,6 +71,8 @@ bool QgsMbTiles::create()
     return false;
   }
 
+  sqlite3_busy_timeout( mDatabase.get(), WRITE_BUSY_TIMEOUT_MS );
+
   QString sql = \
                 "CREATE TABLE metadata (name text, value text);" \
                 "CREATE TABLE tiles (zoom_level integer, tile_column integer, tile_row integer, tile_data blob);" \
@@ -181,12 +189,12 @@ QImage QgsMbTiles::tileDataAsImage( int z, int x, int y )
   return tileImage;
 }
 
-void QgsMbTiles::setTileData( int z, int x, int y, const QByteArray &data )
+bool QgsMbTiles::setTileData( int z, int x, int y, const QByteArray &data )
 {
   if ( !mDatabase )
   {
     QgsDebugMsg( QStringLiteral( "MBTiles database not open: " ) + mFilename );
-    return;
+    return false;
   }
 
   int result;
@@ -195,16 +203,17 @@ void QgsMbTiles::setTileData( int z, int x, int y, const QByteArray &data )
   if ( result != SQLITE_OK )
   {
     QgsDebugMsg( QStringLiteral( "MBTile failed to prepare statement: " ) + sql );
-    return;
+    return false;
   }
 
   sqlite3_bind_blob( preparedStatement.get(), 1, data.constData(), data.size(), SQLITE_TRANSIENT );
 
   if ( preparedStatement.step() != SQLITE_DONE )
   {
-    QgsDebugMsg( QStringLiteral( "MBTile tile failed to be set: %1,%2,%3" ).arg( z ).arg( x ).arg( y ) );
-    return;
+    QgsDebugMsg( QStringLiteral( "MBTile tile failed to be set: %1,%2,%3: %4" ).arg( z ).arg( x ).arg( y ).arg( mDatabase.errorMessage() ) );
+    return false;
   }
+  return true;
 }
 
 bool QgsMbTiles::decodeGzip( const QByteArray &bytesIn, QByteArray &bytesOut )
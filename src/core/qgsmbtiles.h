@@ -41,8 +41,12 @@ class CORE_EXPORT QgsMbTiles
     //! Constructs MBTiles reader (but it does not open the file yet)
     explicit QgsMbTiles( const QString &filename );
 
-    //! Tries to open the file, returns true on success
-    bool open();
+    /**
+     * Tries to open the file, returns true on success.
+     * The file is opened in read-write mode if \a readOnly is FALSE (since QGIS 3.16), in which
+     * case writes wait for a while when another connection locks the file.
+     */
+    bool open( bool readOnly = true );
 
     //! Returns whether the MBTiles file is currently opened
     bool isOpen() const;
@@ -59,7 +63,7 @@ class CORE_EXPORT QgsMbTiles
 
     /**
      * Sets metadata value for the given key. Does not overwrite existing entries.
-     * \note the database has to be opened in read-write mode (currently only when opened with create()
+     * \note the database has to be opened in read-write mode (when opened with create() or open() with readOnly set to FALSE)
      */
     void setMetadataValue( const QString &key, const QString &value );
 
@@ -74,9 +78,10 @@ class CORE_EXPORT QgsMbTiles
 
     /**
      * Adds tile data for the given tile coordinates. Does not overwrite existing entries.
-     * \note the database has to be opened in read-write mode (currently only when opened with create()
+     * Returns TRUE if the tile was added (since QGIS 3.16).
+     * \note the database has to be opened in read-write mode (when opened with create() or open() with readOnly set to FALSE)
      */
-    void setTileData( int z, int x, int y, const QByteArray &data );
+    bool setTileData( int z, int x, int y, const QByteArray &data );
 
     //! Decodes gzip byte stream, returns true on success. Useful for reading vector tiles.
     static bool decodeGzip( const QByteArray &bytesIn, QByteArray &bytesOut );
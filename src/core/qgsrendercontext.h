@@ -84,6 +84,8 @@ class CORE_EXPORT QgsRenderContext : public QgsTemporalRangeObject
       LosslessImageRendering   = 0x1000, //!< Render images losslessly whenever possible, instead of the default lossy jpeg rendering used for some destination devices (e.g. PDF). This flag only works with builds based on Qt 5.13 or later.
       ApplyScalingWorkaroundForTextRendering = 0x2000, //!< Whether a scaling workaround designed to stablise the rendering of small font sizes (or for painters scaled out by a large amount) when rendering text. Generally this is recommended, but it may incur some performance cost.
       Render3DMap              = 0x4000, //!< Render is for a 3D map
+      SplitVectorLayerRendering = 0x8000, //!< Split the rendering of individual vector layers into horizontal bands which are rendered in parallel. Only has an effect for layers rendered to an image (since QGIS 3.16)
+      SkipSymbolRendering      = 0x10000, //!< Disable symbol rendering while still registering features for labeling (since QGIS 3.16)
     };
     Q_DECLARE_FLAGS( Flags, Flag )
 
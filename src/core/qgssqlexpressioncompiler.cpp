@@ -440,6 +440,41 @@ QString QgsSqlExpressionCompiler::castToInt( const QString &value ) const
   return QString();
 }
 
+QgsGeometry QgsSqlExpressionCompiler::geometryFromNode( const QgsExpressionNode *node ) const
+{
+  switch ( node->nodeType() )
+  {
+    case QgsExpressionNode::ntLiteral:
+    {
+      const QVariant value = static_cast<const QgsExpressionNodeLiteral *>( node )->value();
+      if ( value.canConvert< QgsGeometry >() )
+        return value.value< QgsGeometry >();
+      break;
+    }
+
+    case QgsExpressionNode::ntFunction:
+    {
+      const QgsExpressionNodeFunction *n = static_cast<const QgsExpressionNodeFunction *>( node );
+      if ( QgsExpression::Functions()[n->fnIndex()]->name() != QLatin1String( "geom_from_wkt" ) || !n->args() || n->args()->count() != 1 )
+        break;
+
+      const QgsExpressionNode *arg = n->args()->at( 0 );
+      if ( arg->nodeType() != QgsExpressionNode::ntLiteral )
+        break;
+
+      const QVariant wkt = static_cast<const QgsExpressionNodeLiteral *>( arg )->value();
+      if ( wkt.type() == QVariant::String )
+        return QgsGeometry::fromWkt( wkt.toString() );
+      break;
+    }
+
+    default:
+      break;
+  }
+
+  return QgsGeometry();
+}
+
 bool QgsSqlExpressionCompiler::nodeIsNullLiteral( const QgsExpressionNode *node ) const
 {
   if ( node->nodeType() != QgsExpressionNode::ntLiteral )
@@ -21,6 +21,7 @@
 #include "qgis_core.h"
 #include "qgsfields.h"
 #include "qgsexpressionnodeimpl.h"
+#include "qgsgeometry.h"
 
 class QgsExpression;
 class QgsExpressionNode;
@@ -173,6 +174,14 @@ class CORE_EXPORT QgsSqlExpressionCompiler
      */
     virtual QString castToInt( const QString &value ) const;
 
+    /**
+     * Returns the geometry a \a node evaluates to if it is a constant geometry, i.e. a
+     * literal geometry or geom_from_wkt() called with a literal string, so that subclasses
+     * can pass it to the provider as a parameter. Returns a null geometry otherwise.
+     * \since QGIS 3.16
+     */
+    QgsGeometry geometryFromNode( const QgsExpressionNode *node ) const;
+
     QString mResult;
     QgsFields mFields;
 
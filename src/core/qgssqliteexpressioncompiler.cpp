@@ -27,6 +27,43 @@ QgsSQLiteExpressionCompiler::QgsSQLiteExpressionCompiler( const QgsFields &field
 {
 }
 
+void QgsSQLiteExpressionCompiler::setGeometryColumn( const QString &column, int srid, GeometryFunctions functions )
+{
+  mGeometryColumn = column;
+  mSrid = srid;
+  mGeometryFunctions = column.isEmpty() ? NoGeometryFunctions : functions;
+}
+
+void QgsSQLiteExpressionCompiler::setSpatialIndex( const QString &indexTable, const QString &rowIdColumn )
+{
+  mIndexTable = indexTable;
+  mRowIdColumn = rowIdColumn;
+}
+
+QgsSqlExpressionCompiler::Result QgsSQLiteExpressionCompiler::compile( const QgsExpression *exp )
+{
+  mConditionNodes.clear();
+  if ( exp->rootNode() )
+  {
+    QList< const QgsExpressionNode * > nodes { exp->rootNode() };
+    while ( !nodes.isEmpty() )
+    {
+      const QgsExpressionNode *node = nodes.takeLast();
+      mConditionNodes.insert( node );
+      if ( node->nodeType() != QgsExpressionNode::ntBinaryOperator )
+        continue;
+
+      const QgsExpressionNodeBinaryOperator *op = static_cast<const QgsExpressionNodeBinaryOperator *>( node );
+      if ( op->op() == QgsExpressionNodeBinaryOperator::boAnd || op->op() == QgsExpressionNodeBinaryOperator::boOr )
+        nodes << op->opLeft() << op->opRight();
+    }
+  }
+
+  const Result result = QgsSqlExpressionCompiler::compile( exp );
+  mConditionNodes.clear();
+  return result;
+}
+
 QgsSqlExpressionCompiler::Result QgsSQLiteExpressionCompiler::compileNode( const QgsExpressionNode *node, QString &result )
 {
   switch ( node->nodeType() )
@@ -40,6 +77,17 @@ QgsSqlExpressionCompiler::Result QgsSQLiteExpressionCompiler::compileNode( const
         case QgsExpressionNodeBinaryOperator::boRegexp:
           return Fail; //not supported by SQLite
 
+        case QgsExpressionNodeBinaryOperator::boLT:
+        case QgsExpressionNodeBinaryOperator::boLE:
+        case QgsExpressionNodeBinaryOperator::boGT:
+        case QgsExpressionNodeBinaryOperator::boGE:
+        {
+          const Result distanceResult = compileDistanceWithin( op, result );
+          if ( distanceResult != None )
+            return distanceResult;
+          return QgsSqlExpressionCompiler::compileNode( node, result );
+        }
+
         case QgsExpressionNodeBinaryOperator::boILike:
         case QgsExpressionNodeBinaryOperator::boNotILike:
         {
@@ -78,6 +126,28 @@ QgsSqlExpressionCompiler::Result QgsSQLiteExpressionCompiler::compileNode( const
         }
       }
 
+      if ( mGeometryFunctions != NoGeometryFunctions )
+      {
+        const Result geometryResult = compileGeometryFunction( n, result );
+        if ( geometryResult != None )
+          return geometryResult;
+      }
+
+      return QgsSqlExpressionCompiler::compileNode( node, result );
+    }
+
+    case QgsExpressionNode::ntLiteral:
+    {
+      const QgsGeometry geometry = geometryFromNode( node );
+      if ( !geometry.isNull() )
+      {
+        if ( mGeometryFunctions != SpatiaLiteFunctions )
+          return Fail;
+
+        result = QStringLiteral( "GeomFromText(%1,%2)" ).arg( QgsSqliteUtils::quotedString( geometry.asWkt() ) ).arg( mSrid );
+        return Complete;
+      }
+
       return QgsSqlExpressionCompiler::compileNode( node, result );
     }
 
@@ -88,6 +158,237 @@ QgsSqlExpressionCompiler::Result QgsSQLiteExpressionCompiler::compileNode( const
   return QgsSqlExpressionCompiler::compileNode( node, result );
 }
 
+QgsSqlExpressionCompiler::Result QgsSQLiteExpressionCompiler::compileGeometryFunction( const QgsExpressionNodeFunction *node, QString &result )
+{
+  // predicates true only if the bounding boxes of the geometries intersect
+  static const QMap<QString, QString> PREDICATES
+  {
+    { "intersects", "ST_Intersects" },
+    { "touches", "ST_Touches" },
+    { "crosses", "ST_Crosses" },
+    { "contains", "ST_Contains" },
+    { "within", "ST_Within" },
+    { "overlaps", "ST_Overlaps" },
+  };
+
+  // the bounds of a null geometry are 0
+  static const QMap<QString, QString> BOUNDS
+  {
+    { "x_min", "MinX" },
+    { "x_max", "MaxX" },
+    { "y_min", "MinY" },
+    { "y_max", "MaxY" },
+  };
+
+  static const QMap<QString, QString> SPATIALITE_FUNCTIONS
+  {
+    { "centroid", "ST_Centroid" },
+    { "point_on_surface", "ST_PointOnSurface" },
+    { "area", "ST_Area" },
+    { "perimeter", "ST_Perimeter" },
+  };
+
+  const QString name = QgsExpression::Functions()[node->fnIndex()]->name();
+  const QList<QgsExpressionNode *> args = node->args() ? node->args()->list() : QList<QgsExpressionNode *>();
+
+  if ( name == QLatin1String( "$geometry" ) )
+  {
+    if ( mGeometryFunctions != SpatiaLiteFunctions )
+      return Fail;
+
+    result = quotedIdentifier( mGeometryColumn );
+    return Complete;
+  }
+
+  if ( name == QLatin1String( "geom_from_wkt" ) )
+  {
+    // only constant geometries, which are parsed by QGIS
+    const QgsGeometry geometry = geometryFromNode( node );
+    if ( geometry.isNull() || mGeometryFunctions != SpatiaLiteFunctions )
+      return Fail;
+
+    result = QStringLiteral( "GeomFromText(%1,%2)" ).arg( QgsSqliteUtils::quotedString( geometry.asWkt() ) ).arg( mSrid );
+    return Complete;
+  }
+
+  if ( PREDICATES.contains( name ) && args.size() == 2 )
+  {
+    // the features whose bounding box does not intersect a constant geometry are filtered with the index
+    QString prefilter;
+    if ( mConditionNodes.contains( node ) )
+    {
+      QgsGeometry geometry;
+      if ( isGeometryColumn( args.at( 0 ) ) )
+        geometry = geometryFromNode( args.at( 1 ) );
+      else if ( isGeometryColumn( args.at( 1 ) ) )
+        geometry = geometryFromNode( args.at( 0 ) );
+      if ( !geometry.isNull() && !geometry.isEmpty() )
+        prefilter = boundingBoxFilter( geometry.boundingBox() );
+    }
+
+    if ( mGeometryFunctions == GeoPackageFunctions )
+    {
+      if ( prefilter.isEmpty() )
+        return Fail;
+
+      result = prefilter;
+      return Partial;
+    }
+
+    QString left;
+    QString right;
+    if ( compileNode( args.at( 0 ), left ) != Complete || compileNode( args.at( 1 ), right ) != Complete )
+      return Fail;
+
+    // SpatiaLite predicates return -1 for NULL or invalid geometries, QGIS ones are false
+    result = QStringLiteral( "coalesce(%1(%2,%3) = 1,0)" ).arg( PREDICATES.value( name ), left, right );
+    if ( !prefilter.isEmpty() )
+      result = QStringLiteral( "(%1 AND %2)" ).arg( prefilter, result );
+    return Complete;
+  }
+
+  if ( BOUNDS.contains( name ) && args.size() == 1 )
+  {
+    QString geometry;
+    if ( mGeometryFunctions == GeoPackageFunctions )
+    {
+      if ( !isGeometryColumn( args.at( 0 ) ) )
+        return Fail;
+      result = QStringLiteral( "coalesce(ST_%1(%2),0)" ).arg( BOUNDS.value( name ), quotedIdentifier( mGeometryColumn ) );
+      return Complete;
+    }
+
+    if ( compileNode( args.at( 0 ), geometry ) != Complete )
+      return Fail;
+    result = QStringLiteral( "coalesce(Mbr%1(%2),0)" ).arg( BOUNDS.value( name ), geometry );
+    return Complete;
+  }
+
+  if ( mGeometryFunctions != SpatiaLiteFunctions )
+    return None;
+
+  if ( name == QLatin1String( "distance" ) && args.size() == 2 )
+  {
+    QString left;
+    QString right;
+    if ( compileNode( args.at( 0 ), left ) != Complete || compileNode( args.at( 1 ), right ) != Complete )
+      return Fail;
+
+    // the distance to a null geometry is -1
+    result = QStringLiteral( "coalesce(ST_Distance(%1,%2),-1)" ).arg( left, right );
+    return Complete;
+  }
+
+  if ( SPATIALITE_FUNCTIONS.contains( name ) && args.size() == 1 )
+  {
+    QString geometry;
+    if ( compileNode( args.at( 0 ), geometry ) != Complete )
+      return Fail;
+
+    result = QStringLiteral( "%1(%2)" ).arg( SPATIALITE_FUNCTIONS.value( name ), geometry );
+    // the area and perimeter of other geometries than polygons are NULL
+    if ( name == QLatin1String( "area" ) || name == QLatin1String( "perimeter" ) )
+      result = QStringLiteral( "CASE WHEN GeometryAliasType(%1) IN ('POLYGON','MULTIPOLYGON') THEN %2 END" ).arg( geometry, result );
+    return Complete;
+  }
+
+  return None;
+}
+
+QgsSqlExpressionCompiler::Result QgsSQLiteExpressionCompiler::compileDistanceWithin( const QgsExpressionNodeBinaryOperator *node, QString &result )
+{
+  if ( mGeometryFunctions == NoGeometryFunctions || !mConditionNodes.contains( node ) )
+    return None;
+
+  // distance(...) < d or d > distance(...)
+  const bool distanceOnLeft = node->op() == QgsExpressionNodeBinaryOperator::boLT || node->op() == QgsExpressionNodeBinaryOperator::boLE;
+  const QgsExpressionNode *distanceNode = distanceOnLeft ? node->opLeft() : node->opRight();
+  const QgsExpressionNode *maxNode = distanceOnLeft ? node->opRight() : node->opLeft();
+
+  if ( distanceNode->nodeType() != QgsExpressionNode::ntFunction || maxNode->nodeType() != QgsExpressionNode::ntLiteral )
+    return None;
+
+  const QgsExpressionNodeFunction *distance = static_cast<const QgsExpressionNodeFunction *>( distanceNode );
+  if ( QgsExpression::Functions()[distance->fnIndex()]->name() != QLatin1String( "distance" ) || !distance->args() || distance->args()->count() != 2 )
+    return None;
+
+  const QVariant maxValue = static_cast<const QgsExpressionNodeLiteral *>( maxNode )->value();
+  bool ok = false;
+  const double maxDistance = maxValue.toDouble( &ok );
+  if ( !ok || maxValue.type() == QVariant::String || maxValue.type() == QVariant::Bool || maxDistance < 0 )
+    return None;
+
+  const QList<QgsExpressionNode *> args = distance->args()->list();
+  QgsGeometry geometry;
+  if ( isGeometryColumn( args.at( 0 ) ) )
+    geometry = geometryFromNode( args.at( 1 ) );
+  else if ( isGeometryColumn( args.at( 1 ) ) )
+    geometry = geometryFromNode( args.at( 0 ) );
+  if ( geometry.isNull() || geometry.isEmpty() )
+    return None;
+
+  QgsRectangle rectangle = geometry.boundingBox();
+  rectangle.grow( maxDistance );
+  const QString bboxFilter = boundingBoxFilter( rectangle );
+  if ( bboxFilter.isEmpty() )
+    return None;
+
+  // the distance to null or empty geometries is negative or 0, which are not in the index
+  const QString column = quotedIdentifier( mGeometryColumn );
+  const QString prefilter = QStringLiteral( "(%1 IS NULL OR ST_IsEmpty(%1) OR %2)" ).arg( column, bboxFilter );
+
+  if ( mGeometryFunctions == GeoPackageFunctions )
+  {
+    result = prefilter;
+    return Partial;
+  }
+
+  QString comparison;
+  if ( QgsSqlExpressionCompiler::compileNode( node, comparison ) != Complete )
+    return Fail;
+
+  result = QStringLiteral( "(%1 AND %2)" ).arg( prefilter, comparison );
+  return Complete;
+}
+
+bool QgsSQLiteExpressionCompiler::isGeometryColumn( const QgsExpressionNode *node ) const
+{
+  return node->nodeType() == QgsExpressionNode::ntFunction
+         && QgsExpression::Functions()[static_cast<const QgsExpressionNodeFunction *>( node )->fnIndex()]->name() == QLatin1String( "$geometry" );
+}
+
+QString QgsSQLiteExpressionCompiler::boundingBoxFilter( const QgsRectangle &rectangle ) const
+{
+  if ( !rectangle.isFinite() )
+    return QString();
+
+  const QString xMin = qgsDoubleToString( rectangle.xMinimum() );
+  const QString yMin = qgsDoubleToString( rectangle.yMinimum() );
+  const QString xMax = qgsDoubleToString( rectangle.xMaximum() );
+  const QString yMax = qgsDoubleToString( rectangle.yMaximum() );
+
+  if ( !mIndexTable.isEmpty() )
+  {
+    // SpatiaLite and GeoPackage R-trees only differ by the names of their columns
+    const bool spatiaLite = mGeometryFunctions == SpatiaLiteFunctions;
+    const QString bounds = spatiaLite ? QStringLiteral( "xmin <= %1 AND xmax >= %2 AND ymin <= %3 AND ymax >= %4" ).arg( xMax, xMin, yMax, yMin )
+                           : QStringLiteral( "minx <= %1 AND maxx >= %2 AND miny <= %3 AND maxy >= %4" ).arg( xMax, xMin, yMax, yMin );
+    return QStringLiteral( "%1 IN (SELECT %2 FROM %3 WHERE %4)" ).arg( QgsSqliteUtils::quotedIdentifier( mRowIdColumn ),
+           spatiaLite ? QStringLiteral( "pkid" ) : QStringLiteral( "id" ),
+           QgsSqliteUtils::quotedIdentifier( mIndexTable ),
+           bounds );
+  }
+
+  if ( mGeometryFunctions == GeoPackageFunctions )
+  {
+    // without index, the bounding box is still read from the header of the geometry blob
+    const QString column = QgsSqliteUtils::quotedIdentifier( mGeometryColumn );
+    return QStringLiteral( "(ST_MinX(%1) <= %2 AND ST_MaxX(%1) >= %3 AND ST_MinY(%1) <= %4 AND ST_MaxY(%1) >= %5)" ).arg( column, xMax, xMin, yMax, yMin );
+  }
+
+  return QString();
+}
+
 QString QgsSQLiteExpressionCompiler::quotedIdentifier( const QString &identifier )
 {
   return QgsSqliteUtils::quotedIdentifier( identifier );
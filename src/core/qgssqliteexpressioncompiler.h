@@ -44,6 +44,32 @@ class CORE_EXPORT QgsSQLiteExpressionCompiler : public QgsSqlExpressionCompiler
      */
     explicit QgsSQLiteExpressionCompiler( const QgsFields &fields );
 
+    //! SQL functions available to compile geometry functions and spatial predicates
+    enum GeometryFunctions
+    {
+      NoGeometryFunctions, //!< Geometry functions are not compiled
+      SpatiaLiteFunctions, //!< SpatiaLite functions, working on SpatiaLite geometry blobs
+      GeoPackageFunctions, //!< Functions GDAL registers for GeoPackage geometry blobs, which only give their bounding boxes
+    };
+
+    /**
+     * Sets the geometry \a column of the layer, whose geometries have the given \a srid,
+     * and the SQL \a functions available to compile geometry functions. By default
+     * geometry functions are not compiled.
+     * \since QGIS 3.16
+     */
+    void setGeometryColumn( const QString &column, int srid, GeometryFunctions functions );
+
+    /**
+     * Sets the R-tree \a indexTable of the geometry column, whose ids match the
+     * \a rowIdColumn of the layer. Spatial predicates against constant geometries are
+     * prefiltered with the index.
+     * \since QGIS 3.16
+     */
+    void setSpatialIndex( const QString &indexTable, const QString &rowIdColumn );
+
+    Result compile( const QgsExpression *exp ) override;
+
   protected:
 
     Result compileNode( const QgsExpressionNode *node, QString &str ) override;
@@ -55,6 +81,31 @@ class CORE_EXPORT QgsSQLiteExpressionCompiler : public QgsSqlExpressionCompiler
     QString castToInt( const QString &value ) const override;
     QString castToText( const QString &value ) const override;
 
+  private:
+
+    //! Compiles a geometry function or spatial predicate
+    Result compileGeometryFunction( const QgsExpressionNodeFunction *node, QString &result );
+
+    //! Compiles a comparison of distance($geometry, constant geometry) with a maximum distance
+    Result compileDistanceWithin( const QgsExpressionNodeBinaryOperator *node, QString &result );
+
+    //! Returns TRUE if \a node is the $geometry of the feature
+    bool isGeometryColumn( const QgsExpressionNode *node ) const;
+
+    //! Returns a filter of the features whose bounding box intersects \a rectangle, or an empty string
+    QString boundingBoxFilter( const QgsRectangle &rectangle ) const;
+
+    QString mGeometryColumn;
+    int mSrid = 0;
+    GeometryFunctions mGeometryFunctions = NoGeometryFunctions;
+    QString mIndexTable;
+    QString mRowIdColumn;
+
+    /**
+     * Nodes whose value is only used as the filter condition, i.e. the root and the operands
+     * of its AND and OR operators, so that they can be prefiltered by bounding box.
+     */
+    QSet<const QgsExpressionNode *> mConditionNodes;
 };
 
 ///@endcond
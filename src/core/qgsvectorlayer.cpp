@@ -839,7 +839,8 @@ QgsRectangle QgsVectorLayer::extent() const
   if ( !isSpatial() )
     return rect;
 
-  if ( !mValidExtent && mLazyExtent && mDataProvider && !mDataProvider->hasMetadata() && mReadExtentFromXml && !mXmlExtent.isNull() )
+  // layers read without their provider also use the extent stored in the project
+  if ( !mValidExtent && mLazyExtent && ( !mDataProvider || !mDataProvider->hasMetadata() ) && mReadExtentFromXml && !mXmlExtent.isNull() )
   {
     mExtent = mXmlExtent;
     mValidExtent = true;
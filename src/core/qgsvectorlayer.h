@@ -359,6 +359,13 @@ typedef QSet<int> QgsAttributeIds;
  *
  *   Determines whether the provider generates a spatial index.  The default is no.
  *
+ * - persistIndex=(yes|no)
+ *
+ *   Determines whether the results of the scan of the file, including the indexes,
+ *   are saved in a .qgsindex file next to it, so that they are read from it rather
+ *   than scanning the file again the next time it is opened, unless it has changed.
+ *   The default is no.
+ *
  * - watchFile=(yes|no)
  *
  *   Defines whether the file will be monitored for changes. The default is
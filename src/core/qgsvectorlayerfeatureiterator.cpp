@@ -15,6 +15,7 @@
 #include "qgsvectorlayerfeatureiterator.h"
 
 #include "qgsexpressionfieldbuffer.h"
+#include "qgsfeaturebatch.h"
 #include "qgsgeometrysimplifier.h"
 #include "qgssimplifymethod.h"
 #include "qgsvectordataprovider.h"
@@ -481,6 +482,21 @@ bool QgsVectorLayerFeatureIterator::fetchFeature( QgsFeature &f )
   return false;
 }
 
+bool QgsVectorLayerFeatureIterator::fetchBatch( QgsFeatureBatch &batch, int maxSize )
+{
+  // provider features are returned untouched only without edits, joined or
+  // expression fields, reprojection and geometry validity checks
+  if ( mClosed || mSource->mHasEditBuffer || mHasVirtualAttributes || mTransform.isValid()
+       || mRequest.invalidGeometryCheck() != QgsFeatureRequest::GeometryNoCheck
+       || mProviderIterator.isClosed() )
+    return false;
+
+  if ( !mProviderIterator.nextBatch( batch, maxSize ) )
+    close();
+
+  return true;
+}
+
 
 
 bool QgsVectorLayerFeatureIterator::rewind()
@@ -156,6 +156,13 @@ class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureItera
     //! fetch next feature, return TRUE on success
     bool fetchFeature( QgsFeature &feature ) override;
 
+    /**
+     * Delegates the batch to the provider iterator when its features do not need
+     * to be changed by the layer.
+     * \note not available in Python bindings
+     */
+    bool fetchBatch( QgsFeatureBatch &batch, int maxSize ) override SIP_SKIP;
+
     /**
      * Overrides default method as we only need to filter features in the edit buffer
      * while for others filtering is left to the provider implementation.
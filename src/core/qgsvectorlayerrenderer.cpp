@@ -42,6 +42,54 @@
 #include "qgsmapclippingutils.h"
 
 #include <QPicture>
+#include <numeric>
+#include <QThreadPool>
+#include <QtConcurrentMap>
+
+///@cond PRIVATE
+
+//! Minimum height (in painter units) of a band when splitting layer rendering into bands
+static const int MIN_BAND_HEIGHT = 64;
+
+/**
+ * Returns TRUE if the rendered extent of \a symbol around a feature can be determined
+ * up-front, i.e. the symbol does not generate geometries or use data defined sizes or offsets.
+ */
+static bool symbolHasPredictableBleed( const QgsSymbol *symbol )
+{
+  static const QList< QgsSymbolLayer::Property > sSizeProperties
+  {
+    QgsSymbolLayer::PropertySize,
+    QgsSymbolLayer::PropertyStrokeWidth,
+    QgsSymbolLayer::PropertyOffset,
+    QgsSymbolLayer::PropertyOffsetX,
+    QgsSymbolLayer::PropertyOffsetY,
+    QgsSymbolLayer::PropertyWidth,
+    QgsSymbolLayer::PropertyHeight,
+  };
+
+  for ( int i = 0; i < symbol->symbolLayerCount(); ++i )
+  {
+    const QgsSymbolLayer *layer = symbol->symbolLayer( i );
+    if ( layer->layerType() == QLatin1String( "GeometryGenerator" ) )
+      return false;
+
+    for ( QgsSymbolLayer::Property property : sSizeProperties )
+    {
+      if ( layer->dataDefinedProperties().isActive( property ) )
+        return false;
+    }
+
+    if ( const QgsSymbol *subSymbol = const_cast< QgsSymbolLayer * >( layer )->subSymbol() )
+    {
+      if ( !symbolHasPredictableBleed( subSymbol ) )
+        return false;
+    }
+  }
+  return true;
+}
+
+///@endcond
 
 
 QgsVectorLayerRenderer::QgsVectorLayerRenderer( QgsVectorLayer *layer, QgsRenderContext &context )
@@ -127,6 +175,9 @@ QgsVectorLayerRenderer::QgsVectorLayerRenderer( QgsVectorLayer *layer, QgsRender
   prepareDiagrams( layer, mAttrNames );
 
   mClippingRegions = QgsMapClippingUtils::collectClippingRegionsForLayer( context, layer );
+
+  if ( context.testFlag( QgsRenderContext::SplitVectorLayerRendering ) )
+    prepareBands( layer );
 }
 
 QgsVectorLayerRenderer::~QgsVectorLayerRenderer()
@@ -161,6 +212,13 @@ bool QgsVectorLayerRenderer::render()
 
   QgsRenderContext &context = *renderContext();
 
+  // when only labels are wanted there's no need to fetch features for layers without labels or diagrams
+  if ( context.testFlag( QgsRenderContext::SkipSymbolRendering ) && ( !context.labelingEngine() || ( !mLabelProvider && !mDiagramProvider ) ) )
+    return true;
+
+  if ( !mBandRenderers.empty() && canRenderBands() )
+    return renderBands();
+
   QgsScopedQPainterState painterState( context.painter() );
 
   // MUST be created in the thread doing the rendering
@@ -242,7 +300,7 @@ bool QgsVectorLayerRenderer::render()
     {
       try
       {
-        QgsPointXY center = context.extent().center();
+        QgsPointXY center = ( mSimplificationExtent.isNull() ? context.extent() : mSimplificationExtent ).center();
         double rectSize = ct.sourceCrs().isGeographic() ? 0.0008983 /* ~100/(40075014/360=111319.4833) */ : 100;
 
         QgsRectangle sourceRect = QgsRectangle( center.x(), center.y(), center.x() + rectSize, center.y() + rectSize );
@@ -368,7 +426,11 @@ void QgsVectorLayerRenderer::drawRenderer( QgsFeatureIterator &fit )
       bool drawMarker = ( mDrawVertexMarkers && context.drawEditingInformation() && ( !mVertexMarkerOnlyForSelection || sel ) );
 
       // render feature
-      bool rendered = mRenderer->renderFeature( fet, context, -1, sel, drawMarker );
+      bool rendered = false;
+      if ( !context.testFlag( QgsRenderContext::SkipSymbolRendering ) )
+        rendered = mRenderer->renderFeature( fet, context, -1, sel, drawMarker );
+      else
+        rendered = mRenderer->willRenderFeature( fet, context );
 
       // labeling - register feature
       if ( rendered )
@@ -511,7 +573,7 @@ void QgsVectorLayerRenderer::drawRendererLevels( QgsFeatureIterator &fit )
 
   scopePopper.reset();
 
-  if ( features.empty() )
+  if ( features.empty() || context.testFlag( QgsRenderContext::SkipSymbolRendering ) )
   {
     // nothing to draw
     stopRenderer( selRenderer );
@@ -600,6 +662,210 @@ void QgsVectorLayerRenderer::stopRenderer( QgsSingleSymbolRenderer *selRenderer
 
 
 
+void QgsVectorLayerRenderer::prepareBands( QgsVectorLayer *layer )
+{
+  QgsRenderContext &context = *renderContext();
+
+  // labels and diagrams must be registered exactly once per feature, and renderer paint effects
+  // and rendered feature handlers operate on the layer as a whole
+  if ( mLabelProvider || mDiagramProvider || context.hasRenderedFeatureHandlers() )
+    return;
+  if ( context.testFlag( QgsRenderContext::SkipSymbolRendering ) )
+    return;
+  if ( mRenderer->paintEffect() && mRenderer->paintEffect()->enabled() )
+    return;
+
+  // only renderers which draw each feature independently of the others can be split. Renderers
+  // which aggregate features (e.g. heatmaps, point clusters) or draw outside of the features (inverted
+  // polygons) need to see the whole layer at once
+  static const QStringList sSplittableRenderers
+  {
+    QStringLiteral( "singleSymbol" ),
+    QStringLiteral( "categorizedSymbol" ),
+    QStringLiteral( "graduatedSymbol" ),
+    QStringLiteral( "RuleRenderer" ),
+  };
+  if ( !sSplittableRenderers.contains( mRenderer->type() ) )
+    return;
+
+  // avoid splitting extents which cross the antimeridian in geographic layer CRS
+  const QgsCoordinateTransform ct = context.coordinateTransform();
+  if ( ct.isValid() && ct.sourceCrs().isGeographic() )
+    return;
+
+  const QgsMapToPixel &mtp = context.mapToPixel();
+  const int width = mtp.mapWidth();
+  const int height = mtp.mapHeight();
+  const int bandCount = std::min( 2 * QThreadPool::globalInstance()->maxThreadCount(), height / MIN_BAND_HEIGHT );
+  if ( bandCount < 2 )
+    return;
+
+  // features outside of a band may still have symbols which extend into the band, so
+  // grow each band's request extent by the maximum symbol bleed
+  double maxBleed = 0;
+  const QgsSymbolList symbols = mRenderer->symbols( context );
+  for ( QgsSymbol *symbol : symbols )
+  {
+    if ( !symbolHasPredictableBleed( symbol ) )
+      return;
+    maxBleed = std::max( maxBleed, QgsSymbolLayerUtils::estimateMaxSymbolBleed( symbol, context ) );
+  }
+  // allow for antialiasing and vertex markers
+  maxBleed += context.convertToPainterUnits( mVertexMarkerSize, QgsUnitTypes::RenderMillimeters ) + 1;
+  const double bleedMapUnits = maxBleed * mtp.mapUnitsPerPixel();
+
+  QVector< QRect > bandRects;
+  QVector< QgsRectangle > bandExtents;
+  for ( int i = 0; i < bandCount; ++i )
+  {
+    const int top = i * height / bandCount;
+    const int bottom = ( i + 1 ) * height / bandCount;
+    const QRect bandRect( 0, top, width, bottom - top );
+
+    // take the bounding box of all corners, in order to handle rotated maps
+    const QgsPointXY corners[4] =
+    {
+      mtp.toMapCoordinates( static_cast< double >( bandRect.left() ), static_cast< double >( top ) ),
+      mtp.toMapCoordinates( static_cast< double >( bandRect.left() + width ), static_cast< double >( top ) ),
+      mtp.toMapCoordinates( static_cast< double >( bandRect.left() ), static_cast< double >( bottom ) ),
+      mtp.toMapCoordinates( static_cast< double >( bandRect.left() + width ), static_cast< double >( bottom ) )
+    };
+    QgsRectangle bandExtent( corners[0], corners[1] );
+    bandExtent.combineExtentWith( corners[2] );
+    bandExtent.combineExtentWith( corners[3] );
+    bandExtent.grow( bleedMapUnits );
+
+    if ( ct.isValid() )
+    {
+      try
+      {
+        QgsCoordinateTransform approxTransform = ct;
+        approxTransform.setBallparkTransformsAreAppropriate( true );
+        bandExtent = approxTransform.transformBoundingBox( bandExtent, QgsCoordinateTransform::ReverseTransform );
+      }
+      catch ( QgsCsException & )
+      {
+        QgsDebugMsg( QStringLiteral( "Could not transform band extent, not splitting layer %1" ).arg( layerId() ) );
+        return;
+      }
+    }
+
+    bandRects << bandRect;
+    bandExtents << bandExtent.intersect( context.extent() );
+  }
+
+  for ( int i = 0; i < bandCount; ++i )
+  {
+    std::unique_ptr< QgsRenderContext > bandContext = qgis::make_unique< QgsRenderContext >( context );
+    bandContext->setFlag( QgsRenderContext::SplitVectorLayerRendering, false );
+    bandContext->setLabelingEngine( nullptr );
+    bandContext->setPainter( nullptr );
+    bandContext->setExtent( bandExtents.at( i ) );
+    // the band renderer will add its own layer scope
+    delete bandContext->expressionContext().popScope();
+
+    std::unique_ptr< QgsVectorLayerRenderer > bandRenderer = qgis::make_unique< QgsVectorLayerRenderer >( layer, *bandContext );
+    // all bands must share the same simplification tolerance, or shared edges won't match
+    bandRenderer->mSimplificationExtent = context.extent();
+
+    mBandRenderers.emplace_back( std::move( bandRenderer ) );
+    mBandContexts.emplace_back( std::move( bandContext ) );
+  }
+  mBandRects = bandRects;
+}
+
+bool QgsVectorLayerRenderer::canRenderBands()
+{
+  QgsRenderContext &context = *renderContext();
+
+  // only raster destinations can be split into bands
+  QPainter *painter = context.painter();
+  if ( !painter || !painter->device() || painter->device()->devType() != QInternal::Image || !painter->transform().isIdentity() )
+    return false;
+
+  // selective masking is set up after the renderer is created, and refers to the
+  // symbol layers of this renderer only
+  if ( context.maskPainter() || !context.disabledSymbolLayers().isEmpty() )
+    return false;
+
+  return true;
+}
+
+bool QgsVectorLayerRenderer::renderBands()
+{
+  QgsRenderContext &context = *renderContext();
+  QPainter *painter = context.painter();
+  const qreal devicePixelRatio = painter->device()->devicePixelRatioF();
+
+  // MUST be created in the thread doing the rendering
+  mInterruptionChecker = qgis::make_unique< QgsVectorLayerRendererInterruptionChecker >( context );
+  QObject::connect( mInterruptionChecker.get(), &QgsFeedback::canceled, mInterruptionChecker.get(), [ = ]
+  {
+    for ( const std::unique_ptr< QgsRenderContext > &bandContext : mBandContexts )
+      bandContext->setRenderingStopped( true );
+  }, Qt::DirectConnection );
+
+  QVector< QImage > bandImages( static_cast< int >( mBandRenderers.size() ) );
+  QVector< int > bandIndices( bandImages.size() );
+  std::iota( bandIndices.begin(), bandIndices.end(), 0 );
+
+  QImage *images = bandImages.data();
+  auto renderBand = [this, painter, devicePixelRatio, images]( int &index )
+  {
+    if ( mBandContexts[index]->renderingStopped() )
+      return;
+
+    const QRect &bandRect = mBandRects.at( index );
+    QImage &image = images[index];
+    image = QImage( static_cast< int >( std::ceil( bandRect.width() * devicePixelRatio ) ),
+                    static_cast< int >( std::ceil( bandRect.height() * devicePixelRatio ) ),
+                    QImage::Format_ARGB32_Premultiplied );
+    if ( image.isNull() )
+      return;
+    image.setDevicePixelRatio( devicePixelRatio );
+    image.fill( 0 );
+
+    QPainter bandPainter( &image );
+    bandPainter.setRenderHints( painter->renderHints() );
+    bandPainter.translate( -bandRect.left(), -bandRect.top() );
+
+    QgsRenderContext &bandContext = *mBandContexts[index];
+    bandContext.setPainter( &bandPainter );
+    try
+    {
+      mBandRenderers[index]->render();
+    }
+    catch ( QgsException &e )
+    {
+      Q_UNUSED( e )
+      QgsDebugMsg( "Caught unhandled QgsException: " + e.what() );
+    }
+    catch ( std::exception &e )
+    {
+      Q_UNUSED( e )
+      QgsDebugMsg( "Caught unhandled std::exception: " + QString::fromLatin1( e.what() ) );
+    }
+    bandContext.setPainter( nullptr );
+    bandPainter.end();
+  };
+  QtConcurrent::blockingMap( bandIndices, renderBand );
+
+  // compose bands in order - bands don't overlap, so the result is identical to rendering the layer in one go
+  QgsScopedQPainterState painterState( painter );
+  painter->setCompositionMode( QPainter::CompositionMode_SourceOver );
+  for ( int i = 0; i < bandImages.size(); ++i )
+  {
+    if ( bandImages.at( i ).isNull() )
+      continue;
+
+    painter->drawImage( mBandRects.at( i ).topLeft(), bandImages.at( i ) );
+    mErrors.append( mBandRenderers[i]->errors() );
+  }
+
+  mInterruptionChecker.reset();
+  return true;
+}
+
 void QgsVectorLayerRenderer::prepareLabeling( QgsVectorLayer *layer, QSet<QString> &attributeNames )
 {
   QgsRenderContext &context = *renderContext();
@@ -32,6 +32,8 @@ class QgsMapClippingRegion;
 
 #include <QList>
 #include <QPainter>
+#include <QRect>
+#include <memory>
 
 typedef QList<int> QgsAttributeList;
 
@@ -111,6 +113,24 @@ class QgsVectorLayerRenderer : public QgsMapLayerRenderer
     //! Stop version 2 renderer and selected renderer (if required)
     void stopRenderer( QgsSingleSymbolRenderer *selRenderer );
 
+    /**
+     * Prepares band renderers, used to split the rendering of the layer into horizontal bands
+     * which are rendered in parallel. Does nothing if the layer cannot be safely split.
+     */
+    void prepareBands( QgsVectorLayer *layer );
+
+    /**
+     * Returns TRUE if the prepared band renderers can be used for rendering to the
+     * current render context painter.
+     */
+    bool canRenderBands();
+
+    /**
+     * Renders the layer using the band renderers, compositing the rendered bands
+     * in order onto the render context's painter.
+     */
+    bool renderBands();
+
 
   protected:
 
@@ -168,6 +188,16 @@ class QgsVectorLayerRenderer : public QgsMapLayerRenderer
     QgsGeometry mLabelClipFeatureGeom;
     bool mApplyLabelClipGeometries = false;
 
+    //! Extent used to calculate the simplification tolerance, if different to the render context extent
+    QgsRectangle mSimplificationExtent;
+
+    //! Band extents, in painter units
+    QVector< QRect > mBandRects;
+    //! Render contexts for band renderers. Band renderers keep a pointer to these, so they must outlive the renderers.
+    std::vector< std::unique_ptr< QgsRenderContext > > mBandContexts;
+    //! Renderers for the individual bands, empty if the layer is not split into bands
+    std::vector< std::unique_ptr< QgsVectorLayerRenderer > > mBandRenderers;
+
 };
 
 
@@ -16,6 +16,7 @@
 #include <QRegularExpression>
 
 #include "qgsexpressioncontext.h"
+#include "qgsfeaturebatch.h"
 #include "qgsfeatureiterator.h"
 #include "qgsfeaturerequest.h"
 #include "qgsvectorlayerutils.h"
@@ -41,6 +42,9 @@
 #include "qgsstyleentityvisitor.h"
 #include "qgsstyle.h"
 
+//! Number of features evaluated at once by getValues()
+static const int VALUES_BATCH_SIZE = 4096;
+
 QgsFeatureIterator QgsVectorLayerUtils::getValuesIterator( const QgsVectorLayer *layer, const QString &fieldOrExpression, bool &ok, bool selectedOnly )
 {
   std::unique_ptr<QgsExpression> expression;
@@ -100,6 +104,34 @@ QList<QVariant> QgsVectorLayerUtils::getValues( const QgsVectorLayer *layer, con
       context.appendScopes( QgsExpressionContextUtils::globalProjectLayerScopes( layer ) );
     }
 
+    if ( expression )
+    {
+      expression->prepare( &context );
+
+      // the batch stores the attributes fetched by the iterator
+      const QgsFeatureRequest request = QgsFeatureRequest().setSubsetOfAttributes( expression->referencedColumns(), layer->fields() );
+      const QgsAttributeList attributes = request.flags() & QgsFeatureRequest::SubsetOfAttributes ? request.subsetOfAttributes() : layer->fields().allAttributesList();
+
+      // evaluate numeric expressions by batches, over whole columns
+      if ( expression->canEvaluateByColumns() && !attributes.isEmpty() )
+      {
+        QgsFeatureBatch batch( layer->fields(), attributes, expression->needsGeometry() );
+        while ( fit.nextBatch( batch, VALUES_BATCH_SIZE ) )
+        {
+          const QVector<QVariant> batchValues = expression->evaluateBatch( batch, &context );
+          for ( const QVariant &v : batchValues )
+            values << v;
+
+          if ( feedback && feedback->isCanceled() )
+          {
+            ok = false;
+            return values;
+          }
+        }
+        return values;
+      }
+    }
+
     QgsFeature f;
     while ( fit.nextFeature( f ) )
     {
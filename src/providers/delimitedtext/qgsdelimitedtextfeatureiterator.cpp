@@ -125,6 +125,9 @@ QgsDelimitedTextFeatureIterator::QgsDelimitedTextFeatureIterator( QgsDelimitedTe
   if ( mMode == FileScan )
   {
     QgsDebugMsgLevel( QStringLiteral( "File will be scanned for desired features" ), 4 );
+
+    // The blocks of records whose extent is outside of the filter rectangle can be skipped
+    mSkipBlocks = mTestGeometry && !mSource->mBlockExtents.isEmpty();
   }
 
   // If the layer has geometry, do we really need to load it?
@@ -319,6 +322,19 @@ bool QgsDelimitedTextFeatureIterator::nextFeatureInternal( QgsFeature &feature )
 
     QgsFeatureId fid = file->recordId();
 
+    if ( mSkipBlocks && file->recordPositions().size() == mSource->mBlockExtents.size() )
+    {
+      // None of the records of the block can be in the filter rectangle, so
+      // jump to the next one
+      const int block = file->recordPositionIndex( fid );
+      if ( block >= 0 && ! mSource->mBlockExtents.at( block ).intersects( mFilterRect ) )
+      {
+        if ( ! file->setNextRecordPosition( block + 1 ) )
+          break;
+        continue;
+      }
+    }
+
     while ( tokens.size() < mSource->mFieldCount )
       tokens.append( QString() );
 
@@ -533,6 +549,7 @@ QgsDelimitedTextFeatureSource::QgsDelimitedTextFeatureSource( const QgsDelimited
   , mSpatialIndex( p->mSpatialIndex ? new QgsSpatialIndex( *p->mSpatialIndex ) : nullptr )
   , mUseSubsetIndex( p->mUseSubsetIndex )
   , mSubsetIndex( p->mSubsetIndex )
+  , mBlockExtents( p->mBlockExtents )
   , mFile( nullptr )
   , mFields( p->attributeFields )
   , mFieldCount( p->mFieldCount )
@@ -560,6 +577,7 @@ QgsDelimitedTextFeatureSource::QgsDelimitedTextFeatureSource( const QgsDelimited
 
   mFile.reset( new QgsDelimitedTextFile() );
   mFile->setFromUrl( url );
+  mFile->setRecordPositions( p->mFile->recordPositions() );
 
   mExpressionContext << QgsExpressionContextUtils::globalScope()
                      << QgsExpressionContextUtils::projectScope( QgsProject::instance() );
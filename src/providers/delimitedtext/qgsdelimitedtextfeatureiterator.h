@@ -38,6 +38,7 @@ class QgsDelimitedTextFeatureSource final: public QgsAbstractFeatureSource
     std::unique_ptr< QgsSpatialIndex > mSpatialIndex;
     bool mUseSubsetIndex;
     QList<quintptr> mSubsetIndex;
+    QVector<QgsRectangle> mBlockExtents;
     std::unique_ptr< QgsDelimitedTextFile > mFile;
     QgsFields mFields;
     int mFieldCount;  // Note: this includes field count for wkt field
@@ -95,6 +96,8 @@ class QgsDelimitedTextFeatureIterator final: public QgsAbstractFeatureIteratorFr
     bool mTestSubset = false;
     bool mTestGeometry = false;
     bool mTestGeometryExact = false;
+    //! Whether the records of blocks outside of the filter rectangle are skipped
+    bool mSkipBlocks = false;
     bool mLoadGeometry = false;
     QgsRectangle mFilterRect;
     QgsCoordinateTransform mTransform;
@@ -30,6 +30,8 @@
 #include <QUrl>
 #include <QUrlQuery>
 
+#include <algorithm>
+
 QgsDelimitedTextFile::QgsDelimitedTextFile( const QString &url )
   : mFileName( QString() )
   , mEncoding( QStringLiteral( "UTF-8" ) )
@@ -58,6 +60,8 @@ void QgsDelimitedTextFile::close()
     delete mStream;
     mStream = nullptr;
   }
+  mCodec = nullptr;
+  mRawBuffer = QByteArray();
   if ( mFile )
   {
     delete mFile;
@@ -89,11 +93,32 @@ bool QgsDelimitedTextFile::open()
     }
     if ( mFile )
     {
-      mStream = new QTextStream( mFile );
-      if ( ! mEncoding.isEmpty() )
+      QTextCodec *codec = mEncoding.isEmpty() ? QTextCodec::codecForLocale() : QTextCodec::codecForName( mEncoding.toLatin1() );
+
+      // A byte order mark overrides the encoding, as it does for a QTextStream
+      const QByteArray start = mFile->peek( 4 );
+      QTextCodec *bomCodec = QTextCodec::codecForUtfText( start, nullptr );
+      mDataOffset = 0;
+      if ( bomCodec && bomCodec->mibEnum() == 106 )
+      {
+        codec = bomCodec;
+        mDataOffset = 3;
+      }
+
+      // Lines can only be split in the raw bytes if the end of line characters
+      // are encoded as single bytes, otherwise the file is read as a text stream
+      if ( codec && ( !bomCodec || mDataOffset > 0 ) && codec->fromUnicode( QStringLiteral( "\r\n" ) ) == QByteArrayLiteral( "\r\n" ) )
       {
-        QTextCodec *codec = QTextCodec::codecForName( mEncoding.toLatin1() );
-        mStream->setCodec( codec );
+        mCodec = codec;
+      }
+      else
+      {
+        mStream = new QTextStream( mFile );
+        if ( ! mEncoding.isEmpty() )
+        {
+          mStream->setCodec( QTextCodec::codecForName( mEncoding.toLatin1() ) );
+        }
+        mRecordPositions.clear();
       }
       if ( mUseWatcher )
       {
@@ -109,6 +134,7 @@ bool QgsDelimitedTextFile::open()
 void QgsDelimitedTextFile::updateFile()
 {
   close();
+  mRecordPositions.clear();
   emit fileUpdated();
 }
 
@@ -118,6 +144,7 @@ void QgsDelimitedTextFile::resetDefinition()
   close();
   mFieldNames.clear();
   mMaxFieldCount = 0;
+  mRecordPositions.clear();
 }
 
 // Extract the provider definition from the url
@@ -523,6 +550,16 @@ QgsDelimitedTextFile::Status QgsDelimitedTextFile::nextRecord( QStringList &reco
 
     mCurrentRecord.clear();
     mRecordLineNumber = mLineNumber;
+
+    // Note the position of a record from time to time, to be able to come back to it
+    if ( mCodec && ( mRecordPositions.isEmpty() || mLineNumber >= mRecordPositions.constLast().lineNumber + RECORD_POSITION_INTERVAL ) )
+    {
+      RecordPosition position;
+      position.lineNumber = mLineNumber;
+      position.offset = mLineOffset;
+      mRecordPositions.append( position );
+    }
+
     if ( mRecordNumber >= 0 )
     {
       mRecordNumber++;
@@ -543,7 +580,10 @@ QgsDelimitedTextFile::Status  QgsDelimitedTextFile::reset()
   if ( ! isValid() || ! open() ) return InvalidDefinition;
 
   // Reset the file pointer
-  mStream->seek( 0 );
+  if ( mStream )
+    mStream->seek( 0 );
+  else
+    seekRaw( mDataOffset, 0 );
   mLineNumber = 0;
   mRecordNumber = -1;
   mRecordLineNumber = -1;
@@ -570,11 +610,21 @@ QgsDelimitedTextFile::Status  QgsDelimitedTextFile::reset()
 
 QgsDelimitedTextFile::Status QgsDelimitedTextFile::nextLine( QString &buffer, bool skipBlank )
 {
-  if ( ! mStream )
+  if ( ! mFile )
   {
     Status status = reset();
     if ( status != RecordOk ) return status;
   }
+  if ( mCodec )
+  {
+    while ( nextRawLine( buffer ) == RecordOk )
+    {
+      mLineNumber++;
+      if ( skipBlank && buffer.isEmpty() ) continue;
+      return RecordOk;
+    }
+    return RecordEOF;
+  }
   if ( mLineNumber == 0 )
   {
     mPosInBuffer = 0;
@@ -657,10 +707,125 @@ QgsDelimitedTextFile::Status QgsDelimitedTextFile::nextLine( QString &buffer, bo
   return RecordEOF;
 }
 
+QgsDelimitedTextFile::Status QgsDelimitedTextFile::nextRawLine( QString &buffer )
+{
+  while ( ! mRawEndOfFile )
+  {
+    const char *data = mRawBuffer.constData();
+    int size = mRawBuffer.size();
+
+    // Identify position of \r , \n or \r\n
+    int eolPos = mPosInRawBuffer;
+    while ( eolPos < size && data[eolPos] != '\n' && data[eolPos] != '\r' )
+      eolPos++;
+
+    if ( eolPos < size )
+    {
+      int nextPos = eolPos + 1;
+      if ( data[eolPos] == '\r' )
+      {
+        // If we are just at the end of the buffer, read an extra byte
+        // to check for a \n
+        if ( nextPos == size && ! mFile->atEnd() )
+        {
+          mRawBuffer += mFile->read( 1 );
+          data = mRawBuffer.constData();
+          size = mRawBuffer.size();
+        }
+        if ( nextPos < size && data[nextPos] == '\n' )
+          nextPos++;
+      }
+      buffer = mCodec->toUnicode( data + mPosInRawBuffer, eolPos - mPosInRawBuffer );
+      mLineOffset = mRawBufferOffset + mPosInRawBuffer;
+      mPosInRawBuffer = nextPos;
+      return RecordOk;
+    }
+
+    if ( ( mPosInRawBuffer == 0 && size >= mMaxBufferSize ) || mFile->atEnd() )
+    {
+      // Either the last line has no end of line character, or the line does not
+      // fit in the buffer, in which case it is truncated and we don't iterate
+      // any more (to avoid unbounded line sizes)
+      mRawEndOfFile = true;
+      if ( mPosInRawBuffer >= size ) break;
+      buffer = mCodec->toUnicode( data + mPosInRawBuffer, size - mPosInRawBuffer );
+      mLineOffset = mRawBufferOffset + mPosInRawBuffer;
+      mPosInRawBuffer = size;
+      return RecordOk;
+    }
+
+    // Read more bytes from file to have up to mMaxBufferSize bytes
+    // in our buffer (after having subset it from mPosInRawBuffer)
+    mRawBuffer.remove( 0, mPosInRawBuffer );
+    mRawBufferOffset += mPosInRawBuffer;
+    mPosInRawBuffer = 0;
+    const QByteArray bytes = mFile->read( mMaxBufferSize - mRawBuffer.size() );
+    if ( bytes.isEmpty() && ! mFile->atEnd() )
+    {
+      QgsDebugMsg( "Data file " + mFileName + " could not be read" );
+      mRawEndOfFile = true;
+    }
+    mRawBuffer += bytes;
+  }
+  return RecordEOF;
+}
+
+void QgsDelimitedTextFile::seekRaw( qint64 offset, long lineNumber )
+{
+  mRawBuffer.clear();
+  mPosInRawBuffer = 0;
+  mRawEndOfFile = ! mFile->seek( offset );
+  mRawBufferOffset = offset;
+  mLineNumber = lineNumber;
+}
+
+void QgsDelimitedTextFile::setRecordPositions( const QVector<RecordPosition> &positions )
+{
+  // The positions are only valid if the lines are split in the raw bytes of the file,
+  // otherwise they are discarded when the file is opened
+  mRecordPositions = ( mFile && ! mCodec ) ? QVector<RecordPosition>() : positions;
+}
+
+int QgsDelimitedTextFile::recordPositionIndex( long recordId ) const
+{
+  auto it = std::upper_bound( mRecordPositions.constBegin(), mRecordPositions.constEnd(), recordId,
+                              []( long id, const RecordPosition & position ) { return id < position.lineNumber; } );
+  return static_cast<int>( it - mRecordPositions.constBegin() ) - 1;
+}
+
+bool QgsDelimitedTextFile::setNextRecordPosition( int index )
+{
+  if ( ! mFile ) reset();
+  if ( ! mCodec || index < 0 || index >= mRecordPositions.size() ) return false;
+
+  const RecordPosition &position = mRecordPositions.at( index );
+  seekRaw( position.offset, position.lineNumber - 1 );
+  mRecordNumber = -1;
+  mRecordLineNumber = -1;
+  mHoldCurrentRecord = false;
+  return true;
+}
+
 bool QgsDelimitedTextFile::setNextLineNumber( long nextLineNumber )
 {
-  if ( ! mStream ) return false;
-  if ( mLineNumber > nextLineNumber - 1 )
+  if ( ! mFile ) return false;
+  if ( mCodec )
+  {
+    // Start from the closest known record before the line, unless the
+    // current line is closer
+    int index = recordPositionIndex( nextLineNumber );
+    if ( index >= 0 && ( mLineNumber > nextLineNumber - 1 || mRecordPositions.at( index ).lineNumber - 1 > mLineNumber ) )
+    {
+      mRecordNumber = -1;
+      seekRaw( mRecordPositions.at( index ).offset, mRecordPositions.at( index ).lineNumber - 1 );
+    }
+    else if ( mLineNumber > nextLineNumber - 1 )
+    {
+      mRecordNumber = -1;
+      seekRaw( mDataOffset, 0 );
+    }
+  }
+  else if ( mLineNumber > nextLineNumber - 1 )
   {
     mRecordNumber = -1;
     mStream->seek( 0 );
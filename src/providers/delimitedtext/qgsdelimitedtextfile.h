@@ -22,11 +22,13 @@
 #include <QRegExp>
 #include <QUrl>
 #include <QObject>
+#include <QVector>
 
 class QgsFeature;
 class QgsField;
 class QFile;
 class QFileSystemWatcher;
+class QTextCodec;
 class QTextStream;
 
 
@@ -56,6 +58,12 @@ class QTextStream;
 * - CSV format files - these are a special case of character delimited, in which the
 *   delimiter is a comma, and the quote and escape characters are double quotes (")
 *
+* Unless the encoding uses more than one byte for the end of line characters (UTF-16
+* and UTF-32), lines are split in the raw bytes of the file, read by large blocks, and
+* only then decoded.  The file then keeps the byte offset of a record every
+* RECORD_POSITION_INTERVAL lines, so that it can move to a record without reading the
+* file from the start.
+*
 * The delimiters can be encode in and decoded from a QUrl as query items.  The
 * items used are:
 *
@@ -96,6 +104,18 @@ class QgsDelimitedTextFile : public QObject
       DelimTypeRegexp
     };
 
+    //! Position of the start of a record in the file
+    struct RecordPosition
+    {
+      //! Line number of the record, i.e. its record id
+      long lineNumber = -1;
+      //! Offset of the record in the file, in bytes
+      qint64 offset = -1;
+    };
+
+    //! Minimum number of lines between two positions of records kept by the file
+    static const int RECORD_POSITION_INTERVAL = 256;
+
     explicit QgsDelimitedTextFile( const QString &url = QString() );
 
     ~QgsDelimitedTextFile() override;
@@ -293,6 +313,32 @@ class QgsDelimitedTextFile : public QObject
      */
     bool setNextRecordId( long nextRecordId );
 
+    /**
+     * Returns the positions of records noted while reading the file, by increasing
+     * line number.  They are only kept when the lines are split in the raw bytes of
+     * the file, and are the same for any reader of the same file and definition.
+     */
+    const QVector<RecordPosition> &recordPositions() const { return mRecordPositions; }
+
+    /**
+     * Sets the positions of records, as returned by recordPositions() for the same
+     * file and definition, e.g. by another reader or by a previous scan of the file.
+     */
+    void setRecordPositions( const QVector<RecordPosition> &positions );
+
+    /**
+     * Returns the index in recordPositions() of the last position before the record
+     * \a recordId, or -1 if there is none.
+     */
+    int recordPositionIndex( long recordId ) const;
+
+    /**
+     * Moves to the record at the position \a index of recordPositions(), so that it
+     * is the next record returned.
+     * \returns valid  True if the position exists
+     */
+    bool setNextRecordPosition( int index );
+
     /**
      * Number record number of records visited. After scanning the file
      *  serves as a record count.
@@ -387,6 +433,15 @@ class QgsDelimitedTextFile : public QObject
      */
     Status nextLine( QString &buffer, bool skipBlank = false );
 
+    /**
+     * Returns the next line from the raw bytes of the file, for encodings in which
+     * the end of line characters are single bytes.
+     */
+    Status nextRawLine( QString &buffer );
+
+    //! Moves the raw reading of the file to \a offset, the start of the line after \a lineNumber
+    void seekRaw( qint64 offset, long lineNumber );
+
     /**
      * Set the next line to read from the file.
      */
@@ -405,6 +460,8 @@ class QgsDelimitedTextFile : public QObject
     QString mEncoding;
     QFile *mFile = nullptr;
     QTextStream *mStream = nullptr;
+    //! Codec of the lines split in the raw bytes of the file, NULLPTR when read by mStream
+    QTextCodec *mCodec = nullptr;
     bool mUseWatcher = false;
     QFileSystemWatcher *mWatcher = nullptr;
 
@@ -433,6 +490,14 @@ class QgsDelimitedTextFile : public QObject
     QString mBuffer;
     int mPosInBuffer = 0;
     int mMaxBufferSize = 0;
+    // Reading of the raw bytes
+    QByteArray mRawBuffer;
+    int mPosInRawBuffer = 0;
+    qint64 mRawBufferOffset = 0;
+    qint64 mDataOffset = 0;
+    qint64 mLineOffset = -1;
+    bool mRawEndOfFile = false;
+    QVector<RecordPosition> mRecordPositions;
     QStringList mCurrentRecord;
     bool mHoldCurrentRecord = false;
     // Maximum number of record (ie maximum record number visited)
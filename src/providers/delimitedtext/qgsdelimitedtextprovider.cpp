@@ -21,12 +21,15 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QDataStream>
+#include <QDateTime>
 #include <QTextStream>
+#include <QSaveFile>
 #include <QStringList>
 #include <QSettings>
 #include <QRegExp>
 #include <QUrl>
 #include <QUrlQuery>
+#include <QtConcurrentMap>
 
 #include "qgsapplication.h"
 #include "qgscoordinateutils.h"
@@ -59,6 +62,180 @@ static const int SUBSET_ID_THRESHOLD_FACTOR = 10;
 QRegExp QgsDelimitedTextProvider::sWktPrefixRegexp( "^\\s*(?:\\d+\\s+|SRID\\=\\d+\\;)", Qt::CaseInsensitive );
 QRegExp QgsDelimitedTextProvider::sCrdDmsRegexp( "^\\s*(?:([-+nsew])\\s*)?(\\d{1,3})(?:[^0-9.]+([0-5]?\\d))?[^0-9.]+([0-5]?\\d(?:\\.\\d+)?)[^0-9.]*([-+nsew])?\\s*$", Qt::CaseInsensitive );
 
+///@cond PRIVATE
+namespace
+{
+  //! Number of records read from the file before their geometries are parsed in parallel
+  const int SCAN_BATCH_SIZE = 16384;
+
+  //! Number of records of which the types of the values are detected by the same task
+  const int TYPE_DETECTION_BLOCK_SIZE = 1024;
+
+  //! Identifies the index files, followed by their version
+  const quint32 INDEX_FILE_MAGIC = 0x51445449;
+  const quint32 INDEX_FILE_VERSION = 1;
+
+  //! A record read while scanning the file, and what its geometry turned out to be
+  struct ScannedRecord
+  {
+    enum Status
+    {
+      RecordOk,
+      InvalidFormat,
+      EmptyGeometry,
+      InvalidGeometry,
+      NoGeometry,
+      ValidGeometry,
+    };
+
+    QStringList parts;
+    long recordId = -1;
+    //! Index of the last record position noted by the file before this record
+    int block = -1;
+    Status status = RecordOk;
+    bool wktHasPrefix = false;
+    QgsWkbTypes::Type wkbType = QgsWkbTypes::Unknown;
+    bool multipart = false;
+    QgsRectangle boundingBox;
+    //! Whether the record is a feature of the layer, whose values determine the field types
+    bool used = false;
+  };
+
+  /**
+   * Possible types of the non empty values of a column.  Types are possible
+   * until the first value which cannot be parsed.
+   */
+  struct ColumnTypes
+  {
+    bool isEmpty = true;
+    bool couldBeInt = true;
+    bool couldBeLongLong = true;
+    bool couldBeDouble = true;
+    bool couldBeDateTime = true;
+    bool couldBeDate = true;
+    bool couldBeTime = true;
+    //! Time is only tested from the first value which is not a date time
+    bool couldBeTimeAfterDateTime = true;
+
+    void test( const QString &value, const QString &decimalPoint, bool detectTypes )
+    {
+      isEmpty = false;
+      if ( ! detectTypes )
+        return;
+
+      bool ok = false;
+      if ( couldBeInt )
+      {
+        ( void )value.toInt( &ok );
+        couldBeInt = ok;
+      }
+
+      if ( couldBeLongLong && !ok )
+      {
+        ( void )value.toLongLong( &ok );
+        couldBeLongLong = ok;
+      }
+
+      if ( couldBeDouble && !ok )
+      {
+        if ( ! decimalPoint.isEmpty() )
+          ( void )QString( value ).replace( decimalPoint, QLatin1String( "." ) ).toDouble( &ok );
+        else
+          ( void )value.toDouble( &ok );
+        couldBeDouble = ok;
+      }
+
+      bool isDateTime = false;
+      if ( couldBeDateTime )
+      {
+        isDateTime = value.length() > 10 && QDateTime::fromString( value, Qt::ISODate ).isValid();
+        couldBeDateTime = isDateTime;
+      }
+
+      if ( couldBeDate && !isDateTime )
+      {
+        couldBeDate = QDate::fromString( value, Qt::ISODate ).isValid();
+      }
+
+      if ( isDateTime )
+      {
+        couldBeTime = false;
+      }
+      else if ( couldBeTime || couldBeTimeAfterDateTime )
+      {
+        const bool isTime = QTime::fromString( value ).isValid();
+        couldBeTime = couldBeTime && isTime;
+        couldBeTimeAfterDateTime = couldBeTimeAfterDateTime && isTime;
+      }
+    }
+
+    //! Adds the types of the values following the ones of this column
+    void merge( const ColumnTypes &next )
+    {
+      if ( next.isEmpty )
+        return;
+      if ( isEmpty )
+      {
+        *this = next;
+        return;
+      }
+
+      couldBeTimeAfterDateTime = couldBeDateTime ? next.couldBeTimeAfterDateTime : couldBeTimeAfterDateTime && next.couldBeTime;
+      couldBeInt = couldBeInt && next.couldBeInt;
+      couldBeLongLong = couldBeLongLong && next.couldBeLongLong;
+      couldBeDouble = couldBeDouble && next.couldBeDouble;
+      couldBeDateTime = couldBeDateTime && next.couldBeDateTime;
+      couldBeDate = couldBeDate && next.couldBeDate;
+      couldBeTime = couldBeTime && next.couldBeTime;
+    }
+
+    //! Returns the type name of the column, prioritizing integer, double, datetime, date, time, or an empty string for text
+    QString typeName() const
+    {
+      if ( isEmpty )
+        return QString();
+      if ( couldBeInt )
+        return QStringLiteral( "integer" );
+      if ( couldBeLongLong )
+        return QStringLiteral( "longlong" );
+      if ( couldBeDouble )
+        return QStringLiteral( "double" );
+      if ( couldBeDateTime )
+        return QStringLiteral( "datetime" );
+      if ( couldBeDate )
+        return QStringLiteral( "date" );
+      if ( couldBeTimeAfterDateTime )
+        return QStringLiteral( "time" );
+      return QString();
+    }
+  };
+
+  //! Records of a batch of which the types of the values are tested by the same task
+  struct TypeDetectionBlock
+  {
+    QVector<ScannedRecord>::const_iterator begin;
+    QVector<ScannedRecord>::const_iterator end;
+    QVector<ColumnTypes> columnTypes;
+  };
+
+  QgsRectangle emptyBlockExtent()
+  {
+    QgsRectangle extent;
+    extent.setMinimal();
+    return extent;
+  }
+
+  void includeInBlockExtent( QgsRectangle &extent, const QgsRectangle &bbox )
+  {
+    // Not combineExtentWith(), which would ignore a point at 0,0
+    extent.setXMinimum( std::min( extent.xMinimum(), bbox.xMinimum() ) );
+    extent.setYMinimum( std::min( extent.yMinimum(), bbox.yMinimum() ) );
+    extent.setXMaximum( std::max( extent.xMaximum(), bbox.xMaximum() ) );
+    extent.setYMaximum( std::max( extent.yMaximum(), bbox.yMaximum() ) );
+  }
+}
+///@endcond
+
 QgsDelimitedTextProvider::QgsDelimitedTextProvider( const QString &uri, const ProviderOptions &options )
   : QgsVectorDataProvider( uri, options )
 {
@@ -148,6 +325,11 @@ QgsDelimitedTextProvider::QgsDelimitedTextProvider( const QString &uri, const Pr
     mBuildSpatialIndex = ! query.queryItemValue( QStringLiteral( "spatialIndex" ) ).toLower().startsWith( 'n' );
   }
 
+  if ( query.hasQueryItem( QStringLiteral( "persistIndex" ) ) )
+  {
+    mPersistIndex = ! query.queryItemValue( QStringLiteral( "persistIndex" ) ).toLower().startsWith( 'n' );
+  }
+
   if ( query.hasQueryItem( QStringLiteral( "subset" ) ) )
   {
     // We need to specify FullyDecoded so that %25 is decoded as %
@@ -390,9 +572,110 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
   // 3) the geometric extents of the layer
   // 4) the type of each field
   //
-  // Also build subset and spatial indexes.
+  // Also build subset and spatial indexes.  If the results of a previous scan
+  // have been saved in an index file, then they are just read from it.
+
+  QStringList fieldNames;
+  QStringList detectedTypes;
+  QStringList warnings;
+  QVector< QPair< QgsFeatureId, QgsRectangle > > spatialIndexEntries;
+
+  const bool indexFileRead = mPersistIndex && buildIndexes && readIndexFile( fieldNames, detectedTypes, warnings, spatialIndexEntries );
+  if ( ! indexFileRead )
+  {
+    scanRecords( buildSpatialIndex, buildSubsetIndex, detectedTypes, warnings, mPersistIndex ? &spatialIndexEntries : nullptr );
+    fieldNames = mFile->fieldNames();
+  }
+
+  // Now create the attribute fields.  Field types are determined by prioritizing
+  // integer, failing that double, datetime, date, time, and finally text.
+  mFieldCount = fieldNames.size();
+  attributeColumns.clear();
+  attributeFields.clear();
+
+  QString csvtMessage;
+  QStringList csvtTypes = readCsvtFieldTypes( mFile->fileName(), &csvtMessage );
+
+  for ( int i = 0; i < fieldNames.size(); i++ )
+  {
+    // Skip over WKT field ... don't want to display in attribute table
+    if ( i == mWktFieldIndex )
+      continue;
+
+    // Add the field index lookup for the column
+    attributeColumns.append( i );
+    QVariant::Type fieldType = QVariant::String;
+    QString typeName = QStringLiteral( "text" );
+    if ( i < csvtTypes.size() )
+    {
+      typeName = csvtTypes[i];
+    }
+    else if ( i < detectedTypes.size() && ! detectedTypes[i].isEmpty() )
+    {
+      typeName = detectedTypes[i];
+    }
+
+    if ( typeName == QStringLiteral( "integer" ) )
+    {
+      fieldType = QVariant::Int;
+    }
+    else if ( typeName == QStringLiteral( "longlong" ) )
+    {
+      fieldType = QVariant::LongLong;
+    }
+    else if ( typeName == QStringLiteral( "real" ) || typeName == QStringLiteral( "double" ) )
+    {
+      typeName = QStringLiteral( "double" );
+      fieldType = QVariant::Double;
+    }
+    else if ( typeName == QStringLiteral( "datetime" ) )
+    {
+      fieldType = QVariant::DateTime;
+    }
+    else if ( typeName == QStringLiteral( "date" ) )
+    {
+      fieldType = QVariant::Date;
+    }
+    else if ( typeName == QStringLiteral( "time" ) )
+    {
+      fieldType = QVariant::Time;
+    }
+    else
+    {
+      typeName = QStringLiteral( "text" );
+    }
+
+    attributeFields.append( QgsField( fieldNames[i], fieldType, typeName ) );
+  }
+
+  QgsDebugMsgLevel( "Field count for the delimited text file is " + QString::number( attributeFields.size() ), 2 );
+  QgsDebugMsgLevel( "geometry type is: " + QString::number( mWkbType ), 2 );
+  QgsDebugMsgLevel( "feature count is: " + QString::number( mNumberFeatures ), 2 );
+
+  if ( mPersistIndex && buildIndexes && ! indexFileRead )
+    writeIndexFile( fieldNames, detectedTypes, warnings, spatialIndexEntries );
+
+  if ( ! csvtMessage.isEmpty() )
+    warnings.prepend( csvtMessage );
+
+  reportErrors( warnings );
+
+  mUseSpatialIndex = buildSpatialIndex;
+
+  mValid = mGeometryType != QgsWkbTypes::UnknownGeometry;
+  mLayerValid = mValid;
+
+  // If it is valid, then watch for changes to the file
+  connect( mFile.get(), &QgsDelimitedTextFile::fileUpdated, this, &QgsDelimitedTextProvider::onFileUpdated );
+}
+
+void QgsDelimitedTextProvider::scanRecords( bool buildSpatialIndex, bool buildSubsetIndex, QStringList &detectedTypes, QStringList &warnings,
+    QVector< QPair< QgsFeatureId, QgsRectangle > > *spatialIndexEntries )
+{
+  // The records are read by batches.  Their geometries are parsed in parallel, then
+  // the records are accepted or discarded in the order of the file, and finally the
+  // types of the values of the accepted records are tested in parallel.
 
-  QStringList parts;
   long nEmptyRecords = 0;
   long nBadFormatRecords = 0;
   long nIncompatibleGeometry = 0;
@@ -400,101 +683,48 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
   long nEmptyGeometry = 0;
   mNumberFeatures = 0;
   mExtent = QgsRectangle();
+  mBlockExtents.clear();
 
-  QList<bool> isEmpty;
-  QList<bool> couldBeInt;
-  QList<bool> couldBeLongLong;
-  QList<bool> couldBeDouble;
-  QList<bool> couldBeDateTime;
-  QList<bool> couldBeDate;
-  QList<bool> couldBeTime;
-
+  QVector<ColumnTypes> columnTypes;
   bool foundFirstGeometry = false;
 
-  while ( true )
-  {
-    QgsDelimitedTextFile::Status status = mFile->nextRecord( parts );
-    if ( status == QgsDelimitedTextFile::RecordEOF )
-      break;
-    if ( status != QgsDelimitedTextFile::RecordOk )
-    {
-      nBadFormatRecords++;
-      recordInvalidLine( tr( "Invalid record format at line %1" ) );
-      continue;
-    }
-    // Skip over empty records
-    if ( recordIsEmpty( parts ) )
-    {
-      nEmptyRecords++;
-      continue;
-    }
+  QgsWkbTypes::Type xyWkbType = QgsWkbTypes::Point;
+  if ( mZFieldIndex > -1 )
+    xyWkbType = QgsWkbTypes::addZ( xyWkbType );
+  if ( mMFieldIndex > -1 )
+    xyWkbType = QgsWkbTypes::addM( xyWkbType );
 
-    // Check geometries are valid
-    bool geomValid = true;
+  auto parseGeometry = [this, xyWkbType]( ScannedRecord & record )
+  {
+    if ( record.status != ScannedRecord::RecordOk )
+      return;
 
+    const QStringList &parts = record.parts;
     if ( mGeomRep == GeomAsWkt )
     {
       if ( mWktFieldIndex >= parts.size() || parts[mWktFieldIndex].isEmpty() )
       {
-        nEmptyGeometry++;
-        mNumberFeatures++;
+        record.status = ScannedRecord::EmptyGeometry;
+        return;
       }
-      else
-      {
-        // Get the wkt - confirm it is valid, get the type, and
-        // if compatible with the rest of file, add to the extents
-
-        QString sWkt = parts[mWktFieldIndex];
-        QgsGeometry geom;
-        if ( !mWktHasPrefix && sWkt.indexOf( sWktPrefixRegexp ) >= 0 )
-          mWktHasPrefix = true;
-        geom = geomFromWkt( sWkt, mWktHasPrefix );
 
-        if ( !geom.isNull() )
-        {
-          QgsWkbTypes::Type type = geom.wkbType();
-          if ( type != QgsWkbTypes::NoGeometry )
-          {
-            if ( mGeometryType == QgsWkbTypes::UnknownGeometry || geom.type() == mGeometryType )
-            {
-              mGeometryType = geom.type();
-              if ( !foundFirstGeometry )
-              {
-                mNumberFeatures++;
-                mWkbType = type;
-                mExtent = geom.boundingBox();
-                foundFirstGeometry = true;
-              }
-              else
-              {
-                mNumberFeatures++;
-                if ( geom.isMultipart() )
-                  mWkbType = type;
-                QgsRectangle bbox( geom.boundingBox() );
-                mExtent.combineExtentWith( bbox );
-              }
-              if ( buildSpatialIndex )
-              {
-                QgsFeature f;
-                f.setId( mFile->recordId() );
-                f.setGeometry( geom );
-                mSpatialIndex->addFeature( f );
-              }
-            }
-            else
-            {
-              nIncompatibleGeometry++;
-              geomValid = false;
-            }
-          }
-        }
-        else
-        {
-          geomValid = false;
-          nInvalidGeometry++;
-          recordInvalidLine( tr( "Invalid WKT at line %1" ) );
-        }
+      QString sWkt = parts[mWktFieldIndex];
+      record.wktHasPrefix = sWkt.indexOf( sWktPrefixRegexp ) >= 0;
+      const QgsGeometry geom = geomFromWkt( sWkt, record.wktHasPrefix );
+      if ( geom.isNull() )
+      {
+        record.status = ScannedRecord::InvalidGeometry;
+        return;
       }
+      record.wkbType = geom.wkbType();
+      if ( record.wkbType == QgsWkbTypes::NoGeometry )
+      {
+        record.status = ScannedRecord::NoGeometry;
+        return;
+      }
+      record.status = ScannedRecord::ValidGeometry;
+      record.multipart = geom.isMultipart();
+      record.boundingBox = geom.boundingBox();
     }
     else if ( mGeomRep == GeomAsXy )
     {
@@ -503,253 +733,219 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
 
       QString sX = mXFieldIndex < parts.size() ? parts[mXFieldIndex] : QString();
       QString sY = mYFieldIndex < parts.size() ? parts[mYFieldIndex] : QString();
-      QString sZ, sM;
-      if ( mZFieldIndex > -1 )
-        sZ = mZFieldIndex < parts.size() ? parts[mZFieldIndex] : QString();
-      if ( mMFieldIndex > -1 )
-        sM = mMFieldIndex < parts.size() ? parts[mMFieldIndex] : QString();
       if ( sX.isEmpty() && sY.isEmpty() )
       {
-        nEmptyGeometry++;
-        mNumberFeatures++;
+        record.status = ScannedRecord::EmptyGeometry;
+        return;
       }
-      else
-      {
-        QgsPoint pt;
-        bool ok = pointFromXY( sX, sY, pt, mDecimalPoint, mXyDms );
-
-        if ( ok )
-        {
-          if ( !sZ.isEmpty() || sM.isEmpty() )
-            appendZM( sZ, sM, pt, mDecimalPoint );
 
-          if ( foundFirstGeometry )
-          {
-            mExtent.combineExtentWith( pt.x(), pt.y() );
-          }
-          else
-          {
-            // Extent for the first point is just the first point
-            mExtent.set( pt.x(), pt.y(), pt.x(), pt.y() );
-            mWkbType = QgsWkbTypes::Point;
-            if ( mZFieldIndex > -1 )
-              mWkbType = QgsWkbTypes::addZ( mWkbType );
-            if ( mMFieldIndex > -1 )
-              mWkbType = QgsWkbTypes::addM( mWkbType );
-            mGeometryType = QgsWkbTypes::PointGeometry;
-            foundFirstGeometry = true;
-          }
-          mNumberFeatures++;
-          if ( buildSpatialIndex && std::isfinite( pt.x() ) && std::isfinite( pt.y() ) )
-          {
-            QgsFeature f;
-            f.setId( mFile->recordId() );
-            f.setGeometry( QgsGeometry::fromPointXY( pt ) );
-            mSpatialIndex->addFeature( f );
-          }
-        }
-        else
-        {
-          geomValid = false;
-          nInvalidGeometry++;
-          recordInvalidLine( tr( "Invalid X or Y fields at line %1" ) );
-        }
+      QgsPoint pt;
+      if ( ! pointFromXY( sX, sY, pt, mDecimalPoint, mXyDms ) )
+      {
+        record.status = ScannedRecord::InvalidGeometry;
+        return;
       }
+      record.status = ScannedRecord::ValidGeometry;
+      record.wkbType = xyWkbType;
+      record.boundingBox = QgsRectangle( pt.x(), pt.y(), pt.x(), pt.y() );
     }
     else
     {
-      mWkbType = QgsWkbTypes::NoGeometry;
-      mNumberFeatures++;
+      record.status = ScannedRecord::NoGeometry;
     }
+  };
 
-    if ( !geomValid )
-      continue;
-
-    if ( buildSubsetIndex )
-      mSubsetIndex.append( mFile->recordId() );
-
-
-    // If we are going to use this record, then assess the potential types of each column
+  auto processBatch = [&]( QVector<ScannedRecord> &batch )
+  {
+    QtConcurrent::blockingMap( batch, parseGeometry );
 
-    for ( int i = 0; i < parts.size(); i++ )
+    for ( ScannedRecord &record : batch )
     {
+      if ( record.wktHasPrefix )
+        mWktHasPrefix = true;
 
-      QString &value = parts[i];
-      // Ignore empty fields - spreadsheet generated CSV files often
-      // have random empty fields at the end of a row
-      if ( value.isEmpty() )
-        continue;
-
-      // Expand the columns to include this non empty field if necessary
-
-      while ( couldBeInt.size() <= i )
-      {
-        isEmpty.append( true );
-        couldBeInt.append( false );
-        couldBeLongLong.append( false );
-        couldBeDouble.append( false );
-        couldBeDateTime.append( false );
-        couldBeDate.append( false );
-        couldBeTime.append( false );
-      }
-
-      // If this column has been empty so far then initiallize it
-      // for possible types
-
-      if ( isEmpty[i] )
+      switch ( record.status )
       {
-        isEmpty[i] = false;
-        couldBeInt[i] = true;
-        couldBeLongLong[i] = true;
-        couldBeDouble[i] = true;
-        couldBeDateTime[i] = true;
-        couldBeDate[i] = true;
-        couldBeTime[i] = true;
-      }
+        case ScannedRecord::RecordOk:
+          break;
 
-      if ( ! mDetectTypes )
-      {
-        continue;
-      }
+        case ScannedRecord::InvalidFormat:
+          nBadFormatRecords++;
+          recordInvalidLine( tr( "Invalid record format at line %1" ), record.recordId );
+          continue;
 
-      // Now test for still valid possible types for the field
-      // Types are possible until first record which cannot be parsed
+        case ScannedRecord::InvalidGeometry:
+          nInvalidGeometry++;
+          recordInvalidLine( mGeomRep == GeomAsWkt ? tr( "Invalid WKT at line %1" ) : tr( "Invalid X or Y fields at line %1" ), record.recordId );
+          continue;
 
-      if ( couldBeInt[i] )
-      {
-        ( void )value.toInt( &couldBeInt[i] );
-      }
+        case ScannedRecord::EmptyGeometry:
+          nEmptyGeometry++;
+          mNumberFeatures++;
+          break;
 
-      if ( couldBeLongLong[i] && !couldBeInt[i] )
-      {
-        ( void )value.toLongLong( &couldBeLongLong[i] );
-      }
+        case ScannedRecord::NoGeometry:
+          if ( mGeomRep == GeomNone )
+          {
+            mWkbType = QgsWkbTypes::NoGeometry;
+            mNumberFeatures++;
+          }
+          break;
 
-      if ( couldBeDouble[i] && !couldBeLongLong[i] )
-      {
-        if ( ! mDecimalPoint.isEmpty() )
+        case ScannedRecord::ValidGeometry:
         {
-          value.replace( mDecimalPoint, QLatin1String( "." ) );
-        }
-        ( void )value.toDouble( &couldBeDouble[i] );
-      }
+          const QgsRectangle &bbox = record.boundingBox;
+          if ( mGeomRep == GeomAsWkt )
+          {
+            // If compatible with the rest of file, add to the extents
+            const QgsWkbTypes::GeometryType geometryType = QgsWkbTypes::geometryType( record.wkbType );
+            if ( mGeometryType != QgsWkbTypes::UnknownGeometry && geometryType != mGeometryType )
+            {
+              nIncompatibleGeometry++;
+              continue;
+            }
+            mGeometryType = geometryType;
+            if ( !foundFirstGeometry )
+            {
+              mWkbType = record.wkbType;
+              mExtent = bbox;
+              foundFirstGeometry = true;
+            }
+            else
+            {
+              if ( record.multipart )
+                mWkbType = record.wkbType;
+              mExtent.combineExtentWith( bbox );
+            }
+          }
+          else
+          {
+            if ( foundFirstGeometry )
+            {
+              mExtent.combineExtentWith( bbox.xMinimum(), bbox.yMinimum() );
+            }
+            else
+            {
+              // Extent for the first point is just the first point
+              mExtent = bbox;
+              mWkbType = record.wkbType;
+              mGeometryType = QgsWkbTypes::PointGeometry;
+              foundFirstGeometry = true;
+            }
+          }
+          mNumberFeatures++;
 
-      if ( couldBeDateTime[i] )
-      {
-        QDateTime dt;
-        if ( value.length() > 10 )
-        {
-          dt = QDateTime::fromString( value, Qt::ISODate );
-        }
-        couldBeDateTime[i] = ( dt.isValid() );
-      }
+          if ( buildSpatialIndex && std::isfinite( bbox.xMinimum() ) && std::isfinite( bbox.yMinimum() ) )
+          {
+            mSpatialIndex->addFeature( record.recordId, bbox );
+            if ( spatialIndexEntries )
+              spatialIndexEntries->append( qMakePair( static_cast<QgsFeatureId>( record.recordId ), bbox ) );
+          }
 
-      if ( couldBeDate[i] && !couldBeDateTime[i] )
-      {
-        QDate d = QDate::fromString( value, Qt::ISODate );
-        couldBeDate[i] = d.isValid();
+          if ( record.block >= 0 )
+          {
+            while ( mBlockExtents.size() <= record.block )
+              mBlockExtents.append( emptyBlockExtent() );
+            includeInBlockExtent( mBlockExtents[record.block], bbox );
+          }
+          break;
+        }
       }
 
-      if ( couldBeTime[i] && !couldBeDateTime[i] )
-      {
-        QTime t = QTime::fromString( value );
-        couldBeTime[i] = t.isValid();
-      }
+      // The record is valid, so it will be used
+      record.used = true;
+      if ( buildSubsetIndex )
+        mSubsetIndex.append( record.recordId );
     }
-  }
-
-  // Now create the attribute fields.  Field types are determined by prioritizing
-  // integer, failing that double, datetime, date, time, and finally text.
-  QStringList fieldNames = mFile->fieldNames();
-  mFieldCount = fieldNames.size();
-  attributeColumns.clear();
-  attributeFields.clear();
-
-  QString csvtMessage;
-  QStringList csvtTypes = readCsvtFieldTypes( mFile->fileName(), &csvtMessage );
 
-  for ( int i = 0; i < fieldNames.size(); i++ )
-  {
-    // Skip over WKT field ... don't want to display in attribute table
-    if ( i == mWktFieldIndex )
-      continue;
-
-    // Add the field index lookup for the column
-    attributeColumns.append( i );
-    QVariant::Type fieldType = QVariant::String;
-    QString typeName = QStringLiteral( "text" );
-    if ( i < csvtTypes.size() )
+    // Now assess the potential types of each column, block by block
+    QVector<TypeDetectionBlock> blocks;
+    for ( int start = 0; start < batch.size(); start += TYPE_DETECTION_BLOCK_SIZE )
     {
-      typeName = csvtTypes[i];
+      TypeDetectionBlock block;
+      block.begin = batch.constBegin() + start;
+      block.end = batch.constBegin() + std::min( start + TYPE_DETECTION_BLOCK_SIZE, batch.size() );
+      blocks.append( block );
     }
-    else if ( mDetectTypes && i < couldBeInt.size() )
+
+    const QString decimalPoint = mDecimalPoint;
+    const bool detectTypes = mDetectTypes;
+    QtConcurrent::blockingMap( blocks, [decimalPoint, detectTypes]( TypeDetectionBlock & block )
     {
-      if ( couldBeInt[i] )
-      {
-        typeName = QStringLiteral( "integer" );
-      }
-      else if ( couldBeLongLong[i] )
-      {
-        typeName = QStringLiteral( "longlong" );
-      }
-      else if ( couldBeDouble[i] )
+      for ( auto record = block.begin; record != block.end; ++record )
       {
-        typeName = QStringLiteral( "double" );
-      }
-      else if ( couldBeDateTime[i] )
-      {
-        typeName = QStringLiteral( "datetime" );
-      }
-      else if ( couldBeDate[i] )
-      {
-        typeName = QStringLiteral( "date" );
-      }
-      else if ( couldBeTime[i] )
-      {
-        typeName = QStringLiteral( "time" );
+        if ( ! record->used )
+          continue;
+
+        for ( int i = 0; i < record->parts.size(); i++ )
+        {
+          const QString &value = record->parts[i];
+          // Ignore empty fields - spreadsheet generated CSV files often
+          // have random empty fields at the end of a row
+          if ( value.isEmpty() )
+            continue;
+
+          // Expand the columns to include this non empty field if necessary
+          if ( block.columnTypes.size() <= i )
+            block.columnTypes.resize( i + 1 );
+
+          block.columnTypes[i].test( value, decimalPoint, detectTypes );
+        }
       }
-    }
+    } );
 
-    if ( typeName == QStringLiteral( "integer" ) )
-    {
-      fieldType = QVariant::Int;
-    }
-    else if ( typeName == QStringLiteral( "longlong" ) )
-    {
-      fieldType = QVariant::LongLong;
-    }
-    else if ( typeName == QStringLiteral( "real" ) || typeName == QStringLiteral( "double" ) )
-    {
-      typeName = QStringLiteral( "double" );
-      fieldType = QVariant::Double;
-    }
-    else if ( typeName == QStringLiteral( "datetime" ) )
+    for ( const TypeDetectionBlock &block : qgis::as_const( blocks ) )
     {
-      fieldType = QVariant::DateTime;
+      if ( columnTypes.size() < block.columnTypes.size() )
+        columnTypes.resize( block.columnTypes.size() );
+      for ( int i = 0; i < block.columnTypes.size(); i++ )
+        columnTypes[i].merge( block.columnTypes.at( i ) );
     }
-    else if ( typeName == QStringLiteral( "date" ) )
+  };
+
+  QVector<ScannedRecord> batch;
+  batch.reserve( SCAN_BATCH_SIZE );
+  while ( true )
+  {
+    ScannedRecord record;
+    QgsDelimitedTextFile::Status status = mFile->nextRecord( record.parts );
+    if ( status == QgsDelimitedTextFile::RecordEOF )
+      break;
+    if ( status != QgsDelimitedTextFile::RecordOk )
     {
-      fieldType = QVariant::Date;
+      record.status = ScannedRecord::InvalidFormat;
     }
-    else if ( typeName == QStringLiteral( "time" ) )
+    // Skip over empty records
+    else if ( recordIsEmpty( record.parts ) )
     {
-      fieldType = QVariant::Time;
+      nEmptyRecords++;
+      continue;
     }
-    else
+    record.recordId = mFile->recordId();
+    // The record is after the last position noted by the file
+    record.block = mFile->recordPositions().size() - 1;
+    batch.append( std::move( record ) );
+
+    if ( batch.size() == SCAN_BATCH_SIZE )
     {
-      typeName = QStringLiteral( "text" );
+      processBatch( batch );
+      batch.clear();
     }
-
-    attributeFields.append( QgsField( fieldNames[i], fieldType, typeName ) );
   }
+  processBatch( batch );
 
-  QgsDebugMsgLevel( "Field count for the delimited text file is " + QString::number( attributeFields.size() ), 2 );
-  QgsDebugMsgLevel( "geometry type is: " + QString::number( mWkbType ), 2 );
-  QgsDebugMsgLevel( "feature count is: " + QString::number( mNumberFeatures ), 2 );
+  // Blocks without geometry have an empty extent
+  while ( mBlockExtents.size() < mFile->recordPositions().size() )
+    mBlockExtents.append( emptyBlockExtent() );
 
-  QStringList warnings;
-  if ( ! csvtMessage.isEmpty() )
-    warnings.append( csvtMessage );
+  detectedTypes.clear();
+  if ( mDetectTypes )
+  {
+    for ( const ColumnTypes &types : qgis::as_const( columnTypes ) )
+      detectedTypes.append( types.typeName() );
+  }
+
+  warnings.clear();
   if ( nBadFormatRecords > 0 )
     warnings.append( tr( "%1 records discarded due to invalid format" ).arg( nBadFormatRecords ) );
   if ( nEmptyGeometry > 0 )
@@ -759,28 +955,187 @@ void QgsDelimitedTextProvider::scanFile( bool buildIndexes )
   if ( nIncompatibleGeometry > 0 )
     warnings.append( tr( "%1 records discarded due to incompatible geometry types" ).arg( nIncompatibleGeometry ) );
 
-  reportErrors( warnings );
-
   // Decide whether to use subset ids to index records rather than simple iteration through all
   // If more than 10% of records are being skipped, then use index.  (Not based on any experimentation,
   // could do with some analysis?)
 
+  mRecordCount = mFile->recordCount();
   if ( buildSubsetIndex )
   {
-    long recordCount = mFile->recordCount();
+    long recordCount = mRecordCount;
     recordCount -= recordCount / SUBSET_ID_THRESHOLD_FACTOR;
     mUseSubsetIndex = mSubsetIndex.size() < recordCount;
     if ( ! mUseSubsetIndex )
       mSubsetIndex = QList<quintptr>();
   }
+}
 
-  mUseSpatialIndex = buildSpatialIndex;
+QString QgsDelimitedTextProvider::indexFileName() const
+{
+  return mFile->fileName() + QStringLiteral( ".qgsindex" );
+}
 
-  mValid = mGeometryType != QgsWkbTypes::UnknownGeometry;
-  mLayerValid = mValid;
+QString QgsDelimitedTextProvider::indexFileKey() const
+{
+  // The parameters of the uri which do not change the result of the scan are ignored
+  QUrl url = QUrl::fromEncoded( dataSourceUri().toLatin1() );
+  QUrlQuery query( url );
+  query.removeAllQueryItems( QStringLiteral( "subset" ) );
+  query.removeAllQueryItems( QStringLiteral( "watchFile" ) );
+  query.removeAllQueryItems( QStringLiteral( "quiet" ) );
+  url.setQuery( query );
+  return QString::fromLatin1( url.toEncoded() );
+}
 
-  // If it is valid, then watch for changes to the file
-  connect( mFile.get(), &QgsDelimitedTextFile::fileUpdated, this, &QgsDelimitedTextProvider::onFileUpdated );
+bool QgsDelimitedTextProvider::readIndexFile( QStringList &fieldNames, QStringList &detectedTypes, QStringList &warnings,
+    QVector< QPair< QgsFeatureId, QgsRectangle > > &spatialIndexEntries )
+{
+  QFile file( indexFileName() );
+  if ( ! file.open( QIODevice::ReadOnly ) )
+    return false;
+
+  QDataStream stream( &file );
+  stream.setVersion( QDataStream::Qt_5_0 );
+
+  quint32 magic = 0;
+  quint32 version = 0;
+  QString key;
+  qint64 fileSize = 0;
+  QDateTime lastModified;
+  stream >> magic >> version;
+  if ( magic != INDEX_FILE_MAGIC || version != INDEX_FILE_VERSION )
+    return false;
+
+  // The index is only valid for the same file and definition
+  const QFileInfo fileInfo( mFile->fileName() );
+  stream >> key >> fileSize >> lastModified;
+  if ( key != indexFileKey() || fileSize != fileInfo.size() || lastModified != fileInfo.lastModified() )
+  {
+    QgsDebugMsgLevel( QStringLiteral( "Index file %1 is out of date" ).arg( file.fileName() ), 2 );
+    return false;
+  }
+
+  qint32 wkbType = 0;
+  qint32 geometryType = 0;
+  qint64 numberFeatures = 0;
+  qint64 recordCount = 0;
+  qint32 nExtraInvalidLines = 0;
+  QStringList invalidLines;
+  bool useSubsetIndex = false;
+  QList<quintptr> subsetIndex;
+  QVector<QgsDelimitedTextFile::RecordPosition> recordPositions;
+  QVector<QgsRectangle> blockExtents;
+  QgsRectangle extent;
+  bool wktHasPrefix = false;
+
+  stream >> fieldNames >> detectedTypes >> warnings >> invalidLines >> nExtraInvalidLines;
+  stream >> wkbType >> geometryType >> wktHasPrefix >> numberFeatures >> extent >> recordCount;
+
+  qint32 count = 0;
+  stream >> count;
+  for ( qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i )
+  {
+    QgsDelimitedTextFile::RecordPosition position;
+    qint64 lineNumber = 0;
+    stream >> lineNumber >> position.offset;
+    position.lineNumber = lineNumber;
+    recordPositions.append( position );
+  }
+
+  stream >> count;
+  for ( qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i )
+  {
+    QgsRectangle blockExtent;
+    stream >> blockExtent;
+    blockExtents.append( blockExtent );
+  }
+
+  stream >> useSubsetIndex >> count;
+  for ( qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i )
+  {
+    quint64 id = 0;
+    stream >> id;
+    subsetIndex.append( id );
+  }
+
+  stream >> count;
+  for ( qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i )
+  {
+    qint64 id = 0;
+    QgsRectangle bbox;
+    stream >> id >> bbox;
+    spatialIndexEntries.append( qMakePair( static_cast<QgsFeatureId>( id ), bbox ) );
+  }
+
+  if ( stream.status() != QDataStream::Ok )
+  {
+    QgsDebugMsg( QStringLiteral( "Index file %1 is corrupted" ).arg( file.fileName() ) );
+    spatialIndexEntries.clear();
+    return false;
+  }
+
+  mWkbType = static_cast<QgsWkbTypes::Type>( wkbType );
+  mWktHasPrefix = wktHasPrefix;
+  mGeometryType = static_cast<QgsWkbTypes::GeometryType>( geometryType );
+  mNumberFeatures = numberFeatures;
+  mExtent = extent;
+  mRecordCount = recordCount;
+  mInvalidLines = invalidLines;
+  mNExtraInvalidLines = nExtraInvalidLines;
+  mFile->setRecordPositions( recordPositions );
+  mBlockExtents = blockExtents;
+  mUseSubsetIndex = useSubsetIndex;
+  mSubsetIndex = subsetIndex;
+  if ( mSpatialIndex )
+  {
+    for ( const QPair< QgsFeatureId, QgsRectangle > &entry : qgis::as_const( spatialIndexEntries ) )
+      mSpatialIndex->addFeature( entry.first, entry.second );
+  }
+
+  QgsDebugMsgLevel( QStringLiteral( "Read the scan of %1 from its index file" ).arg( mFile->fileName() ), 2 );
+  return true;
+}
+
+void QgsDelimitedTextProvider::writeIndexFile( const QStringList &fieldNames, const QStringList &detectedTypes, const QStringList &warnings,
+    const QVector< QPair< QgsFeatureId, QgsRectangle > > &spatialIndexEntries ) const
+{
+  QSaveFile file( indexFileName() );
+  if ( ! file.open( QIODevice::WriteOnly ) )
+  {
+    QgsDebugMsgLevel( QStringLiteral( "Index file %1 could not be created" ).arg( file.fileName() ), 2 );
+    return;
+  }
+
+  QDataStream stream( &file );
+  stream.setVersion( QDataStream::Qt_5_0 );
+
+  const QFileInfo fileInfo( mFile->fileName() );
+  stream << INDEX_FILE_MAGIC << INDEX_FILE_VERSION;
+  stream << indexFileKey() << static_cast<qint64>( fileInfo.size() ) << fileInfo.lastModified();
+
+  stream << fieldNames << detectedTypes << warnings << mInvalidLines << static_cast<qint32>( mNExtraInvalidLines );
+  stream << static_cast<qint32>( mWkbType ) << static_cast<qint32>( mGeometryType ) << mWktHasPrefix
+         << static_cast<qint64>( mNumberFeatures ) << mExtent << static_cast<qint64>( mRecordCount );
+
+  const QVector<QgsDelimitedTextFile::RecordPosition> &recordPositions = mFile->recordPositions();
+  stream << static_cast<qint32>( recordPositions.size() );
+  for ( const QgsDelimitedTextFile::RecordPosition &position : recordPositions )
+    stream << static_cast<qint64>( position.lineNumber ) << position.offset;
+
+  stream << static_cast<qint32>( mBlockExtents.size() );
+  for ( const QgsRectangle &blockExtent : mBlockExtents )
+    stream << blockExtent;
+
+  stream << mUseSubsetIndex << static_cast<qint32>( mSubsetIndex.size() );
+  for ( quintptr id : qgis::as_const( mSubsetIndex ) )
+    stream << static_cast<quint64>( id );
+
+  stream << static_cast<qint32>( spatialIndexEntries.size() );
+  for ( const QPair< QgsFeatureId, QgsRectangle > &entry : spatialIndexEntries )
+    stream << static_cast<qint64>( entry.first ) << entry.second;
+
+  if ( ! file.commit() )
+    QgsDebugMsgLevel( QStringLiteral( "Index file %1 could not be written" ).arg( file.fileName() ), 2 );
 }
 
 // rescanFile.  Called if something has changed file definition, such as
@@ -874,7 +1229,7 @@ void QgsDelimitedTextProvider::rescanFile() const
   }
   if ( buildSubsetIndex )
   {
-    long recordCount = mFile->recordCount();
+    long recordCount = mRecordCount;
     recordCount -= recordCount / SUBSET_ID_THRESHOLD_FACTOR;
     mUseSubsetIndex = recordCount < mSubsetIndex.size();
     if ( ! mUseSubsetIndex )
@@ -990,11 +1345,11 @@ bool QgsDelimitedTextProvider::recordIsEmpty( QStringList &record )
   return true;
 }
 
-void QgsDelimitedTextProvider::recordInvalidLine( const QString &message )
+void QgsDelimitedTextProvider::recordInvalidLine( const QString &message, long recordId )
 {
   if ( mInvalidLines.size() < mMaxInvalidLines )
   {
-    mInvalidLines.append( message.arg( mFile->recordId() ) );
+    mInvalidLines.append( message.arg( recordId ) );
   }
   else
   {
@@ -1168,6 +1523,7 @@ void QgsDelimitedTextProvider::onFileUpdated()
     messages.append( tr( "The file has been updated by another application - reloading" ) );
     reportErrors( messages );
     mRescanRequired = true;
+    mBlockExtents.clear();
     emit dataChanged();
   }
 }
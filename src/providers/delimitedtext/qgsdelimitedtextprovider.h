@@ -142,12 +142,37 @@ class QgsDelimitedTextProvider final: public QgsVectorDataProvider
 
     void scanFile( bool buildIndexes );
 
+    /**
+     * Reads all the records of the file to determine the features, their extent,
+     * the types of the fields and the indexes.  The bounding boxes added to the
+     * spatial index are also appended to \a spatialIndexEntries if not NULLPTR.
+     */
+    void scanRecords( bool buildSpatialIndex, bool buildSubsetIndex, QStringList &detectedTypes, QStringList &warnings,
+                      QVector< QPair< QgsFeatureId, QgsRectangle > > *spatialIndexEntries );
+
+    //! Returns the name of the file in which the results of the scan are saved
+    QString indexFileName() const;
+
+    //! Returns the uri parameters identifying the results of the scan in the index file
+    QString indexFileKey() const;
+
+    /**
+     * Reads the results of a previous scan of the file from the index file.
+     * Returns FALSE if there is no index file, or if it is out of date.
+     */
+    bool readIndexFile( QStringList &fieldNames, QStringList &detectedTypes, QStringList &warnings,
+                        QVector< QPair< QgsFeatureId, QgsRectangle > > &spatialIndexEntries );
+
+    //! Saves the results of the scan of the file in the index file
+    void writeIndexFile( const QStringList &fieldNames, const QStringList &detectedTypes, const QStringList &warnings,
+                         const QVector< QPair< QgsFeatureId, QgsRectangle > > &spatialIndexEntries ) const;
+
     //some of these methods const, as they need to be called from const methods such as extent()
     void rescanFile() const;
     void resetCachedSubset() const;
     void resetIndexes() const;
     void clearInvalidLines() const;
-    void recordInvalidLine( const QString &message );
+    void recordInvalidLine( const QString &message, long recordId );
     void reportErrors( const QStringList &messages = QStringList(), bool showDialog = false ) const;
     static bool recordIsEmpty( QStringList &record );
     void setUriParameter( const QString &parameter, const QString &value );
@@ -195,6 +220,8 @@ class QgsDelimitedTextProvider final: public QgsVectorDataProvider
     int mGeomType;
 
     mutable long mNumberFeatures;
+    //! Number of records of the file, when it was scanned
+    long mRecordCount = 0;
     int mSkipLines;
     QString mDecimalPoint;
     bool mXyDms = false;
@@ -229,6 +256,15 @@ class QgsDelimitedTextProvider final: public QgsVectorDataProvider
     mutable bool mCachedUseSpatialIndex;
     mutable std::unique_ptr< QgsSpatialIndex > mSpatialIndex;
 
+    /**
+     * Extent of the geometries of the records following each record position noted
+     * by the file, used to skip the records outside of a filter rectangle
+     */
+    QVector<QgsRectangle> mBlockExtents;
+
+    //! Whether the results of the scan of the file are saved in an index file, to be read when the file is opened again
+    bool mPersistIndex = false;
+
     friend class QgsDelimitedTextFeatureIterator;
     friend class QgsDelimitedTextFeatureSource;
 };
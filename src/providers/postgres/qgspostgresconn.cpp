@@ -31,10 +31,15 @@
 #include "qgspostgresstringutils.h"
 
 #include <QApplication>
+#include <QRegularExpression>
 #include <QStringList>
 #include <QThread>
+#include <QtEndian>
+#include <QUuid>
 
 #include <climits>
+#include <cmath>
+#include <limits>
 
 #include <nlohmann/json.hpp>
 
@@ -1359,6 +1364,15 @@ bool QgsPostgresConn::closeCursor( const QString &cursorName )
 {
   QMutexLocker locker( &mLock ); // to protect access to mOpenCursors
 
+  if ( !mTransaction && ::PQtransactionStatus( mConn ) == PQTRANS_INERROR )
+  {
+    // a canceled query aborted the read-only transaction and its cursors
+    QgsDebugMsgLevel( QStringLiteral( "Rolling back aborted read-only transaction" ), 4 );
+    mOpenCursors = 0;
+    PQexecNR( QStringLiteral( "ROLLBACK" ) );
+    return true;
+  }
+
   if ( !PQexecNR( QStringLiteral( "CLOSE %1" ).arg( cursorName ) ) )
     return false;
 
@@ -1414,6 +1428,16 @@ PGresult *QgsPostgresConn::PQgetResult()
   return ::PQgetResult( mConn );
 }
 
+int QgsPostgresConn::PQputCopyData( const QByteArray &data )
+{
+  return ::PQputCopyData( mConn, data.constData(), data.size() );
+}
+
+int QgsPostgresConn::PQputCopyEnd( const QString &errorMessage )
+{
+  return ::PQputCopyEnd( mConn, errorMessage.isEmpty() ? nullptr : errorMessage.toUtf8().constData() );
+}
+
 PGresult *QgsPostgresConn::PQprepare( const QString &stmtName, const QString &query, int nParams, const Oid *paramTypes )
 {
   QMutexLocker locker( &mLock );
@@ -1603,6 +1627,267 @@ qint64 QgsPostgresConn::getBinaryInt( QgsPostgresResult &queryResult, int row, i
   return oid;
 }
 
+namespace
+{
+  // values fetched from binary cursors are in network byte order
+  template <typename T> T readBinary( const char *p )
+  {
+    return qFromBigEndian<T>( reinterpret_cast<const uchar *>( p ) );
+  }
+
+  //! Returns the type of the values decoded for the binary format of the PostgreSQL type \a typeName
+  QVariant::Type binaryDecoderType( const QString &typeName )
+  {
+    if ( typeName == QLatin1String( "int2" ) || typeName == QLatin1String( "int4" ) )
+      return QVariant::Int;
+    else if ( typeName == QLatin1String( "int8" ) )
+      return QVariant::LongLong;
+    // float4 values are left to the text format, which is rounded the way users expect
+    else if ( typeName == QLatin1String( "float8" ) || typeName == QLatin1String( "numeric" ) )
+      return QVariant::Double;
+    else if ( typeName == QLatin1String( "bool" ) )
+      return QVariant::Bool;
+    else if ( typeName == QLatin1String( "date" ) )
+      return QVariant::Date;
+    else if ( typeName == QLatin1String( "time" ) )
+      return QVariant::Time;
+    else if ( typeName == QLatin1String( "timestamp" ) )
+      return QVariant::DateTime;
+    else if ( typeName == QLatin1String( "bytea" ) )
+      return QVariant::ByteArray;
+    else if ( typeName == QLatin1String( "uuid" ) || typeName == QLatin1String( "text" ) ||
+              typeName == QLatin1String( "varchar" ) || typeName == QLatin1String( "bpchar" ) ||
+              typeName == QLatin1String( "char" ) )
+      return QVariant::String;
+    return QVariant::Invalid;
+  }
+
+  //! Formats a numeric value like the text format, so that no digit is lost
+  QString decodeBinaryNumeric( const char *p )
+  {
+    const qint16 ndigits = readBinary<qint16>( p );
+    const qint16 weight = readBinary<qint16>( p + 2 );
+    const quint16 sign = readBinary<quint16>( p + 4 );
+    const qint16 dscale = readBinary<qint16>( p + 6 );
+    if ( sign == 0xC000 )
+      return QStringLiteral( "NaN" );
+
+    // digits are in base 10000, the weight being the exponent of the first one
+    auto digit = [p, ndigits]( int i ) -> int
+    {
+      return i >= 0 && i < ndigits ? readBinary<qint16>( p + 8 + 2 * i ) : 0;
+    };
+
+    QString value = sign == 0x4000 ? QStringLiteral( "-" ) : QString();
+    if ( weight < 0 )
+      value += '0';
+    for ( int i = 0; i <= weight; ++i )
+      value += i == 0 ? QString::number( digit( i ) ) : QStringLiteral( "%1" ).arg( digit( i ), 4, 10, QChar( '0' ) );
+
+    if ( dscale > 0 )
+    {
+      QString decimals;
+      for ( int i = weight + 1; decimals.length() < dscale; ++i )
+        decimals += QStringLiteral( "%1" ).arg( digit( i ), 4, 10, QChar( '0' ) );
+      value += '.' + decimals.left( dscale );
+    }
+
+    return value;
+  }
+
+  QVariant decodeBinary( const QString &typeName, QVariant::Type type, const char *p, int length )
+  {
+    // PostgreSQL dates and timestamps are relative to 2000-01-01
+    static const QDate epoch( 2000, 1, 1 );
+    static const qint64 usecsPerDay = Q_INT64_C( 86400000000 );
+
+    switch ( type )
+    {
+      case QVariant::Int:
+        return typeName == QLatin1String( "int2" ) ? int( readBinary<qint16>( p ) ) : int( readBinary<qint32>( p ) );
+
+      case QVariant::LongLong:
+        return qlonglong( readBinary<qint64>( p ) );
+
+      case QVariant::Double:
+      {
+        if ( typeName == QLatin1String( "numeric" ) )
+        {
+          // converted from its text representation, as with the text format
+          QVariant value( decodeBinaryNumeric( p ) );
+          if ( !value.convert( type ) )
+            return QVariant( type );
+          return value;
+        }
+
+        const quint64 bits = readBinary<quint64>( p );
+        double value;
+        memcpy( &value, &bits, sizeof( value ) );
+        return value;
+      }
+
+      case QVariant::Bool:
+        return *p != 0;
+
+      case QVariant::Date:
+      {
+        const qint32 days = readBinary<qint32>( p );
+        // infinite dates
+        if ( days == std::numeric_limits<qint32>::max() || days == std::numeric_limits<qint32>::min() )
+          return QVariant( type );
+        return epoch.addDays( days );
+      }
+
+      case QVariant::Time:
+        return QTime::fromMSecsSinceStartOfDay( static_cast<int>( readBinary<qint64>( p ) / 1000 ) );
+
+      case QVariant::DateTime:
+      {
+        const qint64 usecs = readBinary<qint64>( p );
+        // infinite timestamps
+        if ( usecs == std::numeric_limits<qint64>::max() || usecs == std::numeric_limits<qint64>::min() )
+          return QVariant( type );
+
+        // split the date and time, so that the local time is the one stored like with the text format
+        qint64 days = usecs / usecsPerDay;
+        qint64 dayUsecs = usecs % usecsPerDay;
+        if ( dayUsecs < 0 )
+        {
+          days--;
+          dayUsecs += usecsPerDay;
+        }
+        return QDateTime( epoch.addDays( days ), QTime::fromMSecsSinceStartOfDay( static_cast<int>( dayUsecs / 1000 ) ) );
+      }
+
+      case QVariant::ByteArray:
+        return QByteArray( p, length );
+
+      case QVariant::String:
+        if ( typeName == QLatin1String( "uuid" ) )
+          return QUuid::fromRfc4122( QByteArray::fromRawData( p, length ) ).toString().mid( 1, 36 );
+        return QString::fromUtf8( p, length );
+
+      default:
+        break;
+    }
+
+    return QVariant( type );
+  }
+
+  //! Quotes an array element like the text format
+  QString quotedArrayElement( const QString &value )
+  {
+    static const QRegularExpression sSpecial( QStringLiteral( "^$|[{},\"\\\\\\s]|^NULL$" ), QRegularExpression::CaseInsensitiveOption );
+    if ( !sSpecial.match( value ).hasMatch() )
+      return value;
+
+    QString quoted = value;
+    quoted.replace( '\\', QLatin1String( "\\\\" ) ).replace( '"', QLatin1String( "\\\"" ) );
+    return '"' + quoted + '"';
+  }
+
+  //! Formats the values of a multidimensional array like the text format
+  QString formatBinaryArray( const QVariantList &values, const QVector<int> &sizes, int dimension, int &index )
+  {
+    QStringList items;
+    for ( int i = 0; i < sizes.at( dimension ); ++i )
+    {
+      if ( dimension + 1 < sizes.size() )
+      {
+        items << formatBinaryArray( values, sizes, dimension + 1, index );
+        continue;
+      }
+
+      const QVariant &value = values.at( index++ );
+      if ( value.isNull() )
+        items << QStringLiteral( "NULL" );
+      else if ( value.type() == QVariant::String )
+        items << quotedArrayElement( value.toString() );
+      else
+        items << value.toString();
+    }
+    return '{' + items.join( ',' ) + '}';
+  }
+
+  QVariant decodeBinaryArray( const QgsField &fld, const char *p, int length )
+  {
+    const QString elementTypeName = fld.typeName().mid( 1 );
+    const QVariant::Type elementType = fld.subType();
+    const char *end = p + length;
+
+    const qint32 ndim = readBinary<qint32>( p );
+    QVector<int> sizes;
+    p += 12; // dimensions, null flag and element type
+    for ( int i = 0; i < ndim; ++i )
+    {
+      sizes << readBinary<qint32>( p );
+      p += 8; // size and lower bound
+    }
+
+    QVariantList values;
+    while ( p + 4 <= end )
+    {
+      const qint32 elementLength = readBinary<qint32>( p );
+      p += 4;
+      if ( elementLength < 0 )
+      {
+        values << QVariant( elementType );
+        continue;
+      }
+      values << decodeBinary( elementTypeName, elementType, p, elementLength );
+      p += elementLength;
+    }
+
+    if ( ndim > 1 )
+    {
+      // multidimensional arrays are returned as the list of their sub arrays in text format
+      QStringList result;
+      int index = 0;
+      for ( int i = 0; i < sizes.at( 0 ) && index < values.size(); ++i )
+      {
+        result << formatBinaryArray( values, sizes, 1, index );
+      }
+      return result;
+    }
+
+    if ( fld.type() == QVariant::StringList )
+    {
+      QStringList result;
+      for ( const QVariant &value : qgis::as_const( values ) )
+        result << value.toString();
+      return result;
+    }
+    return values;
+  }
+}
+
+bool QgsPostgresConn::hasBinaryDecoder( const QgsField &fld )
+{
+  const QString &typeName = fld.typeName();
+  if ( typeName.startsWith( '_' ) )
+  {
+    return ( fld.type() == QVariant::List || fld.type() == QVariant::StringList )
+           && fld.subType() != QVariant::Invalid
+           && binaryDecoderType( typeName.mid( 1 ) ) == fld.subType();
+  }
+
+  return binaryDecoderType( typeName ) == fld.type();
+}
+
+QVariant QgsPostgresConn::getBinaryValue( const QgsField &fld, QgsPostgresResult &queryResult, int row, int col )
+{
+  if ( ::PQgetisnull( queryResult.result(), row, col ) )
+    return QVariant( fld.type() );
+
+  const char *p = ::PQgetvalue( queryResult.result(), row, col );
+  const int length = ::PQgetlength( queryResult.result(), row, col );
+
+  if ( fld.typeName().startsWith( '_' ) )
+    return decodeBinaryArray( fld, p, length );
+
+  return decodeBinary( fld.typeName(), fld.type(), p, length );
+}
+
 QString QgsPostgresConn::fieldExpressionForWhereClause( const QgsField &fld, QVariant::Type valueType, QString expr )
 {
   QString out;
@@ -268,6 +268,18 @@ class QgsPostgresConn : public QObject
      */
     PGresult *PQgetResult();
 
+    /**
+     * PQputCopyData sends \a data to the server during a COPY FROM STDIN
+     * Thread safety must be ensured by the caller by calling QgsPostgresConn::lock() and QgsPostgresConn::unlock()
+     */
+    int PQputCopyData( const QByteArray &data );
+
+    /**
+     * PQputCopyEnd ends a COPY FROM STDIN, making it fail with \a errorMessage if not empty
+     * Thread safety must be ensured by the caller by calling QgsPostgresConn::lock() and QgsPostgresConn::unlock()
+     */
+    int PQputCopyEnd( const QString &errorMessage = QString() );
+
     bool begin();
     bool commit();
     bool rollback();
@@ -340,6 +352,19 @@ class QgsPostgresConn : public QObject
 
     qint64 getBinaryInt( QgsPostgresResult &queryResult, int row, int col );
 
+    /**
+     * Returns TRUE if values of the field \a fld fetched from a binary cursor
+     * without any cast can be decoded by getBinaryValue().
+     */
+    static bool hasBinaryDecoder( const QgsField &fld );
+
+    /**
+     * Decodes the value of the field \a fld fetched from a binary cursor
+     * without any cast, in the PostgreSQL binary format.
+     * \see hasBinaryDecoder()
+     */
+    static QVariant getBinaryValue( const QgsField &fld, QgsPostgresResult &queryResult, int row, int col );
+
     QString fieldExpressionForWhereClause( const QgsField &fld, QVariant::Type valueType = QVariant::LastType, QString expr = "%1" );
 
     QString fieldExpression( const QgsField &fld, QString expr = "%1" );
@@ -163,9 +163,19 @@ QgsSqlExpressionCompiler::Result QgsPostgresExpressionCompiler::compileNode( con
       QgsExpressionFunction *fd = QgsExpression::Functions()[n->fnIndex()];
       if ( fd->name() == QLatin1String( "$geometry" ) )
       {
+        // functions on geography columns use spheroidal measurements, unlike QGIS ones
+        if ( mSpatialColType != SctGeometry )
+          return Fail;
+
         result = quotedIdentifier( mGeometryColumn );
         return Complete;
       }
+      else if ( ( fd->name() == QLatin1String( "geom_from_wkt" ) || fd->name() == QLatin1String( "geom_from_gml" ) )
+                && mRequestedSrid.isEmpty() && mDetectedSrid.isEmpty() )
+      {
+        // mixed or unknown srid, no srid to pass to the geometry constructor
+        return Fail;
+      }
 #if 0
       /*
        * These methods are tricky
@@ -199,7 +209,23 @@ QgsSqlExpressionCompiler::Result QgsPostgresExpressionCompiler::compileNode( con
         return Complete;
       }
 #endif
-      FALLTHROUGH
+      break;
+    }
+
+    case QgsExpressionNode::ntLiteral:
+    {
+      const QgsGeometry geometry = geometryFromNode( node );
+      if ( !geometry.isNull() )
+      {
+        // mixed or unknown srid, no srid to pass to the geometry constructor
+        if ( mRequestedSrid.isEmpty() && mDetectedSrid.isEmpty() )
+          return Fail;
+
+        bool ok = false;
+        result = QStringLiteral( "ST_GeomFromText(%1,%2)" ).arg( quotedValue( geometry.asWkt(), ok ), mRequestedSrid.isEmpty() ? mDetectedSrid : mRequestedSrid );
+        return ok ? Complete : Fail;
+      }
+      break;
     }
 
     default:
@@ -260,40 +260,17 @@ bool QgsPostgresFeatureIterator::fetchFeature( QgsFeature &feature )
     timer.start();
 #endif
 
-    QString fetch = QStringLiteral( "FETCH FORWARD %1 FROM %2" ).arg( mFeatureQueueSize ).arg( mCursorName );
-    QgsDebugMsgLevel( QStringLiteral( "fetching %1 features." ).arg( mFeatureQueueSize ), 4 );
-
     lock();
-    if ( mConn->PQsendQuery( fetch ) == 0 ) // fetch features asynchronously
-    {
-      QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName, mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
-    }
-
-    QgsPostgresResult queryResult;
-    for ( ;; )
-    {
-      queryResult = mConn->PQgetResult();
-      if ( !queryResult.result() )
-        break;
-
-      if ( queryResult.PQresultStatus() != PGRES_TUPLES_OK )
-      {
-        QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName, mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
-        break;
-      }
-
-      int rows = queryResult.PQntuples();
-      if ( rows == 0 )
-        continue;
-
-      mLastFetch = rows < mFeatureQueueSize;
-
-      for ( int row = 0; row < rows; row++ )
-      {
-        mFeatureQueue.enqueue( QgsFeature() );
-        getFeature( queryResult, row, mFeatureQueue.back() );
-      } // for each row in queue
-    }
+    if ( !mFetchPending )
+      sendFetch();
+    receiveFetch();
+
+    // fetch the next batch while the features of this one are consumed,
+    // unless the connection is shared with the transaction or the cursor
+    // has no feature left within its limit
+    if ( !mLastFetch && !mIsTransactionConnection
+         && ( mCursorLimit < 0 || mFetched + mFeatureQueue.size() < mCursorLimit ) )
+      sendFetch();
     unlock();
 
 #if 0 //disabled dynamic queue size
@@ -386,9 +363,22 @@ bool QgsPostgresFeatureIterator::rewind()
   if ( mClosed )
     return false;
 
-  // move cursor to first record
+  if ( mFetchPending && !cancelFetch() )
+  {
+    // the canceled FETCH aborted the transaction along with the cursor
+    mConn->closeCursor( mCursorName );
+    if ( !mConn->openCursor( mCursorName, mCursorQuery ) )
+    {
+      close();
+      return false;
+    }
+  }
+  else
+  {
+    // move cursor to first record
+    mConn->PQexecNR( QStringLiteral( "move absolute 0 in %1" ).arg( mCursorName ) );
+  }
 
-  mConn->PQexecNR( QStringLiteral( "move absolute 0 in %1" ).arg( mCursorName ) );
   mFeatureQueue.clear();
   mFetched = 0;
   mLastFetch = false;
@@ -401,6 +391,9 @@ bool QgsPostgresFeatureIterator::close()
   if ( !mConn )
     return false;
 
+  if ( mFetchPending )
+    cancelFetch();
+
   mConn->closeCursor( mCursorName );
 
   if ( !mIsTransactionConnection )
@@ -493,6 +486,67 @@ QString QgsPostgresFeatureIterator::whereClauseRect()
 
 
 
+void QgsPostgresFeatureIterator::sendFetch()
+{
+  QString fetch = QStringLiteral( "FETCH FORWARD %1 FROM %2" ).arg( mFeatureQueueSize ).arg( mCursorName );
+  QgsDebugMsgLevel( QStringLiteral( "fetching %1 features." ).arg( mFeatureQueueSize ), 4 );
+
+  if ( mConn->PQsendQuery( fetch ) == 0 ) // fetch features asynchronously
+  {
+    QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName, mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
+    return;
+  }
+
+  mFetchPending = true;
+}
+
+bool QgsPostgresFeatureIterator::receiveFetch( bool discard )
+{
+  bool ok = true;
+  QgsPostgresResult queryResult;
+  for ( ;; )
+  {
+    queryResult = mConn->PQgetResult();
+    if ( !queryResult.result() )
+      break;
+
+    if ( queryResult.PQresultStatus() != PGRES_TUPLES_OK )
+      ok = false;
+
+    if ( discard )
+      continue;
+
+    if ( !ok )
+    {
+      QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName, mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
+      break;
+    }
+
+    int rows = queryResult.PQntuples();
+    if ( rows == 0 )
+      continue;
+
+    mLastFetch = rows < mFeatureQueueSize;
+
+    for ( int row = 0; row < rows; row++ )
+    {
+      mFeatureQueue.enqueue( QgsFeature() );
+      getFeature( queryResult, row, mFeatureQueue.back() );
+    } // for each row in queue
+  }
+
+  mFetchPending = false;
+  return ok;
+}
+
+bool QgsPostgresFeatureIterator::cancelFetch()
+{
+  // the features of the pending FETCH are not needed anymore, so rather than
+  // waiting for the whole batch the query is canceled and its results dropped
+  mConn->cancel();
+  return receiveFetch( true );
+}
+
 bool QgsPostgresFeatureIterator::declareCursor( const QString &whereClause, long limit, bool closeOnFail, const QString &orderBy )
 {
   mFetchGeometry = ( !( mRequest.flags() & QgsFeatureRequest::NoGeometry ) || mFilterRequiresGeometry ) && !mSource->mGeometryColumn.isNull();
@@ -637,7 +691,8 @@ bool QgsPostgresFeatureIterator::declareCursor( const QString &whereClause, long
     if ( mSource->mPrimaryKeyAttrs.contains( idx ) )
       continue;
 
-    query += delim + mConn->fieldExpression( mSource->mFields.at( idx ) );
+    const QgsField &fld = mSource->mFields.at( idx );
+    query += delim + ( isBinaryAttribute( idx ) ? QgsPostgresConn::quotedIdentifier( fld.name() ) : mConn->fieldExpression( fld ) );
   }
 
   query += " FROM " + mSource->mQuery;
@@ -660,10 +715,19 @@ bool QgsPostgresFeatureIterator::declareCursor( const QString &whereClause, long
     return false;
   }
 
+  mCursorQuery = query;
+  mCursorLimit = limit;
   mLastFetch = false;
   return true;
 }
 
+bool QgsPostgresFeatureIterator::isBinaryAttribute( int idx ) const
+{
+  // int8 values are always fetched in the binary format
+  const QgsField &fld = mSource->mFields.at( idx );
+  return mSource->mBinaryAttributes && fld.type() != QVariant::LongLong && QgsPostgresConn::hasBinaryDecoder( fld );
+}
+
 bool QgsPostgresFeatureIterator::getFeature( QgsPostgresResult &queryResult, int row, QgsFeature &feature )
 {
   feature.initAttributes( mSource->mFields.count() );
@@ -837,6 +901,13 @@ void QgsPostgresFeatureIterator::getFeatureAttribute( int idx, QgsPostgresResult
 
   const QgsField fld = mSource->mFields.at( idx );
 
+  if ( isBinaryAttribute( idx ) )
+  {
+    feature.setAttribute( idx, QgsPostgresConn::getBinaryValue( fld, queryResult, row, col ) );
+    col++;
+    return;
+  }
+
   QVariant v;
 
   switch ( fld.type() )
@@ -853,14 +924,8 @@ void QgsPostgresFeatureIterator::getFeatureAttribute( int idx, QgsPostgresResult
         size_t returnedLength = 0;
         const char *value = ::PQgetvalue( queryResult.result(), row, col );
         unsigned char *data = ::PQunescapeBytea( reinterpret_cast<const unsigned char *>( value ), &returnedLength );
-        if ( returnedLength == 0 )
-        {
-          v = QVariant( QVariant::ByteArray );
-        }
-        else
-        {
-          v = QByteArray( reinterpret_cast<const char *>( data ), int( returnedLength ) );
-        }
+        // an empty value is not NULL
+        v = QByteArray( reinterpret_cast<const char *>( data ), int( returnedLength ) );
         ::PQfreemem( data );
       }
       break;
@@ -905,6 +970,7 @@ QgsPostgresFeatureSource::QgsPostgresFeatureSource( const QgsPostgresProvider *p
   , mPrimaryKeyType( p->mPrimaryKeyType )
   , mPrimaryKeyAttrs( p->mPrimaryKeyAttrs )
   , mQuery( p->mQuery )
+  , mBinaryAttributes( p->mBinaryAttributes )
   , mCrs( p->crs() )
   , mShared( p->mShared )
 {
@@ -50,6 +50,7 @@ class QgsPostgresFeatureSource final: public QgsAbstractFeatureSource
     QgsPostgresPrimaryKeyType mPrimaryKeyType;
     QList<int> mPrimaryKeyAttrs;
     QString mQuery;
+    bool mBinaryAttributes = false;
     // TODO: loadFields()
     QgsCoordinateReferenceSystem mCrs;
 
@@ -94,8 +95,32 @@ class QgsPostgresFeatureIterator final: public QgsAbstractFeatureIteratorFromSou
     void getFeatureAttribute( int idx, QgsPostgresResult &queryResult, int row, int &col, QgsFeature &feature );
     bool declareCursor( const QString &whereClause, long limit = -1, bool closeOnFail = true, const QString &orderBy = QString() );
 
+    //! Sends the FETCH of the next batch of features, without waiting for its results
+    void sendFetch();
+
+    /**
+     * Waits for the results of the pending FETCH and adds them to the feature queue,
+     * or drops them if \a discard is TRUE. Returns FALSE if the FETCH failed.
+     */
+    bool receiveFetch( bool discard = false );
+
+    /**
+     * Cancels the pending FETCH and drops its results. Returns FALSE if the FETCH
+     * was actually canceled, which aborts the transaction of the cursor.
+     */
+    bool cancelFetch();
+
+    //! Returns TRUE if the attribute \a idx is fetched in the binary format
+    bool isBinaryAttribute( int idx ) const;
+
     QString mCursorName;
 
+    //! Query of the cursor, to declare it again once its transaction was aborted
+    QString mCursorQuery;
+
+    //! Maximum number of features of the cursor, -1 if unlimited
+    long mCursorLimit = -1;
+
     /**
      * Feature queue that GetNextFeature will retrieve from
      * before the next fetch from PostgreSQL
@@ -108,6 +133,9 @@ class QgsPostgresFeatureIterator final: public QgsAbstractFeatureIteratorFromSou
     //! Number of retrieved features
     int mFetched = 0;
 
+    //! Sets to true while a FETCH has been sent and its results not received
+    bool mFetchPending = false;
+
     //! Sets to true, if geometry is in the requested columns
     bool mFetchGeometry = false;
 
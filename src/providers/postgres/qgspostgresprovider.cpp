@@ -54,6 +54,9 @@ const QString QgsPostgresProvider::POSTGRES_DESCRIPTION = QStringLiteral( "Postg
 
 static const QString EDITOR_WIDGET_STYLES_TABLE = QStringLiteral( "qgis_editor_widget_styles" );
 
+// minimum number of features inserted with COPY instead of INSERT
+static const int COPY_MIN_FEATURES = 100;
+
 inline qint64 PKINT2FID( qint32 x )
 {
   return QgsPostgresUtils::int32pk_to_fid( x );
@@ -134,6 +137,8 @@ QgsPostgresProvider::QgsPostgresProvider( QString const &uri, const ProviderOpti
     }
   }
 
+  mBinaryAttributes = mUri.param( QStringLiteral( "binaryAttributes" ) ) == QLatin1String( "1" );
+
   if ( mSchemaName.isEmpty() && mTableName.startsWith( '(' ) && mTableName.endsWith( ')' ) )
   {
     mIsQuery = true;
@@ -2263,6 +2268,19 @@ bool QgsPostgresProvider::addFeatures( QgsFeatureList &flist, Flags flags )
   }
   conn->lock();
 
+  // large batches not needing the values computed by the database are streamed
+  if ( ( flags & QgsFeatureSink::FastInsert ) && flist.size() >= COPY_MIN_FEATURES &&
+       ( mGeometryColumn.isNull() || mSpatialColType == SctGeometry || mSpatialColType == SctGeography ) )
+  {
+    bool copied = true;
+    const bool returnvalue = copyFeatures( conn, flist, copied );
+    if ( copied )
+    {
+      conn->unlock();
+      return returnvalue;
+    }
+  }
+
   bool returnvalue = true;
 
   try
@@ -2583,6 +2601,180 @@ bool QgsPostgresProvider::addFeatures( QgsFeatureList &flist, Flags flags )
   return returnvalue;
 }
 
+bool QgsPostgresProvider::copyFeatures( QgsPostgresConn *conn, QgsFeatureList &flist, bool &copied )
+{
+  // values in the COPY text format
+  auto copyValue = []( const QString & value ) -> QString
+  {
+    if ( value.isNull() )
+      return QStringLiteral( "\\N" );
+
+    QString escaped = value;
+    escaped.replace( '\\', QLatin1String( "\\\\" ) )
+    .replace( '\t', QLatin1String( "\\t" ) )
+    .replace( '\n', QLatin1String( "\\n" ) )
+    .replace( '\r', QLatin1String( "\\r" ) );
+    return escaped;
+  };
+
+  QStringList columns;
+  if ( !mGeometryColumn.isNull() )
+    columns << quotedIdentifier( mGeometryColumn );
+
+  QList<int> fieldId;
+  QStringList defaultValues;
+  for ( int idx = 0; idx < mAttributeFields.count(); ++idx )
+  {
+    const QString fieldname = mAttributeFields.at( idx ).name();
+    if ( fieldname.isEmpty() || fieldname == mGeometryColumn || !mGeneratedValues.value( idx, QString() ).isEmpty() )
+      continue;
+
+    // columns only holding default values are left to the database,
+    // e.g. primary keys filled by a sequence
+    const QString defVal = defaultValueClause( idx );
+    bool onlyDefaults = true;
+    for ( const QgsFeature &feature : qgis::as_const( flist ) )
+    {
+      const QVariant v = feature.attributes().value( idx, QVariant( QVariant::Int ) );
+      if ( !v.isNull() && ( defVal.isNull() || v.toString() != defVal ) )
+      {
+        onlyDefaults = false;
+        break;
+      }
+    }
+    if ( onlyDefaults )
+      continue;
+
+    columns << quotedIdentifier( fieldname );
+    fieldId << idx;
+    defaultValues << defVal;
+  }
+
+  // the rows are then inserted with the INSERT statement
+  if ( columns.isEmpty() )
+  {
+    copied = false;
+    return false;
+  }
+
+  copied = true;
+
+  const QString srid = mRequestedSrid.isEmpty() ? mDetectedSrid : mRequestedSrid;
+  bool returnvalue = true;
+
+  try
+  {
+    conn->begin();
+
+    // the rows are formatted before starting the COPY, as evaluating default
+    // values may use the same connection, e.g. in a transaction group
+    QList<QByteArray> chunks;
+    QByteArray data;
+    for ( QgsFeatureList::iterator features = flist.begin(); features != flist.end(); ++features )
+    {
+      QStringList row;
+      row.reserve( columns.size() );
+
+      if ( !mGeometryColumn.isNull() )
+      {
+        const QgsGeometry geom = features->geometry();
+        if ( geom.isNull() )
+        {
+          row << copyValue( QString() );
+        }
+        else
+        {
+          // hex WKB is accepted by the geometry and geography input functions
+          const QgsGeometry convertedGeom( convertToProviderType( geom ) );
+          const QByteArray wkb( !convertedGeom.isNull() ? convertedGeom.asWkb() : geom.asWkb() );
+          QString value = QString::fromLatin1( wkb.toHex() );
+          if ( mSpatialColType == SctGeometry && !srid.isEmpty() )
+            value.prepend( QStringLiteral( "SRID=%1;" ).arg( srid ) );
+          row << value;
+        }
+      }
+
+      const QgsAttributes attrs = features->attributes();
+      for ( int i = 0; i < fieldId.size(); i++ )
+      {
+        const int attrIdx = fieldId[i];
+        const QVariant value = attrIdx < attrs.length() ? attrs.at( attrIdx ) : QVariant( QVariant::Int );
+
+        // same values as the parameters of the INSERT statement
+        QString v;
+        if ( value.isNull() )
+        {
+          const QgsField fld = field( attrIdx );
+          v = paramValue( defaultValues[ i ], defaultValues[ i ] );
+          features->setAttribute( attrIdx, convertValue( fld.type(), fld.subType(), v, fld.typeName() ) );
+        }
+        else
+        {
+          v = paramValue( value.toString(), defaultValues[ i ] );
+
+          if ( v != value.toString() )
+          {
+            const QgsField fld = field( attrIdx );
+            features->setAttribute( attrIdx, convertValue( fld.type(), fld.subType(), v, fld.typeName() ) );
+          }
+        }
+
+        row << copyValue( v );
+      }
+
+      data += row.join( '\t' ).toUtf8();
+      data += '\n';
+
+      if ( data.size() >= 1024 * 1024 )
+      {
+        chunks << data;
+        data.clear();
+      }
+    }
+    if ( !data.isEmpty() )
+      chunks << data;
+
+    QgsPostgresResult result( conn->PQexec( QStringLiteral( "COPY %1(%2) FROM STDIN" ).arg( mQuery, columns.join( ',' ) ), false, false ) );
+    if ( result.PQresultStatus() != PGRES_COPY_IN )
+      throw PGException( result );
+
+    QString copyError;
+    for ( const QByteArray &chunk : qgis::as_const( chunks ) )
+    {
+      if ( conn->PQputCopyData( chunk ) != 1 )
+      {
+        copyError = conn->PQerrorMessage();
+        break;
+      }
+    }
+
+    conn->PQputCopyEnd( copyError );
+
+    result = conn->PQgetResult();
+    // drain the remaining results
+    QgsPostgresResult next( conn->PQgetResult() );
+    while ( next.result() )
+      next = conn->PQgetResult();
+
+    if ( result.PQresultStatus() != PGRES_COMMAND_OK )
+      throw PGException( result );
+
+    returnvalue &= conn->commit();
+    if ( mTransaction )
+      mTransaction->dirtyLastSavePoint();
+
+    mShared->addFeaturesCounted( flist.size() );
+  }
+  catch ( PGException &e )
+  {
+    pushError( tr( "PostGIS error while adding features: %1" ).arg( e.errorMessage() ) );
+    conn->rollback();
+    returnvalue = false;
+  }
+
+  return returnvalue;
+}
+
 bool QgsPostgresProvider::deleteFeatures( const QgsFeatureIds &ids )
 {
   if ( ids.isEmpty() )
@@ -5640,6 +5832,8 @@ QVariantMap QgsPostgresProviderMetadata::decodeUri( const QString &uri )
     uriParts[ QStringLiteral( "sql" ) ] = dsUri.sql();
   if ( ! dsUri.geometryColumn().isEmpty() )
     uriParts[ QStringLiteral( "geometrycolumn" ) ] = dsUri.geometryColumn();
+  if ( dsUri.hasParam( QStringLiteral( "binaryAttributes" ) ) )
+    uriParts[ QStringLiteral( "binaryAttributes" ) ] = dsUri.param( QStringLiteral( "binaryAttributes" ) );
 
   return uriParts;
 }
@@ -5684,5 +5878,7 @@ QString QgsPostgresProviderMetadata::encodeUri( const QVariantMap &parts )
     dsUri.setParam( QStringLiteral( "checkPrimaryKeyUnicity" ), parts.value( QStringLiteral( "checkPrimaryKeyUnicity" ) ).toString() );
   if ( parts.contains( QStringLiteral( "geometrycolumn" ) ) )
     dsUri.setGeometryColumn( parts.value( QStringLiteral( "geometrycolumn" ) ).toString() );
+  if ( parts.contains( QStringLiteral( "binaryAttributes" ) ) )
+    dsUri.setParam( QStringLiteral( "binaryAttributes" ), parts.value( QStringLiteral( "binaryAttributes" ) ).toString() );
   return dsUri.uri( false );
 }
@@ -452,6 +452,15 @@ class QgsPostgresProvider final: public QgsVectorDataProvider
 
     QString paramValue( const QString &fieldvalue, const QString &defaultValue ) const;
 
+    /**
+     * Inserts the features of \a flist with COPY ... FROM STDIN, without
+     * returning the values computed by the database.
+     *
+     * \a copied is set to FALSE, without inserting any feature, if all the
+     * columns are left to their default values, which COPY cannot express.
+     */
+    bool copyFeatures( QgsPostgresConn *conn, QgsFeatureList &flist, bool &copied );
+
     QgsPostgresConn *mConnectionRO = nullptr ; //!< Read-only database connection (initially)
     QgsPostgresConn *mConnectionRW = nullptr ; //!< Read-write database connection (on update)
 
@@ -479,6 +488,9 @@ class QgsPostgresProvider final: public QgsVectorDataProvider
 
     bool mCheckPrimaryKeyUnicity = true;
 
+    //! Fetch attributes in the binary format instead of casting them to text
+    bool mBinaryAttributes = false;
+
     QgsLayerMetadata mLayerMetadata;
 
     std::unique_ptr< QgsPostgresListener > mListener;
@@ -126,6 +126,13 @@ QgsSpatiaLiteFeatureIterator::QgsSpatiaLiteFeatureIterator( QgsSpatiaLiteFeature
     if ( QgsSettings().value( QStringLiteral( "qgis/compileExpressions" ), true ).toBool() )
     {
       QgsSQLiteExpressionCompiler compiler = QgsSQLiteExpressionCompiler( source->mFields );
+      // the filter is evaluated on the geometries in the destination crs
+      if ( !mTransform.isValid() )
+      {
+        compiler.setGeometryColumn( mSource->mGeometryColumn, mSource->mSrid, QgsSQLiteExpressionCompiler::SpatiaLiteFunctions );
+        if ( mSource->mSpatialIndexRTree && !mSource->mVShapeBased )
+          compiler.setSpatialIndex( QStringLiteral( "idx_%1_%2" ).arg( mSource->mIndexTable, mSource->mIndexGeometry ), QStringLiteral( "ROWID" ) );
+      }
 
       QgsSqlExpressionCompiler::Result result = compiler.compile( request.filterExpression() );
 
@@ -668,6 +675,7 @@ bool QgsSpatiaLiteFeatureIterator::prepareOrderBy( const QList<QgsFeatureRequest
 
 QgsSpatiaLiteFeatureSource::QgsSpatiaLiteFeatureSource( const QgsSpatiaLiteProvider *p )
   : mGeometryColumn( p->mGeometryColumn )
+  , mSrid( p->mSrid )
   , mSubsetString( p->mSubsetString )
   , mFields( p->mAttributeFields )
   , mQuery( p->mQuery )
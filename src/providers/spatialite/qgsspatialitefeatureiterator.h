@@ -38,6 +38,7 @@ class QgsSpatiaLiteFeatureSource final: public QgsAbstractFeatureSource
 
   private:
     QString mGeometryColumn;
+    int mSrid;
     QString mSubsetString;
     QgsFields mFields;
     QString mQuery;
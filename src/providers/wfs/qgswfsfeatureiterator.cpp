@@ -393,6 +393,8 @@ void QgsWFSFeatureDownloaderImpl::run( bool serializeFeatures, int maxFeatures )
   {
     success = true;
     QgsGmlStreamingParser *parser = mShared->createParser();
+    // large responses would otherwise be limited by the parsing on a single core
+    parser->setParallelParsingEnabled( true );
 
     if ( maxTotalFeatures > 0 && mTotalDownloadedFeatureCount >= maxTotalFeatures )
     {
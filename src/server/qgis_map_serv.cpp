@@ -21,14 +21,22 @@
 #include "qgsserver.h"
 #include "qgsfcgiserverresponse.h"
 #include "qgsfcgiserverrequest.h"
+#include "qgsconfigcache.h"
+#include "qgsserverinterfaceimpl.h"
+#include "qgsserversettings.h"
 #include "qgsapplication.h"
 
-#include <fcgi_stdio.h>
-#include <cstdlib>
-
 #include <QFontDatabase>
+#include <QMap>
+#include <QMutex>
 #include <QString>
 
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <fcgi_stdio.h>
+
 int fcgi_accept()
 {
 #ifdef Q_OS_WIN
@@ -41,6 +49,111 @@ int fcgi_accept()
 #endif
 }
 
+/**
+ * Pool of threads accepting and handling FastCGI requests with FCGX_Accept_r.
+ *
+ * Each worker thread has its own FastCGI request, whose parameters are read
+ * from the request itself instead of the process environment, and handles
+ * its requests concurrently with the other workers. The projects of the
+ * cache are shared read-only by the workers, each WMS request rendering its
+ * own clones of the layers. The main thread runs the event loop of the
+ * caches: it reads the projects requested by the workers, which must be
+ * created on the main thread, and handles the changes of the project files.
+ */
+class QgsFcgiWorkerPool
+{
+  public:
+
+    explicit QgsFcgiWorkerPool( QgsServer &server )
+      : mServer( server )
+    {}
+
+    //! Starts \a workers threads and returns once they all stop accepting requests
+    void exec( int workers )
+    {
+      FCGX_Init();
+
+      // the caches are created by the main thread, which delivers their events
+      QgsConfigCache::instance();
+
+      mRunningWorkers = workers;
+      std::vector< std::thread > threads;
+      for ( int i = 0; i < workers; ++i )
+        threads.emplace_back( [this] { work(); } );
+
+      // the last worker quits the event loop
+      QCoreApplication::exec();
+
+      for ( std::thread &thread : threads )
+        thread.join();
+    }
+
+  private:
+
+    //! Returns the parameters of a FastCGI request as environment variables
+    static QMap<QString, QString> environment( char **envp )
+    {
+      QMap<QString, QString> env;
+      for ( ; envp && *envp; ++envp )
+      {
+        const QString variable = QString::fromLocal8Bit( *envp );
+        const int separator = variable.indexOf( '=' );
+        if ( separator > 0 )
+          env.insert( variable.left( separator ), variable.mid( separator + 1 ) );
+      }
+      return env;
+    }
+
+    void work()
+    {
+      FCGX_Request fcgiRequest;
+      FCGX_InitRequest( &fcgiRequest, 0, 0 );
+
+      QgsServerInterfaceImpl *serverInterface = mServer.serverInterface();
+
+      for ( ;; )
+      {
+        int rc = 0;
+        {
+          // accepting is not thread safe on all platforms
+          QMutexLocker locker( &mAcceptMutex );
+          rc = FCGX_Accept_r( &fcgiRequest );
+        }
+
+        if ( rc < 0 )
+          break;
+
+        // getEnv() of plugins and QGIS_PROJECT_FILE read the parameters of
+        // the request handled by this thread
+        serverInterface->setRequestEnvironment( environment( fcgiRequest.envp ) );
+        {
+          QgsFcgiServerRequest request( &fcgiRequest );
+          QgsFcgiServerResponse response( request.method(), &fcgiRequest );
+          if ( ! request.hasError() )
+          {
+            mServer.handleRequest( request, response );
+          }
+          else
+          {
+            response.sendError( 400, "Bad request" );
+          }
+        }
+        serverInterface->clearRequestEnvironment();
+
+        FCGX_Finish_r( &fcgiRequest );
+      }
+
+      QMutexLocker locker( &mMutex );
+      if ( --mRunningWorkers == 0 )
+        QMetaObject::invokeMethod( qApp, "quit", Qt::QueuedConnection );
+    }
+
+    QgsServer &mServer;
+    QMutex mAcceptMutex;
+    QMutex mMutex;
+    int mRunningWorkers = 0;
+};
+
 int main( int argc, char *argv[] )
 {
   // Test if the environ variable DISPLAY is defined
@@ -73,18 +186,28 @@ int main( int argc, char *argv[] )
   QFontDatabase fontDB;
 #endif
 
-  // Starts FCGI loop
-  while ( fcgi_accept() >= 0 )
+  const int workers = server.serverInterface()->serverSettings()->fcgiWorkers();
+  if ( workers > 0 && !FCGX_IsCGI() )
   {
-    QgsFcgiServerRequest  request;
-    QgsFcgiServerResponse response( request.method() );
-    if ( ! request.hasError() )
-    {
-      server.handleRequest( request, response );
-    }
-    else
+    // Starts FCGI worker threads
+    QgsFcgiWorkerPool pool( server );
+    pool.exec( workers );
+  }
+  else
+  {
+    // Starts FCGI loop
+    while ( fcgi_accept() >= 0 )
     {
-      response.sendError( 400, "Bad request" );
+      QgsFcgiServerRequest  request;
+      QgsFcgiServerResponse response( request.method() );
+      if ( ! request.hasError() )
+      {
+        server.handleRequest( request, response );
+      }
+      else
+      {
+        response.sendError( 400, "Bad request" );
+      }
     }
   }
   app.exitQgis();
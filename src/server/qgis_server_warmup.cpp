@@ -0,0 +1,208 @@
+/***************************************************************************
+                              qgis_server_warmup.cpp
+
+A tool building the snapshots of QGIS server projects ahead of time, so that
+server processes do not have to load every layer of the projects from scratch.
+The snapshots are written into the directory defined by the environment
+variable QGIS_SERVER_PROJECT_SNAPSHOT_DIRECTORY, or with the -d option.
+
+With the -l option, the tool seeds the server tile cache with the WMTS tiles
+of a layer instead, into the directory defined by the environment variable
+QGIS_SERVER_TILE_CACHE_DIRECTORY.
+
+                              -------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+//for CMAKE_INSTALL_PREFIX
+#include "qgsconfig.h"
+#include "qgsserver.h"
+#include "qgsbufferserverrequest.h"
+#include "qgsbufferserverresponse.h"
+#include "qgsserverinterfaceimpl.h"
+#include "qgsserversettings.h"
+#include "qgsconfigcache.h"
+#include "qgsapplication.h"
+
+#include <QCommandLineParser>
+#include <QString>
+#include <QUrl>
+#include <QUrlQuery>
+
+#include <iostream>
+
+/**
+ * Renders the WMTS tile of the \a layer of the \a project through the \a server,
+ * which stores it in the tile cache. Returns the HTTP status code of the response,
+ * 400 if the tile is outside of the tile matrix.
+ */
+static int seedTile( QgsServer &server, const QString &project, const QString &layer, const QString &tileMatrixSet,
+                      const QString &format, int zoom, int row, int column )
+{
+  QUrlQuery query;
+  query.addQueryItem( QStringLiteral( "MAP" ), project );
+  query.addQueryItem( QStringLiteral( "SERVICE" ), QStringLiteral( "WMTS" ) );
+  query.addQueryItem( QStringLiteral( "VERSION" ), QStringLiteral( "1.0.0" ) );
+  query.addQueryItem( QStringLiteral( "REQUEST" ), QStringLiteral( "GetTile" ) );
+  query.addQueryItem( QStringLiteral( "LAYER" ), layer );
+  query.addQueryItem( QStringLiteral( "FORMAT" ), format );
+  query.addQueryItem( QStringLiteral( "TILEMATRIXSET" ), tileMatrixSet );
+  query.addQueryItem( QStringLiteral( "TILEMATRIX" ), QString::number( zoom ) );
+  query.addQueryItem( QStringLiteral( "TILEROW" ), QString::number( row ) );
+  query.addQueryItem( QStringLiteral( "TILECOL" ), QString::number( column ) );
+
+  QUrl url( QStringLiteral( "http://localhost/" ) );
+  url.setQuery( query );
+  QgsBufferServerRequest request( url );
+  QgsBufferServerResponse response;
+  server.handleRequest( request, response );
+  return response.statusCode();
+}
+
+int main( int argc, char *argv[] )
+{
+  // see qgis_mapserver.cpp for the offscreen mode
+  const QString display { qgetenv( "DISPLAY" ) };
+  bool withDisplay = true;
+  if ( display.isEmpty() )
+  {
+    withDisplay = false;
+    qputenv( "QT_QPA_PLATFORM", "offscreen" );
+  }
+
+  QgsApplication app( argc, argv, withDisplay, QString(), QStringLiteral( "server" ) );
+
+  QCoreApplication::setApplicationName( QStringLiteral( "QGIS Server Warm-up" ) );
+  QCoreApplication::setApplicationVersion( QStringLiteral( "1.0" ) );
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription( QObject::tr( "Builds the snapshots loaded by QGIS server instead of the projects" ) );
+  parser.addHelpOption();
+  parser.addVersionOption();
+  parser.addPositionalArgument( QStringLiteral( "projects" ), QObject::tr( "Paths to QGIS project files (*.qgs or *.qgz)" ), QStringLiteral( "projects..." ) );
+  QCommandLineOption directoryOption( "d", QObject::tr( "Snapshot directory, overrides the QGIS_SERVER_PROJECT_SNAPSHOT_DIRECTORY\n"
+                                      "environment variable." ), "directory", "" );
+  parser.addOption( directoryOption );
+  QCommandLineOption layerOption( "l", QObject::tr( "WMTS layer to seed the tile cache with, instead of writing snapshots." ), "layer", "" );
+  parser.addOption( layerOption );
+  QCommandLineOption tileMatrixSetOption( "t", QObject::tr( "Tile matrix set of the seeded tiles, EPSG:3857 by default." ), "tileMatrixSet", "EPSG:3857" );
+  parser.addOption( tileMatrixSetOption );
+  QCommandLineOption zoomOption( "z", QObject::tr( "Range of tile matrices (zoom levels) to seed, 0-5 by default." ), "min-max", "0-5" );
+  parser.addOption( zoomOption );
+  QCommandLineOption formatOption( "f", QObject::tr( "Format of the seeded tiles, image/png by default." ), "format", "image/png" );
+  parser.addOption( formatOption );
+  parser.process( app );
+
+  if ( ! parser.value( directoryOption ).isEmpty() )
+  {
+    qputenv( "QGIS_SERVER_PROJECT_SNAPSHOT_DIRECTORY", parser.value( directoryOption ).toUtf8() );
+  }
+
+  const QStringList projects = parser.positionalArguments();
+  if ( projects.isEmpty() )
+  {
+    parser.showHelp( 1 );
+  }
+
+  // initialize the server as qgis_mapserv does, so that the same providers and settings are used
+  QgsServer server;
+  const QgsServerSettings &settings = *server.serverInterface()->serverSettings();
+
+  int errors = 0;
+
+  const QString layer = parser.value( layerOption );
+  if ( !layer.isEmpty() )
+  {
+    if ( settings.tileCacheDirectory().isEmpty() )
+    {
+      std::cerr << QObject::tr( "QGIS_SERVER_TILE_CACHE_DIRECTORY must be set to seed the tile cache" ).toStdString() << std::endl;
+      app.exitQgis();
+      return 1;
+    }
+
+    const QStringList zoomRange = parser.value( zoomOption ).split( '-' );
+    const int minZoom = zoomRange.value( 0 ).toInt();
+    const int maxZoom = zoomRange.value( 1, zoomRange.value( 0 ) ).toInt();
+
+    for ( const QString &project : projects )
+    {
+      int tiles = 0;
+      int failedTiles = 0;
+      for ( int zoom = minZoom; zoom <= maxZoom; ++zoom )
+      {
+        // the server rejects the rows and columns outside of the tile matrix
+        for ( int row = 0; ; ++row )
+        {
+          int column = 0;
+          for ( ; ; ++column )
+          {
+            const int status = seedTile( server, project, layer, parser.value( tileMatrixSetOption ), parser.value( formatOption ), zoom, row, column );
+            if ( status == 400 )
+              break;
+
+            // a failed tile does not prevent seeding the next ones
+            if ( status == 200 )
+            {
+              tiles++;
+            }
+            else
+            {
+              std::cerr << QObject::tr( "Unable to seed the tile %1/%2/%3 of %4 for %5 (HTTP status %6)" )
+                        .arg( zoom ).arg( row ).arg( column ).arg( layer, project ).arg( status ).toStdString() << std::endl;
+              failedTiles++;
+            }
+          }
+
+          if ( column == 0 )
+            break;
+        }
+      }
+
+      if ( tiles > 0 )
+      {
+        std::cout << QObject::tr( "%1 tiles of %2 seeded for %3" ).arg( tiles ).arg( layer, project ).toStdString() << std::endl;
+      }
+
+      if ( failedTiles > 0 )
+      {
+        std::cerr << QObject::tr( "Unable to seed %1 tiles of %2 for %3" ).arg( failedTiles ).arg( layer, project ).toStdString() << std::endl;
+        errors++;
+      }
+      else if ( tiles == 0 )
+      {
+        std::cerr << QObject::tr( "Unable to seed the tiles of %1 for %2" ).arg( layer, project ).toStdString() << std::endl;
+        errors++;
+      }
+    }
+
+    app.exitQgis();
+    return errors > 0 ? 1 : 0;
+  }
+
+  for ( const QString &project : projects )
+  {
+    if ( QgsConfigCache::writeProjectSnapshot( project, settings ) )
+    {
+      std::cout << QObject::tr( "Snapshot of %1 written to %2" )
+                .arg( project, QgsConfigCache::projectSnapshotPath( project, settings.projectSnapshotDirectory() ) ).toStdString() << std::endl;
+    }
+    else
+    {
+      std::cerr << QObject::tr( "Unable to write the snapshot of %1" ).arg( project ).toStdString() << std::endl;
+      errors++;
+    }
+  }
+
+  app.exitQgis();
+  return errors > 0 ? 1 : 0;
+}
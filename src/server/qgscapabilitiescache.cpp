@@ -19,6 +19,8 @@
 
 #include <QCoreApplication>
 #include <QFileInfo>
+#include <QMutexLocker>
+#include <QThread>
 
 #if defined(Q_OS_LINUX)
 #include <sys/vfs.h>
@@ -38,8 +40,12 @@ QgsCapabilitiesCache::QgsCapabilitiesCache()
 
 const QDomDocument *QgsCapabilitiesCache::searchCapabilitiesDocument( const QString &configFilePath, const QString &key )
 {
-  QCoreApplication::processEvents(); //get updates from file system watcher
+  // the FastCGI worker threads have no event loop, the updates are then
+  // delivered by the main thread
+  if ( QThread::currentThread() == thread() )
+    QCoreApplication::processEvents(); //get updates from file system watcher
 
+  QMutexLocker locker( &mMutex );
   if ( mCachedCapabilities.contains( configFilePath ) && mCachedCapabilities[ configFilePath ].contains( key ) )
   {
     return &mCachedCapabilities[ configFilePath ][ key ];
@@ -52,21 +58,27 @@ const QDomDocument *QgsCapabilitiesCache::searchCapabilitiesDocument( const QStr
 
 void QgsCapabilitiesCache::insertCapabilitiesDocument( const QString &configFilePath, const QString &key, const QDomDocument *doc )
 {
+  QMutexLocker locker( &mMutex );
   if ( mCachedCapabilities.size() > 40 )
   {
     //remove another cache entry to avoid memory problems
     QHash<QString, QHash<QString, QDomDocument> >::iterator capIt = mCachedCapabilities.begin();
-    mFileSystemWatcher.removePath( capIt.key() );
+    QMetaObject::invokeMethod( this, "unwatchPath", Qt::AutoConnection, Q_ARG( QString, capIt.key() ) );
     mCachedCapabilities.erase( capIt );
   }
 
   if ( !mCachedCapabilities.contains( configFilePath ) )
   {
-    mFileSystemWatcher.addPath( configFilePath );
+    QMetaObject::invokeMethod( this, "watchPath", Qt::AutoConnection, Q_ARG( QString, configFilePath ) );
     mCachedCapabilities.insert( configFilePath, QHash<QString, QDomDocument>() );
   }
 
   mCachedCapabilities[ configFilePath ].insert( key, doc->cloneNode().toDocument() );
+}
+
+void QgsCapabilitiesCache::watchPath( const QString &configFilePath )
+{
+  mFileSystemWatcher.addPath( configFilePath );
 
 #if defined(Q_OS_LINUX)
   struct statfs sStatFS;
@@ -83,13 +95,21 @@ void QgsCapabilitiesCache::insertCapabilitiesDocument( const QString &configFile
 #endif
 }
 
-void QgsCapabilitiesCache::removeCapabilitiesDocument( const QString &path )
+void QgsCapabilitiesCache::unwatchPath( const QString &path )
 {
-  mCachedCapabilities.remove( path );
   mCachedCapabilitiesTimestamps.remove( path );
   mFileSystemWatcher.removePath( path );
 }
 
+void QgsCapabilitiesCache::removeCapabilitiesDocument( const QString &path )
+{
+  {
+    QMutexLocker locker( &mMutex );
+    mCachedCapabilities.remove( path );
+  }
+  QMetaObject::invokeMethod( this, "unwatchPath", Qt::AutoConnection, Q_ARG( QString, path ) );
+}
+
 void QgsCapabilitiesCache::removeChangedEntry( const QString &path )
 {
   QgsDebugMsg( QStringLiteral( "Remove capabilities cache entry because file changed" ) );
@@ -21,6 +21,7 @@
 #include <QDomDocument>
 #include <QFileSystemWatcher>
 #include <QHash>
+#include <QMutex>
 #include <QObject>
 #include <QDateTime>
 #include <QTimer>
@@ -65,7 +66,14 @@ class SERVER_EXPORT QgsCapabilitiesCache : public QObject
     QFileSystemWatcher mFileSystemWatcher;
     QTimer mTimer;
 
+    //! Protects the cached documents, which are used by concurrent requests
+    QMutex mMutex;
+
   private slots:
+    //! Watches the changes of the file at \a path, from the thread of the cache
+    void watchPath( const QString &path );
+    //! Stops watching the file at \a path, from the thread of the cache
+    void unwatchPath( const QString &path );
     //! Removes changed entry from this cache
     void removeChangedEntry( const QString &path );
     //! Remove outdated enties
@@ -20,8 +20,17 @@
 #include "qgsserverexception.h"
 #include "qgsstorebadlayerinfo.h"
 #include "qgsserverprojectutils.h"
+#include "qgsservertilecache.h"
+#include "qgsproviderregistry.h"
+#include "qgsmaplayer.h"
 
+#include <QCryptographicHash>
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
 
 QgsConfigCache *QgsConfigCache::instance()
 {
@@ -41,79 +50,352 @@ QgsConfigCache::QgsConfigCache()
 
 const QgsProject *QgsConfigCache::project( const QString &path, QgsServerSettings *settings )
 {
-  if ( ! mProjectCache[ path ] )
+  // keeps the project alive for the caller, even if it is removed from the cache
+  std::shared_ptr<const QgsProject> &reference = mProjectReferences.localData();
+  reference = sharedProject( path, settings );
+  return reference.get();
+}
+
+std::shared_ptr<const QgsProject> QgsConfigCache::sharedProject( const QString &path, QgsServerSettings *settings )
+{
+  std::shared_ptr<PendingLoad> load;
+  bool loader = false;
   {
-    std::unique_ptr<QgsProject> prj( new QgsProject() );
+    QMutexLocker locker( &mMutex );
+    if ( mProjectCache.contains( path ) )
+      return *mProjectCache.object( path );
 
-    QgsStoreBadLayerInfo *badLayerHandler = new QgsStoreBadLayerInfo();
-    prj->setBadLayerHandler( badLayerHandler );
+    // the concurrent calls for the same project wait for a single load
+    load = mLoads.value( path );
+    if ( !load )
+    {
+      load = std::make_shared<PendingLoad>();
+      load->settings = settings;
+      mLoads.insert( path, load );
+      loader = true;
+    }
+  }
 
-    QgsProject::ReadFlags readFlags = QgsProject::ReadFlag();
-    if ( settings )
+  const bool cacheThread = QThread::currentThread() == thread();
+  if ( loader )
+  {
+    // only the snapshot files are read from the calling thread, the project
+    // is read from the thread of the cache (layouts, provider connections...)
+    load->snapshot = validProjectSnapshot( path, settings );
+    if ( cacheThread )
     {
-      // Activate trust layer metadata flag
-      if ( settings->trustLayerMetadata() )
+      runLoad( path, load );
+    }
+    else
+    {
+      QMutexLocker locker( &mMutex );
+      mQueuedLoads << qMakePair( path, load );
+      mLoadsChanged.wakeAll();
+      QMetaObject::invokeMethod( this, "runQueuedLoads", Qt::QueuedConnection );
+    }
+  }
+
+  QMutexLocker locker( &mMutex );
+  while ( !load->finished )
+  {
+    // the thread of the cache does not wait for the loads it has to run
+    if ( cacheThread && !mQueuedLoads.isEmpty() )
+    {
+      locker.unlock();
+      runQueuedLoads();
+      locker.relock();
+      continue;
+    }
+    mLoadsChanged.wait( &mMutex );
+  }
+
+  if ( !load->error.isEmpty() )
+    throw QgsServerException( load->error );
+
+  return load->project;
+}
+
+void QgsConfigCache::runQueuedLoads()
+{
+  for ( ;; )
+  {
+    QPair<QString, std::shared_ptr<PendingLoad>> queued;
+    {
+      QMutexLocker locker( &mMutex );
+      if ( mQueuedLoads.isEmpty() )
+        return;
+      queued = mQueuedLoads.takeFirst();
+    }
+    runLoad( queued.first, queued.second );
+  }
+}
+
+void QgsConfigCache::runLoad( const QString &path, const std::shared_ptr<PendingLoad> &load )
+{
+  QString error;
+  std::shared_ptr<QgsProject> project;
+  try
+  {
+    project = loadProject( path, load->snapshot, load->settings, error );
+  }
+  catch ( ... )
+  {
+    // the waiting calls must not wait forever
+    error = QStringLiteral( "Project could not be loaded" );
+  }
+
+  QMutexLocker locker( &mMutex );
+  if ( project && !load->outdated )
+  {
+    mProjectCache.insert( path, new std::shared_ptr<QgsProject>( project ) );
+    mFileSystemWatcher.addPath( path );
+  }
+  load->project = project;
+  load->error = error;
+  load->finished = true;
+  if ( mLoads.value( path ) == load )
+    mLoads.remove( path );
+  mLoadsChanged.wakeAll();
+}
+
+std::shared_ptr<QgsProject> QgsConfigCache::loadProject( const QString &path, const QString &snapshot, QgsServerSettings *settings, QString &error )
+{
+  std::unique_ptr<ProjectLoad> load = readProject( path, snapshot, settings );
+  if ( !load->project )
+    return nullptr;
+
+  if ( !load->badLayerHandler->badLayers().isEmpty() )
+  {
+    // if bad layers are not restricted layers so service failed
+    QStringList unrestrictedBadLayers;
+    // test bad layers through restrictedlayers
+    const QStringList badLayerIds = load->badLayerHandler->badLayers();
+    const QMap<QString, QString> badLayerNames = load->badLayerHandler->badLayerNames();
+    const QStringList resctrictedLayers = QgsServerProjectUtils::wmsRestrictedLayers( *load->project );
+    for ( const QString &badLayerId : badLayerIds )
+    {
+      // if this bad layer is in restricted layers
+      // it doesn't need to be added to unrestricted bad layers
+      if ( badLayerNames.contains( badLayerId ) &&
+           resctrictedLayers.contains( badLayerNames.value( badLayerId ) ) )
+      {
+        continue;
+      }
+      unrestrictedBadLayers.append( badLayerId );
+    }
+    if ( !unrestrictedBadLayers.isEmpty() )
+    {
+      // This is a critical error unless QGIS_SERVER_IGNORE_BAD_LAYERS is set to TRUE
+      if ( ! settings || ! settings->ignoreBadLayers() )
       {
-        readFlags |= QgsProject::ReadFlag::FlagTrustLayerMetadata;
+        QgsMessageLog::logMessage(
+          QStringLiteral( "Error, Layer(s) %1 not valid in project %2" ).arg( unrestrictedBadLayers.join( QStringLiteral( ", " ) ), path ),
+          QStringLiteral( "Server" ), Qgis::Critical );
+        error = QStringLiteral( "Layer(s) not valid" );
+        return nullptr;
       }
-      // Activate don't load layouts flag
-      if ( settings->getPrintDisabled() )
+      else
       {
-        readFlags |= QgsProject::ReadFlag::FlagDontLoadLayouts;
+        QgsMessageLog::logMessage(
+          QStringLiteral( "Warning, Layer(s) %1 not valid in project %2" ).arg( unrestrictedBadLayers.join( QStringLiteral( ", " ) ), path ),
+          QStringLiteral( "Server" ), Qgis::Warning );
       }
     }
+  }
+
+  // the last request using a project may be handled by another thread, the
+  // project is deleted from the thread of the cache
+  return std::shared_ptr<QgsProject>( load->project.release(), []( QgsProject * obsolete ) { obsolete->deleteLater(); } );
+}
+
+std::unique_ptr<QgsConfigCache::ProjectLoad> QgsConfigCache::readProject( const QString &path, const QString &snapshot, QgsServerSettings *settings )
+{
+  std::unique_ptr<ProjectLoad> load = qgis::make_unique<ProjectLoad>();
+  std::unique_ptr<QgsProject> prj( new QgsProject() );
+
+  load->badLayerHandler = new QgsStoreBadLayerInfo();
+  prj->setBadLayerHandler( load->badLayerHandler );
+
+  QgsProject::ReadFlags readFlags = QgsProject::ReadFlag();
+
+  // layer metadata of snapshots is up to date
+  if ( !snapshot.isEmpty() )
+  {
+    readFlags |= QgsProject::ReadFlag::FlagTrustLayerMetadata;
+  }
 
-    if ( prj->read( path, readFlags ) )
+  if ( settings )
+  {
+    // Activate trust layer metadata flag
+    if ( settings->trustLayerMetadata() )
     {
-      if ( !badLayerHandler->badLayers().isEmpty() )
-      {
-        // if bad layers are not restricted layers so service failed
-        QStringList unrestrictedBadLayers;
-        // test bad layers through restrictedlayers
-        const QStringList badLayerIds = badLayerHandler->badLayers();
-        const QMap<QString, QString> badLayerNames = badLayerHandler->badLayerNames();
-        const QStringList resctrictedLayers = QgsServerProjectUtils::wmsRestrictedLayers( *prj );
-        for ( const QString &badLayerId : badLayerIds )
-        {
-          // if this bad layer is in restricted layers
-          // it doesn't need to be added to unrestricted bad layers
-          if ( badLayerNames.contains( badLayerId ) &&
-               resctrictedLayers.contains( badLayerNames.value( badLayerId ) ) )
-          {
-            continue;
-          }
-          unrestrictedBadLayers.append( badLayerId );
-        }
-        if ( !unrestrictedBadLayers.isEmpty() )
-        {
-          // This is a critical error unless QGIS_SERVER_IGNORE_BAD_LAYERS is set to TRUE
-          if ( ! settings || ! settings->ignoreBadLayers() )
-          {
-            QgsMessageLog::logMessage(
-              QStringLiteral( "Error, Layer(s) %1 not valid in project %2" ).arg( unrestrictedBadLayers.join( QStringLiteral( ", " ) ), path ),
-              QStringLiteral( "Server" ), Qgis::Critical );
-            throw QgsServerException( QStringLiteral( "Layer(s) not valid" ) );
-          }
-          else
-          {
-            QgsMessageLog::logMessage(
-              QStringLiteral( "Warning, Layer(s) %1 not valid in project %2" ).arg( unrestrictedBadLayers.join( QStringLiteral( ", " ) ), path ),
-              QStringLiteral( "Server" ), Qgis::Warning );
-          }
-        }
-      }
-      mProjectCache.insert( path, prj.release() );
-      mFileSystemWatcher.addPath( path );
+      readFlags |= QgsProject::ReadFlag::FlagTrustLayerMetadata;
     }
-    else
+    // Activate don't load layouts flag
+    if ( settings->getPrintDisabled() )
     {
-      QgsMessageLog::logMessage(
-        QStringLiteral( "Error when loading project file '%1': %2 " ).arg( path, prj->error() ),
-        QStringLiteral( "Server" ), Qgis::Critical );
+      readFlags |= QgsProject::ReadFlag::FlagDontLoadLayouts;
+    }
+    // Layers are resolved when a request uses them, see QgsServerProjectUtils::resolveLayers()
+    if ( settings->lazyLayerLoading() )
+    {
+      readFlags |= QgsProject::ReadFlag::FlagDontResolveLayers;
+      readFlags |= QgsProject::ReadFlag::FlagTrustLayerMetadata;
     }
   }
-  return mProjectCache[ path ];
 
+  if ( prj->read( snapshot.isEmpty() ? path : snapshot, readFlags ) )
+  {
+    if ( !snapshot.isEmpty() )
+    {
+      // the project must look as if loaded from its own path (home path, cache keys...)
+      prj->setFileName( path );
+      prj->setDirty( false );
+    }
+    load->project = std::move( prj );
+  }
+  else
+  {
+    QgsMessageLog::logMessage(
+      QStringLiteral( "Error when loading project file '%1': %2 " ).arg( path, prj->error() ),
+      QStringLiteral( "Server" ), Qgis::Critical );
+  }
+
+  return load;
+}
+
+QString QgsConfigCache::projectSnapshotPath( const QString &path, const QString &directory )
+{
+  const QByteArray hash = QCryptographicHash::hash( QFileInfo( path ).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1 ).toHex();
+  return QDir( directory ).filePath( QStringLiteral( "%1.qgs" ).arg( QString::fromLatin1( hash ) ) );
+}
+
+///@cond PRIVATE
+//! Returns the path of the validity key file of the \a snapshot
+static QString projectSnapshotKeyPath( const QString &snapshot )
+{
+  return QFileInfo( snapshot ).dir().filePath( QStringLiteral( "%1.key" ).arg( QFileInfo( snapshot ).completeBaseName() ) );
+}
+///@endcond
+
+QByteArray QgsConfigCache::projectSnapshotKey( const QStringList &files )
+{
+  // one line per file, missing files are part of the key too
+  QByteArray key;
+  for ( const QString &file : files )
+  {
+    const QFileInfo info( file );
+    key += QStringLiteral( "%1\t%2\t%3\n" ).arg( info.absoluteFilePath() )
+           .arg( info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1 )
+           .arg( info.exists() ? info.size() : -1 ).toUtf8();
+  }
+  return key;
+}
+
+QStringList QgsConfigCache::projectDataSourceFiles( const QgsProject &project )
+{
+  QStringList files;
+  const QMap<QString, QgsMapLayer *> layers = project.mapLayers();
+  for ( const QgsMapLayer *layer : layers )
+  {
+    // databases and web services have no modification time
+    const QString path = QgsProviderRegistry::instance()->decodeUri( layer->providerType(), layer->source() ).value( QStringLiteral( "path" ) ).toString();
+    const QFileInfo info( path );
+    if ( path.isEmpty() || !info.isFile() )
+      continue;
+
+    if ( !files.contains( info.absoluteFilePath() ) )
+      files << info.absoluteFilePath();
+  }
+  return files;
+}
+
+QString QgsConfigCache::validProjectSnapshot( const QString &path, QgsServerSettings *settings )
+{
+  if ( !settings || settings->projectSnapshotDirectory().isEmpty() )
+    return QString();
+
+  // projects from project storages (e.g. PostgreSQL) have no snapshot
+  const QFileInfo projectInfo( path );
+  if ( !projectInfo.exists() )
+    return QString();
+
+  const QFileInfo snapshotInfo( projectSnapshotPath( path, settings->projectSnapshotDirectory() ) );
+  if ( !snapshotInfo.exists() )
+    return QString();
+
+  // the key lists the project file and the data source files of the snapshot
+  QFile keyFile( projectSnapshotKeyPath( snapshotInfo.filePath() ) );
+  if ( !keyFile.open( QIODevice::ReadOnly ) )
+    return QString();
+
+  const QByteArray key = keyFile.readAll();
+  QStringList files;
+  const QList<QByteArray> lines = key.split( '\n' );
+  for ( const QByteArray &line : lines )
+  {
+    if ( !line.isEmpty() )
+      files << QString::fromUtf8( line.split( '\t' ).value( 0 ) );
+  }
+
+  if ( files.value( 0 ) != projectInfo.absoluteFilePath() || projectSnapshotKey( files ) != key )
+    return QString();
+
+  return snapshotInfo.filePath();
+}
+
+bool QgsConfigCache::writeProjectSnapshot( const QString &path, const QgsServerSettings &settings )
+{
+  const QString directory = settings.projectSnapshotDirectory();
+  if ( directory.isEmpty() )
+  {
+    QgsMessageLog::logMessage( QStringLiteral( "Error, no project snapshot directory defined" ), QStringLiteral( "Server" ), Qgis::Critical );
+    return false;
+  }
+
+  if ( !QFileInfo::exists( path ) )
+  {
+    QgsMessageLog::logMessage( QStringLiteral( "Error, project file '%1' does not exist" ).arg( path ), QStringLiteral( "Server" ), Qgis::Critical );
+    return false;
+  }
+
+  QgsProject::ReadFlags readFlags = QgsProject::ReadFlag();
+  if ( settings.getPrintDisabled() )
+  {
+    readFlags |= QgsProject::ReadFlag::FlagDontLoadLayouts;
+  }
+
+  // layer metadata is never trusted here, so that the snapshot stores the actual one
+  QgsProject project;
+  if ( !project.read( path, readFlags ) )
+  {
+    QgsMessageLog::logMessage( QStringLiteral( "Error when loading project file '%1': %2 " ).arg( path, project.error() ), QStringLiteral( "Server" ), Qgis::Critical );
+    return false;
+  }
+
+  // the snapshot lives in another directory than the project
+  project.writeEntry( QStringLiteral( "Paths" ), QStringLiteral( "/Absolute" ), true );
+
+  // the previous snapshot is invalid until the new one and its key are written
+  const QString snapshot = projectSnapshotPath( path, directory );
+  QFile::remove( projectSnapshotKeyPath( snapshot ) );
+
+  if ( !QDir().mkpath( directory ) || !project.write( snapshot ) )
+  {
+    QgsMessageLog::logMessage( QStringLiteral( "Error when writing snapshot of project file '%1': %2 " ).arg( path, project.error() ), QStringLiteral( "Server" ), Qgis::Critical );
+    return false;
+  }
+
+  QSaveFile keyFile( projectSnapshotKeyPath( snapshot ) );
+  if ( !keyFile.open( QIODevice::WriteOnly )
+       || keyFile.write( projectSnapshotKey( QStringList() << path << projectDataSourceFiles( project ) ) ) < 0
+       || !keyFile.commit() )
+  {
+    QgsMessageLog::logMessage( QStringLiteral( "Error when writing snapshot key of project file '%1': %2 " ).arg( path, keyFile.errorString() ), QStringLiteral( "Server" ), Qgis::Critical );
+    return false;
+  }
+
+  return true;
 }
 
 QDomDocument *QgsConfigCache::xmlDocument( const QString &filePath )
@@ -157,16 +439,38 @@ QDomDocument *QgsConfigCache::xmlDocument( const QString &filePath )
 
 void QgsConfigCache::removeChangedEntry( const QString &path )
 {
-  mProjectCache.remove( path );
+  {
+    QMutexLocker locker( &mMutex );
+    mProjectCache.remove( path );
+    if ( mLoads.contains( path ) )
+      mLoads.value( path )->outdated = true;
+  }
 
   //xml document must be removed last, as other config cache destructors may require it
   mXmlDocumentCache.remove( path );
 
+  // the tiles rendered from the previous file are outdated
+  QgsServerTileCache::instance()->removeProject( path );
+
   mFileSystemWatcher.removePath( path );
 }
 
 
 void QgsConfigCache::removeEntry( const QString &path )
 {
-  removeChangedEntry( path );
+  if ( QThread::currentThread() == thread() )
+  {
+    removeChangedEntry( path );
+    return;
+  }
+
+  // the project is no longer returned from now on, the watched files are
+  // only handled by the thread of the cache
+  {
+    QMutexLocker locker( &mMutex );
+    mProjectCache.remove( path );
+    if ( mLoads.contains( path ) )
+      mLoads.value( path )->outdated = true;
+  }
+  QMetaObject::invokeMethod( this, "removeChangedEntry", Qt::QueuedConnection, Q_ARG( QString, path ) );
 }
@@ -22,14 +22,22 @@
 
 #include <QCache>
 #include <QFileSystemWatcher>
+#include <QMap>
+#include <QMutex>
 #include <QObject>
 #include <QDomDocument>
+#include <QPair>
+#include <QThreadStorage>
+#include <QWaitCondition>
+#include <memory>
 
 #include "qgis_server.h"
 #include "qgis_sip.h"
 #include "qgsproject.h"
 #include "qgsserversettings.h"
 
+class QgsStoreBadLayerInfo;
+
 /**
  * \ingroup server
  * \brief Cache for server configuration.
@@ -61,25 +69,158 @@ class SERVER_EXPORT QgsConfigCache : public QObject
      * \param path the filename of the QGIS project
      * \param settings QGIS server settings
      * \returns the project or NULLPTR if an error happened
+     *
+     * The returned project is valid as long as it is cached, and at least
+     * until the next call to project() from the same thread. Use
+     * sharedProject() to keep it longer.
      * \since QGIS 3.0
      */
     const QgsProject *project( const QString &path, QgsServerSettings *settings = nullptr );
 
+    /**
+     * Returns the project stored at \a path as project() does, along with a
+     * reference keeping the project alive as long as it is used, even if it
+     * is removed from the cache meanwhile. This allows requests handled by
+     * concurrent threads to share the cached projects.
+     *
+     * A project is loaded once, the concurrent calls for a project which is
+     * being loaded wait for that load to finish and return its project.
+     * Projects are always read by the thread of the cache (their layouts and
+     * provider connections belong to it): calls from other threads only
+     * check the snapshot of the project, then wait for the event loop of the
+     * thread of the cache to read it.
+     *
+     * \note not available in Python bindings
+     * \note This method is thread safe.
+     * \since QGIS 3.16
+     */
+    std::shared_ptr<const QgsProject> sharedProject( const QString &path, QgsServerSettings *settings = nullptr ) SIP_SKIP;
+
+    /**
+     * Returns the path of the snapshot of the project stored at \a path
+     * within the snapshot \a directory.
+     * \see writeProjectSnapshot()
+     * \since QGIS 3.16
+     */
+    static QString projectSnapshotPath( const QString &path, const QString &directory );
+
+    /**
+     * Returns the path of the snapshot of the project stored at \a path
+     * within the snapshot directory defined by \a settings, or an empty
+     * string if there is no up to date snapshot.
+     *
+     * A snapshot is up to date as long as neither the project file nor the
+     * local files of its layer data sources (e.g. shapefiles, GeoPackages)
+     * are modified since the snapshot was written.
+     *
+     * \see writeProjectSnapshot()
+     * \since QGIS 3.16
+     */
+    static QString validProjectSnapshot( const QString &path, QgsServerSettings *settings );
+
+    /**
+     * Loads the project stored at \a path and writes its snapshot into the
+     * snapshot directory defined by \a settings.
+     *
+     * The snapshot is a flat .qgs copy of the project with absolute layer
+     * paths and with the layer metadata (extents...) computed while loading.
+     * Once built, the server loads the snapshot instead of the project,
+     * trusting its layer metadata, as long as neither the project file nor
+     * the local files of its layer data sources are modified. Snapshots are
+     * meant to be built ahead of time, e.g. by the qgis_server_warmup tool
+     * when deploying projects.
+     *
+     * \returns TRUE if the snapshot is written
+     * \see QgsServerSettings::projectSnapshotDirectory()
+     * \since QGIS 3.16
+     */
+    static bool writeProjectSnapshot( const QString &path, const QgsServerSettings &settings );
+
   private:
     QgsConfigCache() SIP_FORCE;
 
+    // keys its tile sets by the data source files of the projects
+    friend class QgsServerTileCache;
+
+    //! Project loaded from a file
+    struct ProjectLoad
+    {
+      std::unique_ptr<QgsProject> project;
+      QgsStoreBadLayerInfo *badLayerHandler = nullptr; // owned by project
+    };
+
+    /**
+     * Reads the project stored at \a path, or its up to date \a snapshot if
+     * not empty. The returned project is NULLPTR on errors.
+     */
+    static std::unique_ptr<ProjectLoad> readProject( const QString &path, const QString &snapshot, QgsServerSettings *settings );
+
+    //! Load of a project, shared by the calls waiting for it
+    struct PendingLoad
+    {
+      QgsServerSettings *settings = nullptr;
+      //! Up to date snapshot of the project, checked by the calling thread
+      QString snapshot;
+      bool finished = false;
+      //! TRUE if the project file changed during the load, the project is then not cached
+      bool outdated = false;
+      std::shared_ptr<QgsProject> project;
+      //! Message of the server exception raised to the callers if not empty
+      QString error;
+    };
+
+    /**
+     * Loads the project stored at \a path from the thread of the cache and
+     * publishes it into the cache, then wakes the calls waiting for the
+     * \a load.
+     */
+    void runLoad( const QString &path, const std::shared_ptr<PendingLoad> &load );
+
+    /**
+     * Loads the project stored at \a path, or its \a snapshot, checking its
+     * bad layers. Returns NULLPTR and sets the \a error message if the
+     * project is not available.
+     */
+    std::shared_ptr<QgsProject> loadProject( const QString &path, const QString &snapshot, QgsServerSettings *settings, QString &error );
+
     //! Check for configuration file updates (remove entry from cache if file changes)
     QFileSystemWatcher mFileSystemWatcher;
 
+    //! Returns the validity key of a snapshot, made of the modification times and sizes of the \a files it was built from
+    static QByteArray projectSnapshotKey( const QStringList &files );
+
+    //! Returns the paths of the local files read by the layers of the \a project
+    static QStringList projectDataSourceFiles( const QgsProject &project );
+
     //! Returns xml document for project file / sld or 0 in case of errors
     QDomDocument *xmlDocument( const QString &filePath );
 
     QCache<QString, QDomDocument> mXmlDocumentCache;
-    QCache<QString, QgsProject> mProjectCache;
+
+    /**
+     * The cached projects are shared with the requests using them. Projects
+     * removed from the cache are deleted from the thread of the cache once
+     * the last request using them is finished.
+     */
+    QCache<QString, std::shared_ptr<QgsProject>> mProjectCache;
+
+    //! Protects the project cache and the pending loads
+    mutable QMutex mMutex;
+    //! Woken when a load is queued or finished
+    QWaitCondition mLoadsChanged;
+    QMap<QString, std::shared_ptr<PendingLoad>> mLoads;
+    //! Loads requested by other threads, run by the thread of the cache
+    QList<QPair<QString, std::shared_ptr<PendingLoad>>> mQueuedLoads;
+
+    //! Last project returned by project() to each thread
+    QThreadStorage<std::shared_ptr<const QgsProject>> mProjectReferences;
 
   private slots:
     //! Removes changed entry from this cache
     void removeChangedEntry( const QString &path );
+
+    //! Runs the loads queued by the other threads
+    void runQueuedLoads();
 };
 
 #endif // QGSCONFIGCACHE_H
@@ -25,15 +25,21 @@
 #include <QDebug>
 
 QgsFcgiServerRequest::QgsFcgiServerRequest()
+  : QgsFcgiServerRequest( nullptr )
+{
+}
+
+QgsFcgiServerRequest::QgsFcgiServerRequest( FCGX_Request *request )
+  : mFcgiRequest( request )
 {
 
   // Get the REQUEST_URI from the environment
   QUrl url;
-  QString uri = getenv( "REQUEST_URI" );
+  QString uri = param( "REQUEST_URI" );
 
   if ( uri.isEmpty() )
   {
-    uri = getenv( "SCRIPT_NAME" );
+    uri = param( "SCRIPT_NAME" );
   }
 
   url.setUrl( uri );
@@ -41,13 +47,13 @@ QgsFcgiServerRequest::QgsFcgiServerRequest()
   // Check if host is defined
   if ( url.host().isEmpty() )
   {
-    url.setHost( getenv( "SERVER_NAME" ) );
+    url.setHost( param( "SERVER_NAME" ) );
   }
 
   // Port ?
   if ( url.port( -1 ) == -1 )
   {
-    QString portString = getenv( "SERVER_PORT" );
+    QString portString = param( "SERVER_PORT" );
     if ( !portString.isEmpty() )
     {
       bool portOk;
@@ -62,7 +68,7 @@ QgsFcgiServerRequest::QgsFcgiServerRequest()
   // scheme
   if ( url.scheme().isEmpty() )
   {
-    QString( getenv( "HTTPS" ) ).compare( QLatin1String( "on" ), Qt::CaseInsensitive ) == 0
+    QString( param( "HTTPS" ) ).compare( QLatin1String( "on" ), Qt::CaseInsensitive ) == 0
     ? url.setScheme( QStringLiteral( "https" ) )
     : url.setScheme( QStringLiteral( "http" ) );
   }
@@ -73,7 +79,7 @@ QgsFcgiServerRequest::QgsFcgiServerRequest()
   // OGC parameters are passed with the query string, which is normally part of
   // the REQUEST_URI, we override the query string url in case it is defined
   // independently of REQUEST_URI
-  const char *qs = getenv( "QUERY_STRING" );
+  const char *qs = param( "QUERY_STRING" );
   if ( qs )
   {
     url.setQuery( qs );
@@ -86,7 +92,7 @@ QgsFcgiServerRequest::QgsFcgiServerRequest()
   QgsServerRequest::Method method = GetMethod;
 
   // Get method
-  const char *me = getenv( "REQUEST_METHOD" );
+  const char *me = param( "REQUEST_METHOD" );
 
   if ( me )
   {
@@ -122,7 +128,7 @@ QgsFcgiServerRequest::QgsFcgiServerRequest()
   setMethod( method );
 
   // Get accept header for content-type negotiation
-  const char *accept = getenv( "HTTP_ACCEPT" );
+  const char *accept = param( "HTTP_ACCEPT" );
   if ( accept )
   {
     setHeader( QStringLiteral( "Accept" ), accept );
@@ -141,11 +147,19 @@ QByteArray QgsFcgiServerRequest::data() const
   return mData;
 }
 
+const char *QgsFcgiServerRequest::param( const char *name ) const
+{
+  if ( mFcgiRequest )
+    return FCGX_GetParam( name, mFcgiRequest->envp );
+
+  return getenv( name );
+}
+
 // Read post put data
 void QgsFcgiServerRequest::readData()
 {
   // Check if we have CONTENT_LENGTH defined
-  const char *lengthstr = getenv( "CONTENT_LENGTH" );
+  const char *lengthstr = param( "CONTENT_LENGTH" );
   if ( lengthstr )
   {
     bool success = false;
@@ -154,7 +168,7 @@ void QgsFcgiServerRequest::readData()
     // normally passed by any CGI web server and it is implemented only
     // to allow unit tests to inject a request body and simulate a POST
     // request
-    const char *request_body  = getenv( "REQUEST_BODY" );
+    const char *request_body  = param( "REQUEST_BODY" );
     if ( success && request_body )
     {
       QString body( request_body );
@@ -165,7 +179,17 @@ void QgsFcgiServerRequest::readData()
 #ifdef QGISDEBUG
     qDebug() << "fcgi: reading " << lengthstr << " bytes from " << ( request_body ? "REQUEST_BODY" : "stdin" );
 #endif
-    if ( success )
+    if ( success && mFcgiRequest )
+    {
+      if ( length > 0 )
+      {
+        const int offset = mData.size();
+        mData.resize( offset + length );
+        const int read = FCGX_GetStr( mData.data() + offset, length, mFcgiRequest->in );
+        mData.resize( offset + read );
+      }
+    }
+    else if ( success )
     {
       // XXX This not efficient at all  !!
       for ( int i = 0; i < length; ++i )
@@ -220,9 +244,10 @@ void QgsFcgiServerRequest::printRequestInfos( const QUrl &url )
 
   for ( const auto &envVar : envVars )
   {
-    if ( getenv( envVar.toStdString().c_str() ) )
+    const char *value = param( envVar.toStdString().c_str() );
+    if ( value )
     {
-      QgsMessageLog::logMessage( QStringLiteral( "%1: %2" ).arg( envVar ).arg( QString( getenv( envVar.toStdString().c_str() ) ) ), QStringLiteral( "Server" ), Qgis::Info );
+      QgsMessageLog::logMessage( QStringLiteral( "%1: %2" ).arg( envVar ).arg( QString( value ) ), QStringLiteral( "Server" ), Qgis::Info );
     }
   }
 }
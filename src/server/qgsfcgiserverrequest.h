@@ -20,8 +20,10 @@
 #define QGSFCGISERVERREQUEST_H
 
 
+#include "qgis_sip.h"
 #include "qgsserverrequest.h"
 
+struct FCGX_Request;
 
 /**
  * \ingroup server
@@ -32,8 +34,19 @@
 class SERVER_EXPORT QgsFcgiServerRequest: public QgsServerRequest
 {
   public:
+
     QgsFcgiServerRequest();
 
+    /**
+     * Constructor for QgsFcgiServerRequest reading the parameters and the
+     * input stream of a FastCGI \a request accepted with FCGX_Accept_r(),
+     * instead of the environment and standard input set up by FCGI_Accept().
+     * This allows several requests to be accepted concurrently.
+     * The \a request must outlive this object.
+     * \since QGIS 3.16
+     */
+    explicit QgsFcgiServerRequest( FCGX_Request *request ) SIP_SKIP;
+
     QByteArray data() const override;
 
     /**
@@ -44,11 +57,15 @@ class SERVER_EXPORT QgsFcgiServerRequest: public QgsServerRequest
   private:
     void readData();
 
+    // Returns the value of a FastCGI parameter, or NULLPTR if not defined
+    const char *param( const char *name ) const;
+
     // Log request info: print debug infos
     // about the request
     void printRequestInfos( const QUrl &url );
 
 
+    FCGX_Request *mFcgiRequest = nullptr;
     QByteArray mData;
     bool       mHasError = false;
 };
@@ -27,8 +27,9 @@
 // QgsFcgiServerResponse
 //
 
-QgsFcgiServerResponse::QgsFcgiServerResponse( QgsServerRequest::Method method )
+QgsFcgiServerResponse::QgsFcgiServerResponse( QgsServerRequest::Method method, FCGX_Request *request )
   : mMethod( method )
+  , mFcgiRequest( request )
 {
   mBuffer.open( QIODevice::ReadWrite );
   setDefaultHeaders();
@@ -109,12 +110,10 @@ void QgsFcgiServerResponse::flush()
     QMap<QString, QString>::const_iterator it;
     for ( it = mHeaders.constBegin(); it != mHeaders.constEnd(); ++it )
     {
-      fputs( it.key().toUtf8(), FCGI_stdout );
-      fputs( ": ", FCGI_stdout );
-      fputs( it.value().toUtf8(), FCGI_stdout );
-      fputs( "\n", FCGI_stdout );
+      const QByteArray header = QStringLiteral( "%1: %2\n" ).arg( it.key(), it.value() ).toUtf8();
+      writeOutput( header.constData(), header.size() );
     }
-    fputs( "\n", FCGI_stdout );
+    writeOutput( "\n", 1 );
     mHeadersSent = true;
   }
 
@@ -128,11 +127,9 @@ void QgsFcgiServerResponse::flush()
   else if ( mBuffer.bytesAvailable() > 0 )
   {
     QByteArray &ba = mBuffer.buffer();
-    size_t count   = fwrite( ( void * )ba.data(), ba.size(), 1, FCGI_stdout );
+    writeOutput( ba.constData(), ba.size() );
 #ifdef QGISDEBUG
-    qDebug() << QStringLiteral( "Sent %1 blocks of %2 bytes" ).arg( count ).arg( ba.size() );
-#else
-    Q_UNUSED( count )
+    qDebug() << QStringLiteral( "Sent %1 bytes" ).arg( ba.size() );
 #endif
     // Reset the internal buffer
     ba.clear();
@@ -140,6 +137,19 @@ void QgsFcgiServerResponse::flush()
 }
 
 
+void QgsFcgiServerResponse::writeOutput( const char *data, int size )
+{
+  if ( mFcgiRequest )
+  {
+    FCGX_PutStr( data, size, mFcgiRequest->out );
+  }
+  else
+  {
+    fwrite( data, size, 1, FCGI_stdout );
+  }
+}
+
+
 void QgsFcgiServerResponse::clear()
 {
   mHeaders.clear();
@@ -27,6 +27,8 @@
 
 #include <QBuffer>
 
+struct FCGX_Request;
+
 /**
  * \ingroup server
  * \class QgsFcgiServerResponse
@@ -40,8 +42,11 @@ class SERVER_EXPORT QgsFcgiServerResponse: public QgsServerResponse
     /**
      * Constructor for QgsFcgiServerResponse.
      * \param method The HTTP method (Get by default)
+     * \param request The FastCGI request accepted with FCGX_Accept_r() to write
+     * the response to, or NULLPTR to write to the standard output set up by FCGI_Accept().
+     * The \a request must outlive this object. (since QGIS 3.16)
      */
-    QgsFcgiServerResponse( QgsServerRequest::Method method = QgsServerRequest::GetMethod );
+    QgsFcgiServerResponse( QgsServerRequest::Method method = QgsServerRequest::GetMethod, FCGX_Request *request = nullptr );
 
     void setHeader( const QString &key, const QString &value ) override;
 
@@ -82,7 +87,11 @@ class SERVER_EXPORT QgsFcgiServerResponse: public QgsServerResponse
     bool mFinished    = false;
     bool mHeadersSent = false;
     QgsServerRequest::Method mMethod;
+    FCGX_Request *mFcgiRequest = nullptr;
     int mStatusCode = 0;
+
+    // Writes raw data to the FastCGI output stream
+    void writeOutput( const char *data, int size );
 };
 
 #endif
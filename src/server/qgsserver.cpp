@@ -30,6 +30,7 @@
 #include "qgslogger.h"
 #include "qgsmapserviceexception.h"
 #include "qgsnetworkaccessmanager.h"
+#include "qgsserverlayerpool.h"
 #include "qgsserverlogger.h"
 #include "qgsserverrequest.h"
 #include "qgsfilterresponsedecorator.h"
@@ -43,6 +44,9 @@
 #include <QNetworkDiskCache>
 #include <QSettings>
 #include <QElapsedTimer>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
 
 // TODO: remove, it's only needed by a single debug message
 #include <fcgi_stdio.h>
@@ -64,6 +68,65 @@ QgsServiceRegistry *QgsServer::sServiceRegistry = nullptr;
 
 Q_GLOBAL_STATIC( QgsServerSettings, sSettings );
 
+///@cond PRIVATE
+
+/**
+ * Sets the current project instance for a request and keeps it until the
+ * request is finished.
+ *
+ * The requests handled concurrently by the FastCGI worker threads may use
+ * different projects, while QgsProject::instance() is global. The current
+ * instance is only switched once the requests using the previous one are
+ * finished, requests for the current project running concurrently. Requests
+ * for the current project arriving while a switch is pending wait for it, so
+ * that requests for other projects are not starved.
+ */
+class QgsServerProjectInstanceLocker
+{
+  public:
+
+    explicit QgsServerProjectInstanceLocker( const QgsProject *project )
+    {
+      QMutexLocker locker( &sMutex );
+      if ( sActiveRequests == 0 || sCurrent != project || sPendingSwitches > 0 )
+      {
+        sPendingSwitches++;
+        while ( sActiveRequests > 0 )
+          sFinished.wait( &sMutex );
+        sPendingSwitches--;
+
+        if ( sCurrent != project || sActiveRequests == 0 )
+        {
+          QgsProject::setInstance( const_cast<QgsProject *>( project ) );
+          sCurrent = project;
+        }
+      }
+      sActiveRequests++;
+    }
+
+    ~QgsServerProjectInstanceLocker()
+    {
+      QMutexLocker locker( &sMutex );
+      if ( --sActiveRequests == 0 )
+        sFinished.wakeAll();
+    }
+
+  private:
+    static QMutex sMutex;
+    static QWaitCondition sFinished;
+    static const QgsProject *sCurrent;
+    static int sActiveRequests;
+    static int sPendingSwitches;
+};
+
+QMutex QgsServerProjectInstanceLocker::sMutex;
+QWaitCondition QgsServerProjectInstanceLocker::sFinished;
+const QgsProject *QgsServerProjectInstanceLocker::sCurrent = nullptr;
+int QgsServerProjectInstanceLocker::sActiveRequests = 0;
+int QgsServerProjectInstanceLocker::sPendingSwitches = 0;
+
+///@endcond
+
 QgsServer::QgsServer()
 {
   // QgsApplication must exist
@@ -141,10 +204,12 @@ QString QgsServer::configPath( const QString &defaultConfigPath, const QString &
   {
     if ( configPath.isEmpty() )
     {
-      // Read it from the environment, because a rewrite rule may have rewritten it
-      if ( getenv( "QGIS_PROJECT_FILE" ) )
+      // Read it from the environment, because a rewrite rule may have rewritten it.
+      // The environment of the request is used by the FastCGI worker threads.
+      const QString projectFileEnv = sServerInterface->getEnv( QStringLiteral( "QGIS_PROJECT_FILE" ) );
+      if ( !projectFileEnv.isEmpty() )
       {
-        cfPath = getenv( "QGIS_PROJECT_FILE" );
+        cfPath = projectFileEnv;
         QgsMessageLog::logMessage( QStringLiteral( "Using configuration file path from environment: %1" ).arg( cfPath ), QStringLiteral( "Server" ), Qgis::Info );
       }
       else  if ( ! defaultConfigPath.isEmpty() )
@@ -299,13 +364,21 @@ void QgsServer::handleRequest( QgsServerRequest &request, QgsServerResponse &res
   Qgis::MessageLevel logLevel = QgsServerLogger::instance()->logLevel();
   QElapsedTimer time; //used for measuring request time if loglevel < 1
 
-  qApp->processEvents();
+  // the events of the caches (e.g. watched files) are delivered by the main
+  // thread, the FastCGI worker threads have no event loop
+  if ( QThread::currentThread() == qApp->thread() )
+    qApp->processEvents();
 
   if ( logLevel == Qgis::Info )
   {
     time.start();
   }
 
+  // the cached project used by the request and the current project instance
+  // are kept until the request is finished
+  std::shared_ptr<const QgsProject> projectReference;
+  std::unique_ptr<QgsServerProjectInstanceLocker> projectInstance;
+
   response.clear();
 
   // Pass the filters to the requestHandler, this is needed for the following reasons:
@@ -370,17 +443,21 @@ void QgsServer::handleRequest( QgsServerRequest &request, QgsServerResponse &res
         QString configFilePath = configPath( *sConfigFilePath, params.map() );
 
         // load the project if needed and not empty
-        project = mConfigCache->project( configFilePath, sServerInterface->serverSettings() );
+        projectReference = mConfigCache->sharedProject( configFilePath, sServerInterface->serverSettings() );
+        project = projectReference.get();
       }
 
       // Set the current project instance
-      QgsProject::setInstance( const_cast<QgsProject *>( project ) );
+      projectInstance = qgis::make_unique<QgsServerProjectInstanceLocker>( project );
 
       if ( project )
       {
         sServerInterface->setConfigFilePath( project->fileName() );
       }
 
+      // the copies of the layers used by the previous requests of this thread are reset
+      QgsServerLayerPool::startRequest( *sServerInterface->serverSettings() );
+
       // Dispatcher: if SERVICE is set, we assume a OWS service, if not, let's try an API
       // TODO: QGIS 4 fix the OWS services and treat them as APIs
       QgsServerApi *api = nullptr;
@@ -449,6 +526,8 @@ void QgsServer::handleRequest( QgsServerRequest &request, QgsServerResponse &res
   // to a deleted request handler from Python bindings
   sServerInterface->clearRequestHandler();
 
+  projectInstance.reset();
+
   if ( logLevel == Qgis::Info )
   {
     QgsMessageLog::logMessage( "Request finished in " + QString::number( time.elapsed() ) + " ms", QStringLiteral( "Server" ), Qgis::Info );
@@ -26,7 +26,6 @@ QgsServerInterfaceImpl::QgsServerInterfaceImpl( QgsCapabilitiesCache *capCache,
   , mServiceRegistry( srvRegistry )
   , mServerSettings( settings )
 {
-  mRequestHandler = nullptr;
 #ifdef HAVE_SERVER_PYTHON_PLUGINS
   mAccessControls = new QgsAccessControl();
   mCacheManager = new QgsServerCacheManager();
@@ -35,9 +34,27 @@ QgsServerInterfaceImpl::QgsServerInterfaceImpl( QgsCapabilitiesCache *capCache,
 
 QString QgsServerInterfaceImpl::getEnv( const QString &name ) const
 {
+  const RequestState &state = mRequestStates.localData();
+  if ( state.hasEnvironment )
+    return state.environment.value( name );
+
   return getenv( name.toLocal8Bit() );
 }
 
+void QgsServerInterfaceImpl::setRequestEnvironment( const QMap<QString, QString> &environment )
+{
+  RequestState &state = mRequestStates.localData();
+  state.environment = environment;
+  state.hasEnvironment = true;
+}
+
+void QgsServerInterfaceImpl::clearRequestEnvironment()
+{
+  RequestState &state = mRequestStates.localData();
+  state.environment.clear();
+  state.hasEnvironment = false;
+}
+
 
 QgsServerInterfaceImpl::~QgsServerInterfaceImpl()
 {
@@ -50,17 +67,17 @@ QgsServerInterfaceImpl::~QgsServerInterfaceImpl()
 
 void QgsServerInterfaceImpl::clearRequestHandler()
 {
-  mRequestHandler = nullptr;
+  mRequestStates.localData().requestHandler = nullptr;
 }
 
 void QgsServerInterfaceImpl::setRequestHandler( QgsRequestHandler *requestHandler )
 {
-  mRequestHandler = requestHandler;
+  mRequestStates.localData().requestHandler = requestHandler;
 }
 
 void QgsServerInterfaceImpl::setConfigFilePath( const QString &configFilePath )
 {
-  mConfigFilePath = configFilePath;
+  mRequestStates.localData().configFilePath = configFilePath;
 }
 
 void QgsServerInterfaceImpl::registerFilter( QgsServerFilter *filter, int priority )
@@ -26,10 +26,17 @@
 #include "qgscapabilitiescache.h"
 #include "qgsservercachemanager.h"
 
+#include <QMap>
+#include <QThreadStorage>
+
 /**
  * \ingroup server
  * \class QgsServerInterfaceImpl
  * \brief Interfaces exposed by QGIS Server and made available to plugins.
+ *
+ * The state of the request being handled (request handler, configuration
+ * file path and environment) is kept per thread, so that the FastCGI worker
+ * threads of qgis_mapserv can handle requests concurrently.
  * \since QGIS 2.8
  */
 class SERVER_EXPORT QgsServerInterfaceImpl : public QgsServerInterface
@@ -48,7 +55,7 @@ class SERVER_EXPORT QgsServerInterfaceImpl : public QgsServerInterface
     void clearRequestHandler() override;
     QgsCapabilitiesCache *capabilitiesCache() override { return mCapabilitiesCache; }
     //! Returns the QgsRequestHandler, to be used only in server plugins
-    QgsRequestHandler  *requestHandler() override { return mRequestHandler; }
+    QgsRequestHandler  *requestHandler() override { return mRequestStates.localData().requestHandler; }
     void registerFilter( QgsServerFilter *filter, int priority = 0 ) override;
     QgsServerFiltersMap filters() override { return mFilters; }
 
@@ -78,8 +85,26 @@ class SERVER_EXPORT QgsServerInterfaceImpl : public QgsServerInterface
     QgsServerCacheManager *cacheManager() const override;
 
     QString getEnv( const QString &name ) const override;
-    QString configFilePath() override { return mConfigFilePath; }
+    QString configFilePath() override { return mRequestStates.localData().configFilePath; }
     void setConfigFilePath( const QString &configFilePath ) override;
+
+    /**
+     * Sets the \a environment of the request handled by the current thread,
+     * which is then returned by getEnv() instead of the process environment.
+     * This is used for FastCGI requests accepted with FCGX_Accept_r(), whose
+     * parameters are not set into the process environment.
+     * \see clearRequestEnvironment()
+     * \since QGIS 3.16
+     */
+    void setRequestEnvironment( const QMap<QString, QString> &environment );
+
+    /**
+     * Clears the environment of the request handled by the current thread,
+     * getEnv() then returns the process environment again.
+     * \see setRequestEnvironment()
+     * \since QGIS 3.16
+     */
+    void clearRequestEnvironment();
     void setFilters( QgsServerFiltersMap *filters ) override;
     void removeConfigCacheEntry( const QString &path ) override;
 
@@ -89,12 +114,20 @@ class SERVER_EXPORT QgsServerInterfaceImpl : public QgsServerInterface
 
   private:
 
-    QString mConfigFilePath;
+    //! State of the request handled by a thread
+    struct RequestState
+    {
+      QgsRequestHandler *requestHandler = nullptr;
+      QString configFilePath;
+      QMap<QString, QString> environment;
+      bool hasEnvironment = false;
+    };
+
+    mutable QThreadStorage<RequestState> mRequestStates;
     QgsServerFiltersMap mFilters;
     QgsAccessControl *mAccessControls = nullptr;
     QgsServerCacheManager *mCacheManager = nullptr;
     QgsCapabilitiesCache *mCapabilitiesCache = nullptr;
-    QgsRequestHandler *mRequestHandler = nullptr;
     QgsServiceRegistry *mServiceRegistry = nullptr;
     QgsServerSettings *mServerSettings = nullptr;
 };
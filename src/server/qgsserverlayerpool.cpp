@@ -0,0 +1,182 @@
+/***************************************************************************
+                          qgsserverlayerpool.cpp
+                          ----------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsserverlayerpool.h"
+#include "qgsmaplayerstylemanager.h"
+#include "qgsmessagelog.h"
+#include "qgsproject.h"
+#include "qgsrasterlayer.h"
+#include "qgsrasterrenderer.h"
+#include "qgsreadwritecontext.h"
+#include "qgsserverexception.h"
+#include "qgsserversettings.h"
+#include "qgsvectordataprovider.h"
+#include "qgsvectorlayer.h"
+
+#include <QDomDocument>
+#include <QThreadStorage>
+#include <memory>
+
+bool QgsServerLayerPool::isEnabled( const QgsServerSettings &settings )
+{
+  return settings.fcgiWorkers() > 0;
+}
+
+QgsServerLayerPool::~QgsServerLayerPool()
+{
+  qDeleteAll( mLayers );
+}
+
+QgsMapLayer *QgsServerLayerPool::layer( const QgsServerSettings &settings, const QgsProject *project, QgsMapLayer *layer )
+{
+  if ( !layer || !isEnabled( settings ) )
+    return layer;
+
+  switch ( layer->type() )
+  {
+    case QgsMapLayerType::VectorLayer:
+    case QgsMapLayerType::RasterLayer:
+      break;
+
+    // the styles, filters and selection of the requests only apply to
+    // vector and raster layers, the other layers are shared
+    case QgsMapLayerType::MeshLayer:
+    case QgsMapLayerType::VectorTileLayer:
+    case QgsMapLayerType::PluginLayer:
+    case QgsMapLayerType::AnnotationLayer:
+      return layer;
+  }
+
+  QgsServerLayerPool *pool = threadPool();
+
+  // the copies of the layers of the previous project are of no use anymore
+  if ( pool->mProject != project )
+  {
+    qDeleteAll( pool->mLayers );
+    pool->mLayers.clear();
+    pool->mResetLayers.clear();
+    pool->mProject = const_cast<QgsProject *>( project );
+  }
+
+  QgsMapLayer *copy = pool->mLayers.value( layer->id() );
+  if ( !copy )
+  {
+    copy = copyLayer( project, layer );
+    if ( !copy )
+    {
+      throw QgsServerException( QStringLiteral( "Layer %1 cannot be copied for the request" ).arg( layer->name() ) );
+    }
+    pool->mLayers.insert( layer->id(), copy );
+  }
+
+  // the copy is reset once per request, the request may use it several times
+  if ( !pool->mResetLayers.contains( layer->id() ) )
+  {
+    resetLayer( copy, layer );
+    pool->mResetLayers.insert( layer->id() );
+  }
+  return copy;
+}
+
+void QgsServerLayerPool::startRequest( const QgsServerSettings &settings )
+{
+  if ( !isEnabled( settings ) )
+    return;
+
+  threadPool()->mResetLayers.clear();
+}
+
+void QgsServerLayerPool::clear()
+{
+  QgsServerLayerPool *pool = threadPool();
+  qDeleteAll( pool->mLayers );
+  pool->mLayers.clear();
+  pool->mResetLayers.clear();
+  pool->mProject.clear();
+}
+
+QgsServerLayerPool *QgsServerLayerPool::threadPool()
+{
+  static QThreadStorage<QgsServerLayerPool *> sPools;
+  if ( !sPools.hasLocalData() )
+    sPools.setLocalData( new QgsServerLayerPool() );
+  return sPools.localData();
+}
+
+QgsMapLayer *QgsServerLayerPool::copyLayer( const QgsProject *project, const QgsMapLayer *layer )
+{
+  // the copy is read from the XML of the layer as in the project, so that
+  // it keeps the identifier, the styles and the joins of the layer
+  std::unique_ptr<QgsMapLayer> copy;
+  if ( layer->type() == QgsMapLayerType::VectorLayer )
+    copy.reset( new QgsVectorLayer() );
+  else
+    copy.reset( new QgsRasterLayer() );
+
+  QgsReadWriteContext context;
+  context.setPathResolver( project->pathResolver() );
+  context.setTransformContext( project->transformContext() );
+
+  QDomDocument document;
+  QDomElement element = document.createElement( QStringLiteral( "maplayer" ) );
+  if ( !layer->writeLayerXml( element, document, context ) || !copy->readLayerXml( element, context ) )
+  {
+    QgsMessageLog::logMessage( QStringLiteral( "Layer %1 cannot be copied for the request" ).arg( layer->id() ),
+                               QStringLiteral( "Server" ), Qgis::Critical );
+    return nullptr;
+  }
+
+  copy->resolveReferences( const_cast<QgsProject *>( project ) );
+
+  // e.g. the features of memory layers are not stored in the XML
+  const QgsVectorLayer *vl = qobject_cast<const QgsVectorLayer *>( layer );
+  QgsVectorLayer *vlCopy = qobject_cast<QgsVectorLayer *>( copy.get() );
+  if ( vl && vl->dataProvider() && vlCopy->dataProvider() )
+  {
+    vlCopy->dataProvider()->handlePostCloneOperations( const_cast<QgsVectorDataProvider *>( vl->dataProvider() ) );
+  }
+
+  return copy.release();
+}
+
+void QgsServerLayerPool::resetLayer( QgsMapLayer *copy, const QgsMapLayer *layer )
+{
+  copy->setName( layer->name() );
+  copy->styleManager()->setCurrentStyle( layer->styleManager()->currentStyle() );
+
+  QgsVectorLayer *vlCopy = qobject_cast<QgsVectorLayer *>( copy );
+  if ( vlCopy )
+  {
+    const QgsVectorLayer *vl = qobject_cast<const QgsVectorLayer *>( layer );
+
+    // the edits of a failed transaction are dropped
+    if ( vlCopy->isEditable() )
+      vlCopy->rollBack();
+
+    if ( vlCopy->subsetString() != vl->subsetString() )
+      vlCopy->setSubsetString( vl->subsetString() );
+    vlCopy->setOpacity( vl->opacity() );
+    vlCopy->selectByIds( vl->selectedFeatureIds() );
+  }
+
+  QgsRasterLayer *rlCopy = qobject_cast<QgsRasterLayer *>( copy );
+  if ( rlCopy && rlCopy->renderer() )
+  {
+    const QgsRasterLayer *rl = qobject_cast<const QgsRasterLayer *>( layer );
+    if ( rl->renderer() )
+      rlCopy->renderer()->setOpacity( rl->renderer()->opacity() );
+  }
+}
@@ -0,0 +1,102 @@
+/***************************************************************************
+                          qgsserverlayerpool.h
+                          --------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSSERVERLAYERPOOL_H
+#define QGSSERVERLAYERPOOL_H
+
+#define SIP_NO_FILE
+
+#include "qgis_server.h"
+
+#include <QHash>
+#include <QPointer>
+#include <QSet>
+#include <QString>
+
+class QgsMapLayer;
+class QgsProject;
+class QgsServerSettings;
+
+/**
+ * \ingroup server
+ * \class QgsServerLayerPool
+ * \brief Copies of the layers of the cached projects, used by the requests
+ * handled concurrently.
+ *
+ * When the server handles requests concurrently (see QgsServerSettings::fcgiWorkers()),
+ * the cached projects are shared by the worker threads. The requests which change
+ * their layers (styles, opacity, filters, selection, edits...) then use copies of
+ * them, which belong to the thread handling the request.
+ *
+ * Each thread keeps the copies of the layers of its last project and reuses them
+ * for its next requests, so that their data providers are only created once per
+ * thread. A copy is reset to the state of the layer of the project the first time
+ * a request uses it, and the requests restore the layers they change as they do
+ * with the layers of the project when requests are not concurrent.
+ *
+ * \since QGIS 3.16
+ */
+class SERVER_EXPORT QgsServerLayerPool
+{
+  public:
+
+    //! Returns TRUE if the requests handled with \a settings use copies of the layers
+    static bool isEnabled( const QgsServerSettings &settings );
+
+    /**
+     * Returns the layer to use instead of the \a layer of \a project for the request
+     * handled by the calling thread, i.e. \a layer itself when the pool is not enabled
+     * by \a settings, or the copy of \a layer owned by the thread otherwise.
+     *
+     * Layers whose type is never changed by the requests (e.g. mesh layers) are not
+     * copied. A copy is valid until the thread uses the layers of another project.
+     *
+     * \throws QgsServerException if the layer cannot be copied, the request must not
+     * fall back to the shared layer
+     */
+    static QgsMapLayer *layer( const QgsServerSettings &settings, const QgsProject *project, QgsMapLayer *layer );
+
+    /**
+     * Starts a new request handled by the calling thread, whose copies of the
+     * layers are reset again when the request uses them.
+     */
+    static void startRequest( const QgsServerSettings &settings );
+
+    //! Deletes the copies of the layers owned by the calling thread
+    static void clear();
+
+    ~QgsServerLayerPool();
+
+  private:
+
+    QgsServerLayerPool() = default;
+
+    //! Returns the pool of the calling thread
+    static QgsServerLayerPool *threadPool();
+
+    //! Returns a new copy of the \a layer of \a project, or NULLPTR on errors
+    static QgsMapLayer *copyLayer( const QgsProject *project, const QgsMapLayer *layer );
+
+    //! Resets the \a copy to the state of \a layer
+    static void resetLayer( QgsMapLayer *copy, const QgsMapLayer *layer );
+
+    QPointer<QgsProject> mProject;
+    //! Copies of the layers of the project by layer id
+    QHash<QString, QgsMapLayer *> mLayers;
+    //! Ids of the layers whose copy is reset for the current request
+    QSet<QString> mResetLayers;
+};
+
+#endif // QGSSERVERLAYERPOOL_H
@@ -28,6 +28,8 @@
 #include "qgsserverapiutils.h"
 #include "qgsserverresponse.h"
 #include "qgsserverinterface.h"
+#include "qgsserverprojectutils.h"
+#include "qgsserverlayerpool.h"
 
 #include "nlohmann/json.hpp"
 #include "inja/inja.hpp"
@@ -545,7 +547,15 @@ QgsVectorLayer *QgsServerOgcApiHandler::layerFromCollectionId( const QgsServerAp
   {
     throw QgsServerApiNotFoundError( QStringLiteral( "Collection with given id (%1) was not found or multiple matches were found" ).arg( collectionId ) );
   }
-  return mapLayers.first();
+  // the provider is created on demand with lazy layer loading
+  QgsVectorLayer *mapLayer { mapLayers.first() };
+  QgsServerProjectUtils::resolveLayers( { mapLayer } );
+  if ( ! mapLayer->dataProvider() )
+  {
+    throw QgsServerApiInternalServerError( QStringLiteral( "Collection with given id (%1) is not valid" ).arg( collectionId ) );
+  }
+  // concurrent requests do not share the filters of their layers
+  return qobject_cast<QgsVectorLayer *>( QgsServerLayerPool::layer( *context.serverInterface()->serverSettings(), context.project(), mapLayer ) );
 }
 
 json QgsServerOgcApiHandler::defaultResponse()
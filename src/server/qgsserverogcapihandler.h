@@ -354,7 +354,11 @@ class SERVER_EXPORT QgsServerOgcApiHandler
 
     /**
      * Returns a vector layer from the \a collectionId in the given \a context.
+     * The data provider of the layer is created if it was not yet, e.g. with lazy layer loading.
+     * When the server handles requests concurrently, the returned layer is the copy of the
+     * layer of the project owned by the thread handling the request.
      * \throws QgsServerApiNotFoundError if the layer could not be found.
+     * \throws QgsServerApiInternalServerError if the layer has no data provider.
      */
     static QgsVectorLayer *layerFromCollectionId( const QgsServerApiContext &context, const QString &collectionId );
 
@@ -17,6 +17,9 @@
 
 #include "qgsserverprojectutils.h"
 #include "qgsproject.h"
+#include "qgsmessagelog.h"
+
+#include <QMutex>
 
 double  QgsServerProjectUtils::ceilWithPrecision( double number, int places )
 {
@@ -373,3 +376,29 @@ QString QgsServerProjectUtils::wmtsServiceUrl( const QgsProject &project )
 {
   return project.readEntry( QStringLiteral( "WMTSUrl" ), QStringLiteral( "/" ), "" );
 }
+
+void QgsServerProjectUtils::resolveLayers( const QList<QgsMapLayer *> &layers )
+{
+  // the layers of a cached project are shared by the requests handled
+  // concurrently by the FastCGI worker threads
+  static QMutex sMutex;
+  QMutexLocker locker( &sMutex );
+
+  for ( QgsMapLayer *layer : layers )
+  {
+    // layers read without resolving their data source have no provider
+    if ( !layer || layer->isValid() || layer->dataProvider() || layer->source().isEmpty() )
+    {
+      continue;
+    }
+
+    const QgsDataProvider::ProviderOptions options { layer->transformContext() };
+    layer->setDataSource( layer->source(), layer->name(), layer->providerType(), options );
+
+    if ( !layer->isValid() )
+    {
+      QgsMessageLog::logMessage( QStringLiteral( "Layer %1 is not valid" ).arg( layer->id() ),
+                                 QStringLiteral( "Server" ), Qgis::Warning );
+    }
+  }
+}
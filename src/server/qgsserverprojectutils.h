@@ -25,6 +25,7 @@
 #include "qgis_server.h"
 #include "qgis_sip.h"
 
+class QgsMapLayer;
 class QgsProject;
 class QgsRectangle;
 
@@ -398,6 +399,16 @@ namespace QgsServerProjectUtils
    * \since QGIS 3.4
    */
   SERVER_EXPORT QString wmtsServiceUrl( const QgsProject &project );
+
+  /**
+   * Creates the data providers of the \a layers which were read without
+   * resolving their data source, i.e. when the projects are read with
+   * QgsServerSettings::lazyLayerLoading() enabled. Layers which are
+   * already resolved are left untouched.
+   * \param layers the layers used by a request
+   * \since QGIS 3.16
+   */
+  SERVER_EXPORT void resolveLayers( const QList<QgsMapLayer *> &layers );
 };
 
 #endif
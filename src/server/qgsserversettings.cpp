@@ -265,6 +265,138 @@ void QgsServerSettings::initSettings()
                                          };
 
   mSettings[ sProjectsPgConnections.envVar ] = sProjectsPgConnections;
+
+  // label cache size
+  const Setting sLabelCacheSize = { QgsServerSettingsEnv::QGIS_SERVER_LABEL_CACHE_SIZE,
+                                    QgsServerSettingsEnv::DEFAULT_VALUE,
+                                    QStringLiteral( "Maximum size in kilobytes of the metatile label images cached for tiled requests, 0 disables the cache" ),
+                                    QStringLiteral( "/qgis/server_label_cache_size" ),
+                                    QVariant::Int,
+                                    QVariant( 0 ),
+                                    QVariant()
+                                  };
+
+  mSettings[ sLabelCacheSize.envVar ] = sLabelCacheSize;
+
+  // label metatile size
+  const Setting sLabelMetatileSize = { QgsServerSettingsEnv::QGIS_SERVER_LABEL_METATILE_SIZE,
+                                       QgsServerSettingsEnv::DEFAULT_VALUE,
+                                       QStringLiteral( "Number of tiles per side of the metatiles used for labeling tiled requests" ),
+                                       QStringLiteral( "/qgis/server_label_metatile_size" ),
+                                       QVariant::Int,
+                                       QVariant( 4 ),
+                                       QVariant()
+                                     };
+
+  mSettings[ sLabelMetatileSize.envVar ] = sLabelMetatileSize;
+
+  // label metatile buffer
+  const Setting sLabelMetatileBuffer = { QgsServerSettingsEnv::QGIS_SERVER_LABEL_METATILE_BUFFER,
+                                         QgsServerSettingsEnv::DEFAULT_VALUE,
+                                         QStringLiteral( "Buffer in pixels around the metatiles used for labeling tiled requests" ),
+                                         QStringLiteral( "/qgis/server_label_metatile_buffer" ),
+                                         QVariant::Int,
+                                         QVariant( 64 ),
+                                         QVariant()
+                                       };
+
+  mSettings[ sLabelMetatileBuffer.envVar ] = sLabelMetatileBuffer;
+
+  // fcgi worker threads
+  const Setting sFcgiWorkers = { QgsServerSettingsEnv::QGIS_SERVER_FCGI_WORKERS,
+                                 QgsServerSettingsEnv::DEFAULT_VALUE,
+                                 QStringLiteral( "Number of threads accepting FastCGI requests, 0 to accept requests one at a time" ),
+                                 QStringLiteral( "/qgis/server_fcgi_workers" ),
+                                 QVariant::Int,
+                                 QVariant( 0 ),
+                                 QVariant()
+                               };
+
+  mSettings[ sFcgiWorkers.envVar ] = sFcgiWorkers;
+
+  // project snapshots directory
+  const Setting sProjectSnapshotDirectory = { QgsServerSettingsEnv::QGIS_SERVER_PROJECT_SNAPSHOT_DIRECTORY,
+                                              QgsServerSettingsEnv::DEFAULT_VALUE,
+                                              QStringLiteral( "Directory where project snapshots built ahead of time are stored" ),
+                                              QStringLiteral( "/qgis/server_project_snapshot_directory" ),
+                                              QVariant::String,
+                                              QVariant( "" ),
+                                              QVariant()
+                                            };
+
+  mSettings[ sProjectSnapshotDirectory.envVar ] = sProjectSnapshotDirectory;
+
+  // lazy layer loading
+  const Setting sLazyLayerLoading = { QgsServerSettingsEnv::QGIS_SERVER_LAZY_LAYER_LOADING,
+                                      QgsServerSettingsEnv::DEFAULT_VALUE,
+                                      QStringLiteral( "Create the layer providers only when a request uses the layers" ),
+                                      QStringLiteral( "/qgis/server_lazy_layer_loading" ),
+                                      QVariant::Bool,
+                                      QVariant( false ),
+                                      QVariant()
+                                    };
+
+  mSettings[ sLazyLayerLoading.envVar ] = sLazyLayerLoading;
+
+  // tile cache size
+  const Setting sTileCacheSize = { QgsServerSettingsEnv::QGIS_SERVER_TILE_CACHE_SIZE,
+                                   QgsServerSettingsEnv::DEFAULT_VALUE,
+                                   QStringLiteral( "Maximum size in bytes of the WMTS tiles kept in memory" ),
+                                   QStringLiteral( "/qgis/server_tile_cache_size" ),
+                                   QVariant::Int,
+                                   QVariant( 0 ),
+                                   QVariant()
+                                 };
+
+  mSettings[ sTileCacheSize.envVar ] = sTileCacheSize;
+
+  // tile cache directory
+  const Setting sTileCacheDirectory = { QgsServerSettingsEnv::QGIS_SERVER_TILE_CACHE_DIRECTORY,
+                                        QgsServerSettingsEnv::DEFAULT_VALUE,
+                                        QStringLiteral( "Directory where WMTS tiles are cached" ),
+                                        QStringLiteral( "/qgis/server_tile_cache_directory" ),
+                                        QVariant::String,
+                                        QVariant( "" ),
+                                        QVariant()
+                                      };
+
+  mSettings[ sTileCacheDirectory.envVar ] = sTileCacheDirectory;
+
+  // tile cache expiry
+  const Setting sTileCacheExpiry = { QgsServerSettingsEnv::QGIS_SERVER_TILE_CACHE_EXPIRY,
+                                     QgsServerSettingsEnv::DEFAULT_VALUE,
+                                     QStringLiteral( "Period in seconds after which the cached WMTS tiles are rendered again" ),
+                                     QStringLiteral( "/qgis/server_tile_cache_expiry" ),
+                                     QVariant::Int,
+                                     QVariant( 0 ),
+                                     QVariant()
+                                   };
+
+  mSettings[ sTileCacheExpiry.envVar ] = sTileCacheExpiry;
+
+  // WMTS metatile size
+  const Setting sWmtsMetatileSize = { QgsServerSettingsEnv::QGIS_SERVER_WMTS_METATILE_SIZE,
+                                      QgsServerSettingsEnv::DEFAULT_VALUE,
+                                      QStringLiteral( "Number of tiles per side of the metatiles rendered for cached WMTS tiles, ignored if the tile cache is disabled" ),
+                                      QStringLiteral( "/qgis/server_wmts_metatile_size" ),
+                                      QVariant::Int,
+                                      QVariant( 1 ),
+                                      QVariant()
+                                    };
+
+  mSettings[ sWmtsMetatileSize.envVar ] = sWmtsMetatileSize;
+
+  // WMTS metatile buffer
+  const Setting sWmtsMetatileBuffer = { QgsServerSettingsEnv::QGIS_SERVER_WMTS_METATILE_BUFFER,
+                                        QgsServerSettingsEnv::DEFAULT_VALUE,
+                                        QStringLiteral( "Default buffer in pixels around the metatiles rendered for cached WMTS tiles" ),
+                                        QStringLiteral( "/qgis/server_wmts_metatile_buffer" ),
+                                        QVariant::Int,
+                                        QVariant( 64 ),
+                                        QVariant()
+                                      };
+
+  mSettings[ sWmtsMetatileBuffer.envVar ] = sWmtsMetatileBuffer;
 }
 
 void QgsServerSettings::load()
@@ -406,6 +538,12 @@ void QgsServerSettings::logSummary() const
     const QString msg = "Ini file used to initialize settings: " + iniFile();
     QgsMessageLog::logMessage( msg, "Server", Qgis::Info );
   }
+
+  // metatiles are only rendered to fill the tile cache
+  if ( wmtsMetatileSize() > 1 && tileCacheSize() <= 0 && tileCacheDirectory().isEmpty() )
+  {
+    QgsMessageLog::logMessage( QStringLiteral( "QGIS_SERVER_WMTS_METATILE_SIZE is ignored as the tile cache is disabled, set QGIS_SERVER_TILE_CACHE_SIZE or QGIS_SERVER_TILE_CACHE_DIRECTORY to enable it" ), "Server", Qgis::Warning );
+  }
 }
 
 // getter
@@ -513,3 +651,58 @@ bool QgsServerSettings::getPrintDisabled() const
 {
   return value( QgsServerSettingsEnv::QGIS_SERVER_DISABLE_GETPRINT ).toBool();
 }
+
+int QgsServerSettings::labelCacheSize() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_LABEL_CACHE_SIZE ).toInt();
+}
+
+int QgsServerSettings::labelMetatileSize() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_LABEL_METATILE_SIZE ).toInt();
+}
+
+int QgsServerSettings::labelMetatileBuffer() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_LABEL_METATILE_BUFFER ).toInt();
+}
+
+int QgsServerSettings::fcgiWorkers() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_FCGI_WORKERS ).toInt();
+}
+
+QString QgsServerSettings::projectSnapshotDirectory() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_PROJECT_SNAPSHOT_DIRECTORY ).toString();
+}
+
+bool QgsServerSettings::lazyLayerLoading() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_LAZY_LAYER_LOADING ).toBool();
+}
+
+int QgsServerSettings::tileCacheSize() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_TILE_CACHE_SIZE ).toInt();
+}
+
+QString QgsServerSettings::tileCacheDirectory() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_TILE_CACHE_DIRECTORY ).toString();
+}
+
+int QgsServerSettings::tileCacheExpiry() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_TILE_CACHE_EXPIRY ).toInt();
+}
+
+int QgsServerSettings::wmtsMetatileSize() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_WMTS_METATILE_SIZE ).toInt();
+}
+
+int QgsServerSettings::wmtsMetatileBuffer() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_WMTS_METATILE_BUFFER ).toInt();
+}
@@ -70,7 +70,18 @@ class SERVER_EXPORT QgsServerSettingsEnv : public QObject
       QGIS_SERVER_TRUST_LAYER_METADATA, //!< Trust layer metadata. Improves project read time. (since QGIS 3.16).
       QGIS_SERVER_DISABLE_GETPRINT, //!< Disabled WMS GetPrint request and don't load layouts. Improves project read time. (since QGIS 3.16).
       QGIS_SERVER_LANDING_PAGE_PROJECTS_DIRECTORIES, //!< Directories used by the landing page service to find .qgs and .qgz projects (since QGIS 3.16)
-      QGIS_SERVER_LANDING_PAGE_PROJECTS_PG_CONNECTIONS //!< PostgreSQL connection strings used by the landing page service to find projects (since QGIS 3.16)
+      QGIS_SERVER_LANDING_PAGE_PROJECTS_PG_CONNECTIONS, //!< PostgreSQL connection strings used by the landing page service to find projects (since QGIS 3.16)
+      QGIS_SERVER_LABEL_CACHE_SIZE, //!< Maximum size in kilobytes of the metatile label images kept in memory for tiled requests, 0 disables the cache (since QGIS 3.16)
+      QGIS_SERVER_LABEL_METATILE_SIZE, //!< Number of tiles per side of the metatiles used for labeling tiled requests (since QGIS 3.16)
+      QGIS_SERVER_LABEL_METATILE_BUFFER, //!< Buffer in pixels around the metatiles used for labeling tiled requests (since QGIS 3.16)
+      QGIS_SERVER_FCGI_WORKERS, //!< Number of threads accepting FastCGI requests in a single qgis_mapserv process (since QGIS 3.16)
+      QGIS_SERVER_PROJECT_SNAPSHOT_DIRECTORY, //!< Directory where project snapshots are stored by qgis_server_warmup and loaded from (since QGIS 3.16)
+      QGIS_SERVER_LAZY_LAYER_LOADING, //!< Defer the creation of layer data providers until a request uses the layer (since QGIS 3.16)
+      QGIS_SERVER_TILE_CACHE_SIZE, //!< Maximum size in bytes of the WMTS tiles kept in memory, 0 disables the memory cache (since QGIS 3.16)
+      QGIS_SERVER_TILE_CACHE_DIRECTORY, //!< Directory where WMTS tiles are cached, an empty string disables the disk cache (since QGIS 3.16)
+      QGIS_SERVER_WMTS_METATILE_SIZE, //!< Number of tiles per side of the metatiles rendered for cached WMTS tiles, ignored if the tile cache is disabled (since QGIS 3.16)
+      QGIS_SERVER_WMTS_METATILE_BUFFER, //!< Default buffer in pixels around the metatiles rendered for cached WMTS tiles (since QGIS 3.16)
+      QGIS_SERVER_TILE_CACHE_EXPIRY //!< Period in seconds after which the cached WMTS tiles are rendered again, 0 to never expire them (since QGIS 3.16)
     };
     Q_ENUM( EnvVar )
 };
@@ -273,6 +284,159 @@ class SERVER_EXPORT QgsServerSettings
      */
     bool getPrintDisabled() const;
 
+    /**
+     * Returns the maximum size in kilobytes of the metatile label images kept
+     * in memory for tiled WMS/WMTS requests. Labels of tiles belonging to the
+     * same metatile are then placed once and shared between these tiles.
+     *
+     * The default value is 0 (cache disabled), this value can be changed by
+     * setting the environment variable QGIS_SERVER_LABEL_CACHE_SIZE.
+     *
+     * \see labelMetatileSize()
+     * \since QGIS 3.16
+     */
+    int labelCacheSize() const;
+
+    /**
+     * Returns the number of tiles per side of the metatiles used to place
+     * labels of tiled WMS/WMTS requests when the label cache is enabled.
+     *
+     * The default value is 4, this value can be changed by setting the
+     * environment variable QGIS_SERVER_LABEL_METATILE_SIZE.
+     *
+     * \see labelCacheSize()
+     * \see labelMetatileBuffer()
+     * \since QGIS 3.16
+     */
+    int labelMetatileSize() const;
+
+    /**
+     * Returns the buffer in pixels around the metatiles used to place labels
+     * of tiled WMS/WMTS requests. Labels of features lying in the buffer are
+     * placed too, so that labels crossing the metatile edges are not cut.
+     *
+     * The default value is 64, this value can be changed by setting the
+     * environment variable QGIS_SERVER_LABEL_METATILE_BUFFER.
+     *
+     * \see labelMetatileSize()
+     * \since QGIS 3.16
+     */
+    int labelMetatileBuffer() const;
+
+    /**
+     * Returns the number of worker threads accepting FastCGI requests in a
+     * single qgis_mapserv process. Each worker accepts its own requests and
+     * handles them concurrently with the other workers, sharing the project
+     * cache of the process. The requests of all services (WMS, WFS, WFS-T
+     * and OGC API) use copies of the layers owned by their worker thread, so
+     * that concurrent requests do not share their styles, filters and edits.
+     *
+     * The default value is 0 (requests are accepted one at a time), this
+     * value can be changed by setting the environment variable
+     * QGIS_SERVER_FCGI_WORKERS.
+     *
+     * \since QGIS 3.16
+     */
+    int fcgiWorkers() const;
+
+    /**
+     * Returns the directory where project snapshots are stored. A snapshot
+     * is a flat copy of a project, with absolute layer paths and up to date
+     * layer metadata, built ahead of time with the qgis_server_warmup tool.
+     * When a snapshot is up to date with the project file and the local
+     * files of its layer data sources, it is loaded instead of the project
+     * while trusting its layer metadata.
+     *
+     * The default value is an empty string (snapshots disabled), this value
+     * can be changed by setting the environment variable
+     * QGIS_SERVER_PROJECT_SNAPSHOT_DIRECTORY.
+     *
+     * \since QGIS 3.16
+     */
+    QString projectSnapshotDirectory() const;
+
+    /**
+     * Returns TRUE if the data providers of the layers are only created when
+     * a request uses the layers. Projects are then read without resolving
+     * their layers, and with trusted layer metadata so that capabilities
+     * documents are answered from the metadata stored in the project. This
+     * reduces the read time and the memory of projects with many layers.
+     *
+     * The default value is FALSE, this value can be changed by setting the
+     * environment variable QGIS_SERVER_LAZY_LAYER_LOADING.
+     *
+     * \since QGIS 3.16
+     */
+    bool lazyLayerLoading() const;
+
+    /**
+     * Returns the maximum size in bytes of the WMTS tiles kept in memory by
+     * the server tile cache.
+     *
+     * The default value is 0 (memory cache disabled), this value can be
+     * changed by setting the environment variable QGIS_SERVER_TILE_CACHE_SIZE.
+     *
+     * \see tileCacheDirectory()
+     * \since QGIS 3.16
+     */
+    int tileCacheSize() const;
+
+    /**
+     * Returns the directory where the server tile cache stores WMTS tiles,
+     * in one MBTiles file per project, layer, style, format and tile matrix set.
+     *
+     * The default value is an empty string (disk cache disabled), this value
+     * can be changed by setting the environment variable
+     * QGIS_SERVER_TILE_CACHE_DIRECTORY.
+     *
+     * \see tileCacheSize()
+     * \since QGIS 3.16
+     */
+    QString tileCacheDirectory() const;
+
+    /**
+     * Returns the period in seconds after which the tiles of the server tile
+     * cache expire. All the tiles cached during a period are rendered again
+     * once it is over, so that tiles of layers from databases or web services,
+     * which have no modification time, are renewed. Tiles of layers from local
+     * files are already renewed when the files are modified.
+     *
+     * The default value is 0 (tiles never expire), this value can be changed
+     * by setting the environment variable QGIS_SERVER_TILE_CACHE_EXPIRY.
+     *
+     * \see tileCacheDirectory()
+     * \since QGIS 3.16
+     */
+    int tileCacheExpiry() const;
+
+    /**
+     * Returns the number of tiles per side of the metatiles rendered for
+     * WMTS GetTile requests. All the tiles of a metatile are rendered at
+     * once and stored in the server tile cache, so metatiling is only used
+     * when the tile cache is enabled.
+     *
+     * The default value is 1 (metatiling disabled), this value can be
+     * changed by setting the environment variable QGIS_SERVER_WMTS_METATILE_SIZE.
+     *
+     * \see wmtsMetatileBuffer()
+     * \since QGIS 3.16
+     */
+    int wmtsMetatileSize() const;
+
+    /**
+     * Returns the default buffer in pixels rendered around WMTS metatiles,
+     * avoiding symbols and labels to be clipped on metatile edges. The buffer
+     * can be overridden by layer or group with the "wmtsMetaBuffer" custom
+     * property.
+     *
+     * The default value is 64, this value can be changed by setting the
+     * environment variable QGIS_SERVER_WMTS_METATILE_BUFFER.
+     *
+     * \see wmtsMetatileSize()
+     * \since QGIS 3.16
+     */
+    int wmtsMetatileBuffer() const;
+
     /**
      * Returns the string representation of a setting.
      * \since QGIS 3.16
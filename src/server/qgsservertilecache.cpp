@@ -0,0 +1,215 @@
+/***************************************************************************
+                          qgsservertilecache.cpp
+                          ----------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsservertilecache.h"
+#include "qgsconfigcache.h"
+#include "qgsmbtiles.h"
+#include "qgsmessagelog.h"
+#include "qgsproject.h"
+#include "qgsserversettings.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+QgsServerTileCache *QgsServerTileCache::instance()
+{
+  static QgsServerTileCache sInstance;
+  return &sInstance;
+}
+
+bool QgsServerTileCache::isEnabled( const QgsServerSettings &settings )
+{
+  return settings.tileCacheSize() > 0 || !settings.tileCacheDirectory().isEmpty();
+}
+
+QByteArray QgsServerTileCache::tile( const QgsProject *project, const QString &tileSet, int zoom, int row, int column, const QgsServerSettings &settings )
+{
+  QMutexLocker locker( &mMutex );
+  const QString version = projectVersion( project, settings );
+  const QString setKey = version + '\n' + tileSet;
+  const QString key = QStringLiteral( "%1/%2/%3/%4" ).arg( setKey ).arg( zoom ).arg( row ).arg( column );
+
+  if ( const QByteArray *data = mTiles.object( key ) )
+  {
+    return *data;
+  }
+
+  QgsMbTiles *file = tileSetFile( project, version, setKey, settings );
+  if ( !file )
+  {
+    return QByteArray();
+  }
+
+  // rows are stored as WMTS rows, not as flipped TMS rows
+  const QByteArray data = file->tileData( zoom, column, row );
+  if ( !data.isEmpty() && settings.tileCacheSize() > 0 )
+  {
+    mTiles.setMaxCost( settings.tileCacheSize() );
+    mTiles.insert( key, new QByteArray( data ), data.size() );
+  }
+  return data;
+}
+
+void QgsServerTileCache::insertTile( const QgsProject *project, const QString &tileSet, int zoom, int row, int column, const QByteArray &data, const QgsServerSettings &settings )
+{
+  if ( data.isEmpty() )
+  {
+    return;
+  }
+
+  QMutexLocker locker( &mMutex );
+  const QString version = projectVersion( project, settings );
+  const QString setKey = version + '\n' + tileSet;
+  const QString key = QStringLiteral( "%1/%2/%3/%4" ).arg( setKey ).arg( zoom ).arg( row ).arg( column );
+
+  if ( settings.tileCacheSize() > 0 )
+  {
+    mTiles.setMaxCost( settings.tileCacheSize() );
+    mTiles.insert( key, new QByteArray( data ), data.size() );
+  }
+
+  if ( QgsMbTiles *file = tileSetFile( project, version, setKey, settings ) )
+  {
+    // e.g. the file stayed locked by another server process
+    if ( !file->setTileData( zoom, column, row, data ) && file->tileData( zoom, column, row ).isEmpty() )
+    {
+      QgsMessageLog::logMessage( QStringLiteral( "Unable to store the tile %1/%2/%3 in the tile cache" ).arg( zoom ).arg( row ).arg( column ),
+                                 QStringLiteral( "Server" ), Qgis::Warning );
+    }
+  }
+}
+
+void QgsServerTileCache::removeProject( const QString &path )
+{
+  QMutexLocker locker( &mMutex );
+
+  const QString prefix = path + '\n';
+  const QStringList keys = mTiles.keys();
+  for ( const QString &key : keys )
+  {
+    if ( key.startsWith( prefix ) )
+    {
+      mTiles.remove( key );
+    }
+  }
+
+  // the files may still be used by other server processes, they are only closed
+  for ( auto it = mFiles.begin(); it != mFiles.end(); )
+  {
+    if ( it.key().startsWith( prefix ) )
+      it = mFiles.erase( it );
+    else
+      ++it;
+  }
+
+  for ( auto it = mDataSourceFiles.begin(); it != mDataSourceFiles.end(); )
+  {
+    if ( it.key().startsWith( prefix ) )
+      it = mDataSourceFiles.erase( it );
+    else
+      ++it;
+  }
+}
+
+void QgsServerTileCache::clear()
+{
+  QMutexLocker locker( &mMutex );
+  mTiles.clear();
+}
+
+QString QgsServerTileCache::projectVersion( const QgsProject *project, const QgsServerSettings &settings )
+{
+  // the modification times make tiles of a modified project or data source
+  // unreachable, even if they were cached by another server process
+  const QString projectKey = QStringLiteral( "%1\n%2" ).arg( project->fileName(),
+                             project->lastModified().toString( Qt::ISODateWithMs ) );
+
+  // the layers of a project file do not change, only their files are checked again
+  auto files = mDataSourceFiles.constFind( projectKey );
+  if ( files == mDataSourceFiles.constEnd() )
+  {
+    const QString prefix = project->fileName() + '\n';
+    for ( auto it = mDataSourceFiles.begin(); it != mDataSourceFiles.end(); )
+    {
+      if ( it.key().startsWith( prefix ) )
+        it = mDataSourceFiles.erase( it );
+      else
+        ++it;
+    }
+    files = mDataSourceFiles.insert( projectKey, QgsConfigCache::projectDataSourceFiles( *project ) );
+  }
+
+  QString version = projectKey + '\n' + QString::fromLatin1( QCryptographicHash::hash( QgsConfigCache::projectSnapshotKey( files.value() ), QCryptographicHash::Sha1 ).toHex() );
+
+  // data from databases and web services is only renewed by expiring the tiles,
+  // all of them at once at the end of each period
+  const int expiry = settings.tileCacheExpiry();
+  if ( expiry > 0 )
+    version += '\n' + QString::number( QDateTime::currentSecsSinceEpoch() / expiry );
+
+  return version;
+}
+
+QgsMbTiles *QgsServerTileCache::tileSetFile( const QgsProject *project, const QString &version, const QString &tileSetKey, const QgsServerSettings &settings )
+{
+  const QString directory = settings.tileCacheDirectory();
+  if ( directory.isEmpty() )
+  {
+    return nullptr;
+  }
+
+  const QString fileKey = tileSetKey + '\n' + directory;
+  if ( mFiles.contains( fileKey ) )
+  {
+    return mFiles.value( fileKey ).get();
+  }
+
+  // one directory per project, so that its tiles are easily found
+  const QByteArray projectHash = QCryptographicHash::hash( project->fileName().toUtf8(), QCryptographicHash::Sha1 ).toHex();
+  const QByteArray tileSetHash = QCryptographicHash::hash( tileSetKey.toUtf8(), QCryptographicHash::Sha1 ).toHex();
+  const QString projectDirectory = QDir( directory ).filePath( QString::fromLatin1( projectHash ) );
+  const QString fileName = QDir( projectDirectory ).filePath( QStringLiteral( "%1.mbtiles" ).arg( QString::fromLatin1( tileSetHash ) ) );
+
+  // the files of the previous versions of the project are not used anymore
+  const QString prefix = project->fileName() + '\n';
+  for ( auto it = mFiles.begin(); it != mFiles.end(); )
+  {
+    if ( it.key().startsWith( prefix ) && !it.key().startsWith( version + '\n' ) )
+      it = mFiles.erase( it );
+    else
+      ++it;
+  }
+
+  std::shared_ptr<QgsMbTiles> file;
+  if ( QDir().mkpath( projectDirectory ) )
+  {
+    file = std::make_shared<QgsMbTiles>( fileName );
+    const bool opened = QFileInfo::exists( fileName ) ? file->open( false ) : file->create();
+    if ( !opened )
+    {
+      QgsMessageLog::logMessage( QStringLiteral( "Unable to open the tile cache file %1" ).arg( fileName ),
+                                 QStringLiteral( "Server" ), Qgis::Warning );
+      file.reset();
+    }
+  }
+
+  // failures are not retried for each tile
+  mFiles.insert( fileKey, file );
+  return file.get();
+}
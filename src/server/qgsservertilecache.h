@@ -0,0 +1,112 @@
+/***************************************************************************
+                          qgsservertilecache.h
+                          --------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSSERVERTILECACHE_H
+#define QGSSERVERTILECACHE_H
+
+#define SIP_NO_FILE
+
+#include "qgis_server.h"
+
+#include <QByteArray>
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <memory>
+
+class QgsMbTiles;
+class QgsProject;
+class QgsServerSettings;
+
+/**
+ * \ingroup server
+ * \class QgsServerTileCache
+ * \brief Built-in cache of the tiles rendered by the server.
+ *
+ * Tiles are cached in two tiers:
+ *
+ * - in memory, with a least recently used policy bounded by QgsServerSettings::tileCacheSize()
+ * - on disk, in the directory given by QgsServerSettings::tileCacheDirectory(), with one
+ *   MBTiles file per project and tile set
+ *
+ * A tile set identifies the tiles rendered the same way, e.g. the same layer, style,
+ * format and tile matrix set for WMTS. Tiles of a project are invalidated when the
+ * project file or one of the local files of its layer data sources (e.g. shapefiles,
+ * GeoPackages) is modified. Data from databases and web services has no modification
+ * time: their tiles are only renewed when they expire, see
+ * QgsServerSettings::tileCacheExpiry(), tiles never expire by default.
+ *
+ * The disk tier may be shared by several server processes, so the server never
+ * deletes its files: the tile sets of a modified project are stored in new files
+ * and the outdated ones are left to the administrator, e.g. by clearing the
+ * directory when deploying projects.
+ *
+ * \note This class is thread safe.
+ * \since QGIS 3.16
+ */
+class SERVER_EXPORT QgsServerTileCache
+{
+  public:
+
+    //! Returns the unique instance
+    static QgsServerTileCache *instance();
+
+    //! Returns TRUE if at least one tier of the cache is enabled by \a settings
+    static bool isEnabled( const QgsServerSettings &settings );
+
+    /**
+     * Returns the tile at \a zoom, \a row and \a column of the tile set \a tileSet
+     * of the \a project, or an empty array if the tile is not cached.
+     */
+    QByteArray tile( const QgsProject *project, const QString &tileSet, int zoom, int row, int column, const QgsServerSettings &settings );
+
+    /**
+     * Stores the \a data of the tile at \a zoom, \a row and \a column of the tile
+     * set \a tileSet of the \a project.
+     */
+    void insertTile( const QgsProject *project, const QString &tileSet, int zoom, int row, int column, const QByteArray &data, const QgsServerSettings &settings );
+
+    /**
+     * Removes all the tiles of the project stored at \a path from the memory
+     * tier and closes its files of the disk tier, which are kept as other
+     * server processes may still use them.
+     */
+    void removeProject( const QString &path );
+
+    //! Removes all the tiles from the memory tier
+    void clear();
+
+  private:
+    QgsServerTileCache() = default;
+
+    /**
+     * Returns the version of the tiles of the project, changing with the project file,
+     * the local files of its data sources and the expiry period of the tiles.
+     */
+    QString projectVersion( const QgsProject *project, const QgsServerSettings &settings );
+
+    //! Returns the MBTiles file storing the tile set, NULLPTR if the disk tier is disabled
+    QgsMbTiles *tileSetFile( const QgsProject *project, const QString &version, const QString &tileSetKey, const QgsServerSettings &settings );
+
+    QMutex mMutex;
+    QCache<QString, QByteArray> mTiles;
+    QHash<QString, std::shared_ptr<QgsMbTiles>> mFiles;
+
+    //! Local data source files of the projects, by project file and modification time
+    QHash<QString, QStringList> mDataSourceFiles;
+};
+
+#endif // QGSSERVERTILECACHE_H
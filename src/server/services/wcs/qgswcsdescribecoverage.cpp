@@ -142,6 +142,7 @@ namespace QgsWcs
 
       if ( coveNameList.size() == 0 || coveNameList.contains( name ) )
       {
+        QgsServerProjectUtils::resolveLayers( { layer } );
         QgsRasterLayer *rLayer = qobject_cast<QgsRasterLayer *>( layer );
         coveDescElement.appendChild( getCoverageOffering( doc, const_cast<QgsRasterLayer *>( rLayer ), project ) );
       }
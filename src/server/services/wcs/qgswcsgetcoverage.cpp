@@ -105,6 +105,7 @@ namespace QgsWcs
 
       if ( name == coveName )
       {
+        QgsServerProjectUtils::resolveLayers( { layer } );
         rLayer = qobject_cast<QgsRasterLayer *>( layer );
         break;
       }
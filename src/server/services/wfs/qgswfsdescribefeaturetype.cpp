@@ -165,6 +165,7 @@ namespace QgsWfs
         }
       }
 #endif
+      QgsServerProjectUtils::resolveLayers( { layer } );
       QgsVectorLayer *vLayer = qobject_cast<QgsVectorLayer *>( layer );
       QgsVectorDataProvider *provider = vLayer->dataProvider();
       if ( !provider )
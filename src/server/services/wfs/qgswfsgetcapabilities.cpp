@@ -546,8 +546,10 @@ namespace QgsWfs
            wfstDeleteLayersId.contains( layer->id() ) )
       {
         QgsVectorLayer *vlayer = qobject_cast<QgsVectorLayer *>( layer );
+        // the provider is created on demand with lazy layer loading
+        QgsServerProjectUtils::resolveLayers( { vlayer } );
         QgsVectorDataProvider *provider = vlayer->dataProvider();
-        if ( ( provider->capabilities() & QgsVectorDataProvider::AddFeatures ) && wfstInsertLayersId.contains( layer->id() ) )
+        if ( provider && ( provider->capabilities() & QgsVectorDataProvider::AddFeatures ) && wfstInsertLayersId.contains( layer->id() ) )
         {
           //wfs:Insert element
           QDomElement operationElement = doc.createElement( QStringLiteral( "Operation" ) );
@@ -556,7 +558,7 @@ namespace QgsWfs
           operationsElement.appendChild( operationElement );
         }
 
-        if ( ( provider->capabilities() & QgsVectorDataProvider::ChangeAttributeValues ) &&
+        if ( provider && ( provider->capabilities() & QgsVectorDataProvider::ChangeAttributeValues ) &&
              ( provider->capabilities() & QgsVectorDataProvider::ChangeGeometries ) &&
              wfstUpdateLayersId.contains( layer->id() ) )
         {
@@ -567,7 +569,7 @@ namespace QgsWfs
           operationsElement.appendChild( operationElement );
         }
 
-        if ( ( provider->capabilities() & QgsVectorDataProvider::DeleteFeatures ) && wfstDeleteLayersId.contains( layer->id() ) )
+        if ( provider && ( provider->capabilities() & QgsVectorDataProvider::DeleteFeatures ) && wfstDeleteLayersId.contains( layer->id() ) )
         {
           //wfs:Delete element
           QDomElement operationElement = doc.createElement( QStringLiteral( "Operation" ) );
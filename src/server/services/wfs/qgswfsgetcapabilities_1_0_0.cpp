@@ -400,14 +400,16 @@ namespace QgsWfs
              wfstDeleteLayersId.contains( layer->id() ) )
         {
           QgsVectorLayer *vlayer = qobject_cast<QgsVectorLayer *>( layer );
+          // the provider is created on demand with lazy layer loading
+          QgsServerProjectUtils::resolveLayers( { vlayer } );
           QgsVectorDataProvider *provider = vlayer->dataProvider();
-          if ( ( provider->capabilities() & QgsVectorDataProvider::AddFeatures ) && wfstInsertLayersId.contains( layer->id() ) )
+          if ( provider && ( provider->capabilities() & QgsVectorDataProvider::AddFeatures ) && wfstInsertLayersId.contains( layer->id() ) )
           {
             //wfs:Insert element
             QDomElement insertElement = doc.createElement( QStringLiteral( "Insert" )/*wfs:Insert*/ );
             operationsElement.appendChild( insertElement );
           }
-          if ( ( provider->capabilities() & QgsVectorDataProvider::ChangeAttributeValues ) &&
+          if ( provider && ( provider->capabilities() & QgsVectorDataProvider::ChangeAttributeValues ) &&
                ( provider->capabilities() & QgsVectorDataProvider::ChangeGeometries ) &&
                wfstUpdateLayersId.contains( layer->id() ) )
           {
@@ -415,7 +417,7 @@ namespace QgsWfs
             QDomElement updateElement = doc.createElement( QStringLiteral( "Update" )/*wfs:Update*/ );
             operationsElement.appendChild( updateElement );
           }
-          if ( ( provider->capabilities() & QgsVectorDataProvider::DeleteFeatures ) && wfstDeleteLayersId.contains( layer->id() ) )
+          if ( provider && ( provider->capabilities() & QgsVectorDataProvider::DeleteFeatures ) && wfstDeleteLayersId.contains( layer->id() ) )
           {
             //wfs:Delete element
             QDomElement deleteElement = doc.createElement( QStringLiteral( "Delete" )/*wfs:Delete*/ );
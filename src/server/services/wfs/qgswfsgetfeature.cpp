@@ -21,6 +21,7 @@
  ***************************************************************************/
 #include "qgswfsutils.h"
 #include "qgsserverprojectutils.h"
+#include "qgsserverlayerpool.h"
 #include "qgsserverfeatureid.h"
 #include "qgsfields.h"
 #include "qgsdatetimefieldformatter.h"
@@ -61,15 +62,24 @@ namespace QgsWfs
       const QgsCoordinateReferenceSystem &outputCrs;
 
       bool forceGeomToMulti;
+
+      //! Transformation from crs to outputCrs, created once for all the features of the layer
+      const QgsCoordinateTransform &transform;
+
+      //! Name of the element of each field of the layer, by field index
+      const QStringList &fieldElementNames;
+
+      //! Editor widget setup of each field of the layer, by field index
+      const QVector<QgsEditorWidgetSetup> &fieldSetups;
     };
 
     QString createFeatureGeoJSON( const QgsFeature &feature, const createFeatureParams &params, const QgsAttributeList &pkAttributes );
 
     QString encodeValueToText( const QVariant &value, const QgsEditorWidgetSetup &setup );
 
-    QDomElement createFeatureGML2( const QgsFeature &feature, QDomDocument &doc, const createFeatureParams &params, const QgsProject *project, const QgsAttributeList &pkAttributes );
+    QDomElement createFeatureGML2( const QgsFeature &feature, QDomDocument &doc, const createFeatureParams &params, const QgsAttributeList &pkAttributes );
 
-    QDomElement createFeatureGML3( const QgsFeature &feature, QDomDocument &doc, const createFeatureParams &params, const QgsProject *project, const QgsAttributeList &pkAttributes );
+    QDomElement createFeatureGML3( const QgsFeature &feature, QDomDocument &doc, const createFeatureParams &params, const QgsAttributeList &pkAttributes );
 
     void hitGetFeature( const QgsServerRequest &request, QgsServerResponse &response, const QgsProject *project,
                         QgsWfsParameters::Format format, int numberOfFeatures, const QStringList &typeNames );
@@ -79,7 +89,9 @@ namespace QgsWfs
                           QgsRectangle *rect, const QStringList &typeNames );
 
     void setGetFeature( QgsServerResponse &response, QgsWfsParameters::Format format, const QgsFeature &feature, int featIdx,
-                        const createFeatureParams &params, const QgsProject *project, const QgsAttributeList &pkAttributes = QgsAttributeList() );
+                        const createFeatureParams &params, const QgsAttributeList &pkAttributes = QgsAttributeList() );
+
+    void flushGetFeature( QgsServerResponse &response );
 
     void endGetFeature( QgsServerResponse &response, QgsWfsParameters::Format format );
 
@@ -87,6 +99,15 @@ namespace QgsWfs
     QgsWfsParameters mWfsParameters;
     /* GeoJSON Exporter */
     QgsJsonExporter mJsonExporter;
+
+    /* Features written but not yet sent to the response */
+    QByteArray mFeatureBuffer;
+    int mBufferedFeatures = 0;
+
+    //! Number of features sent to the response at once
+    const int FLUSH_FEATURE_COUNT = 100;
+    //! Size in bytes of the buffered features above which they are sent to the response
+    const int FLUSH_BUFFER_SIZE = 1024 * 1024;
   }
 
   void writeGetFeature( QgsServerInterface *serverIface, const QgsProject *project,
@@ -98,6 +119,8 @@ namespace QgsWfs
     mRequestParameters = request.parameters();
     mWfsParameters = QgsWfsParameters( QUrlQuery( request.url() ) );
     mWfsParameters.dump();
+    mFeatureBuffer.resize( 0 );
+    mBufferedFeatures = 0;
     getFeatureRequest aRequest;
 
     QDomDocument doc;
@@ -150,6 +173,9 @@ namespace QgsWfs
 
       if ( typeNameList.contains( name ) )
       {
+        QgsServerProjectUtils::resolveLayers( { layer } );
+        // concurrent requests do not share the filters of their layers
+        layer = QgsServerLayerPool::layer( *serverIface->serverSettings(), project, layer );
         // store layers
         mapLayerMap[name] = layer;
         // update request metadata
@@ -423,6 +449,26 @@ namespace QgsWfs
       }
       else
       {
+        // what does not depend on the feature is computed once for the layer
+        const QgsCoordinateTransform transform( layerCrs, outputCrs, project );
+        QStringList fieldElementNames;
+        QVector<QgsEditorWidgetSetup> fieldSetups;
+        fieldElementNames.reserve( fields.count() );
+        fieldSetups.reserve( fields.count() );
+        for ( const QgsField &field : qgis::as_const( fields ) )
+        {
+          QString attributeName = field.name();
+          fieldElementNames << "qgs:" + attributeName.replace( ' ', '_' ).replace( cleanTagNameRegExp, QString() );
+          fieldSetups << field.editorWidgetSetup();
+        }
+
+        if ( aRequest.outputFormat == QgsWfsParameters::Format::GeoJSON )
+        {
+          mJsonExporter.setSourceCrs( layerCrs );
+          mJsonExporter.setIncludeAttributes( !attrIndexes.isEmpty() );
+          mJsonExporter.setAttributes( attrIndexes );
+        }
+
         const createFeatureParams cfp = { layerPrecision,
                                           layerCrs,
                                           attrIndexes,
@@ -430,7 +476,10 @@ namespace QgsWfs
                                           withGeom,
                                           geometryName,
                                           outputCrs,
-                                          forceGeomToMulti
+                                          forceGeomToMulti,
+                                          transform,
+                                          fieldElementNames,
+                                          fieldSetups
                                         };
         while ( fit.nextFeature( feature ) && ( aRequest.maxFeatures == -1 || sentFeatures < aRequest.maxFeatures ) )
         {
@@ -439,7 +488,7 @@ namespace QgsWfs
 
           if ( iteratedFeatures >= aRequest.startIndex )
           {
-            setGetFeature( response, aRequest.outputFormat, feature, sentFeatures, cfp, project, provider->pkAttributeIndexes() );
+            setGetFeature( response, aRequest.outputFormat, feature, sentFeatures, cfp, pkAttributes );
             ++sentFeatures;
           }
           ++iteratedFeatures;
@@ -1206,7 +1255,7 @@ namespace QgsWfs
     }
 
     void setGetFeature( QgsServerResponse &response, QgsWfsParameters::Format format, const QgsFeature &feature, int featIdx,
-                        const createFeatureParams &params, const QgsProject *project, const QgsAttributeList &pkAttributes )
+                        const createFeatureParams &params, const QgsAttributeList &pkAttributes )
     {
       if ( !feature.isValid() )
         return;
@@ -1218,14 +1267,11 @@ namespace QgsWfs
           fcString += QLatin1String( "  " );
         else
           fcString += QLatin1String( " ," );
-        mJsonExporter.setSourceCrs( params.crs );
         mJsonExporter.setIncludeGeometry( false );
-        mJsonExporter.setIncludeAttributes( !params.attributeIndexes.isEmpty() );
-        mJsonExporter.setAttributes( params.attributeIndexes );
         fcString += createFeatureGeoJSON( feature, params, pkAttributes );
         fcString += QLatin1String( "\n" );
 
-        response.write( fcString.toUtf8() );
+        mFeatureBuffer += fcString.toUtf8();
       }
       else
       {
@@ -1233,23 +1279,38 @@ namespace QgsWfs
         QDomElement featureElement;
         if ( format == QgsWfsParameters::Format::GML3 )
         {
-          featureElement = createFeatureGML3( feature, gmlDoc, params, project, pkAttributes );
+          featureElement = createFeatureGML3( feature, gmlDoc, params, pkAttributes );
           gmlDoc.appendChild( featureElement );
         }
         else
         {
-          featureElement = createFeatureGML2( feature, gmlDoc, params, project, pkAttributes );
+          featureElement = createFeatureGML2( feature, gmlDoc, params, pkAttributes );
           gmlDoc.appendChild( featureElement );
         }
-        response.write( gmlDoc.toByteArray() );
+        mFeatureBuffer += gmlDoc.toByteArray();
       }
 
-      // Stream partial content
+      // Stream partial content, by groups of features rather than one by one
+      if ( ++mBufferedFeatures >= FLUSH_FEATURE_COUNT || mFeatureBuffer.size() >= FLUSH_BUFFER_SIZE )
+        flushGetFeature( response );
+    }
+
+    void flushGetFeature( QgsServerResponse &response )
+    {
+      if ( mBufferedFeatures == 0 )
+        return;
+
+      response.write( mFeatureBuffer );
       response.flush();
+      // keep the allocated buffer for the next features
+      mFeatureBuffer.resize( 0 );
+      mBufferedFeatures = 0;
     }
 
     void endGetFeature( QgsServerResponse &response, QgsWfsParameters::Format format )
     {
+      flushGetFeature( response );
+
       QString fcString;
       if ( format == QgsWfsParameters::Format::GeoJSON )
       {
@@ -1292,7 +1353,7 @@ namespace QgsWfs
     }
 
 
-    QDomElement createFeatureGML2( const QgsFeature &feature, QDomDocument &doc, const createFeatureParams &params, const QgsProject *project, const QgsAttributeList &pkAttributes )
+    QDomElement createFeatureGML2( const QgsFeature &feature, QDomDocument &doc, const createFeatureParams &params, const QgsAttributeList &pkAttributes )
     {
       //gml:FeatureMember
       QDomElement featureElement = doc.createElement( QStringLiteral( "gml:featureMember" )/*wfs:FeatureMember*/ );
@@ -1309,11 +1370,10 @@ namespace QgsWfs
       {
         int prec = params.precision;
         QgsCoordinateReferenceSystem crs = params.crs;
-        QgsCoordinateTransform mTransform( crs, params.outputCrs, project );
         try
         {
           QgsGeometry transformed = geom;
-          if ( transformed.transform( mTransform ) == 0 )
+          if ( transformed.transform( params.transform ) == 0 )
           {
             geom = transformed;
             crs = params.outputCrs;
@@ -1368,22 +1428,18 @@ namespace QgsWfs
       }
 
       //read all attribute values from the feature
-      QgsAttributes featureAttributes = feature.attributes();
-      QgsFields fields = feature.fields();
+      const QgsAttributes featureAttributes = feature.attributes();
       for ( int i = 0; i < params.attributeIndexes.count(); ++i )
       {
         int idx = params.attributeIndexes[i];
-        if ( idx >= fields.count() )
+        if ( idx >= params.fieldElementNames.count() || idx >= featureAttributes.count() )
         {
           continue;
         }
-        const QgsField field = fields.at( idx );
-        const QgsEditorWidgetSetup setup = field.editorWidgetSetup();
-        QString attributeName = field.name();
 
-        QDomElement fieldElem = doc.createElement( "qgs:" + attributeName.replace( ' ', '_' ).replace( cleanTagNameRegExp, QString() ) );
-        QDomText fieldText = doc.createTextNode( encodeValueToText( featureAttributes[idx], setup ) );
-        if ( featureAttributes[idx].isNull() )
+        QDomElement fieldElem = doc.createElement( params.fieldElementNames.at( idx ) );
+        QDomText fieldText = doc.createTextNode( encodeValueToText( featureAttributes.at( idx ), params.fieldSetups.at( idx ) ) );
+        if ( featureAttributes.at( idx ).isNull() )
         {
           fieldElem.setAttribute( QStringLiteral( "xsi:nil" ), QStringLiteral( "true" ) );
         }
@@ -1394,7 +1450,7 @@ namespace QgsWfs
       return featureElement;
     }
 
-    QDomElement createFeatureGML3( const QgsFeature &feature, QDomDocument &doc, const createFeatureParams &params, const QgsProject *project, const QgsAttributeList &pkAttributes )
+    QDomElement createFeatureGML3( const QgsFeature &feature, QDomDocument &doc, const createFeatureParams &params, const QgsAttributeList &pkAttributes )
     {
       //gml:FeatureMember
       QDomElement featureElement = doc.createElement( QStringLiteral( "gml:featureMember" )/*wfs:FeatureMember*/ );
@@ -1411,11 +1467,10 @@ namespace QgsWfs
       {
         int prec = params.precision;
         QgsCoordinateReferenceSystem crs = params.crs;
-        QgsCoordinateTransform mTransform( crs, params.outputCrs, project );
         try
         {
           QgsGeometry transformed = geom;
-          if ( transformed.transform( mTransform ) == 0 )
+          if ( transformed.transform( params.transform ) == 0 )
           {
             geom = transformed;
             crs = params.outputCrs;
@@ -1470,24 +1525,18 @@ namespace QgsWfs
       }
 
       //read all attribute values from the feature
-      QgsAttributes featureAttributes = feature.attributes();
-      QgsFields fields = feature.fields();
+      const QgsAttributes featureAttributes = feature.attributes();
       for ( int i = 0; i < params.attributeIndexes.count(); ++i )
       {
         int idx = params.attributeIndexes[i];
-        if ( idx >= fields.count() )
+        if ( idx >= params.fieldElementNames.count() || idx >= featureAttributes.count() )
         {
           continue;
         }
 
-        const QgsField field = fields.at( idx );
-        const QgsEditorWidgetSetup setup = field.editorWidgetSetup();
-
-        QString attributeName = field.name();
-
-        QDomElement fieldElem = doc.createElement( "qgs:" + attributeName.replace( ' ', '_' ).replace( cleanTagNameRegExp, QString() ) );
-        QDomText fieldText = doc.createTextNode( encodeValueToText( featureAttributes[idx], setup ) );
-        if ( featureAttributes[idx].isNull() )
+        QDomElement fieldElem = doc.createElement( params.fieldElementNames.at( idx ) );
+        QDomText fieldText = doc.createTextNode( encodeValueToText( featureAttributes.at( idx ), params.fieldSetups.at( idx ) ) );
+        if ( featureAttributes.at( idx ).isNull() )
         {
           fieldElem.setAttribute( QStringLiteral( "xsi:nil" ), QStringLiteral( "true" ) );
         }
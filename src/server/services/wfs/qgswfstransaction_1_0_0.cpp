@@ -23,6 +23,7 @@
 
 #include "qgswfsutils.h"
 #include "qgsserverprojectutils.h"
+#include "qgsserverlayerpool.h"
 #include "qgsserverfeatureid.h"
 #include "qgsfields.h"
 #include "qgsexpression.h"
@@ -265,6 +266,11 @@ namespace QgsWfs
           throw QgsRequestNotWellFormedException( QStringLiteral( "Layer error on '%1'" ).arg( name ) );
         }
 
+        QgsServerProjectUtils::resolveLayers( { vlayer } );
+
+        // concurrent requests do not share the filters and edits of their layers
+        vlayer = qobject_cast<QgsVectorLayer *>( QgsServerLayerPool::layer( *serverIface->serverSettings(), project, vlayer ) );
+
         //get provider
         QgsVectorDataProvider *provider = vlayer->dataProvider();
         if ( !provider )
@@ -94,6 +94,7 @@ namespace QgsWfs
 
       if ( layerTypeName( layer ) == typeName )
       {
+        QgsServerProjectUtils::resolveLayers( { layer } );
         return qobject_cast<QgsVectorLayer *>( layer );
       }
     }
@@ -38,6 +38,8 @@
 #include "qgsaccesscontrol.h"
 #endif
 
+#include <algorithm>
+
 
 QgsWfs3APIHandler::QgsWfs3APIHandler( const QgsServerOgcApi *api ):
   mApi( api )
@@ -199,8 +201,13 @@ json QgsWfs3APIHandler::schema( const QgsServerApiContext &context ) const
 
 void QgsWfs3AbstractItemsHandler::checkLayerIsAccessible( QgsVectorLayer *mapLayer, const QgsServerApiContext &context ) const
 {
+  // the layer may be the copy of a published layer owned by the request
   const QVector<QgsVectorLayer *> publishedLayers = QgsServerApiUtils::publishedWfsLayers<QgsVectorLayer *>( context );
-  if ( ! publishedLayers.contains( mapLayer ) )
+  const bool published = std::any_of( publishedLayers.constBegin(), publishedLayers.constEnd(), [ mapLayer ]( const QgsVectorLayer * layer )
+  {
+    return layer->id() == mapLayer->id();
+  } );
+  if ( ! published )
   {
     throw QgsServerApiNotFoundError( QStringLiteral( "Collection was not found" ) );
   }
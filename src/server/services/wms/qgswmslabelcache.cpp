@@ -0,0 +1,100 @@
+/***************************************************************************
+                              qgswmslabelcache.cpp
+                              --------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgswmslabelcache.h"
+
+#include <QMutexLocker>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace QgsWms
+{
+
+  QgsWmsLabelCache::Metatile QgsWmsLabelCache::metatile( const QgsRectangle &tileExtent, int size )
+  {
+    const double tileWidth = tileExtent.width();
+    const double tileHeight = tileExtent.height();
+
+    // the small epsilon avoids tiles of the same grid to disagree on their
+    // index because of rounding errors in the requested extents
+    const qint64 tileX = static_cast< qint64 >( std::floor( tileExtent.xMinimum() / tileWidth + 1e-6 ) );
+    const qint64 tileY = static_cast< qint64 >( std::floor( tileExtent.yMinimum() / tileHeight + 1e-6 ) );
+    const double offsetX = tileExtent.xMinimum() - tileX * tileWidth;
+    const double offsetY = tileExtent.yMinimum() - tileY * tileHeight;
+
+    const qint64 metaX = static_cast< qint64 >( std::floor( static_cast< double >( tileX ) / size ) );
+    const qint64 metaY = static_cast< qint64 >( std::floor( static_cast< double >( tileY ) / size ) );
+
+    Metatile metatile;
+    metatile.extent = QgsRectangle( offsetX + metaX * size * tileWidth,
+                                    offsetY + metaY * size * tileHeight,
+                                    offsetX + ( metaX + 1 ) * size * tileWidth,
+                                    offsetY + ( metaY + 1 ) * size * tileHeight );
+    metatile.column = static_cast< int >( tileX - metaX * size );
+    metatile.row = static_cast< int >( ( metaY + 1 ) * size - 1 - tileY );
+    metatile.id = QStringLiteral( "%1:%2:%3:%4:%5:%6:%7" ).arg( QString::number( size ),
+                  QString::number( tileWidth, 'g', 8 ),
+                  QString::number( tileHeight, 'g', 8 ),
+                  QString::number( std::round( offsetX / tileWidth * 1e4 ) ),
+                  QString::number( std::round( offsetY / tileHeight * 1e4 ) ),
+                  QString::number( metaX ),
+                  QString::number( metaY ) );
+    return metatile;
+  }
+
+  QgsWmsLabelCache *QgsWmsLabelCache::instance()
+  {
+    static QgsWmsLabelCache sInstance;
+    return &sInstance;
+  }
+
+  QImage QgsWmsLabelCache::labels( const QString &key ) const
+  {
+    QMutexLocker locker( &mMutex );
+    const QImage *image = mImages.object( key );
+    return image ? *image : QImage();
+  }
+
+  void QgsWmsLabelCache::insert( const QString &key, const QImage &image, int maxSize )
+  {
+#if QT_VERSION >= QT_VERSION_CHECK( 5, 10, 0 )
+    const qint64 bytes = image.sizeInBytes();
+#else
+    const qint64 bytes = image.byteCount();
+#endif
+    // the cost of an image is its size in kilobytes, rounded up so that small images still count
+    const int cost = static_cast< int >( std::min< qint64 >( ( bytes + 1023 ) / 1024, std::numeric_limits< int >::max() ) );
+
+    QMutexLocker locker( &mMutex );
+    mImages.setMaxCost( maxSize );
+    // QCache rejects the objects larger than the whole cache
+    mImages.insert( key, new QImage( image ), std::max( cost, 1 ) );
+  }
+
+  int QgsWmsLabelCache::count() const
+  {
+    QMutexLocker locker( &mMutex );
+    return mImages.count();
+  }
+
+  void QgsWmsLabelCache::clear()
+  {
+    QMutexLocker locker( &mMutex );
+    mImages.clear();
+  }
+
+} // namespace QgsWms
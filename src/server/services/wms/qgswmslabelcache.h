@@ -0,0 +1,105 @@
+/***************************************************************************
+                              qgswmslabelcache.h
+                              ------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSWMSLABELCACHE_H
+#define QGSWMSLABELCACHE_H
+
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+
+#include "qgsrectangle.h"
+
+namespace QgsWms
+{
+
+  /**
+   * \ingroup server
+   * \class QgsWms::QgsWmsLabelCache
+   * \brief Cache of the labels rendered for the metatiles of tiled requests.
+   *
+   * Tiled requests are grouped into metatiles made of N x N tiles. The labels of
+   * a whole metatile are placed and rendered once, then each tile of the metatile
+   * draws its own part of the cached label image. Besides avoiding to solve the
+   * labeling problem again for every tile, this guarantees that labels crossing
+   * the tile edges inside a metatile are consistent.
+   *
+   * The cache lives for the whole server process and is shared between requests.
+   * \since QGIS 3.16
+   */
+  class QgsWmsLabelCache
+  {
+    public:
+
+      //! Position of a tile within its metatile
+      struct Metatile
+      {
+        //! Extent of the whole metatile
+        QgsRectangle extent;
+
+        //! Column of the tile in the metatile, from the left
+        int column = 0;
+
+        //! Row of the tile in the metatile, from the top
+        int row = 0;
+
+        //! Identifier of the metatile, unique for a given tile grid
+        QString id;
+      };
+
+      /**
+       * Returns the metatile of \a size x \a size tiles containing the tile
+       * covering \a tileExtent.
+       *
+       * The origin of the tile grid is not known, so the grid is assumed to be
+       * aligned on the tile extent: any tile sharing the same size and the same
+       * offset relative to the multiples of this size belongs to the same grid.
+       */
+      static Metatile metatile( const QgsRectangle &tileExtent, int size );
+
+      //! Returns the cache instance shared by all requests
+      static QgsWmsLabelCache *instance();
+
+      /**
+       * Returns the label image stored for \a key, or a null image if none
+       * is cached.
+       */
+      QImage labels( const QString &key ) const;
+
+      /**
+       * Stores the label \a image for \a key. The least recently used images
+       * are removed to keep the images of the cache within \a maxSize kilobytes.
+       * An image larger than \a maxSize is not cached.
+       */
+      void insert( const QString &key, const QImage &image, int maxSize );
+
+      //! Returns the number of cached images
+      int count() const;
+
+      //! Removes all the cached images
+      void clear();
+
+    private:
+      QgsWmsLabelCache() = default;
+
+      mutable QMutex mMutex;
+      QCache<QString, QImage> mImages;
+  };
+
+} // namespace QgsWms
+
+#endif
@@ -619,6 +619,37 @@ namespace QgsWms
     return loaded;
   }
 
+  QString QgsWmsParameters::cacheKey( const QList<QgsWmsParameter::Name> &excluded ) const
+  {
+    QStringList key;
+
+    const QMap<QString, QString> params = toMap();
+    for ( auto it = params.constBegin(); it != params.constEnd(); ++it )
+    {
+      key << QStringLiteral( "%1=%2" ).arg( it.key(), it.value() );
+    }
+
+    for ( auto it = mWmsParameters.constBegin(); it != mWmsParameters.constEnd(); ++it )
+    {
+      if ( excluded.contains( it.key() ) )
+        continue;
+
+      const QString value = it.value().toString();
+      if ( value.isEmpty() )
+        continue;
+
+      QString name = QgsWmsParameter::name( it.key() );
+      if ( it.value().mId >= 0 )
+      {
+        name = QStringLiteral( "%1:%2" ).arg( QString::number( it.value().mId ), name );
+      }
+
+      key << QStringLiteral( "%1=%2" ).arg( name, value );
+    }
+
+    return key.join( '&' );
+  }
+
   void QgsWmsParameters::dump() const
   {
     log( QStringLiteral( "WMS Request parameters:" ) );
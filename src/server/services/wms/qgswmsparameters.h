@@ -385,6 +385,14 @@ namespace QgsWms
        */
       void dump() const;
 
+      /**
+       * Returns a string identifying the values of all the parameters of the
+       * request, except the \a excluded ones. Two requests with the same key
+       * only differ by the excluded parameters.
+       * \since QGIS 3.16
+       */
+      QString cacheKey( const QList<QgsWmsParameter::Name> &excluded = QList<QgsWmsParameter::Name>() ) const;
+
       /**
        * Returns CRS or an empty string if none is defined.
        * \returns crs parameter as string
@@ -21,6 +21,7 @@
 #include "qgswmsrendercontext.h"
 #include "qgswmsserviceexception.h"
 #include "qgsserverprojectutils.h"
+#include "qgsserverlayerpool.h"
 
 using namespace QgsWms;
 
@@ -49,9 +50,63 @@ void QgsWmsRenderContext::setParameters( const QgsWmsParameters &parameters )
   removeUnwantedLayers();
   checkLayerReadPermissions();
 
+  // only the layers used by the request are resolved with lazy layer loading
+  QgsServerProjectUtils::resolveLayers( mLayersToRender );
+
+  // the cached project is shared by the requests handled concurrently by the
+  // FastCGI worker threads, which must not modify its layers
+  if ( QgsServerLayerPool::isEnabled( settings() ) )
+  {
+    cloneLayersToRender();
+  }
+
   std::reverse( mLayersToRender.begin(), mLayersToRender.end() );
 }
 
+QList<QgsMapLayer *> QgsWmsRenderContext::clonedLayers() const
+{
+  return mClonedLayers;
+}
+
+void QgsWmsRenderContext::cloneLayersToRender()
+{
+  QMap<QgsMapLayer *, QgsMapLayer *> clones;
+  for ( QgsMapLayer *&layer : mLayersToRender )
+  {
+    if ( mExternalLayers.contains( layer ) )
+    {
+      continue;
+    }
+
+    if ( !clones.contains( layer ) )
+    {
+      // the request fails rather than changing the shared layer
+      QgsMapLayer *clone = QgsServerLayerPool::layer( settings(), mProject, layer );
+      clones.insert( layer, clone );
+      if ( clone != layer )
+      {
+        mClonedLayers.append( clone );
+      }
+    }
+
+    layer = clones.value( layer );
+  }
+
+  // the layers are also looked up by nickname and group while rendering
+  for ( auto it = mNicknameLayers.begin(); it != mNicknameLayers.end(); ++it )
+  {
+    it.value() = clones.value( it.value(), it.value() );
+  }
+
+  for ( QList<QgsMapLayer *> &group : mLayerGroups )
+  {
+    for ( QgsMapLayer *&layer : group )
+    {
+      layer = clones.value( layer, layer );
+    }
+  }
+}
+
 void QgsWmsRenderContext::setFlag( const Flag flag, const bool on )
 {
   if ( on )
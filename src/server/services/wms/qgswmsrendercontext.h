@@ -250,6 +250,17 @@ namespace QgsWms
        */
       bool isExternalLayer( const QString &name ) const;
 
+      /**
+       * Returns the layers to render which are copies of the layers of the
+       * project. The layers are copied when the server handles requests
+       * concurrently, so that the settings of a request (styles, filters,
+       * opacity...) are applied to the copies of the layers owned by its
+       * thread instead of the layers of the shared project.
+       * \see QgsServerLayerPool
+       * \since QGIS 3.16
+       */
+      QList<QgsMapLayer *> clonedLayers() const;
+
     private:
       void initNicknameLayers();
       void initRestrictedLayers();
@@ -262,6 +273,8 @@ namespace QgsWms
 
       void checkLayerReadPermissions();
 
+      void cloneLayersToRender();
+
       bool layerScaleVisibility( const QString &name ) const;
 
       const QgsProject *mProject = nullptr;
@@ -286,6 +299,9 @@ namespace QgsWms
 
       // list for external layers
       QList<QgsMapLayer *> mExternalLayers;
+
+      // copies of the project layers to render, owned by the layer pool of the thread
+      QList<QgsMapLayer *> mClonedLayers;
   };
 };
 
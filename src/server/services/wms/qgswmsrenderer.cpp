@@ -57,8 +57,10 @@
 #include "qgsannotation.h"
 #include "qgsvectorlayerlabeling.h"
 #include "qgsvectorlayerfeaturecounter.h"
+#include "qgsvectorlayerutils.h"
 #include "qgspallabeling.h"
 #include "qgswmsrestorer.h"
+#include "qgswmslabelcache.h"
 #include "qgsdxfexport.h"
 #include "qgssymbollayerutils.h"
 #include "qgsserverexception.h"
@@ -655,6 +657,9 @@ namespace QgsWms
         map->setKeepLayerSet( true );
       }
 
+      // locked layers and map themes may use layers which are not requested
+      QgsServerProjectUtils::resolveLayers( map->layersToRender() );
+
       //grid space x / y
       if ( cMapParams.mGridX > 0 && cMapParams.mGridY > 0 )
       {
@@ -811,9 +816,21 @@ namespace QgsWms
     // add layers to map settings
     mapSettings.setLayers( layers );
 
+    // labels of tiled requests may be shared with the other tiles of the metatile
+    const QImage labels = metatileLabels( mapSettings, *image );
+    if ( !labels.isNull() )
+      mapSettings.setFlag( QgsMapSettings::DrawLabeling, false );
+
     // rendering step for layers
     painter.reset( layersRendering( mapSettings, *image ) );
 
+    // labels are drawn on top of the layers
+    if ( !labels.isNull() )
+    {
+      painter->setCompositionMode( QPainter::CompositionMode_SourceOver );
+      painter->drawImage( 0, 0, labels );
+    }
+
     // rendering step for annotations
     annotationsRendering( painter.get() );
 
@@ -2709,6 +2726,86 @@ namespace QgsWms
     return painter;
   }
 
+  QImage QgsRenderer::metatileLabels( const QgsMapSettings &mapSettings, const QImage &image ) const
+  {
+    const int cacheSize = mContext.settings().labelCacheSize();
+    const int metatileSize = mContext.settings().labelMetatileSize();
+    if ( cacheSize <= 0 || metatileSize < 2 || !mWmsParameters.tiledAsBool() )
+      return QImage();
+
+    if ( !mapSettings.testFlag( QgsMapSettings::DrawLabeling ) || !qgsDoubleNear( mapSettings.rotation(), 0.0 ) )
+      return QImage();
+
+    // labels drawn by the symbology of vector tile layers or masking the
+    // symbology of other layers cannot be rendered separately
+    for ( QgsMapLayer *layer : mapSettings.layers() )
+    {
+      if ( layer->type() == QgsMapLayerType::VectorTileLayer )
+        return QImage();
+
+      QgsVectorLayer *vl = qobject_cast<QgsVectorLayer *>( layer );
+      if ( vl && !QgsVectorLayerUtils::labelMasks( vl ).isEmpty() )
+        return QImage();
+    }
+
+    QStringList key;
+#ifdef HAVE_SERVER_PYTHON_PLUGINS
+    // access control plugins may filter features depending on the user
+    if ( !mContext.accessControl()->fillCacheKey( key ) )
+      return QImage();
+#endif
+
+    const QgsWmsLabelCache::Metatile metatile = QgsWmsLabelCache::metatile( mapSettings.extent(), metatileSize );
+
+    // labels are placed on the metatile extent grown by a buffer, so that the
+    // labels of features close to the metatile edges are neither cut nor dropped
+    const int buffer = qMax( 0, mContext.settings().labelMetatileBuffer() );
+    const double bufferX = buffer * mapSettings.extent().width() / image.width();
+    const double bufferY = buffer * mapSettings.extent().height() / image.height();
+    const QgsRectangle labelExtent( metatile.extent.xMinimum() - bufferX, metatile.extent.yMinimum() - bufferY,
+                                    metatile.extent.xMaximum() + bufferX, metatile.extent.yMaximum() + bufferY );
+    const QSize metatileSizePx( image.width() * metatileSize + 2 * buffer, image.height() * metatileSize + 2 * buffer );
+
+    key << mProject->fileName()
+        << mProject->lastModified().toString( Qt::ISODateWithMs )
+        << mWmsParameters.cacheKey( QList<QgsWmsParameter::Name>()
+                                    << QgsWmsParameter::BBOX
+                                    << QgsWmsParameter::WIDTH
+                                    << QgsWmsParameter::HEIGHT )
+        << QString::number( mapSettings.outputDpi() )
+        << QStringLiteral( "%1x%2" ).arg( image.width() ).arg( image.height() )
+        << QString::number( buffer )
+        << metatile.id;
+    const QString cacheKey = key.join( '|' );
+
+    QgsWmsLabelCache *cache = QgsWmsLabelCache::instance();
+    QImage labels = cache->labels( cacheKey );
+    if ( labels.isNull() )
+    {
+      QgsMapSettings labelSettings = mapSettings;
+      labelSettings.setExtent( labelExtent );
+      labelSettings.setOutputSize( metatileSizePx );
+      labelSettings.setBackgroundColor( Qt::transparent );
+      labelSettings.setFlag( QgsMapSettings::SkipSymbolRendering );
+
+      QgsExpressionContext context = mProject->createExpressionContext();
+      context << QgsExpressionContextUtils::mapSettingsScope( labelSettings );
+      labelSettings.setExpressionContext( context );
+
+      labels = QImage( metatileSizePx, QImage::Format_ARGB32_Premultiplied );
+      labels.setDotsPerMeterX( image.dotsPerMeterX() );
+      labels.setDotsPerMeterY( image.dotsPerMeterY() );
+      labels.fill( Qt::transparent );
+
+      std::unique_ptr<QPainter> painter( layersRendering( labelSettings, labels ) );
+      painter->end();
+
+      cache->insert( cacheKey, labels, cacheSize );
+    }
+
+    return labels.copy( buffer + metatile.column * image.width(), buffer + metatile.row * image.height(), image.width(), image.height() );
+  }
+
   void QgsRenderer::setLayerOpacity( QgsMapLayer *layer, int opacity ) const
   {
     if ( opacity >= 0 && opacity <= 255 )
@@ -152,6 +152,16 @@ namespace QgsWms
       // Rendering step for layers
       QPainter *layersRendering( const QgsMapSettings &mapSettings, QImage &image ) const;
 
+      /**
+       * Returns the labels of the tile rendered with \a mapSettings, cropped
+       * from the labels of its whole metatile, which are placed on the metatile
+       * extent grown by the label metatile buffer. The metatile labels are fetched
+       * from the label cache or rendered and stored there.
+       * A null image is returned if the labels cannot be shared between tiles,
+       * in which case they have to be rendered with the layers.
+       */
+      QImage metatileLabels( const QgsMapSettings &mapSettings, const QImage &image ) const;
+
       // Rendering step for annotations
       void annotationsRendering( QPainter *painter ) const;
 
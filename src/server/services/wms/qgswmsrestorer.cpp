@@ -23,6 +23,7 @@
 #include "qgsrasterrenderer.h"
 #include "qgsmaplayerstylemanager.h"
 #include "qgsreadwritecontext.h"
+#include "qgsserverlayerpool.h"
 
 QgsLayerRestorer::QgsLayerRestorer( const QList<QgsMapLayer *> &layers )
 {
@@ -121,8 +122,11 @@ QgsLayerRestorer::~QgsLayerRestorer()
 
 namespace QgsWms
 {
+  // the copies of the layers are reused by the next requests of the thread,
+  // while the layers of a project shared by concurrent requests must not
+  // even be written back
   QgsWmsRestorer::QgsWmsRestorer( const QgsWmsRenderContext &context )
-    : mLayerRestorer( context.layers() )
+    : mLayerRestorer( QgsServerLayerPool::isEnabled( context.settings() ) ? context.clonedLayers() : context.layers() )
   {
   }
 }
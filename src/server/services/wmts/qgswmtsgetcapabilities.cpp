@@ -570,12 +570,12 @@ namespace QgsWmts
           tmElement.appendChild( tmTopLeftCornerElem );
 
           QDomElement tmTileWidthElem = doc.createElement( QStringLiteral( "TileWidth" ) );
-          QDomText tmTileWidthText = doc.createTextNode( QString::number( 256 ) );
+          QDomText tmTileWidthText = doc.createTextNode( QString::number( tm.tileWidth ) );
           tmTileWidthElem.appendChild( tmTileWidthText );
           tmElement.appendChild( tmTileWidthElem );
 
           QDomElement tmTileHeightElem = doc.createElement( QStringLiteral( "TileHeight" ) );
-          QDomText tmTileHeightText = doc.createTextNode( QString::number( 256 ) );
+          QDomText tmTileHeightText = doc.createTextNode( QString::number( tm.tileHeight ) );
           tmTileHeightElem.appendChild( tmTileHeightText );
           tmElement.appendChild( tmTileHeightElem );
 
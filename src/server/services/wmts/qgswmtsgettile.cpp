@@ -17,11 +17,97 @@
 #include "qgswmtsutils.h"
 #include "qgswmtsparameters.h"
 #include "qgswmtsgettile.h"
+#include "qgsservertilecache.h"
+#include "qgsbufferserverresponse.h"
+#include "qgsserverprojectutils.h"
 
+#include <QBuffer>
 #include <QImage>
 
 namespace QgsWmts
 {
+  namespace
+  {
+
+    /**
+     * Returns TRUE if the \a response holds a rendered tile. The status code
+     * of FastCGI responses is 0 until it is explicitly set, which is the
+     * case for errors only.
+     */
+    bool isTileResponse( const QgsServerResponse &response )
+    {
+      const int statusCode = response.statusCode();
+      return ( statusCode == 0 || statusCode == 200 )
+             && response.header( QStringLiteral( "Content-Type" ) ).startsWith( QLatin1String( "image/" ) );
+    }
+
+    /**
+     * Renders the metatile containing the requested tile, stores all its tiles
+     * in the tile cache and writes the requested one to the response.
+     * Returns FALSE if the metatile cannot be rendered.
+     */
+    bool writeMetatile( QgsServerInterface *serverIface, const QgsProject *project, const QgsWmtsParameters &params,
+                        const QString &tileSet, QgsServerResponse &response )
+    {
+      const QgsServerSettings &settings = *serverIface->serverSettings();
+      metatileDef metatile;
+      metatile.size = settings.wmtsMetatileSize();
+      metatile.buffer = settings.wmtsMetatileBuffer();
+      QUrlQuery query = translateWmtsParamToWmsQueryItem( QStringLiteral( "GetMap" ), params, project, serverIface, &metatile );
+
+      // the metatile is rendered losslessly, tiles are encoded afterwards
+      const bool jpeg = params.format() == QgsWmtsParameters::Format::JPG;
+      query.removeAllQueryItems( QgsWmsParameterForWmts::name( QgsWmsParameterForWmts::FORMAT ) );
+      query.addQueryItem( QgsWmsParameterForWmts::name( QgsWmsParameterForWmts::FORMAT ), QStringLiteral( "image/png" ) );
+
+      QgsServerParameters wmsParams( query );
+      QgsServerRequest wmsRequest( "?" + query.query( QUrl::FullyDecoded ) );
+      QgsService *service = serverIface->serviceRegistry()->getService( wmsParams.service(), wmsParams.version() );
+      QgsBufferServerResponse wmsResponse;
+      service->executeRequest( wmsRequest, wmsResponse, project );
+      wmsResponse.finish();
+
+      QImage image;
+      if ( !isTileResponse( wmsResponse ) || !image.loadFromData( wmsResponse.body(), "PNG" ) )
+      {
+        return false;
+      }
+
+      if ( image.width() != metatile.cols * metatile.tileWidth + 2 * metatile.buffer
+           || image.height() != metatile.rows * metatile.tileHeight + 2 * metatile.buffer )
+      {
+        return false;
+      }
+
+      const int quality = jpeg ? QgsServerProjectUtils::wmsImageQuality( *project ) : -1;
+      const int zoom = params.tileMatrixAsInt();
+      QByteArray content;
+      for ( int row = 0; row < metatile.rows; ++row )
+      {
+        for ( int col = 0; col < metatile.cols; ++col )
+        {
+          const int tileRow = metatile.row + row;
+          const int tileCol = metatile.col + col;
+          const QImage tile = metatileTile( image, metatile, tileRow, tileCol );
+          QByteArray data;
+          QBuffer buffer( &data );
+          buffer.open( QIODevice::WriteOnly );
+          tile.save( &buffer, jpeg ? "JPEG" : "PNG", quality > 0 ? quality : -1 );
+
+          QgsServerTileCache::instance()->insertTile( project, tileSet, zoom, tileRow, tileCol, data, settings );
+          if ( tileRow == params.tileRowAsInt() && tileCol == params.tileColAsInt() )
+          {
+            content = data;
+          }
+        }
+      }
+
+      response.setHeader( QStringLiteral( "Content-Type" ), jpeg ? QStringLiteral( "image/jpeg" ) : QStringLiteral( "image/png" ) );
+      response.write( content );
+      return true;
+    }
+
+  } // namespace
 
   void writeGetTile( QgsServerInterface *serverIface, const QgsProject *project,
                      const QString &version, const QgsServerRequest &request,
@@ -33,6 +119,33 @@ namespace QgsWmts
     // WMS query
     QUrlQuery query = translateWmtsParamToWmsQueryItem( QStringLiteral( "GetMap" ), params, project, serverIface );
 
+    // Get tile from the built-in cache
+    const QgsServerSettings &settings = *serverIface->serverSettings();
+    QString tileSet;
+    if ( QgsServerTileCache::isEnabled( settings ) )
+    {
+      QStringList tileSetKey { params.layer(), params.value( QStringLiteral( "STYLE" ) ), params.formatAsString(), params.tileMatrixSet() };
+#ifdef HAVE_SERVER_PYTHON_PLUGINS
+      // tiles depending on access control rules are cached by rule, or not at all
+      if ( !serverIface->accessControls()->fillCacheKey( tileSetKey ) )
+      {
+        tileSetKey.clear();
+      }
+#endif
+      tileSet = tileSetKey.join( '\n' );
+    }
+
+    if ( !tileSet.isEmpty() )
+    {
+      const QByteArray content = QgsServerTileCache::instance()->tile( project, tileSet, params.tileMatrixAsInt(), params.tileRowAsInt(), params.tileColAsInt(), settings );
+      if ( !content.isEmpty() )
+      {
+        response.setHeader( QStringLiteral( "Content-Type" ), params.format() == QgsWmtsParameters::Format::JPG ? QStringLiteral( "image/jpeg" ) : QStringLiteral( "image/png" ) );
+        response.write( content );
+        return;
+      }
+    }
+
     // Get cached image
 #ifdef HAVE_SERVER_PYTHON_PLUGINS
     QgsAccessControl *accessControl = serverIface->accessControls();
@@ -66,10 +179,24 @@ namespace QgsWmts
     }
 #endif
 
-    QgsServerParameters wmsParams( query );
-    QgsServerRequest wmsRequest( "?" + query.query( QUrl::FullyDecoded ) );
-    QgsService *service = serverIface->serviceRegistry()->getService( wmsParams.service(), wmsParams.version() );
-    service->executeRequest( wmsRequest, response, project );
+    // Render the whole metatile once and cache its tiles, falling back to
+    // the single tile if the metatile cannot be rendered, e.g. if it exceeds
+    // the maximum WMS image size
+    const bool metatileWritten = !tileSet.isEmpty() && settings.wmtsMetatileSize() > 1
+                                 && writeMetatile( serverIface, project, params, tileSet, response );
+    if ( !metatileWritten )
+    {
+      QgsServerParameters wmsParams( query );
+      QgsServerRequest wmsRequest( "?" + query.query( QUrl::FullyDecoded ) );
+      QgsService *service = serverIface->serviceRegistry()->getService( wmsParams.service(), wmsParams.version() );
+      service->executeRequest( wmsRequest, response, project );
+
+      if ( !tileSet.isEmpty() && isTileResponse( response ) )
+      {
+        QgsServerTileCache::instance()->insertTile( project, tileSet, params.tileMatrixAsInt(), params.tileRowAsInt(), params.tileColAsInt(), response.data(), settings );
+      }
+    }
+
 #ifdef HAVE_SERVER_PYTHON_PLUGINS
     if ( cacheManager )
     {
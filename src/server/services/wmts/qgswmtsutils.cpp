@@ -175,6 +175,8 @@ namespace QgsWmts
       tm.row = r;
       tm.left = extent.xMinimum();
       tm.top = extent.yMaximum();
+      tm.tileWidth = tileSize;
+      tm.tileHeight = tileSize;
       tileMatrixList.append( tm );
 
       scaleDenominator = scale / 2;
@@ -327,6 +329,8 @@ namespace QgsWmts
           tm.row = row * std::pow( 2, i );
           tm.left = fixedLeft;
           tm.top = fixedTop;
+          tm.tileWidth = tileSize;
+          tm.tileHeight = tileSize;
           tileMatrixList.append( tm );
         }
 
@@ -627,7 +631,7 @@ namespace QgsWmts
   }
 
   QUrlQuery translateWmtsParamToWmsQueryItem( const QString &request, const QgsWmtsParameters &params,
-      const QgsProject *project, QgsServerInterface *serverIface )
+      const QgsProject *project, QgsServerInterface *serverIface, metatileDef *metatile )
   {
 #ifndef HAVE_SERVER_PYTHON_PLUGINS
     ( void )serverIface;
@@ -645,6 +649,7 @@ namespace QgsWmts
     QStringList wmtsGroupNameList = project->readListEntry( QStringLiteral( "WMTSLayers" ), QStringLiteral( "Group" ) );
     QStringList wmtsLayerIdList = project->readListEntry( QStringLiteral( "WMTSLayers" ), QStringLiteral( "Layer" ) );
     QStringList wmtsLayerIds;
+    QVariant metaBuffer;
     if ( wmtsProject )
     {
       // Root Layer name
@@ -673,6 +678,10 @@ namespace QgsWmts
         {
           groupLayerId = gName;
         }
+        if ( groupLayerId == layer )
+        {
+          metaBuffer = treeGroup->customProperty( QStringLiteral( "wmtsMetaBuffer" ) );
+        }
         wmtsLayerIds << groupLayerId;
       }
     }
@@ -699,6 +708,10 @@ namespace QgsWmts
         {
           layerLayerId = l->name();
         }
+        if ( layerLayerId == layer )
+        {
+          metaBuffer = l->customProperty( QStringLiteral( "wmtsMetaBuffer" ) );
+        }
         wmtsLayerIds << layerLayerId;
       }
     }
@@ -762,10 +775,29 @@ namespace QgsWmts
     }
 
     double res = tm.resolution;
-    double minx = tm.left + tc * ( tileSize * res );
-    double miny = tm.top - ( tr + 1 ) * ( tileSize * res );
-    double maxx = tm.left + ( tc + 1 ) * ( tileSize * res );
-    double maxy = tm.top - tr * ( tileSize * res );
+    double minx = tm.left + tc * ( tm.tileWidth * res );
+    double miny = tm.top - ( tr + 1 ) * ( tm.tileHeight * res );
+    double maxx = tm.left + ( tc + 1 ) * ( tm.tileWidth * res );
+    double maxy = tm.top - tr * ( tm.tileHeight * res );
+    int width = tm.tileWidth;
+    int height = tm.tileHeight;
+    if ( metatile )
+    {
+      bool ok = false;
+      const int buffer = metaBuffer.toInt( &ok );
+      if ( ok && buffer >= 0 )
+      {
+        metatile->buffer = buffer;
+      }
+
+      const QgsRectangle extent = calculateMetatile( tm, tr, tc, *metatile );
+      minx = extent.xMinimum();
+      miny = extent.yMinimum();
+      maxx = extent.xMaximum();
+      maxy = extent.yMaximum();
+      width = metatile->cols * metatile->tileWidth + 2 * metatile->buffer;
+      height = metatile->rows * metatile->tileHeight + 2 * metatile->buffer;
+    }
     QString bbox;
     if ( tms.hasAxisInverted )
     {
@@ -794,8 +826,8 @@ namespace QgsWmts
     query.addQueryItem( QgsWmsParameterForWmts::name( QgsWmsParameterForWmts::STYLES ), QString() );
     query.addQueryItem( QgsWmsParameterForWmts::name( QgsWmsParameterForWmts::CRS ), tms.ref );
     query.addQueryItem( QgsWmsParameterForWmts::name( QgsWmsParameterForWmts::BBOX ), bbox );
-    query.addQueryItem( QgsWmsParameterForWmts::name( QgsWmsParameterForWmts::WIDTH ), QStringLiteral( "256" ) );
-    query.addQueryItem( QgsWmsParameterForWmts::name( QgsWmsParameterForWmts::HEIGHT ), QStringLiteral( "256" ) );
+    query.addQueryItem( QgsWmsParameterForWmts::name( QgsWmsParameterForWmts::WIDTH ), QString::number( width ) );
+    query.addQueryItem( QgsWmsParameterForWmts::name( QgsWmsParameterForWmts::HEIGHT ), QString::number( height ) );
     query.addQueryItem( QgsWmsParameterForWmts::name( QgsWmsParameterForWmts::FORMAT ), format );
     if ( params.format() == QgsWmtsParameters::Format::PNG )
     {
@@ -807,6 +839,33 @@ namespace QgsWmts
     return query;
   }
 
+  QgsRectangle calculateMetatile( const tileMatrixDef &tm, int row, int col, metatileDef &metatile )
+  {
+    // metatiles are aligned on the tile matrix, so that a tile always
+    // belongs to the same metatile
+    const int size = std::max( 1, metatile.size );
+    metatile.row = ( row / size ) * size;
+    metatile.col = ( col / size ) * size;
+    metatile.rows = std::min( size, tm.row - metatile.row );
+    metatile.cols = std::min( size, tm.col - metatile.col );
+    metatile.buffer = std::max( 0, metatile.buffer );
+    metatile.tileWidth = tm.tileWidth;
+    metatile.tileHeight = tm.tileHeight;
+
+    const double res = tm.resolution;
+    return QgsRectangle( tm.left + ( metatile.col * tm.tileWidth - metatile.buffer ) * res,
+                         tm.top - ( ( metatile.row + metatile.rows ) * tm.tileHeight + metatile.buffer ) * res,
+                         tm.left + ( ( metatile.col + metatile.cols ) * tm.tileWidth + metatile.buffer ) * res,
+                         tm.top - ( metatile.row * tm.tileHeight - metatile.buffer ) * res );
+  }
+
+  QImage metatileTile( const QImage &image, const metatileDef &metatile, int row, int col )
+  {
+    return image.copy( metatile.buffer + ( col - metatile.col ) * metatile.tileWidth,
+                       metatile.buffer + ( row - metatile.row ) * metatile.tileHeight,
+                       metatile.tileWidth, metatile.tileHeight );
+  }
+
   namespace
   {
 
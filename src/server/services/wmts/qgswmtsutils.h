@@ -24,6 +24,7 @@
 #include "qgswmtsserviceexception.h"
 
 #include <QDomDocument>
+#include <QImage>
 
 /**
  * \ingroup server
@@ -65,6 +66,10 @@ namespace QgsWmts
     double left = 0.0;
 
     double top = 0.0;
+
+    int tileWidth = 256;
+
+    int tileHeight = 256;
   };
 
   struct tileMatrixSetDef
@@ -80,6 +85,33 @@ namespace QgsWmts
     QList< tileMatrixDef > tileMatrixList;
   };
 
+  struct metatileDef
+  {
+    //! Requested number of tiles per side
+    int size = 1;
+
+    //! Buffer in pixels rendered around the metatile
+    int buffer = 0;
+
+    //! Row of the top left tile
+    int row = 0;
+
+    //! Column of the top left tile
+    int col = 0;
+
+    //! Number of rows, less than size at the tile matrix edge
+    int rows = 1;
+
+    //! Number of columns, less than size at the tile matrix edge
+    int cols = 1;
+
+    //! Width in pixels of the tiles
+    int tileWidth = 256;
+
+    //! Height in pixels of the tiles
+    int tileHeight = 256;
+  };
+
   struct tileMatrixLimitDef
   {
     int minCol;
@@ -142,9 +174,28 @@ namespace QgsWmts
 
   /**
    * Translate WMTS parameters to WMS query item
+   *
+   * If \a metatile is set, the query renders the metatile of \a metatile size
+   * containing the requested tile, with its buffer. The buffer is overridden by
+   * the "wmtsMetaBuffer" custom property of the requested layer or group, and
+   * the position of the metatile in the tile matrix is stored in \a metatile.
    */
   QUrlQuery translateWmtsParamToWmsQueryItem( const QString &request, const QgsWmtsParameters &params,
-      const QgsProject *project, QgsServerInterface *serverIface );
+      const QgsProject *project, QgsServerInterface *serverIface, metatileDef *metatile = nullptr );
+
+  /**
+   * Calculates the metatile of \a metatile size containing the tile at \a row
+   * and \a col of the tile matrix \a tm. The position of the metatile and the
+   * size of its tiles are stored in \a metatile, and the extent of the metatile
+   * grown by its buffer is returned.
+   */
+  QgsRectangle calculateMetatile( const tileMatrixDef &tm, int row, int col, metatileDef &metatile );
+
+  /**
+   * Returns the tile at \a row and \a col of the tile matrix cut from the
+   * \a image rendered for the \a metatile, buffer included.
+   */
+  QImage metatileTile( const QImage &image, const metatileDef &metatile, int row, int col );
 
 } // namespace QgsWmts
 
@@ -17,6 +17,8 @@
 #include <QString>
 #include <QtConcurrentMap>
 
+#include <limits>
+
 #include <qgsapplication.h>
 //header for class being tested
 #include "qgsexpression.h"
@@ -33,6 +35,8 @@
 #include "qgsrasterlayer.h"
 #include "qgsproject.h"
 #include "qgsexpressionnodeimpl.h"
+#include "qgsexpressionbytecode.h"
+#include "qgsfeaturebatch.h"
 #include "qgsvectorlayerutils.h"
 #include "qgsexpressioncontextutils.h"
 
@@ -1848,6 +1852,173 @@ class TestQgsExpression: public QObject
       QCOMPARE( res.toInt(), 0 );
     }
 
+    void bytecode_data()
+    {
+      QTest::addColumn<QString>( "string" );
+      QTest::addColumn<bool>( "compiled" );
+
+      QTest::newRow( "field" ) << "int_field" << false;
+      QTest::newRow( "static" ) << "1 + 2 * 3" << false;
+      QTest::newRow( "function" ) << "upper(string_field)" << false;
+      QTest::newRow( "like" ) << "string_field LIKE 'a%'" << false;
+      QTest::newRow( "integer arithmetic" ) << "int_field + 2 * int_field - 3" << true;
+      QTest::newRow( "division" ) << "int_field / 2" << true;
+      QTest::newRow( "division by zero" ) << "double_field / int_field" << true;
+      QTest::newRow( "integer division" ) << "double_field // int_field" << true;
+      QTest::newRow( "integer division null" ) << "null_field // 2" << true;
+      QTest::newRow( "modulo" ) << "int_field % 3 + double_field % 2" << true;
+      QTest::newRow( "power" ) << "int_field ^ 2" << true;
+      QTest::newRow( "null arithmetic" ) << "null_field + int_field" << true;
+      QTest::newRow( "string concatenation" ) << "string_field + 'def'" << true;
+      QTest::newRow( "null string concatenation" ) << "string_field + to_string(null_field)" << true;
+      QTest::newRow( "numeric string arithmetic" ) << "number_string_field - int_field" << true;
+      QTest::newRow( "infinity" ) << "10 ^ 400 > int_field" << true;
+      QTest::newRow( "numeric comparison" ) << "double_field * int_field > 4" << true;
+      QTest::newRow( "string comparison" ) << "string_field = 'abc'" << true;
+      QTest::newRow( "string order" ) << "string_field < 'b'" << true;
+      QTest::newRow( "mixed comparison" ) << "number_string_field > int_field" << true;
+      QTest::newRow( "and" ) << "int_field = 5 AND string_field = 'abc'" << true;
+      QTest::newRow( "or" ) << "int_field > 10 OR null_field IS NULL" << true;
+      QTest::newRow( "null logic" ) << "null_field AND int_field" << true;
+      QTest::newRow( "string logic" ) << "int_field > 1 AND string_field" << true;
+      QTest::newRow( "not" ) << "NOT (int_field > 3)" << true;
+      QTest::newRow( "negate" ) << "-int_field - -double_field" << true;
+      QTest::newRow( "negate null" ) << "-null_field + 1" << true;
+      QTest::newRow( "negate string" ) << "-string_field + 1" << true;
+      QTest::newRow( "is" ) << "(int_field IS 5) + (double_field IS NOT 2.5) + (string_field IS 'abc')" << true;
+      QTest::newRow( "in" ) << "int_field IN (1, 5, null_field)" << true;
+      QTest::newRow( "not in" ) << "string_field NOT IN ('x', 'abc')" << true;
+      QTest::newRow( "in mixed" ) << "int_field IN ('5', '-3')" << true;
+      QTest::newRow( "case" ) << "CASE WHEN int_field > 3 THEN 'big' WHEN int_field > 0 THEN 'small' ELSE NULL END" << true;
+      QTest::newRow( "case error" ) << "CASE WHEN string_field THEN 1 END" << true;
+      QTest::newRow( "fallback" ) << "length(string_field) + int_field" << true;
+      QTest::newRow( "fallback in filter" ) << "int_field = 5 AND string_field LIKE 'a%'" << true;
+    }
+
+    void bytecode()
+    {
+      QFETCH( QString, string );
+      QFETCH( bool, compiled );
+
+      QgsFields fields;
+      fields.append( QgsField( QStringLiteral( "int_field" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "double_field" ), QVariant::Double ) );
+      fields.append( QgsField( QStringLiteral( "string_field" ), QVariant::String ) );
+      fields.append( QgsField( QStringLiteral( "null_field" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "number_string_field" ), QVariant::String ) );
+
+      const QList< QgsAttributes > rows
+      {
+        QgsAttributes() << 5 << 2.5 << QStringLiteral( "abc" ) << QVariant( QVariant::Int ) << QStringLiteral( "7" ),
+        QgsAttributes() << 0 << -1.0 << QVariant( QVariant::String ) << QVariant() << QStringLiteral( "x" ),
+        QgsAttributes() << -3 << 0.0 << QStringLiteral( "ABC" ) << 4 << QStringLiteral( "2.5" ),
+      };
+
+      for ( const QgsAttributes &attributes : rows )
+      {
+        QgsFeature feature( fields );
+        feature.setAttributes( attributes );
+        QgsExpressionContext context = QgsExpressionContextUtils::createFeatureBasedContext( feature, fields );
+
+        QgsExpression exp( string );
+        QVERIFY( exp.prepare( &context ) );
+        QgsExpressionNode *root = const_cast< QgsExpressionNode * >( exp.rootNode() );
+        QCOMPARE( static_cast< bool >( QgsExpressionBytecode::compile( root, &context ) ), compiled );
+
+        // the program must give the same results and errors as the tree
+        const QVariant result = exp.evaluate( &context );
+        const QString error = exp.evalErrorString();
+        exp.setEvalErrorString( QString() );
+        const QVariant expected = root->eval( &exp, &context );
+        QCOMPARE( result.type(), expected.type() );
+        QCOMPARE( result, expected );
+        QCOMPARE( error, exp.evalErrorString() );
+      }
+    }
+
+    void evaluateBatch_data()
+    {
+      QTest::addColumn<QString>( "string" );
+      QTest::addColumn<bool>( "columns" );
+
+      QTest::newRow( "field" ) << "int_field + 0" << true;
+      QTest::newRow( "integer arithmetic" ) << "int_field * 3 - long_field % 4" << true;
+      QTest::newRow( "double arithmetic" ) << "double_field / int_field + 2 ^ double_field" << true;
+      QTest::newRow( "integer division" ) << "double_field // int_field" << true;
+      QTest::newRow( "negate" ) << "-int_field - -double_field" << true;
+      QTest::newRow( "comparison" ) << "double_field > int_field" << true;
+      QTest::newRow( "is" ) << "long_field IS NULL OR double_field IS NOT 2.5" << true;
+      QTest::newRow( "logical" ) << "int_field > 0 AND NOT double_field < 0" << true;
+      QTest::newRow( "in" ) << "int_field IN (0, 5, NULL, long_field)" << true;
+      QTest::newRow( "not in" ) << "double_field NOT IN (2.5, int_field)" << true;
+      QTest::newRow( "case" ) << "CASE WHEN int_field > 0 THEN double_field * 2 WHEN long_field IS NULL THEN -1 ELSE int_field END" << true;
+      QTest::newRow( "null constant" ) << "int_field + NULL" << true;
+      QTest::newRow( "string" ) << "string_field + 'x'" << false;
+      QTest::newRow( "function" ) << "abs(int_field) + sqrt(double_field)" << false;
+      QTest::newRow( "concat" ) << "string_field || int_field" << false;
+    }
+
+    void evaluateBatch()
+    {
+      QFETCH( QString, string );
+      QFETCH( bool, columns );
+
+      QgsFields fields;
+      fields.append( QgsField( QStringLiteral( "int_field" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "double_field" ), QVariant::Double ) );
+      fields.append( QgsField( QStringLiteral( "long_field" ), QVariant::LongLong ) );
+      fields.append( QgsField( QStringLiteral( "string_field" ), QVariant::String ) );
+
+      const QList< QgsAttributes > rows
+      {
+        QgsAttributes() << 5 << 2.5 << 7LL << QStringLiteral( "abc" ),
+        QgsAttributes() << 0 << -1.0 << QVariant( QVariant::LongLong ) << QVariant( QVariant::String ),
+        QgsAttributes() << -3 << 0.0 << -8LL << QStringLiteral( "ABC" ),
+        QgsAttributes() << QVariant( QVariant::Int ) << std::numeric_limits<double>::quiet_NaN() << 0LL << QStringLiteral( "d" ),
+        QgsAttributes() << 2 << std::numeric_limits<double>::infinity() << 5LL << QString(),
+        QgsAttributes() << 1 << QVariant( QVariant::Double ) << 1LL << QStringLiteral( "e" ),
+      };
+
+      QgsFeatureBatch batch( fields );
+      for ( int i = 0; i < rows.size(); ++i )
+      {
+        QgsFeature feature( fields, i );
+        feature.setAttributes( rows.at( i ) );
+        batch.appendFeature( feature );
+      }
+
+      QgsExpressionContext context = QgsExpressionContextUtils::createFeatureBasedContext( batch.feature( 0 ), fields );
+      QgsExpression exp( string );
+      QVERIFY( !exp.hasParserError() );
+      const QVector<QVariant> values = exp.evaluateBatch( batch, &context );
+      const bool error = exp.hasEvalError();
+      QCOMPARE( values.size(), batch.size() );
+
+      // check whether the program ran over the columns
+      QgsExpressionNode *root = const_cast< QgsExpressionNode * >( exp.rootNode() );
+      std::unique_ptr< QgsExpressionBytecode > program = QgsExpressionBytecode::compile( root, &context );
+      QVector<QVariant> programValues;
+      QBitArray remainingRows;
+      QCOMPARE( program && program->evaluateBatch( batch, programValues, remainingRows ), columns );
+
+      // the values must be the same as the ones of each feature evaluated on its own
+      bool expectedError = false;
+      for ( int row = 0; row < batch.size(); ++row )
+      {
+        QgsExpression rowExp( string );
+        QgsExpressionContext rowContext = QgsExpressionContextUtils::createFeatureBasedContext( batch.feature( row ), fields );
+        const QVariant expected = rowExp.evaluate( &rowContext );
+        expectedError |= rowExp.hasEvalError();
+        QCOMPARE( values.at( row ).type(), expected.type() );
+        QCOMPARE( values.at( row ).isNull(), expected.isNull() );
+        if ( expected.type() == QVariant::Double && std::isnan( expected.toDouble() ) )
+          QVERIFY( std::isnan( values.at( row ).toDouble() ) );
+        else
+          QCOMPARE( values.at( row ), expected );
+      }
+      QCOMPARE( error, expectedError );
+    }
+
     void eval_feature_id()
     {
       QgsFeature f( 100 );
@@ -2379,6 +2550,62 @@ class TestQgsExpression: public QObject
       QCOMPARE( res, result );
     }
 
+    void correlatedAggregates()
+    {
+      // the aggregates of all the parents are calculated at once and shared through the context
+      QgsExpressionContext context;
+      context.appendScope( QgsExpressionContextUtils::layerScope( mAggregatesLayer ) );
+
+      QgsExpression sumExp( QStringLiteral( "aggregate(layer:='child_layer', aggregate:='sum', expression:=\"col3\", filter:=\"parent\"=attribute(@parent,'col1') AND \"col3\" > 1)" ) );
+      QgsExpression countExp( QStringLiteral( "aggregate(layer:='child_layer', aggregate:='count', expression:=\"col3\", filter:=attribute(@parent,'col1')=\"parent\")" ) );
+      QgsExpression minExp( QStringLiteral( "aggregate(layer:='child_layer', aggregate:='min', expression:=\"col3\", filter:=\"parent\"=attribute(@parent,'col1'))" ) );
+      QgsExpression relationSumExp( QStringLiteral( "relation_aggregate('my_rel','sum',\"col3\")" ) );
+      QgsExpression relationConcatenateExp( QStringLiteral( "relation_aggregate('my_rel','concatenate',to_string(\"col3\"),concatenator:=',')" ) );
+
+      QMap< int, QVariantList > expected;
+      expected.insert( 4, QVariantList() << 4 << 3 << 1 << 5 << QStringLiteral( "2,1,2" ) );
+      expected.insert( 3, QVariantList() << 9 << 2 << 2 << 9 << QStringLiteral( "2,7" ) );
+
+      QgsFeature f;
+      QgsFeatureIterator it = mAggregatesLayer->getFeatures();
+      while ( it.nextFeature( f ) )
+      {
+        context.setFeature( f );
+        const QVariantList values = expected.value( f.attribute( QStringLiteral( "col1" ) ).toInt(), QVariantList() << 0 << 0 << QVariant() << 0 << QVariant() );
+
+        QCOMPARE( sumExp.evaluate( &context ), values.at( 0 ) );
+        QVERIFY( !sumExp.hasEvalError() );
+        QCOMPARE( countExp.evaluate( &context ), values.at( 1 ) );
+        QVERIFY( !countExp.hasEvalError() );
+        QCOMPARE( minExp.evaluate( &context ), values.at( 2 ) );
+        QVERIFY( !minExp.hasEvalError() );
+        QCOMPARE( relationSumExp.evaluate( &context ), values.at( 3 ) );
+        QVERIFY( !relationSumExp.hasEvalError() );
+        QCOMPARE( relationConcatenateExp.evaluate( &context ).toString(), values.at( 4 ).toString() );
+        QVERIFY( !relationConcatenateExp.hasEvalError() );
+      }
+
+      // the values were looked up in the grouped aggregates, the filters being split once
+      auto correlatedKey = [ = ]( QgsAggregateCalculator::Aggregate aggregate, const QString & filter )
+      {
+        return QStringLiteral( "aggfcn-correlated:%1:%2:%3:%4:%5" ).arg( mChildLayer->id(), QString::number( aggregate ),
+               QStringLiteral( "\"col3\"" ), QgsExpression( filter ).dump(), QString() );
+      };
+      const QString sumKey = correlatedKey( QgsAggregateCalculator::Sum, QStringLiteral( "\"parent\"=attribute(@parent,'col1') AND \"col3\" > 1" ) );
+      QVERIFY( context.hasCachedValue( sumKey ) );
+      const QVariantMap sumCorrelated = context.cachedValue( sumKey ).toMap();
+      QVERIFY( !sumCorrelated.value( QStringLiteral( "grouped" ) ).toMap().isEmpty() );
+      QCOMPARE( sumCorrelated.value( QStringLiteral( "outer" ) ).value<QgsExpression>().expression(), QgsExpression( QStringLiteral( "attribute(@parent,'col1')" ) ).dump() );
+      QVERIFY( !sumCorrelated.value( QStringLiteral( "context" ) ).toBool() );
+      const QString countKey = correlatedKey( QgsAggregateCalculator::Count, QStringLiteral( "attribute(@parent,'col1')=\"parent\"" ) );
+      QVERIFY( context.hasCachedValue( countKey ) );
+      QVERIFY( !context.cachedValue( countKey ).toMap().value( QStringLiteral( "grouped" ) ).toMap().isEmpty() );
+      const QString relationKey = QStringLiteral( "relagg-grouped:%1:%2:%3:%4:%5" ).arg( QStringLiteral( "my_rel" ), QString::number( QgsAggregateCalculator::Sum ),
+                                  QStringLiteral( "\"col3\"" ), QStringLiteral( "\"parent\"" ), QString() );
+      QVERIFY( context.hasCachedValue( relationKey ) );
+      QVERIFY( !context.cachedValue( relationKey ).toMap().isEmpty() );
+    }
+
     void get_feature_geometry()
     {
       //test that get_feature fetches feature's geometry
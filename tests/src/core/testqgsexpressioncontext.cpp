@@ -43,6 +43,7 @@ class TestQgsExpressionContext : public QObject
     void contextCopy();
     void contextStackFunctions();
     void evaluate();
+    void variableSlot();
     void setFeature();
     void setFields();
     void takeScopes();
@@ -455,6 +456,69 @@ void TestQgsExpressionContext::evaluate()
   QCOMPARE( testExpWContextFunction.evaluate( &context2 ).toInt(), 52 );
 }
 
+void TestQgsExpressionContext::variableSlot()
+{
+  QgsExpressionContext context;
+  QgsExpressionContextScope *s1 = new QgsExpressionContextScope();
+  s1->setVariable( QStringLiteral( "a" ), 1 );
+  s1->setVariable( QStringLiteral( "b" ), 2 );
+  QgsExpressionContextScope *s2 = new QgsExpressionContextScope();
+  s2->setVariable( QStringLiteral( "c" ), 3 );
+  context << s1 << s2;
+
+  QgsExpressionContext::VariableSlot slot = context.variableSlot( QStringLiteral( "b" ) );
+  QCOMPARE( slot.name(), QStringLiteral( "b" ) );
+  QCOMPARE( context.variable( slot ).toInt(), 2 );
+
+  // values set in place are read through the slot
+  s1->setVariable( QStringLiteral( "b" ), 5 );
+  QCOMPARE( context.variable( slot ).toInt(), 5 );
+
+  // a variable shadowing it in a later scope must be picked up
+  s2->setVariable( QStringLiteral( "b" ), 7 );
+  QCOMPARE( context.variable( slot ).toInt(), 7 );
+  s2->removeVariable( QStringLiteral( "b" ) );
+  QCOMPARE( context.variable( slot ).toInt(), 5 );
+
+  // removing another variable moves the position of b in its scope
+  s1->removeVariable( QStringLiteral( "a" ) );
+  QCOMPARE( context.variable( slot ).toInt(), 5 );
+  s1->removeVariable( QStringLiteral( "b" ) );
+  QVERIFY( !context.variable( slot ).isValid() );
+  s1->setVariable( QStringLiteral( "b" ), 9 );
+  QCOMPARE( context.variable( slot ).toInt(), 9 );
+
+  // changes to the stack
+  QgsExpressionContextScope *s3 = new QgsExpressionContextScope();
+  s3->setVariable( QStringLiteral( "b" ), 11 );
+  context << s3;
+  QCOMPARE( context.variable( slot ).toInt(), 11 );
+  delete context.popScope();
+  QCOMPARE( context.variable( slot ).toInt(), 9 );
+
+  // slots resolved for a context can be read from its copies
+  QgsExpressionContext copy( context );
+  copy.scope( 0 )->setVariable( QStringLiteral( "b" ), 13 );
+  QCOMPARE( copy.variable( slot ).toInt(), 13 );
+  QCOMPARE( context.variable( slot ).toInt(), 9 );
+
+  // unknown variables
+  QgsExpressionContext::VariableSlot unknown = context.variableSlot( QStringLiteral( "unknown" ) );
+  QVERIFY( !context.variable( unknown ).isValid() );
+  s2->setVariable( QStringLiteral( "unknown" ), 15 );
+  QCOMPARE( context.variable( unknown ).toInt(), 15 );
+
+  // variables read by prepared expressions
+  QgsExpression exp( QStringLiteral( "@b + var('c')" ) );
+  QVERIFY( exp.prepare( &context ) );
+  QCOMPARE( exp.evaluate( &context ).toInt(), 12 );
+  s1->setVariable( QStringLiteral( "b" ), 20 );
+  QCOMPARE( exp.evaluate( &context ).toInt(), 23 );
+  s2->setVariable( QStringLiteral( "b" ), 30 );
+  QCOMPARE( exp.evaluate( &context ).toInt(), 33 );
+  QCOMPARE( exp.evaluate( &copy ).toInt(), 16 );
+}
+
 void TestQgsExpressionContext::setFeature()
 {
   QgsFeature feature( 50LL );
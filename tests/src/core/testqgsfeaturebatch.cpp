@@ -0,0 +1,296 @@
+/***************************************************************************
+     testqgsfeaturebatch.cpp
+     -----------------------
+    Date                 : October 2020
+    Copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgstest.h"
+#include <QObject>
+
+#include "qgsapplication.h"
+#include "qgsfeaturebatch.h"
+#include "qgsfeatureiterator.h"
+#include "qgssimplifymethod.h"
+#include "qgsvectorlayer.h"
+
+class TestQgsFeatureBatch: public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void columns();
+    void appendFeature();
+    void memoryLayer();
+    void ogrLayer();
+    void geopackage();
+    void filteredRequest();
+    void limit();
+    void simplifiedRequest();
+
+  private:
+    void compareWithFeatures( QgsVectorLayer *layer, const QgsFeatureRequest &request, const QgsAttributeList &attributes, bool fetchGeometry, int batchSize );
+};
+
+void TestQgsFeatureBatch::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+}
+
+void TestQgsFeatureBatch::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void TestQgsFeatureBatch::columns()
+{
+  QgsFields fields;
+  fields.append( QgsField( QStringLiteral( "real" ), QVariant::Double ) );
+  fields.append( QgsField( QStringLiteral( "int" ), QVariant::Int ) );
+  fields.append( QgsField( QStringLiteral( "bool" ), QVariant::Bool ) );
+  fields.append( QgsField( QStringLiteral( "text" ), QVariant::String ) );
+
+  QgsFeatureBatch all( fields );
+  QCOMPARE( all.columnCount(), 4 );
+  QCOMPARE( all.columnType( 0 ), QgsFeatureBatch::Double );
+  QCOMPARE( all.columnType( 1 ), QgsFeatureBatch::Integer );
+  QCOMPARE( all.columnType( 2 ), QgsFeatureBatch::Integer );
+  QCOMPARE( all.columnType( 3 ), QgsFeatureBatch::Variant );
+  QVERIFY( all.isEmpty() );
+
+  QgsFeatureBatch subset( fields, QgsAttributeList() << 3 << 1, false );
+  QCOMPARE( subset.columnCount(), 2 );
+  QCOMPARE( subset.column( 3 ), 0 );
+  QCOMPARE( subset.column( 1 ), 1 );
+  QCOMPARE( subset.column( 0 ), -1 );
+  QVERIFY( !subset.fetchGeometry() );
+
+  QCOMPARE( subset.appendRow( 5 ), 0 );
+  subset.setValue( 0, QStringLiteral( "a" ) );
+  subset.setInteger( 1, 3 );
+  subset.setWkb( "ignored", 7 );
+  QCOMPARE( subset.appendRow( 6 ), 1 );
+  QCOMPARE( subset.size(), 2 );
+  QCOMPARE( subset.id( 1 ), 6LL );
+  QVERIFY( !subset.isNull( 0, 0 ) );
+  QVERIFY( subset.isNull( 0, 1 ) );
+  QVERIFY( subset.isNull( 1, 1 ) );
+  QCOMPARE( subset.value( 0, 0 ), QVariant( QStringLiteral( "a" ) ) );
+  QCOMPARE( subset.value( 1, 0 ), QVariant( 3 ) );
+  QCOMPARE( subset.value( 1, 0 ).type(), QVariant::Int );
+  QVERIFY( subset.value( 1, 1 ).isNull() );
+  QCOMPARE( subset.value( 1, 1 ).type(), QVariant::Int );
+  QCOMPARE( subset.integerColumn( 1 ), QVector<qlonglong>() << 3 << 0 );
+  QVERIFY( !subset.hasGeometry( 0 ) );
+
+  subset.clear();
+  QVERIFY( subset.isEmpty() );
+  QCOMPARE( subset.columnCount(), 2 );
+}
+
+void TestQgsFeatureBatch::appendFeature()
+{
+  QgsFields fields;
+  fields.append( QgsField( QStringLiteral( "real" ), QVariant::Double ) );
+  fields.append( QgsField( QStringLiteral( "bool" ), QVariant::Bool ) );
+
+  QgsFeatureBatch batch( fields );
+
+  QgsFeature f( fields, 1 );
+  f.setAttributes( QgsAttributes() << 1.5 << true );
+  f.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "Point (1 2)" ) ) );
+  batch.appendFeature( f );
+
+  QgsFeature f2( fields, 2 );
+  f2.setAttributes( QgsAttributes() << QVariant( QVariant::Double ) << false );
+  batch.appendFeature( f2 );
+
+  QgsFeature f3( fields, 3 );
+  f3.setAttributes( QgsAttributes() << 2.5 << QVariant( QVariant::Bool ) );
+  f3.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "LineString (1 2, 3 4)" ) ) );
+  batch.appendFeature( f3 );
+
+  QCOMPARE( batch.size(), 3 );
+  QCOMPARE( batch.ids(), QVector<QgsFeatureId>() << 1 << 2 << 3 );
+  QCOMPARE( batch.doubleColumn( 0 ), QVector<double>() << 1.5 << 0 << 2.5 );
+  QCOMPARE( batch.validity( 0 ).count( true ), 2 );
+  QVERIFY( batch.isNull( 0, 1 ) );
+  QCOMPARE( batch.value( 1, 0 ), QVariant( true ) );
+  QCOMPARE( batch.value( 1, 1 ), QVariant( false ) );
+  QVERIFY( batch.value( 1, 2 ).isNull() );
+
+  QVERIFY( batch.hasGeometry( 0 ) );
+  QVERIFY( !batch.hasGeometry( 1 ) );
+  QVERIFY( batch.hasGeometry( 2 ) );
+  QCOMPARE( batch.geometry( 0 ).asWkt(), QStringLiteral( "Point (1 2)" ) );
+  QCOMPARE( batch.geometry( 2 ).asWkt(), QStringLiteral( "LineString (1 2, 3 4)" ) );
+  int size = 0;
+  QVERIFY( !batch.wkb( 1, size ) );
+  QCOMPARE( size, 0 );
+  QVERIFY( batch.wkb( 2, size ) );
+  QCOMPARE( batch.wkbBuffer().size(), batch.geometry( 0 ).asWkb().size() + size );
+
+  const QgsFeature back = batch.feature( 2 );
+  QCOMPARE( back.id(), 3LL );
+  QCOMPARE( back.attributes(), f3.attributes() );
+  QVERIFY( back.geometry().equals( f3.geometry() ) );
+}
+
+void TestQgsFeatureBatch::compareWithFeatures( QgsVectorLayer *layer, const QgsFeatureRequest &request, const QgsAttributeList &attributes, bool fetchGeometry, int batchSize )
+{
+  QList<QgsFeature> expected;
+  QgsFeatureIterator it = layer->getFeatures( request );
+  QgsFeature f;
+  while ( it.nextFeature( f ) )
+    expected << f;
+  QVERIFY( !expected.isEmpty() );
+
+  QgsFeatureBatch batch( layer->fields(), attributes, fetchGeometry );
+  int count = 0;
+  it = layer->getFeatures( request );
+  while ( it.nextBatch( batch, batchSize ) )
+  {
+    QVERIFY( batch.size() <= batchSize );
+    for ( int row = 0; row < batch.size(); ++row, ++count )
+    {
+      QVERIFY( count < expected.size() );
+      const QgsFeature &feature = expected.at( count );
+      QCOMPARE( batch.id( row ), feature.id() );
+      for ( int column = 0; column < batch.columnCount(); ++column )
+      {
+        const QVariant expectedValue = feature.attribute( batch.attributes().at( column ) );
+        QCOMPARE( batch.isNull( column, row ), expectedValue.isNull() );
+        if ( !expectedValue.isNull() )
+          QCOMPARE( batch.value( column, row ), expectedValue );
+      }
+      if ( fetchGeometry )
+      {
+        QCOMPARE( batch.hasGeometry( row ), feature.hasGeometry() );
+        QVERIFY( batch.geometry( row ).equals( feature.geometry() ) );
+      }
+    }
+  }
+  QCOMPARE( count, expected.size() );
+  QVERIFY( batch.isEmpty() );
+  QVERIFY( it.isClosed() );
+}
+
+void TestQgsFeatureBatch::memoryLayer()
+{
+  QgsVectorLayer layer( QStringLiteral( "Point?field=id:integer&field=value:double&field=name:string" ), QStringLiteral( "points" ), QStringLiteral( "memory" ) );
+  QVERIFY( layer.isValid() );
+
+  QgsFeatureList features;
+  for ( int i = 0; i < 25; ++i )
+  {
+    QgsFeature f( layer.fields() );
+    f.setAttributes( QgsAttributes() << i << ( i % 3 ? QVariant( i * 0.5 ) : QVariant( QVariant::Double ) ) << QStringLiteral( "p%1" ).arg( i ) );
+    if ( i % 5 )
+      f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( i, -i ) ) );
+    features << f;
+  }
+  QVERIFY( layer.dataProvider()->addFeatures( features ) );
+
+  compareWithFeatures( &layer, QgsFeatureRequest(), QgsAttributeList(), true, 10 );
+  compareWithFeatures( &layer, QgsFeatureRequest().setFlags( QgsFeatureRequest::NoGeometry ).setSubsetOfAttributes( QgsAttributeList() << 1 ), QgsAttributeList() << 1, false, 7 );
+}
+
+void TestQgsFeatureBatch::ogrLayer()
+{
+  const QString dataDir = QStringLiteral( TEST_DATA_DIR ) + '/';
+  QgsVectorLayer points( dataDir + QStringLiteral( "points.shp" ), QStringLiteral( "points" ), QStringLiteral( "ogr" ) );
+  QVERIFY( points.isValid() );
+  compareWithFeatures( &points, QgsFeatureRequest(), QgsAttributeList(), true, 4 );
+  compareWithFeatures( &points, QgsFeatureRequest().setFilterRect( QgsRectangle( -120, 30, -90, 45 ) ), QgsAttributeList(), true, 4 );
+
+  QgsVectorLayer lines( dataDir + QStringLiteral( "lines.shp" ), QStringLiteral( "lines" ), QStringLiteral( "ogr" ) );
+  QVERIFY( lines.isValid() );
+  compareWithFeatures( &lines, QgsFeatureRequest(), QgsAttributeList(), true, 100 );
+}
+
+void TestQgsFeatureBatch::geopackage()
+{
+  // read from the Arrow stream with recent GDAL versions
+  const QString dataDir = QStringLiteral( TEST_DATA_DIR ) + '/';
+  for ( const QString &file : { QStringLiteral( "points_gpkg.gpkg" ), QStringLiteral( "curved_polys.gpkg" ) } )
+  {
+    QgsVectorLayer layer( dataDir + file, file, QStringLiteral( "ogr" ) );
+    QVERIFY( layer.isValid() );
+    compareWithFeatures( &layer, QgsFeatureRequest(), QgsAttributeList(), true, 3 );
+
+    // features fetched by id are read one by one
+    QgsFeatureIds ids;
+    QList<QgsFeature> features;
+    QgsFeatureIterator it = layer.getFeatures();
+    QgsFeature f;
+    while ( it.nextFeature( f ) )
+    {
+      ids << f.id();
+      features << f;
+    }
+    QVERIFY( !features.isEmpty() );
+
+    it = layer.getFeatures( QgsFeatureRequest().setFilterFids( ids ) );
+    int count = 0;
+    while ( it.nextFeature( f ) )
+    {
+      const QgsFeature &expected = features.at( count++ );
+      QCOMPARE( f.id(), expected.id() );
+      QCOMPARE( f.attributes(), expected.attributes() );
+      QVERIFY( f.geometry().equals( expected.geometry() ) );
+    }
+    QCOMPARE( count, features.size() );
+  }
+}
+
+void TestQgsFeatureBatch::filteredRequest()
+{
+  const QString dataDir = QStringLiteral( TEST_DATA_DIR ) + '/';
+  QgsVectorLayer points( dataDir + QStringLiteral( "points.shp" ), QStringLiteral( "points" ), QStringLiteral( "ogr" ) );
+  QVERIFY( points.isValid() );
+
+  // filtered features are fetched one by one
+  compareWithFeatures( &points, QgsFeatureRequest().setFilterExpression( QStringLiteral( "\"Class\" = 'Jet'" ) ), QgsAttributeList(), true, 3 );
+  compareWithFeatures( &points, QgsFeatureRequest().setDestinationCrs( QgsCoordinateReferenceSystem( QStringLiteral( "EPSG:3857" ) ), QgsCoordinateTransformContext() ), QgsAttributeList(), true, 5 );
+}
+
+void TestQgsFeatureBatch::limit()
+{
+  const QString dataDir = QStringLiteral( TEST_DATA_DIR ) + '/';
+  QgsVectorLayer points( dataDir + QStringLiteral( "points.shp" ), QStringLiteral( "points" ), QStringLiteral( "ogr" ) );
+  QVERIFY( points.isValid() );
+
+  QgsFeatureIterator it = points.getFeatures( QgsFeatureRequest().setLimit( 5 ) );
+  QgsFeatureBatch batch( points.fields() );
+  QVERIFY( it.nextBatch( batch, 3 ) );
+  QCOMPARE( batch.size(), 3 );
+  QVERIFY( it.nextBatch( batch, 3 ) );
+  QCOMPARE( batch.size(), 2 );
+  QVERIFY( !it.nextBatch( batch, 3 ) );
+  QVERIFY( batch.isEmpty() );
+}
+
+void TestQgsFeatureBatch::simplifiedRequest()
+{
+  const QString dataDir = QStringLiteral( TEST_DATA_DIR ) + '/';
+  QgsVectorLayer lines( dataDir + QStringLiteral( "lines.shp" ), QStringLiteral( "lines" ), QStringLiteral( "ogr" ) );
+  QVERIFY( lines.isValid() );
+
+  // simplified geometries are fetched one by one, as with nextFeature()
+  QgsSimplifyMethod simplifyMethod;
+  simplifyMethod.setMethodType( QgsSimplifyMethod::OptimizeForRendering );
+  simplifyMethod.setTolerance( 5 );
+  compareWithFeatures( &lines, QgsFeatureRequest().setSimplifyMethod( simplifyMethod ), QgsAttributeList(), true, 4 );
+}
+
+QGSTEST_MAIN( TestQgsFeatureBatch )
+#include "testqgsfeaturebatch.moc"
@@ -142,6 +142,7 @@ class TestQgsGeometry : public QObject
     void exportToGeoJSON();
 
     void wkbInOut();
+    void lazyWkb();
 
     void directionNeutralSegmentation();
     void poleOfInaccessibility();
@@ -17334,6 +17335,57 @@ void TestQgsGeometry::wkbInOut()
   QCOMPARE( badHeader.wkbType(), QgsWkbTypes::Unknown );
 }
 
+void TestQgsGeometry::lazyWkb()
+{
+  // simple features created from WKB answer from it until they are changed
+  const QgsGeometry source = QgsGeometry::fromWkt( QStringLiteral( "MultiPolygonZ (((0 0 1, 10 0 1, 10 5 1, 0 0 1),(1 1 1, 100 1 1, 2 2 1, 1 1 1)),((20 -3 2, 21 -3 2, 21 -2 2, 20 -3 2)))" ) );
+  const QByteArray wkb = source.asWkb();
+
+  QgsGeometry g;
+  g.fromWkb( wkb );
+  QVERIFY( !g.isNull() );
+  QCOMPARE( g.wkbType(), QgsWkbTypes::MultiPolygonZ );
+  QCOMPARE( g.type(), QgsWkbTypes::PolygonGeometry );
+  QVERIFY( g.isMultipart() );
+  QVERIFY( !g.isEmpty() );
+  QCOMPARE( g.boundingBox(), source.boundingBox() );
+  QVERIFY( g.boundingBoxIntersects( QgsRectangle( 20.5, -2.5, 30, 0 ) ) );
+  QVERIFY( !g.boundingBoxIntersects( QgsRectangle( 50, 50, 60, 60 ) ) );
+  QCOMPARE( g.asWkb().constData(), wkb.constData() );
+
+  // copies share the parsed geometry
+  QgsGeometry copy = g;
+  QCOMPARE( g.asWkt(), source.asWkt() );
+  QCOMPARE( copy.constGet(), g.constGet() );
+  QCOMPARE( copy.asWkb(), wkb );
+
+  g.translate( 1, 2 );
+  QCOMPARE( g.asWkt(), QStringLiteral( "MultiPolygonZ (((1 2 1, 11 2 1, 11 7 1, 1 2 1),(2 3 1, 101 3 1, 3 4 1, 2 3 1)),((21 -1 2, 22 -1 2, 22 0 2, 21 -1 2)))" ) );
+  QCOMPARE( g.boundingBox(), QgsRectangle( 1, -1, 22, 7 ) );
+  QVERIFY( g.asWkb() != wkb );
+  QCOMPARE( copy.asWkb(), wkb );
+  QCOMPARE( copy.asWkt(), source.asWkt() );
+
+  // a point and an empty line string
+  const QgsGeometry point = QgsGeometry::fromWkt( QStringLiteral( "Point (3 4)" ) );
+  g.fromWkb( point.asWkb() );
+  QCOMPARE( g.wkbType(), QgsWkbTypes::Point );
+  QCOMPARE( g.boundingBox(), QgsRectangle( 3, 4, 3, 4 ) );
+  QVERIFY( g.intersects( QgsRectangle( 0, 0, 5, 5 ) ) );
+  QVERIFY( !g.intersects( QgsRectangle( 0, 0, 2, 2 ) ) );
+
+  g.fromWkb( QgsGeometry::fromWkt( QStringLiteral( "LineString EMPTY" ) ).asWkb() );
+  QVERIFY( !g.isNull() );
+  QVERIFY( g.isEmpty() );
+  QCOMPARE( g.wkbType(), QgsWkbTypes::LineString );
+  QCOMPARE( g.asWkt(), QStringLiteral( "LineString EMPTY" ) );
+
+  // other types are parsed right away
+  g.fromWkb( QgsGeometry::fromWkt( QStringLiteral( "CircularString (0 0, 1 1, 2 0)" ) ).asWkb() );
+  QCOMPARE( g.wkbType(), QgsWkbTypes::CircularString );
+  QCOMPARE( g.asWkt(), QStringLiteral( "CircularString (0 0, 1 1, 2 0)" ) );
+}
+
 void TestQgsGeometry::directionNeutralSegmentation()
 {
   //Tests, if segmentation of a circularstring is the same in both directions
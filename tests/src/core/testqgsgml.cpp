@@ -81,6 +81,15 @@ class TestQgsGML : public QObject
     void testThroughOGRGeometry_urn_EPSG_4326();
     void testAccents();
     void testSameTypeameAsGeomName();
+    void testParallelParsing();
+    void testParallelParsingFeatureMembers();
+    void testParallelParsingException();
+    void testParallelParsingPartialFeature();
+
+  private:
+    //! Parses \a data by pieces of \a pieceSize bytes, with or without parallel parsing
+    QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> parse( QgsGmlStreamingParser &parser, const QByteArray &data, int pieceSize, bool parallel );
+    void compareParsing( const QByteArray &data, const QgsFields &fields );
 };
 
 const QString data1( "<myns:FeatureCollection "
@@ -1272,5 +1281,150 @@ void TestQgsGML::testSameTypeameAsGeomName()
   delete features[0].first;
 }
 
+QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> TestQgsGML::parse( QgsGmlStreamingParser &parser, const QByteArray &data, int pieceSize, bool parallel )
+{
+  parser.setParallelParsingEnabled( parallel );
+  QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> features;
+  for ( int i = 0; i < data.size(); i += pieceSize )
+  {
+    const bool atEnd = i + pieceSize >= data.size();
+    if ( !parser.processData( data.mid( i, pieceSize ), atEnd ) )
+      break;
+    features << parser.getAndStealReadyFeatures();
+  }
+  return features;
+}
+
+void TestQgsGML::compareParsing( const QByteArray &data, const QgsFields &fields )
+{
+  QgsGmlStreamingParser serialParser( QStringLiteral( "mytypename" ), QStringLiteral( "mygeom" ), fields );
+  const QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> expected = parse( serialParser, data, data.size(), false );
+  QVERIFY( expected.size() > 1000 );
+
+  for ( int pieceSize : { 1000, 65536, data.size() } )
+  {
+    QgsGmlStreamingParser parser( QStringLiteral( "mytypename" ), QStringLiteral( "mygeom" ), fields );
+    const QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> features = parse( parser, data, pieceSize, true );
+    QCOMPARE( features.size(), expected.size() );
+    for ( int i = 0; i < features.size(); ++i )
+    {
+      QCOMPARE( features[i].second, expected[i].second );
+      QCOMPARE( features[i].first->id(), expected[i].first->id() );
+      QCOMPARE( features[i].first->attributes(), expected[i].first->attributes() );
+      QCOMPARE( features[i].first->geometry().asWkt(), expected[i].first->geometry().asWkt() );
+      delete features[i].first;
+    }
+    QCOMPARE( parser.getEPSGCode(), serialParser.getEPSGCode() );
+    QCOMPARE( parser.srsName(), serialParser.srsName() );
+    QCOMPARE( parser.wkbType(), serialParser.wkbType() );
+    QCOMPARE( parser.layerExtent(), serialParser.layerExtent() );
+    QCOMPARE( parser.numberMatched(), serialParser.numberMatched() );
+    QCOMPARE( parser.numberReturned(), serialParser.numberReturned() );
+    QCOMPARE( parser.isTruncatedResponse(), serialParser.isTruncatedResponse() );
+  }
+
+  for ( const QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair &featPair : expected )
+    delete featPair.first;
+}
+
+void TestQgsGML::testParallelParsing()
+{
+  QgsFields fields;
+  fields.append( QgsField( QStringLiteral( "intfield" ), QVariant::Int, QStringLiteral( "int" ) ) );
+  fields.append( QgsField( QStringLiteral( "strfield" ), QVariant::String, QStringLiteral( "string" ) ) );
+
+  // the srsName of the geometries, which inverts the axis, only appears
+  // in the middle of the document and applies to all the following features
+  QByteArray data( "<?xml version='1.0' encoding='UTF-8'?>"
+                   "<!-- a comment with a <tag> -->"
+                   "<wfs:FeatureCollection "
+                   "xmlns:myns='http://myns' "
+                   "xmlns:wfs='http://www.opengis.net/wfs/2.0' "
+                   "xmlns:gml='http://www.opengis.net/gml/3.2' "
+                   "numberMatched='5000' numberReturned='5000'>"
+                   "<gml:boundedBy><gml:Envelope><gml:lowerCorner>0 0</gml:lowerCorner><gml:upperCorner>10 5000</gml:upperCorner></gml:Envelope></gml:boundedBy>" );
+  for ( int i = 0; i < 5000; ++i )
+  {
+    data += QStringLiteral( "<wfs:member>"
+                            "<myns:mytypename gml:id=\"mytypename.%1\">"
+                            "<myns:intfield>%1</myns:intfield>"
+                            "<myns:strfield><![CDATA[<not a tag> %2]]></myns:strfield>"
+                            "<!-- </wfs:member> -->"
+                            "<myns:mygeom><gml:Point%3><gml:pos>%1 %4</gml:pos></gml:Point></myns:mygeom>"
+                            "</myns:mytypename>"
+                            "</wfs:member>\n" ).arg( i ).arg( QStringLiteral( "été > hiver" ) )
+            .arg( i == 2500 ? QStringLiteral( " srsName='urn:ogc:def:crs:EPSG::4326'" ) : QString() ).arg( i % 10 ).toUtf8();
+  }
+  data += "<wfs:member/>"
+          "<wfs:truncatedResponse/>"
+          "</wfs:FeatureCollection>";
+
+  compareParsing( data, fields );
+}
+
+void TestQgsGML::testParallelParsingFeatureMembers()
+{
+  QgsFields fields;
+  fields.append( QgsField( QStringLiteral( "intfield" ), QVariant::Int, QStringLiteral( "int" ) ) );
+
+  QByteArray data( "<myns:FeatureCollection "
+                   "xmlns:myns='http://myns' "
+                   "xmlns:gml='http://www.opengis.net/gml'>"
+                   "<gml:featureMember>"
+                   "<myns:mytypename gml:id='mytypename.first'>"
+                   "<myns:intfield>-1</myns:intfield>"
+                   "</myns:mytypename>"
+                   "</gml:featureMember>"
+                   "<gml:featureMembers xmlns:other='http://other'>" );
+  for ( int i = 0; i < 5000; ++i )
+  {
+    data += QStringLiteral( "<myns:mytypename gml:id='mytypename.%1'>"
+                            "<myns:intfield>%1</myns:intfield>"
+                            "<myns:mygeom><gml:LineString srsName='EPSG:27700'><gml:posList>%1 0 0 %1</gml:posList></gml:LineString></myns:mygeom>"
+                            "</myns:mytypename>" ).arg( i ).toUtf8();
+  }
+  data += "</gml:featureMembers>"
+          "</myns:FeatureCollection>";
+
+  compareParsing( data, fields );
+}
+
+void TestQgsGML::testParallelParsingException()
+{
+  QgsGmlStreamingParser gmlParser( ( QString() ), ( QString() ), QgsFields() );
+  gmlParser.setParallelParsingEnabled( true );
+  QCOMPARE( gmlParser.processData( QByteArray( "<ows:ExceptionReport xmlns:ows='http://www.opengis.net/ows/1.1' version='2.0.0'>"
+                                   "<ows:Exception exceptionCode='foo' locator='bar'>"
+                                   "<ows:ExceptionText>my_exception</ows:ExceptionText>"
+                                   "</ows:Exception>"
+                                   "</ows:ExceptionReport>" ), true ), true );
+  QCOMPARE( gmlParser.isException(), true );
+  QCOMPARE( gmlParser.exceptionText(), QString( "my_exception" ) );
+}
+
+void TestQgsGML::testParallelParsingPartialFeature()
+{
+  QgsFields fields;
+  QgsGmlStreamingParser gmlParser( QStringLiteral( "mytypename" ), QStringLiteral( "mygeom" ), fields );
+  gmlParser.setParallelParsingEnabled( true );
+  QCOMPARE( gmlParser.processData( QByteArray( "<myns:FeatureCollection "
+                                   "xmlns:myns='http://myns' "
+                                   "xmlns:gml='http://www.opengis.net/gml'>"
+                                   "<gml:featureMember>"
+                                   "<myns:mytypename fid='mytypename.1'>"
+                                   "</myns:mytypename>"
+                                   "</gml:featureMember>"
+                                   "<gml:featureMember>"
+                                   "<myns:mytypename fid='mytypename.2'>"
+                                   "<myns:mygeom>"
+                                   "<gml:Point srsName='EPSG:27700'>"
+                                   "<gml:coordinates>10,20</gml:coordinates>"
+                                             ), true ), false );
+  QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> features = gmlParser.getAndStealReadyFeatures();
+  QCOMPARE( features.size(), 1 );
+  QCOMPARE( features[0].second, QString( "mytypename.1" ) );
+  delete features[0].first;
+}
+
 QGSTEST_MAIN( TestQgsGML )
 #include "testqgsgml.moc"
@@ -71,6 +71,7 @@ class TestQgsLabelingEngine : public QObject
     void testLabelRotationWithReprojection();
     void drawUnplaced();
     void labelingResults();
+    void parallelSolver();
     void pointsetExtend();
     void curvedOverrun();
     void parallelOverrun();
@@ -162,6 +163,9 @@ void TestQgsLabelingEngine::testEngineSettings()
   settings.setFlag( QgsLabelingEngineSettings::DrawUnplacedLabels, false );
   QVERIFY( !settings.testFlag( QgsLabelingEngineSettings::DrawUnplacedLabels ) );
 
+  settings.setFlag( QgsLabelingEngineSettings::UseParallelSolver, true );
+  QVERIFY( settings.testFlag( QgsLabelingEngineSettings::UseParallelSolver ) );
+
   settings.setUnplacedLabelColor( QColor( 0, 255, 0 ) );
   QCOMPARE( settings.unplacedLabelColor().name(), QStringLiteral( "#00ff00" ) );
 
@@ -176,14 +180,17 @@ void TestQgsLabelingEngine::testEngineSettings()
   settings2.readSettingsFromProject( &p );
   QCOMPARE( settings2.defaultTextRenderFormat(), QgsRenderContext::TextFormatAlwaysText );
   QVERIFY( settings2.testFlag( QgsLabelingEngineSettings::DrawUnplacedLabels ) );
+  QVERIFY( settings2.testFlag( QgsLabelingEngineSettings::UseParallelSolver ) );
   QCOMPARE( settings2.unplacedLabelColor().name(), QStringLiteral( "#00ff00" ) );
 
   settings.setDefaultTextRenderFormat( QgsRenderContext::TextFormatAlwaysOutlines );
   settings.setFlag( QgsLabelingEngineSettings::DrawUnplacedLabels, false );
+  settings.setFlag( QgsLabelingEngineSettings::UseParallelSolver, false );
   settings.writeSettingsToProject( &p );
   settings2.readSettingsFromProject( &p );
   QCOMPARE( settings2.defaultTextRenderFormat(), QgsRenderContext::TextFormatAlwaysOutlines );
   QVERIFY( !settings2.testFlag( QgsLabelingEngineSettings::DrawUnplacedLabels ) );
+  QVERIFY( !settings2.testFlag( QgsLabelingEngineSettings::UseParallelSolver ) );
   QCOMPARE( settings2.placementVersion(), QgsLabelingEngineSettings::PlacementEngineVersion1 );
 
   // test that older setting is still respected as a fallback
@@ -1784,6 +1791,72 @@ void TestQgsLabelingEngine::drawUnplaced()
   QVERIFY( imageCheck( QStringLiteral( "unplaced_labels" ), img, 20 ) );
 }
 
+void TestQgsLabelingEngine::parallelSolver()
+{
+  // test solving independent groups of labels in parallel
+  QgsPalLayerSettings settings;
+  setDefaultLabelParams( settings );
+  settings.fieldName = QStringLiteral( "\"id\"" );
+  settings.isExpression = true;
+  settings.placement = QgsPalLayerSettings::OverPoint;
+
+  std::unique_ptr< QgsVectorLayer> vl2( new QgsVectorLayer( QStringLiteral( "Point?crs=epsg:3857&field=id:integer" ), QStringLiteral( "vl" ), QStringLiteral( "memory" ) ) );
+  vl2->setRenderer( new QgsNullSymbolRenderer() );
+
+  // a grid of clusters, each containing two points whose labels conflict
+  int id = 0;
+  QgsFeatureList features;
+  for ( int x = 0; x < 8; ++x )
+  {
+    for ( int y = 0; y < 6; ++y )
+    {
+      for ( int i = 0; i < 2; ++i )
+      {
+        QgsFeature f;
+        f.setAttributes( QgsAttributes() << id++ );
+        f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( x * 1000 + i * 5, y * 1000 ) ) );
+        features << f;
+      }
+    }
+  }
+  QVERIFY( vl2->dataProvider()->addFeatures( features ) );
+  vl2->updateExtents();
+
+  vl2->setLabeling( new QgsVectorLayerSimpleLabeling( settings ) );
+  vl2->setLabelsEnabled( true );
+
+  QgsMapSettings mapSettings;
+  mapSettings.setDestinationCrs( vl2->crs() );
+  mapSettings.setOutputSize( QSize( 640, 480 ) );
+  mapSettings.setExtent( QgsRectangle( -500, -500, 7500, 5500 ) );
+  mapSettings.setLayers( QList<QgsMapLayer *>() << vl2.get() );
+  mapSettings.setOutputDpi( 96 );
+
+  QgsLabelingEngineSettings engineSettings = createLabelEngineSettings();
+  engineSettings.setFlag( QgsLabelingEngineSettings::UsePartialCandidates, false );
+  engineSettings.setFlag( QgsLabelingEngineSettings::DrawLabelRectOnly, true );
+  engineSettings.setFlag( QgsLabelingEngineSettings::UseParallelSolver, true );
+  mapSettings.setLabelingEngineSettings( engineSettings );
+
+  QgsMapRendererSequentialJob job( mapSettings );
+  job.start();
+  job.waitForFinished();
+
+  std::unique_ptr< QgsLabelingResults > results( job.takeLabelingResults() );
+  QVERIFY( results );
+
+  // exactly one label should be placed for each cluster, and placed labels must not overlap
+  const QList<QgsLabelPosition> labels = results->labelsWithinRect( mapSettings.visibleExtent() );
+  QCOMPARE( labels.count(), 48 );
+  for ( int i = 0; i < labels.count(); ++i )
+  {
+    for ( int j = i + 1; j < labels.count(); ++j )
+    {
+      QVERIFY( !labels.at( i ).labelRect.intersects( labels.at( j ).labelRect ) );
+    }
+  }
+}
+
 void TestQgsLabelingEngine::labelingResults()
 {
   // test retrieval of labeling results
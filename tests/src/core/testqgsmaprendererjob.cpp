@@ -22,6 +22,7 @@
 #include <QDesktopServices>
 
 #include "qgsvectorlayer.h"
+#include "qgsvectordataprovider.h"
 #include "qgsvectorfilewriter.h"
 #include "qgsfeature.h"
 #include "qgsgeometry.h"
@@ -31,6 +32,7 @@
 #include "qgsfield.h"
 #include "qgis.h"
 #include "qgsmaprenderersequentialjob.h"
+#include "qgsmaprendererparalleljob.h"
 #include "qgsmaplayer.h"
 #include "qgsreadwritecontext.h"
 #include "qgsproviderregistry.h"
@@ -90,6 +92,9 @@ class TestQgsMapRendererJob : public QObject
 
     void temporalRender();
 
+    void splitVectorLayerRendering();
+    void skipSymbolRendering();
+
   private:
     bool imageCheck( const QString &type, const QImage &image, int mismatchCount = 0 );
 
@@ -946,6 +951,118 @@ void TestQgsMapRendererJob::temporalRender()
 
 }
 
+void TestQgsMapRendererJob::splitVectorLayerRendering()
+{
+  std::unique_ptr< QgsVectorLayer > layer = qgis::make_unique< QgsVectorLayer >( QStringLiteral( "Point?crs=EPSG:3857" ), QStringLiteral( "points" ), QStringLiteral( "memory" ) );
+  QVERIFY( layer->isValid() );
+  QgsFeatureList features;
+  for ( int x = 0; x < 50; ++x )
+  {
+    for ( int y = 0; y < 50; ++y )
+    {
+      QgsFeature f;
+      f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( x * 10 + y % 3, y * 10 ) ) );
+      features << f;
+    }
+  }
+  QVERIFY( layer->dataProvider()->addFeatures( features ) );
+
+  std::unique_ptr< QgsMarkerSymbol > symbol = qgis::make_unique< QgsMarkerSymbol >();
+  symbol->setColor( QColor( 255, 0, 255 ) );
+  symbol->setSize( 5 );
+  layer->setRenderer( new QgsSingleSymbolRenderer( symbol.release() ) );
+
+  QgsMapSettings mapSettings;
+  mapSettings.setDestinationCrs( layer->crs() );
+  mapSettings.setExtent( QgsRectangle( -10, -10, 500, 500 ) );
+  mapSettings.setOutputSize( QSize( 512, 512 ) );
+  mapSettings.setFlag( QgsMapSettings::DrawLabeling, false );
+  mapSettings.setFlag( QgsMapSettings::Antialiasing, false );
+  mapSettings.setOutputDpi( 96 );
+  mapSettings.setLayers( QList< QgsMapLayer * >() << layer.get() );
+
+  QgsMapRendererParallelJob renderJob( mapSettings );
+  renderJob.start();
+  renderJob.waitForFinished();
+  const QImage expected = renderJob.renderedImage();
+
+  // rendering in bands must give an identical result, including symbols which cross band boundaries
+  mapSettings.setFlag( QgsMapSettings::SplitVectorLayerRendering, true );
+  QgsMapRendererParallelJob splitRenderJob( mapSettings );
+  splitRenderJob.start();
+  splitRenderJob.waitForFinished();
+  QCOMPARE( splitRenderJob.renderedImage(), expected );
+
+  // rotated maps
+  mapSettings.setRotation( 30 );
+  mapSettings.setFlag( QgsMapSettings::SplitVectorLayerRendering, false );
+  QgsMapRendererParallelJob rotatedJob( mapSettings );
+  rotatedJob.start();
+  rotatedJob.waitForFinished();
+  mapSettings.setFlag( QgsMapSettings::SplitVectorLayerRendering, true );
+  QgsMapRendererParallelJob splitRotatedJob( mapSettings );
+  splitRotatedJob.start();
+  splitRotatedJob.waitForFinished();
+  QCOMPARE( splitRotatedJob.renderedImage(), rotatedJob.renderedImage() );
+}
+
+void TestQgsMapRendererJob::skipSymbolRendering()
+{
+  std::unique_ptr< QgsVectorLayer > layer = qgis::make_unique< QgsVectorLayer >( QStringLiteral( "Point?crs=EPSG:3857&field=name:string" ), QStringLiteral( "points" ), QStringLiteral( "memory" ) );
+  QVERIFY( layer->isValid() );
+  QgsFeature f( layer->fields() );
+  f.setAttributes( QgsAttributes() << QStringLiteral( "XXXX" ) );
+  f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( 250, 250 ) ) );
+  QVERIFY( layer->dataProvider()->addFeature( f ) );
+
+  std::unique_ptr< QgsMarkerSymbol > symbol = qgis::make_unique< QgsMarkerSymbol >();
+  symbol->setColor( QColor( 255, 0, 255 ) );
+  symbol->setSize( 10 );
+  layer->setRenderer( new QgsSingleSymbolRenderer( symbol.release() ) );
+
+  QgsPalLayerSettings settings;
+  settings.fieldName = QStringLiteral( "name" );
+  QgsTextFormat format;
+  format.setFont( QgsFontUtils::getStandardTestFont( QStringLiteral( "Bold" ) ) );
+  format.setSize( 20 );
+  format.setColor( QColor( 0, 0, 0 ) );
+  settings.setFormat( format );
+  layer->setLabeling( new QgsVectorLayerSimpleLabeling( settings ) );
+  layer->setLabelsEnabled( true );
+
+  QgsMapSettings mapSettings;
+  mapSettings.setDestinationCrs( layer->crs() );
+  mapSettings.setExtent( QgsRectangle( 0, 0, 500, 500 ) );
+  mapSettings.setOutputSize( QSize( 256, 256 ) );
+  mapSettings.setBackgroundColor( Qt::transparent );
+  mapSettings.setFlag( QgsMapSettings::DrawLabeling, true );
+  mapSettings.setFlag( QgsMapSettings::SkipSymbolRendering, true );
+  mapSettings.setOutputDpi( 96 );
+  mapSettings.setLayers( QList< QgsMapLayer * >() << layer.get() );
+
+  QgsMapRendererSequentialJob job( mapSettings );
+  job.start();
+  job.waitForFinished();
+  const QImage image = job.renderedImage();
+
+  // the label must be drawn, but not the marker
+  bool hasLabel = false;
+  bool hasMarker = false;
+  for ( int y = 0; y < image.height(); ++y )
+  {
+    for ( int x = 0; x < image.width(); ++x )
+    {
+      const QColor color = image.pixelColor( x, y );
+      if ( color.alpha() == 255 && color == QColor( 0, 0, 0 ) )
+        hasLabel = true;
+      else if ( color == QColor( 255, 0, 255 ) )
+        hasMarker = true;
+    }
+  }
+  QVERIFY( hasLabel );
+  QVERIFY( !hasMarker );
+}
+
 bool TestQgsMapRendererJob::imageCheck( const QString &testName, const QImage &image, int mismatchCount )
 {
   mReport += "<h2>" + testName + "</h2>\n";
@@ -41,6 +41,7 @@ class TestQgsSQLiteExpressionCompiler: public QObject
     void cleanupTestCase();
     void testMakeExpression();
     void testCompiler();
+    void testSpatialPredicates();
 
   private:
 
@@ -112,6 +113,42 @@ void TestQgsSQLiteExpressionCompiler::testCompiler()
   QCOMPARE( compiler.result(), QStringLiteral( "lower('a') NOT LIKE lower('A') ESCAPE '\\'" ) );
 }
 
+void TestQgsSQLiteExpressionCompiler::testSpatialPredicates()
+{
+  QgsExpression intersects( QStringLiteral( "intersects($geometry, geom_from_wkt('POINT(1 2)'))" ) );
+  QgsExpression notIntersects( QStringLiteral( "NOT intersects($geometry, geom_from_wkt('POINT(1 2)'))" ) );
+  QgsExpression intersectsAnd( QStringLiteral( "intersects($geometry, geom_from_wkt('POINT(1 2)')) AND \"Z\" > 1" ) );
+  QgsExpression distance( QStringLiteral( "distance($geometry, geom_from_wkt('POINT(1 2)')) < 5" ) );
+  QgsExpression xMin( QStringLiteral( "x_min($geometry) > 3" ) );
+
+  // geometry functions are not compiled without geometry column
+  QgsSQLiteExpressionCompiler noGeometry = QgsSQLiteExpressionCompiler( mPointsLayer->fields() );
+  QCOMPARE( noGeometry.compile( &intersects ), QgsSqlExpressionCompiler::Result::Fail );
+
+  // SpatiaLite: exact predicates, prefiltered by the index when they are the filter condition
+  QgsSQLiteExpressionCompiler spatialite = QgsSQLiteExpressionCompiler( mPointsLayer->fields() );
+  spatialite.setGeometryColumn( QStringLiteral( "geom" ), 4326, QgsSQLiteExpressionCompiler::SpatiaLiteFunctions );
+  spatialite.setSpatialIndex( QStringLiteral( "idx_t_geom" ), QStringLiteral( "ROWID" ) );
+  QCOMPARE( spatialite.compile( &intersects ), QgsSqlExpressionCompiler::Result::Complete );
+  QCOMPARE( spatialite.result(), QStringLiteral( "(\"ROWID\" IN (SELECT pkid FROM \"idx_t_geom\" WHERE xmin <= 1 AND xmax >= 1 AND ymin <= 2 AND ymax >= 2) AND coalesce(ST_Intersects(\"geom\",GeomFromText('Point (1 2)',4326)) = 1,0))" ) );
+  QCOMPARE( spatialite.compile( &notIntersects ), QgsSqlExpressionCompiler::Result::Complete );
+  QCOMPARE( spatialite.result(), QStringLiteral( "( NOT coalesce(ST_Intersects(\"geom\",GeomFromText('Point (1 2)',4326)) = 1,0))" ) );
+  QCOMPARE( spatialite.compile( &distance ), QgsSqlExpressionCompiler::Result::Complete );
+  QCOMPARE( spatialite.result(), QStringLiteral( "((\"geom\" IS NULL OR ST_IsEmpty(\"geom\") OR \"ROWID\" IN (SELECT pkid FROM \"idx_t_geom\" WHERE xmin <= 6 AND xmax >= -4 AND ymin <= 7 AND ymax >= -3)) AND (coalesce(ST_Distance(\"geom\",GeomFromText('Point (1 2)',4326)),-1) < 5))" ) );
+
+  // GeoPackage: predicates against constant geometries are prefiltered by bounding box
+  QgsSQLiteExpressionCompiler gpkg = QgsSQLiteExpressionCompiler( mPointsLayer->fields() );
+  gpkg.setGeometryColumn( QStringLiteral( "geom" ), 0, QgsSQLiteExpressionCompiler::GeoPackageFunctions );
+  QCOMPARE( gpkg.compile( &intersectsAnd ), QgsSqlExpressionCompiler::Result::Partial );
+  QCOMPARE( gpkg.result(), QStringLiteral( "((ST_MinX(\"geom\") <= 1 AND ST_MaxX(\"geom\") >= 1 AND ST_MinY(\"geom\") <= 2 AND ST_MaxY(\"geom\") >= 2) AND (\"Z\" > 1))" ) );
+  QCOMPARE( gpkg.compile( &notIntersects ), QgsSqlExpressionCompiler::Result::Fail );
+  QCOMPARE( gpkg.compile( &xMin ), QgsSqlExpressionCompiler::Result::Complete );
+  QCOMPARE( gpkg.result(), QStringLiteral( "(coalesce(ST_MinX(\"geom\"),0) > 3)" ) );
+
+  gpkg.setSpatialIndex( QStringLiteral( "rtree_t_geom" ), QStringLiteral( "fid" ) );
+  QCOMPARE( gpkg.compile( &distance ), QgsSqlExpressionCompiler::Result::Partial );
+  QCOMPARE( gpkg.result(), QStringLiteral( "(\"geom\" IS NULL OR ST_IsEmpty(\"geom\") OR \"fid\" IN (SELECT id FROM \"rtree_t_geom\" WHERE minx <= 6 AND maxx >= -4 AND miny <= 7 AND maxy >= -3))" ) );
+}
 
 
 QGSTEST_MAIN( TestQgsSQLiteExpressionCompiler )
@@ -16,6 +16,8 @@
 
 #include "qgsvectorlayerutils.h"
 #include "qgsvectorlayer.h"
+#include "qgsvectordataprovider.h"
+#include "qgsexpressioncontextutils.h"
 
 /**
  * \ingroup UnitTests
@@ -35,6 +37,7 @@ class TestQgsVectorLayerUtils : public QObject
     void cleanup() {} // will be called after every testfunction.
 
     void testGetFeatureSource();
+    void testGetValues();
 };
 
 void TestQgsVectorLayerUtils::initTestCase()
@@ -126,5 +129,76 @@ void TestQgsVectorLayerUtils::testGetFeatureSource()
   thread2->quit();
 }
 
+void TestQgsVectorLayerUtils::testGetValues()
+{
+  QgsVectorLayer vl( QStringLiteral( "Point?field=col1:integer&field=col2:double&field=col3:string" ), QStringLiteral( "vl" ), QStringLiteral( "memory" ) );
+  QgsFeatureList features;
+  for ( int i = 0; i < 5000; ++i )
+  {
+    QgsFeature f( vl.fields() );
+    f.setAttributes( QgsAttributes() << ( i % 7 == 0 ? QVariant( QVariant::Int ) : QVariant( i ) ) << i / 4.0 << QStringLiteral( "f%1" ).arg( i ) );
+    features << f;
+  }
+  QVERIFY( vl.dataProvider()->addFeatures( features ) );
+
+  auto evaluated = [&vl]( const QString & expression )
+  {
+    QgsExpression exp( expression );
+    QgsExpressionContext context( QgsExpressionContextUtils::globalProjectLayerScopes( &vl ) );
+    exp.prepare( &context );
+    QList<QVariant> values;
+    QgsFeature f;
+    QgsFeatureIterator it = vl.getFeatures();
+    while ( it.nextFeature( f ) )
+    {
+      context.setFeature( f );
+      values << exp.evaluate( &context );
+    }
+    return values;
+  };
+
+  auto evaluatedByColumns = [&vl]( const QString & expression )
+  {
+    QgsExpression exp( expression );
+    QgsExpressionContext context( QgsExpressionContextUtils::globalProjectLayerScopes( &vl ) );
+    exp.prepare( &context );
+    return exp.canEvaluateByColumns();
+  };
+
+  bool ok = false;
+
+  // numeric expressions are evaluated by batches over the columns
+  QVERIFY( evaluatedByColumns( QStringLiteral( "col1 * 2 + col2" ) ) );
+  QList<QVariant> values = QgsVectorLayerUtils::getValues( &vl, QStringLiteral( "col1 * 2 + col2" ), ok );
+  QVERIFY( ok );
+  QCOMPARE( values.count(), 5000 );
+  QCOMPARE( values, evaluated( QStringLiteral( "col1 * 2 + col2" ) ) );
+  QVERIFY( values.at( 0 ).isNull() );
+  QCOMPARE( values.at( 1 ).toDouble(), 2.25 );
+
+  QVERIFY( evaluatedByColumns( QStringLiteral( "CASE WHEN col1 > 100 THEN col2 ELSE -1 END" ) ) );
+  values = QgsVectorLayerUtils::getValues( &vl, QStringLiteral( "CASE WHEN col1 > 100 THEN col2 ELSE -1 END" ), ok );
+  QVERIFY( ok );
+  QCOMPARE( values, evaluated( QStringLiteral( "CASE WHEN col1 > 100 THEN col2 ELSE -1 END" ) ) );
+
+  // the other ones feature by feature
+  QVERIFY( !evaluatedByColumns( QStringLiteral( "col3 || '_' || tostring(col1)" ) ) );
+  values = QgsVectorLayerUtils::getValues( &vl, QStringLiteral( "col3 || '_' || tostring(col1)" ), ok );
+  QVERIFY( ok );
+  QCOMPARE( values, evaluated( QStringLiteral( "col3 || '_' || tostring(col1)" ) ) );
+  QCOMPARE( values.at( 1 ).toString(), QStringLiteral( "f1_1" ) );
+
+  // as the expressions which do not use any attribute
+  values = QgsVectorLayerUtils::getValues( &vl, QStringLiteral( "1 + 2" ), ok );
+  QVERIFY( ok );
+  QCOMPARE( values.count(), 5000 );
+  QCOMPARE( values.at( 4999 ).toInt(), 3 );
+
+  // and the fields themselves
+  values = QgsVectorLayerUtils::getValues( &vl, QStringLiteral( "col2" ), ok );
+  QVERIFY( ok );
+  QCOMPARE( values, evaluated( QStringLiteral( "col2" ) ) );
+}
+
 QGSTEST_MAIN( TestQgsVectorLayerUtils )
 #include "testqgsvectorlayerutils.moc"
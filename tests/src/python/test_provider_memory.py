@@ -805,6 +805,109 @@ class TestPyQgsMemoryProvider(unittest.TestCase, ProviderTestCase):
         f = vl.getFeature(1)
         self.assertEqual(f.attribute('int'), 123)
 
+    def testManyFeatures(self):
+        """Test a layer with features spread over several storage chunks"""
+
+        vl = QgsVectorLayer(
+            'Point?crs=epsg:4326&field=i:integer&field=d:double&field=s:string&field=b:bool',
+            'test', 'memory')
+        dp = vl.dataProvider()
+        features = []
+        for i in range(1, 2501):
+            f = QgsFeature(vl.fields())
+            f.setAttributes([i, i / 2 if i % 7 else NULL, str(i), i % 2 == 0])
+            if i % 100:
+                f.setGeometry(QgsGeometry.fromPointXY(QgsPointXY(i, i)))
+            features.append(f)
+        self.assertTrue(dp.addFeatures(features)[0])
+        self.assertEqual(dp.featureCount(), 2500)
+        self.assertEqual(dp.extent(), QgsRectangle(1, 1, 2499, 2499))
+
+        f = vl.getFeature(1234)
+        self.assertEqual(f.attributes(), [1234, 617.0, '1234', True])
+        self.assertEqual(f.geometry().asWkt(), 'Point (1234 1234)')
+        self.assertEqual(vl.getFeature(1400).attributes(), [1400, NULL, '1400', True])
+        self.assertFalse(vl.getFeature(1400).hasGeometry())
+
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(1020, 1020, 1030.5, 1030.5))
+        self.assertEqual([f.id() for f in vl.getFeatures(request)], list(range(1020, 1031)))
+
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(10, 10, 20, 20)).setSubsetOfAttributes(['s'], vl.fields()).setFlags(QgsFeatureRequest.NoGeometry)
+        features = [f for f in vl.getFeatures(request)]
+        self.assertEqual([f['s'] for f in features], [str(i) for i in range(10, 21)])
+        self.assertFalse(features[0].hasGeometry())
+
+        # changes are seen by the spatial index
+        self.assertTrue(dp.deleteFeatures(list(range(1000, 2050))))
+        self.assertEqual(dp.featureCount(), 1450)
+        self.assertFalse(vl.getFeature(1234).isValid())
+        self.assertTrue(dp.changeGeometryValues({2100: QgsGeometry.fromPointXY(QgsPointXY(5.5, 5.5))}))
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(5, 5, 6, 6))
+        self.assertEqual([f.id() for f in vl.getFeatures(request)], [5, 6, 2100])
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(1020, 1020, 1030.5, 1030.5))
+        self.assertEqual([f.id() for f in vl.getFeatures(request)], [])
+
+        # values of another type than the field are kept as they are
+        self.assertTrue(dp.changeAttributeValues({3: {0: NULL, 1: 5}, 2400: {3: False}}))
+        self.assertEqual(vl.getFeature(3).attributes(), [NULL, 5, '3', False])
+        self.assertEqual(vl.getFeature(2400).attributes(), [2400, 1200.0, '2400', False])
+        self.assertEqual(vl.getFeature(4).attributes(), [4, 2.0, '4', True])
+
+        self.assertTrue(dp.addAttributes([QgsField('new', QVariant.Int)]))
+        self.assertTrue(dp.changeAttributeValues({2400: {4: 7}}))
+        self.assertEqual(vl.getFeature(2399).attributes(), [2399, 1199.5, '2399', False, NULL])
+        self.assertEqual(vl.getFeature(2400).attributes(), [2400, 1200.0, '2400', False, 7])
+        self.assertTrue(dp.deleteAttributes([1, 2]))
+        self.assertEqual(vl.getFeature(2400).attributes(), [2400, False, 7])
+        self.assertEqual(sum(1 for f in dp.getFeatures()), 1450)
+
+        self.assertTrue(dp.truncate())
+        self.assertEqual(dp.featureCount(), 0)
+        self.assertFalse(dp.hasFeatures())
+
+    def testSpatialIndexEdits(self):
+        """Test spatial queries interleaved with edits, across rebuilds of the spatial index"""
+
+        vl = QgsVectorLayer('Point?crs=epsg:4326&field=i:integer&index=yes', 'test', 'memory')
+        dp = vl.dataProvider()
+        points = {}
+
+        def add(i, x, y):
+            f = QgsFeature(vl.fields())
+            f.setAttributes([i])
+            f.setGeometry(QgsGeometry.fromPointXY(QgsPointXY(x, y)))
+            ok, added = dp.addFeatures([f])
+            self.assertTrue(ok)
+            points[added[0].id()] = (x, y)
+
+        def check(rect):
+            request = QgsFeatureRequest().setFilterRect(rect)
+            expected = [fid for fid, (x, y) in sorted(points.items()) if rect.contains(QgsPointXY(x, y))]
+            self.assertEqual([f.id() for f in dp.getFeatures(request)], expected)
+
+        for i in range(3000):
+            add(i, i % 100, i // 100)
+        check(QgsRectangle(10, 10, 20, 12))
+
+        # enough edits to go past the changes kept apart from the index
+        for i in range(1500):
+            rect = QgsRectangle(i % 90, i % 25, i % 90 + 10, i % 25 + 5)
+            if i % 3 == 0:
+                add(3000 + i, (i * 7) % 100 + 0.5, (i * 11) % 30 + 0.5)
+            elif i % 3 == 1:
+                fid = sorted(points)[(i * 13) % len(points)]
+                x, y = (i * 17) % 100 + 0.25, (i * 19) % 30 + 0.25
+                self.assertTrue(dp.changeGeometryValues({fid: QgsGeometry.fromPointXY(QgsPointXY(x, y))}))
+                points[fid] = (x, y)
+            else:
+                fid = sorted(points)[(i * 29) % len(points)]
+                self.assertTrue(dp.deleteFeatures([fid]))
+                del points[fid]
+            check(rect)
+
+        self.assertEqual(dp.featureCount(), len(points))
+        check(QgsRectangle(0, 0, 100, 30))
+
 
 class TestPyQgsMemoryProviderIndexed(unittest.TestCase, ProviderTestCase):
     """Runs the provider test suite against an indexed memory layer"""
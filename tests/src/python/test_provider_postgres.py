@@ -48,6 +48,7 @@ from qgis.core import (
     QgsProviderRegistry,
     QgsVectorDataProvider,
     QgsDataSourceUri,
+    QgsFeatureSink,
 )
 from qgis.gui import QgsGui, QgsAttributeForm
 from qgis.PyQt.QtCore import QDate, QTime, QDateTime, QVariant, QDir, QObject, QByteArray
@@ -1522,6 +1523,41 @@ class TestPyQgsPostgresProvider(unittest.TestCase, ProviderTestCase):
         self.assertIsInstance(f.attributes()[value_idx], list)
         self.assertEqual(f.attributes()[value_idx], [1.1, 2, -5.12345])
 
+    def testBinaryAttributes(self):
+        """Test attributes fetched in the binary format are the same as in the text format"""
+        self.execSQLCommand('DROP TABLE IF EXISTS qgis_test.binary_attributes CASCADE')
+        self.execSQLCommand('CREATE TABLE qgis_test.binary_attributes (pk SERIAL NOT NULL PRIMARY KEY, '
+                            'a_int2 int2, a_int4 int4, a_int8 int8, a_float8 float8, a_numeric numeric(12,4), '
+                            'a_bool bool, a_date date, a_time time, a_timestamp timestamp, a_uuid uuid, a_bytea bytea, '
+                            'a_text text, a_varchar varchar(20), a_int_array int4[], a_double_array float8[], '
+                            'a_text_array text[], a_text_array_2d text[][], a_numeric_big numeric, a_char_array char(3)[])')
+        self.execSQLCommand("INSERT INTO qgis_test.binary_attributes VALUES "
+                            "(1, -2, 3, 4000000000, 1.1, -1234.5678, true, '2020-05-04', '12:13:14.5', "
+                            "'1998-12-31 23:59:58', 'a0eebc99-9c0b-4ef8-bb6d-6bb9bd380a11', 'binary', "
+                            "'Orange', 'Apple', '{1,2,-5}', '{1.1,2,-5.12345}', '{a,\"b c\"}', '{{a,b},{c,d}}', "
+                            "-123456789012345678901.0000000000001, '{ab,c}'),"
+                            "(2, NULL, NULL, NULL, NULL, 0.0001, false, NULL, NULL, NULL, NULL, NULL, "
+                            "NULL, NULL, '{}', NULL, NULL, NULL, 0.000000000000000000012345, NULL),"
+                            "(3, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, '', "
+                            "NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL)")
+
+        uri = '%s sslmode=disable key=\'pk\' table="qgis_test"."binary_attributes" sql=' % (self.dbconn)
+        vl = QgsVectorLayer(uri, 'text', 'postgres')
+        self.assertTrue(vl.isValid())
+        binary_vl = QgsVectorLayer(uri + ' binaryAttributes=\'1\'', 'binary', 'postgres')
+        self.assertTrue(binary_vl.isValid())
+
+        features = {f['pk']: f.attributes() for f in vl.getFeatures()}
+        binary_features = {f['pk']: f.attributes() for f in binary_vl.getFeatures()}
+        self.assertEqual(binary_features, features)
+        self.assertEqual(binary_features[1][binary_vl.fields().lookupField('a_numeric')], -1234.5678)
+        self.assertEqual(binary_features[1][binary_vl.fields().lookupField('a_uuid')], 'a0eebc99-9c0b-4ef8-bb6d-6bb9bd380a11')
+        self.assertEqual(binary_features[1][binary_vl.fields().lookupField('a_int_array')], [1, 2, -5])
+        # empty bytea values are not NULL
+        self.assertEqual(binary_features[3][binary_vl.fields().lookupField('a_bytea')], QByteArray())
+        self.assertFalse(binary_features[3][binary_vl.fields().lookupField('a_bytea')].isNull())
+        self.assertFalse(features[3][vl.fields().lookupField('a_bytea')].isNull())
+
     def testNotNullConstraint(self):
         vl = QgsVectorLayer('%s table="qgis_test"."constraints" sql=' % (
             self.dbconn), "constraints", "postgres")
@@ -2248,6 +2284,154 @@ class TestPyQgsPostgresProvider(unittest.TestCase, ProviderTestCase):
         self.assertEqual(vl.featureCount(), 4000)
         print("--- %s seconds ---" % (time.time() - start_time))
 
+    def testCopyFeatures(self):
+        """Test large batches of features added with FastInsert are copied"""
+        self.execSQLCommand('DROP TABLE IF EXISTS qgis_test.copy_features')
+        self.execSQLCommand('CREATE TABLE qgis_test.copy_features(pk SERIAL NOT NULL PRIMARY KEY, '
+                            'name text, value float8, dt timestamp, geom public.geometry(Point, 4326))')
+
+        vl = QgsVectorLayer(
+            self.dbconn +
+            ' sslmode=disable key=\'pk\' srid=4326 type=POINT table="qgis_test"."copy_features" (geom) sql=',
+            'test_copy_features', 'postgres')
+        self.assertTrue(vl.isValid())
+
+        features = []
+        for i in range(500):
+            f = QgsFeature(vl.fields())
+            f.setAttributes([NULL, 'tab\tnew line\nback\\slash {}'.format(i), i / 2,
+                             QDateTime(QDate(2020, 5, 4), QTime(12, 13, 14)) if i % 2 else NULL])
+            f.setGeometry(QgsGeometry.fromWkt('Point ({} 45)'.format(i % 180)) if i % 3 else QgsGeometry())
+            features.append(f)
+        self.assertTrue(vl.dataProvider().addFeatures(features, QgsFeatureSink.FastInsert))
+        self.assertEqual(vl.featureCount(), 500)
+
+        request = QgsFeatureRequest().addOrderBy('value')
+        for i, f in enumerate(vl.getFeatures(request)):
+            self.assertEqual(f['name'], 'tab\tnew line\nback\\slash {}'.format(i))
+            self.assertEqual(f['value'], i / 2)
+            self.assertEqual(f['dt'], QDateTime(QDate(2020, 5, 4), QTime(12, 13, 14)) if i % 2 else NULL)
+            self.assertEqual(f.geometry().asWkt(), 'Point ({} 45)'.format(i % 180) if i % 3 else '')
+
+        # errors are reported
+        features[0].setAttribute('value', 'not a number')
+        self.assertFalse(vl.dataProvider().addFeatures(features, QgsFeatureSink.FastInsert))
+        self.assertEqual(vl.featureCount(), 500)
+
+    def testCopyFeaturesDefaultValues(self):
+        """Test large batches of features only holding default values are inserted"""
+        self.execSQLCommand('DROP TABLE IF EXISTS qgis_test.copy_features_defaults')
+        self.execSQLCommand('CREATE TABLE qgis_test.copy_features_defaults(pk SERIAL NOT NULL PRIMARY KEY, '
+                            'name text DEFAULT \'unnamed\', value integer)')
+
+        vl = QgsVectorLayer(
+            self.dbconn +
+            ' sslmode=disable key=\'pk\' table="qgis_test"."copy_features_defaults" sql=',
+            'test_copy_features_defaults', 'postgres')
+        self.assertTrue(vl.isValid())
+
+        # no column is left to copy
+        features = []
+        for i in range(500):
+            f = QgsFeature(vl.fields())
+            f.setAttributes([NULL, NULL, NULL])
+            features.append(f)
+        self.assertTrue(vl.dataProvider().addFeatures(features, QgsFeatureSink.FastInsert))
+        self.assertEqual(vl.featureCount(), 500)
+
+        values = [(f['pk'], f['name'], f['value']) for f in vl.getFeatures(QgsFeatureRequest().addOrderBy('pk'))]
+        self.assertEqual(values, [(i, 'unnamed', NULL) for i in range(1, 501)])
+
+    def testCopyFeaturesInTransaction(self):
+        """Test default values of features copied within a transaction group"""
+        self.execSQLCommand('DROP TABLE IF EXISTS qgis_test.copy_features_transaction')
+        self.execSQLCommand('CREATE TABLE qgis_test.copy_features_transaction(pk SERIAL NOT NULL PRIMARY KEY, '
+                            'name text DEFAULT \'unnamed\', value integer)')
+
+        vl = QgsVectorLayer(
+            self.dbconn +
+            ' sslmode=disable key=\'pk\' table="qgis_test"."copy_features_transaction" sql=',
+            'test_copy_features_transaction', 'postgres')
+        self.assertTrue(vl.isValid())
+
+        p = QgsProject()
+        p.setAutoTransaction(True)
+        p.addMapLayers([vl])
+        self.assertTrue(vl.startEditing())
+        self.assertIsNotNone(vl.dataProvider().transaction())
+
+        # the default value of the name is evaluated with the connection of the transaction
+        features = []
+        for i in range(200):
+            f = QgsFeature(vl.fields())
+            f.setAttributes([NULL, 'name {}'.format(i) if i % 2 else NULL, i])
+            features.append(f)
+        self.assertTrue(vl.dataProvider().addFeatures(features, QgsFeatureSink.FastInsert))
+        self.assertTrue(vl.commitChanges())
+
+        self.assertEqual(vl.featureCount(), 200)
+        request = QgsFeatureRequest().addOrderBy('value')
+        for i, f in enumerate(vl.getFeatures(request)):
+            self.assertEqual(f['name'], 'name {}'.format(i) if i % 2 else 'unnamed')
+
+        p.removeAllMapLayers()
+
+    def testPrefetchFeatures(self):
+        """Test the next batch prefetched from the cursor is dropped on rewind and close"""
+        self.execSQLCommand('DROP TABLE IF EXISTS qgis_test.prefetch_features')
+        self.execSQLCommand('CREATE TABLE qgis_test.prefetch_features AS '
+                            'SELECT i AS pk, \'name \' || i AS name FROM generate_series(1, 10000) AS i')
+        self.execSQLCommand('ALTER TABLE qgis_test.prefetch_features ADD PRIMARY KEY (pk)')
+
+        vl = QgsVectorLayer(
+            self.dbconn +
+            ' sslmode=disable key=\'pk\' table="qgis_test"."prefetch_features" sql=',
+            'test_prefetch_features', 'postgres')
+        self.assertTrue(vl.isValid())
+        request = QgsFeatureRequest().addOrderBy('pk')
+        self.assertEqual([f['pk'] for f in vl.getFeatures(request)], list(range(1, 10001)))
+
+        # the next batch is being fetched once the first feature is read
+        it = vl.getFeatures(request)
+        f = QgsFeature()
+        self.assertTrue(it.nextFeature(f))
+        self.assertEqual(f['pk'], 1)
+        self.assertTrue(it.rewind())
+        self.assertTrue(it.nextFeature(f))
+        self.assertEqual(f['pk'], 1)
+        self.assertEqual(f['name'], 'name 1')
+        self.assertTrue(it.rewind())
+        self.assertTrue(it.rewind())
+        pks = []
+        while it.nextFeature(f):
+            pks.append(f['pk'])
+        self.assertEqual(pks, list(range(1, 10001)))
+        self.assertTrue(it.rewind())
+        self.assertTrue(it.nextFeature(f))
+        self.assertEqual(f['pk'], 1)
+
+        # the connection is released in a clean state by an early close
+        it = vl.getFeatures(request)
+        self.assertTrue(it.nextFeature(f))
+        self.assertTrue(it.close())
+        self.assertFalse(it.nextFeature(f))
+        for i in range(3):
+            it = vl.getFeatures(request)
+            for j in range(2500):
+                self.assertTrue(it.nextFeature(f))
+            self.assertEqual(f['pk'], 2500)
+            del it
+        self.assertEqual(len([f for f in vl.getFeatures()]), 10000)
+
+        # no feature is fetched past the limit
+        for limit in (1, 1999, 2000, 2001, 4000, 9999, 10000, 20000):
+            request = QgsFeatureRequest().addOrderBy('pk').setLimit(limit)
+            self.assertEqual([f['pk'] for f in vl.getFeatures(request)], list(range(1, min(limit, 10000) + 1)))
+            it = vl.getFeatures(request)
+            self.assertTrue(it.nextFeature(f))
+            self.assertTrue(it.rewind())
+            self.assertEqual(len([f for f in it]), min(limit, 10000))
+
     def testFilterOnCustomBbox(self):
         extent = QgsRectangle(-68, 70, -67, 80)
         request = QgsFeatureRequest().setFilterRect(extent)
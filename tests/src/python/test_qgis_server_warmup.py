@@ -0,0 +1,132 @@
+# -*- coding: utf-8 -*-
+"""QGIS Unit tests for qgis_server_warmup.
+
+.. note:: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+"""
+__author__ = '(C) 2020 by the QGIS project'
+__date__ = '16/10/2020'
+__copyright__ = 'Copyright 2020, The QGIS Project'
+
+import os
+import shutil
+import subprocess
+import tempfile
+import time
+
+from qgis.core import QgsProject, QgsVectorLayer, QgsFeature, QgsGeometry
+from qgis.server import QgsConfigCache, QgsServerSettings
+from qgis.testing import start_app, unittest
+from utilities import unitTestDataPath
+
+print('CTEST_FULL_OUTPUT')
+
+TEST_DATA_DIR = unitTestDataPath()
+
+start_app()
+
+
+class TestQgsServerWarmup(unittest.TestCase):
+
+    def setUp(self):
+        self.tmp_dir = tempfile.mkdtemp()
+        self.snapshot_dir = os.path.join(self.tmp_dir, 'snapshots')
+
+        for extension in ('shp', 'shx', 'dbf', 'prj'):
+            shutil.copy(os.path.join(TEST_DATA_DIR, 'qgis_server', 'testlayer.' + extension), self.tmp_dir)
+
+        project = QgsProject()
+        project.addMapLayer(QgsVectorLayer(os.path.join(self.tmp_dir, 'testlayer.shp'), 'testlayer', 'ogr'))
+        self.project_path = os.path.join(self.tmp_dir, 'project.qgs')
+        self.assertTrue(project.write(self.project_path))
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir, ignore_errors=True)
+
+    def run_warmup(self, arguments):
+        call = [QGIS_SERVER_WARMUP_BIN] + arguments
+        print(' '.join(call))
+
+        myenv = os.environ.copy()
+        myenv["QGIS_DEBUG"] = '0'
+        myenv.pop('QGIS_SERVER_PROJECT_SNAPSHOT_DIRECTORY', None)
+
+        p = subprocess.Popen(call, stdout=subprocess.PIPE, stderr=subprocess.PIPE, env=myenv)
+        output, err = p.communicate()
+        return p.returncode, output.decode(), err.decode()
+
+    def settings(self):
+        os.environ['QGIS_SERVER_PROJECT_SNAPSHOT_DIRECTORY'] = self.snapshot_dir
+        settings = QgsServerSettings()
+        settings.load()
+        os.environ.pop('QGIS_SERVER_PROJECT_SNAPSHOT_DIRECTORY')
+        return settings
+
+    def testNoSnapshotDirectory(self):
+        rc, output, err = self.run_warmup([self.project_path])
+        self.assertEqual(rc, 1)
+        self.assertIn('Unable to write the snapshot of {}'.format(self.project_path), err)
+
+    def testMissingProject(self):
+        missing = os.path.join(self.tmp_dir, 'missing.qgs')
+        rc, output, err = self.run_warmup(['-d', self.snapshot_dir, missing])
+        self.assertEqual(rc, 1)
+        self.assertIn('Unable to write the snapshot of {}'.format(missing), err)
+
+    def testRoundTrip(self):
+        rc, output, err = self.run_warmup(['-d', self.snapshot_dir, self.project_path])
+        self.assertEqual(rc, 0)
+
+        snapshot = QgsConfigCache.projectSnapshotPath(self.project_path, self.snapshot_dir)
+        self.assertIn('Snapshot of {} written to {}'.format(self.project_path, snapshot), output)
+        self.assertTrue(os.path.exists(snapshot))
+
+        # the snapshot written by the tool is loaded by the server
+        settings = self.settings()
+        self.assertEqual(QgsConfigCache.validProjectSnapshot(self.project_path, settings), snapshot)
+        project = QgsConfigCache.instance().project(self.project_path, settings)
+        self.assertEqual(project.fileName(), self.project_path)
+        self.assertTrue(project.readBoolEntry('Paths', '/Absolute')[0])
+        layer = list(project.mapLayers().values())[0]
+        self.assertTrue(layer.isValid())
+        self.assertEqual(layer.featureCount(), QgsVectorLayer(os.path.join(self.tmp_dir, 'testlayer.shp'), 'testlayer', 'ogr').featureCount())
+        QgsConfigCache.instance().removeEntry(self.project_path)
+
+        # modification times may have a resolution of a second
+        time.sleep(1.1)
+
+        # a modified data source outdates the snapshot
+        layer = QgsVectorLayer(os.path.join(self.tmp_dir, 'testlayer.shp'), 'testlayer', 'ogr')
+        feature = QgsFeature(layer.fields())
+        feature.setGeometry(QgsGeometry.fromWkt('Point (8.2035 44.9015)'))
+        self.assertTrue(layer.dataProvider().addFeature(feature))
+        del layer
+        self.assertEqual(QgsConfigCache.validProjectSnapshot(self.project_path, settings), '')
+
+        # until the tool writes it again
+        rc, output, err = self.run_warmup(['-d', self.snapshot_dir, self.project_path])
+        self.assertEqual(rc, 0)
+        self.assertEqual(QgsConfigCache.validProjectSnapshot(self.project_path, settings), snapshot)
+
+
+if __name__ == '__main__':
+    # look for qgis bin path
+    QGIS_SERVER_WARMUP_BIN = ''
+    prefixPath = os.environ['QGIS_PREFIX_PATH']
+    # see qgsapplication.cpp:98
+    for f in ['', '..', 'bin']:
+        d = os.path.join(prefixPath, f)
+        b = os.path.abspath(os.path.join(d, 'qgis_server_warmup'))
+        if os.path.exists(b):
+            QGIS_SERVER_WARMUP_BIN = b
+            break
+        b = os.path.abspath(os.path.join(d, 'qgis_server_warmup.exe'))
+        if os.path.exists(b):
+            QGIS_SERVER_WARMUP_BIN = b
+            break
+
+    print(('\nQGIS_SERVER_WARMUP_BIN: {}'.format(QGIS_SERVER_WARMUP_BIN)))
+    assert QGIS_SERVER_WARMUP_BIN, 'qgis_server_warmup binary not found, skipping test suite'
+    unittest.main()
@@ -164,6 +164,49 @@ class TestQgsAggregateCalculator(unittest.TestCase):
         val, ok = agg.calculate(QgsAggregateCalculator.ArrayAggregate, 'fldint')
         self.assertEqual(val, [2, 2, 4, 8, 3, 5, NULL])
 
+    def testNumericBatches(self):
+        """ Test numeric aggregates computed over several batches of features"""
+
+        layer = QgsVectorLayer("Point?field=fldint:integer&field=flddbl:double&field=fldtxt:string",
+                               "layer", "memory")
+        pr = layer.dataProvider()
+
+        features = []
+        for i in range(10000):
+            f = QgsFeature()
+            f.setFields(layer.fields())
+            f.setAttributes([i if i % 7 else None, i / 4 if i % 5 else None, str(i)])
+            features.append(f)
+        assert pr.addFeatures(features)
+
+        aggregates = [QgsAggregateCalculator.Count, QgsAggregateCalculator.CountMissing,
+                      QgsAggregateCalculator.CountDistinct, QgsAggregateCalculator.Sum,
+                      QgsAggregateCalculator.Mean, QgsAggregateCalculator.Median,
+                      QgsAggregateCalculator.StDev, QgsAggregateCalculator.Min,
+                      QgsAggregateCalculator.Max, QgsAggregateCalculator.Majority]
+
+        # the filter makes the features to be aggregated one by one
+        agg = QgsAggregateCalculator(layer)
+        filtered = QgsAggregateCalculator(layer)
+        params = QgsAggregateCalculator.AggregateParameters()
+        params.filter = 'true'
+        filtered.setParameters(params)
+
+        for field_or_expression in ['fldint', 'flddbl', 'fldint * 2 + flddbl', 'fldint / 3']:
+            for aggregate in aggregates:
+                val, ok = agg.calculate(aggregate, field_or_expression)
+                self.assertTrue(ok)
+                expected, ok = filtered.calculate(aggregate, field_or_expression)
+                self.assertTrue(ok)
+                self.assertAlmostEqual(val, expected, 3)
+
+        val, ok = agg.calculate(QgsAggregateCalculator.Count, 'fldint')
+        self.assertEqual(val, len([i for i in range(10000) if i % 7]))
+        val, ok = agg.calculate(QgsAggregateCalculator.Sum, 'flddbl')
+        self.assertAlmostEqual(val, sum([i / 4 for i in range(10000) if i % 5]), 3)
+        val, ok = agg.calculate(QgsAggregateCalculator.CountMissing, 'fldint * 2 + flddbl')
+        self.assertEqual(val, len([i for i in range(10000) if not i % 7 or not i % 5]))
+
     def testString(self):
         """ Test calculation of aggregates on string fields"""
 
@@ -1009,6 +1009,92 @@ class TestQgsDelimitedTextProviderOther(unittest.TestCase):
         finally:
             del os.environ['QGIS_DELIMITED_TEXT_FILE_BUFFER_SIZE']
 
+    def createLargeFile(self, nRecords):
+        # Points ordered by x, with a multi line quoted field from time to time
+        tmpdir = tempfile.mkdtemp()
+        filename = os.path.join(tmpdir, 'large.csv')
+        with open(filename, 'w', newline='') as f:
+            f.write('id,x,y,name,value\r\n')
+            for i in range(nRecords):
+                name = '"line {}\nnext line"'.format(i) if i % 100 == 0 else 'name {}'.format(i)
+                f.write('{},{},{},{},{}\r\n'.format(i, i, i % 10, name, i * 0.5))
+        return filename
+
+    def largeFileUrl(self, filename, **params):
+        url = MyUrl.fromLocalFile(filename)
+        url.addQueryItem("type", "csv")
+        url.addQueryItem("xField", "x")
+        url.addQueryItem("yField", "y")
+        for k, v in params.items():
+            url.addQueryItem(k, v)
+        return url.toString()
+
+    def testLargeFile(self):
+        # Records spread over many batches and blocks of records
+        filename = self.createLargeFile(5000)
+        vl = QgsVectorLayer(self.largeFileUrl(filename), 'test', 'delimitedtext')
+        self.assertTrue(vl.isValid())
+        self.assertEqual(vl.featureCount(), 5000)
+        self.assertEqual(vl.extent(), QgsRectangle(0, 0, 4999, 9))
+        self.assertEqual([f.type() for f in vl.fields()], [QVariant.Int, QVariant.Int, QVariant.Int, QVariant.String, QVariant.Double])
+
+        features = [f for f in vl.getFeatures()]
+        self.assertEqual(len(features), 5000)
+        self.assertEqual(features[4200]['id'], 4200)
+        self.assertEqual(features[4200]['name'], 'line 4200\nnext line')
+        self.assertEqual(features[4201]['name'], 'name 4201')
+
+        # fids are line numbers, which are shifted by the multi line records
+        fid = features[4321].id()
+        self.assertEqual(fid, 4321 + 2 + 4321 // 100 + 1)
+        self.assertEqual(vl.getFeature(fid)['id'], 4321)
+        self.assertEqual(vl.getFeature(features[12].id())['id'], 12)
+        self.assertEqual(vl.getFeature(features[4999].id())['id'], 4999)
+
+        # the records of the blocks outside of the rectangle are skipped
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(3000.5, 0, 3010, 5))
+        self.assertEqual([f['id'] for f in vl.getFeatures(request)], [i for i in range(3001, 3011) if i % 10 <= 5])
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(-10, -10, -5, -5))
+        self.assertEqual([f['id'] for f in vl.getFeatures(request)], [])
+
+    def testPersistIndex(self):
+        # The results of the scan are saved in an index file next to the file
+        filename = self.createLargeFile(3000)
+        uri = self.largeFileUrl(filename, persistIndex='yes', spatialIndex='yes')
+        indexfilename = filename + '.qgsindex'
+
+        vl = QgsVectorLayer(uri, 'test', 'delimitedtext')
+        self.assertTrue(vl.isValid())
+        self.assertTrue(os.path.exists(indexfilename))
+        expected = [(f.id(), f.attributes()) for f in vl.getFeatures(QgsFeatureRequest().setFilterRect(QgsRectangle(100, 2, 200, 3)))]
+        self.assertEqual(len(expected), 20)
+        del vl
+
+        # the index file is used when the file is opened again
+        vl = QgsVectorLayer(uri, 'test', 'delimitedtext')
+        self.assertTrue(vl.isValid())
+        self.assertEqual(vl.featureCount(), 3000)
+        self.assertEqual(vl.extent(), QgsRectangle(0, 0, 2999, 9))
+        self.assertEqual([f.type() for f in vl.fields()], [QVariant.Int, QVariant.Int, QVariant.Int, QVariant.String, QVariant.Double])
+        self.assertEqual(vl.hasSpatialIndex(), QgsFeatureSource.SpatialIndexPresent)
+        self.assertEqual([(f.id(), f.attributes()) for f in vl.getFeatures(QgsFeatureRequest().setFilterRect(QgsRectangle(100, 2, 200, 3)))], expected)
+        self.assertEqual(vl.getFeature(expected[-1][0]).attributes(), expected[-1][1])
+        del vl
+
+        # but not once the file has changed
+        with open(filename, 'a', newline='') as f:
+            f.write('3000,3000,1,last,1.5\r\n')
+        vl = QgsVectorLayer(uri, 'test', 'delimitedtext')
+        self.assertTrue(vl.isValid())
+        self.assertEqual(vl.featureCount(), 3001)
+        self.assertEqual(vl.extent(), QgsRectangle(0, 0, 3000, 9))
+        del vl
+
+        # nor with another definition
+        vl = QgsVectorLayer(self.largeFileUrl(filename, persistIndex='yes', detectTypes='no'), 'test', 'delimitedtext')
+        self.assertTrue(vl.isValid())
+        self.assertEqual([f.type() for f in vl.fields()], [QVariant.String] * 5)
+
 
 if __name__ == '__main__':
     unittest.main()
@@ -854,6 +854,75 @@ class QgsServerAPITest(QgsServerAPITestBase):
         layer = project.mapLayersByName('test layer èé 3857 published delete')[0]
         self.assertFalse(1 in layer.allFeatureIds())
 
+    def test_wfs3_lazy_layer_loading(self):
+        """Test WFS3 API with layers read without their provider, as with QGIS_SERVER_LAZY_LAYER_LOADING"""
+
+        flags = QgsProject.ReadFlags(QgsProject.FlagDontResolveLayers | QgsProject.FlagTrustLayerMetadata)
+
+        project = QgsProject()
+        project.read(unitTestDataPath('qgis_server') + '/test_project_api.qgs', flags)
+        layer = project.mapLayersByName('testlayer èé')[0]
+        self.assertIsNone(layer.dataProvider())
+
+        request = QgsBufferServerRequest('http://server.qgis.org/wfs3/collections/testlayer%20èé/items')
+        self.compareApi(request, project, 'test_wfs3_collections_items_testlayer_èé.json')
+        self.assertIsNotNone(layer.dataProvider())
+
+        project = QgsProject()
+        project.read(unitTestDataPath('qgis_server') + '/test_project_api.qgs', flags)
+        request = QgsBufferServerRequest('http://server.qgis.org/wfs3/collections/testlayer%20èé/items/1')
+        request.setHeader('Accept', 'application/json')
+        response = QgsBufferServerResponse()
+        self.server.handleRequest(request, response, project)
+        self.assertEqual(response.statusCode(), 200)
+        feature = json.loads(bytes(response.body()).decode('utf8'))
+        self.assertEqual(feature['type'], 'Feature')
+        self.assertTrue(feature['properties'])
+
+        # Transactions
+        tmpDir = QtCore.QTemporaryDir()
+        shutil.copy(unitTestDataPath('qgis_server') + '/test_project_api_editing.qgs',
+                    tmpDir.path() + '/test_project_api_editing.qgs')
+        shutil.copy(unitTestDataPath('qgis_server') + '/test_project_api_editing.gpkg',
+                    tmpDir.path() + '/test_project_api_editing.gpkg')
+
+        project = QgsProject()
+        project.read(tmpDir.path() + '/test_project_api_editing.qgs', flags)
+
+        insert_layer = r'test%20layer%20èé%203857%20published%20insert'
+        delete_layer = r'test%20layer%20èé%203857%20published%20delete'
+
+        data = """{
+        "geometry": {
+            "coordinates": [[
+            7.247,
+            44.814
+            ]],
+            "type": "MultiPoint"
+        },
+        "properties": {
+            "text_1": "Text 1",
+            "text_2": "Text 2"
+        },
+        "type": "Feature"
+        }""".encode('utf8')
+        request = QgsBufferServerRequest('http://server.qgis.org/wfs3/collections/%s/items' % insert_layer,
+                                         QgsBufferServerRequest.PostMethod,
+                                         {'Content-Type': 'application/geo+json'},
+                                         data
+                                         )
+        response = QgsBufferServerResponse()
+        self.server.handleRequest(request, response, project)
+        self.assertEqual(response.statusCode(), 201)
+
+        request = QgsBufferServerRequest('http://server.qgis.org/wfs3/collections/%s/items/1' % delete_layer,
+                                         QgsBufferServerRequest.DeleteMethod)
+        response = QgsBufferServerResponse()
+        self.server.handleRequest(request, response, project)
+        self.assertEqual(response.statusCode(), 200)
+        layer = project.mapLayersByName('test layer èé 3857 published delete')[0]
+        self.assertFalse(1 in layer.allFeatureIds())
+
     def test_wfs3_collection_items_patch(self):
         """Test WFS3 API items PATCH"""
 
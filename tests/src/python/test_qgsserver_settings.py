@@ -161,6 +161,80 @@ class TestQgsServerSettings(unittest.TestCase):
         self.assertFalse(self.settings.getPrintDisabled())
         os.environ.pop(env)
 
+    def test_env_label_cache(self):
+        self.assertEqual(self.settings.labelCacheSize(), 0)
+        self.assertEqual(self.settings.labelMetatileSize(), 4)
+        self.assertEqual(self.settings.labelMetatileBuffer(), 64)
+
+        os.environ["QGIS_SERVER_LABEL_CACHE_SIZE"] = "64"
+        os.environ["QGIS_SERVER_LABEL_METATILE_SIZE"] = "8"
+        os.environ["QGIS_SERVER_LABEL_METATILE_BUFFER"] = "16"
+        self.settings.load()
+        self.assertEqual(self.settings.labelCacheSize(), 64)
+        self.assertEqual(self.settings.labelMetatileSize(), 8)
+        self.assertEqual(self.settings.labelMetatileBuffer(), 16)
+        os.environ.pop("QGIS_SERVER_LABEL_CACHE_SIZE")
+        os.environ.pop("QGIS_SERVER_LABEL_METATILE_SIZE")
+        os.environ.pop("QGIS_SERVER_LABEL_METATILE_BUFFER")
+
+    def test_env_fcgi_workers(self):
+        env = "QGIS_SERVER_FCGI_WORKERS"
+
+        self.assertEqual(self.settings.fcgiWorkers(), 0)
+
+        os.environ[env] = "8"
+        self.settings.load()
+        self.assertEqual(self.settings.fcgiWorkers(), 8)
+        os.environ.pop(env)
+
+    def test_env_project_snapshot_directory(self):
+        env = "QGIS_SERVER_PROJECT_SNAPSHOT_DIRECTORY"
+
+        self.assertEqual(self.settings.projectSnapshotDirectory(), "")
+
+        os.environ[env] = "/tmp/snapshots"
+        self.settings.load()
+        self.assertEqual(self.settings.projectSnapshotDirectory(), "/tmp/snapshots")
+        os.environ.pop(env)
+
+    def test_env_lazy_layer_loading(self):
+        env = "QGIS_SERVER_LAZY_LAYER_LOADING"
+
+        self.assertFalse(self.settings.lazyLayerLoading())
+
+        os.environ[env] = "1"
+        self.settings.load()
+        self.assertTrue(self.settings.lazyLayerLoading())
+        os.environ.pop(env)
+
+    def test_env_tile_cache(self):
+        self.assertEqual(self.settings.tileCacheSize(), 0)
+        self.assertEqual(self.settings.tileCacheDirectory(), "")
+        self.assertEqual(self.settings.tileCacheExpiry(), 0)
+
+        os.environ["QGIS_SERVER_TILE_CACHE_SIZE"] = "1048576"
+        os.environ["QGIS_SERVER_TILE_CACHE_DIRECTORY"] = "/tmp/tiles"
+        os.environ["QGIS_SERVER_TILE_CACHE_EXPIRY"] = "3600"
+        self.settings.load()
+        self.assertEqual(self.settings.tileCacheSize(), 1048576)
+        self.assertEqual(self.settings.tileCacheDirectory(), "/tmp/tiles")
+        self.assertEqual(self.settings.tileCacheExpiry(), 3600)
+        os.environ.pop("QGIS_SERVER_TILE_CACHE_SIZE")
+        os.environ.pop("QGIS_SERVER_TILE_CACHE_DIRECTORY")
+        os.environ.pop("QGIS_SERVER_TILE_CACHE_EXPIRY")
+
+    def test_env_wmts_metatile(self):
+        self.assertEqual(self.settings.wmtsMetatileSize(), 1)
+        self.assertEqual(self.settings.wmtsMetatileBuffer(), 64)
+
+        os.environ["QGIS_SERVER_WMTS_METATILE_SIZE"] = "4"
+        os.environ["QGIS_SERVER_WMTS_METATILE_BUFFER"] = "32"
+        self.settings.load()
+        self.assertEqual(self.settings.wmtsMetatileSize(), 4)
+        self.assertEqual(self.settings.wmtsMetatileBuffer(), 32)
+        os.environ.pop("QGIS_SERVER_WMTS_METATILE_SIZE")
+        os.environ.pop("QGIS_SERVER_WMTS_METATILE_BUFFER")
+
     def test_priority(self):
         env = "QGIS_OPTIONS_PATH"
         dpath = "conf0"
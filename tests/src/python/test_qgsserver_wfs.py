@@ -19,7 +19,10 @@ import os
 # Needed on Qt 5 so that the serialization of XML is consistent among all executions
 os.environ['QT_HASH_SEED'] = '1'
 
+import json
 import re
+import shutil
+import tempfile
 import urllib.request
 import urllib.parse
 import urllib.error
@@ -28,7 +31,7 @@ from qgis.server import QgsServerRequest
 
 from qgis.testing import unittest
 from qgis.PyQt.QtCore import QSize
-from qgis.core import QgsVectorLayer
+from qgis.core import QgsVectorLayer, QgsProject
 
 import osgeo.gdal  # NOQA
 
@@ -628,6 +631,51 @@ class TestQgsServerWFS(QgsServerTestBase):
                 + "&SRSNAME=EPSG:4326&TYPENAME=testlayer&FEATUREID=testlayer.0",
                 'wfs_getFeature_1_0_0_featureid_0_json')
 
+    def test_getFeatureFlush(self):
+        """Test GetFeature responses sent by groups of features are the same as feature by feature"""
+
+        tmp_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, tmp_dir, True)
+
+        # more features than the number of features sent to the response at once
+        feature_count = 250
+        geojson = {'type': 'FeatureCollection', 'features': [
+            {'type': 'Feature', 'id': i, 'properties': {'id': i, 'name': 'feature {}'.format(i)},
+             'geometry': {'type': 'Point', 'coordinates': [8 + i / 1000, 44 + i / 1000]}}
+            for i in range(feature_count)]}
+        with open(os.path.join(tmp_dir, 'points.geojson'), 'w') as f:
+            json.dump(geojson, f)
+
+        project = QgsProject()
+        layer = QgsVectorLayer(os.path.join(tmp_dir, 'points.geojson'), 'points', 'ogr')
+        self.assertTrue(layer.isValid())
+        self.assertEqual(layer.featureCount(), feature_count)
+        project.addMapLayer(layer)
+        project.writeEntry('WFSLayers', '/', [layer.id()])
+        project_path = os.path.join(tmp_dir, 'points.qgs')
+        self.assertTrue(project.write(project_path))
+
+        query_string = '?MAP=%s&SERVICE=WFS&VERSION=1.0.0&REQUEST=GetFeature&TYPENAME=points' % urllib.parse.quote(project_path)
+
+        def gml_members(body):
+            return re.findall(br'<gml:featureMember>.*?</gml:featureMember>', body, re.DOTALL)
+
+        def json_features(body):
+            return json.loads(body.decode('utf8'))['features']
+
+        for output_format, members, end in (('GML2', gml_members, b'</wfs:FeatureCollection>'),
+                                             ('GML3', gml_members, b'</wfs:FeatureCollection>'),
+                                             ('GeoJSON', json_features, b'}')):
+            header, body = self._execute_request(query_string + '&OUTPUTFORMAT=' + output_format)
+            self.assertTrue(body.rstrip().endswith(end), body[-100:])
+            features = members(body)
+            self.assertEqual(len(features), feature_count)
+
+            # a single feature is only sent with the end of the response
+            for i in range(feature_count):
+                header, feature_body = self._execute_request(query_string + '&OUTPUTFORMAT=%s&MAXFEATURES=1&STARTINDEX=%d' % (output_format, i))
+                self.assertEqual(features[i], members(feature_body)[0], 'feature %d differs in %s' % (i, output_format))
+
 
 if __name__ == '__main__':
     unittest.main()
@@ -0,0 +1,356 @@
+/***************************************************************************
+     testqgsconfigcache.cpp
+     ----------------------
+    Date                 : October 2020
+    Copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgstest.h"
+#include <QObject>
+#include <QString>
+#include <QTemporaryDir>
+#include <QThread>
+
+#include <atomic>
+#include <thread>
+
+//qgis includes...
+#include "qgsconfigcache.h"
+#include "qgsserverexception.h"
+#include "qgsserversettings.h"
+#include "qgsvectorlayer.h"
+#include "qgsvectordataprovider.h"
+
+/**
+ * \ingroup UnitTests
+ * Unit tests for the project cache of the server
+ */
+class TestQgsConfigCache : public QObject
+{
+    Q_OBJECT
+
+  public:
+    TestQgsConfigCache() = default;
+
+  private slots:
+    // will be called before the first testfunction is executed.
+    void initTestCase();
+
+    // will be called after the last testfunction was executed.
+    void cleanupTestCase();
+
+    // will be called before each testfunction is executed
+    void init();
+
+    // Concurrent calls for the same project share a single load
+    void testConcurrentLoads();
+
+    // Projects requested by other threads are read by the thread of the cache
+    void testLoadsFromCacheThread();
+
+    // Projects returned by project() outlive their removal from the cache
+    void testProjectLifetime();
+
+    // The callers waiting for a load which fails all get the error
+    void testConcurrentLoadErrors();
+
+    // Snapshots are written, then loaded instead of their project
+    void testSnapshotRoundTrip();
+
+    // Snapshots are outdated by changes of the project or of its data sources
+    void testSnapshotValidity();
+
+  private:
+    //! Calls sharedProject() from \a threadCount threads, processing the events of the cache until they finish
+    std::vector<std::shared_ptr<const QgsProject>> loadConcurrently( const QString &path, QgsServerSettings *settings, int threadCount, std::vector<int> *errors = nullptr );
+
+    //! Writes a project with a copy of testlayer into \a directory and returns its path
+    QString writeProject( const QString &directory );
+
+    QString mProjectPath;
+    QString mInvalidProjectPath;
+};
+
+
+void TestQgsConfigCache::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  mProjectPath = QStringLiteral( "%1/qgis_server/test_project.qgs" ).arg( TEST_DATA_DIR );
+  mInvalidProjectPath = QStringLiteral( "%1/qgis_server/test_project_wms_invalid_layers.qgs" ).arg( TEST_DATA_DIR );
+}
+
+void TestQgsConfigCache::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void TestQgsConfigCache::init()
+{
+  QgsConfigCache::instance()->removeEntry( mProjectPath );
+  QgsConfigCache::instance()->removeEntry( mInvalidProjectPath );
+}
+
+std::vector<std::shared_ptr<const QgsProject>> TestQgsConfigCache::loadConcurrently( const QString &path, QgsServerSettings *settings, int threadCount, std::vector<int> *errors )
+{
+  QgsConfigCache *cache = QgsConfigCache::instance();
+  std::vector<std::shared_ptr<const QgsProject>> projects( threadCount );
+  std::atomic<int> finished( 0 );
+  std::vector<std::thread> threads;
+  for ( int i = 0; i < threadCount; ++i )
+  {
+    threads.emplace_back( [ &, i ]
+    {
+      try
+      {
+        projects[i] = cache->sharedProject( path, settings );
+      }
+      catch ( QgsServerException & )
+      {
+        if ( errors )
+          ( *errors )[i] = 1;
+      }
+      ++finished;
+    } );
+  }
+
+  // the projects are read by the event loop of the thread of the cache
+  while ( finished < threadCount )
+    QCoreApplication::processEvents( QEventLoop::AllEvents, 10 );
+
+  for ( std::thread &thread : threads )
+    thread.join();
+  return projects;
+}
+
+void TestQgsConfigCache::testConcurrentLoads()
+{
+  QgsConfigCache *cache = QgsConfigCache::instance();
+  QgsServerSettings settings;
+
+  const int threadCount = 4;
+  const std::vector<std::shared_ptr<const QgsProject>> projects = loadConcurrently( mProjectPath, &settings, threadCount );
+
+  QVERIFY( projects[0] );
+  for ( int i = 1; i < threadCount; ++i )
+    QCOMPARE( projects[i].get(), projects[0].get() );
+
+  // the project requested by the workers belongs to the thread of the cache
+  QCOMPARE( projects[0]->thread(), cache->thread() );
+  QCOMPARE( projects[0]->fileName(), mProjectPath );
+
+  // and it is cached
+  QCOMPARE( cache->project( mProjectPath, &settings ), projects[0].get() );
+
+  // a removed project is kept alive by the requests using it
+  cache->removeEntry( mProjectPath );
+  QCOMPARE( projects[0]->fileName(), mProjectPath );
+  QVERIFY( cache->project( mProjectPath, &settings ) != projects[0].get() );
+}
+
+void TestQgsConfigCache::testLoadsFromCacheThread()
+{
+  QgsConfigCache *cache = QgsConfigCache::instance();
+  QgsServerSettings settings;
+
+  // the other threads wait for the thread of the cache to read the project
+  std::atomic<bool> finished( false );
+  std::shared_ptr<const QgsProject> workerProject;
+  std::thread worker( [ & ]
+  {
+    workerProject = cache->sharedProject( mProjectPath, &settings );
+    finished = true;
+  } );
+  QTest::qSleep( 500 );
+  QVERIFY( !finished );
+
+  // the thread of the cache reads the projects queued by the threads it waits for
+  const std::shared_ptr<const QgsProject> project = cache->sharedProject( mProjectPath, &settings );
+  worker.join();
+  QVERIFY( finished );
+  QVERIFY( project );
+  QCOMPARE( workerProject.get(), project.get() );
+  QCOMPARE( project->thread(), cache->thread() );
+  const QList<QgsMapLayer *> layers = project->mapLayers().values();
+  for ( const QgsMapLayer *layer : layers )
+    QCOMPARE( layer->thread(), cache->thread() );
+}
+
+void TestQgsConfigCache::testProjectLifetime()
+{
+  QgsConfigCache *cache = QgsConfigCache::instance();
+  QgsServerSettings settings;
+
+  const QgsProject *project = cache->project( mProjectPath, &settings );
+  QVERIFY( project );
+
+  // the removed project stays valid until the next call from this thread
+  cache->removeEntry( mProjectPath );
+  QCoreApplication::sendPostedEvents( nullptr, QEvent::DeferredDelete );
+  QCOMPARE( project->fileName(), mProjectPath );
+  QVERIFY( cache->project( mProjectPath, &settings ) != project );
+}
+
+void TestQgsConfigCache::testConcurrentLoadErrors()
+{
+  QgsConfigCache *cache = QgsConfigCache::instance();
+  QgsServerSettings settings;
+
+  const int threadCount = 3;
+  std::vector<int> errors( threadCount, 0 );
+  loadConcurrently( mInvalidProjectPath, &settings, threadCount, &errors );
+
+  for ( int i = 0; i < threadCount; ++i )
+    QCOMPARE( errors[i], 1 );
+
+  // failed loads are not cached, the next call loads the project again
+  bool error = false;
+  try
+  {
+    cache->project( mInvalidProjectPath, &settings );
+  }
+  catch ( QgsServerException & )
+  {
+    error = true;
+  }
+  QVERIFY( error );
+
+  // projects which cannot be read give no project to every caller
+  const QString missing = QStringLiteral( "%1/qgis_server/missing_project.qgs" ).arg( TEST_DATA_DIR );
+  const std::vector<std::shared_ptr<const QgsProject>> projects = loadConcurrently( missing, &settings, threadCount );
+  for ( int i = 0; i < threadCount; ++i )
+    QVERIFY( !projects[i] );
+}
+
+QString TestQgsConfigCache::writeProject( const QString &directory )
+{
+  const QStringList extensions = QStringList() << "shp" << "shx" << "dbf" << "prj";
+  for ( const QString &extension : extensions )
+  {
+    QFile::copy( QStringLiteral( "%1/qgis_server/testlayer.%2" ).arg( TEST_DATA_DIR, extension ),
+                 QStringLiteral( "%1/testlayer.%2" ).arg( directory, extension ) );
+  }
+
+  QgsProject project;
+  project.addMapLayer( new QgsVectorLayer( QStringLiteral( "%1/testlayer.shp" ).arg( directory ), QStringLiteral( "testlayer" ), QStringLiteral( "ogr" ) ) );
+  const QString path = QStringLiteral( "%1/project.qgs" ).arg( directory );
+  project.write( path );
+  return path;
+}
+
+void TestQgsConfigCache::testSnapshotRoundTrip()
+{
+  QTemporaryDir dir;
+  const QString path = writeProject( dir.path() );
+  const QString snapshotDirectory = QStringLiteral( "%1/snapshots" ).arg( dir.path() );
+  qputenv( "QGIS_SERVER_PROJECT_SNAPSHOT_DIRECTORY", snapshotDirectory.toUtf8() );
+  QgsServerSettings settings;
+  qunsetenv( "QGIS_SERVER_PROJECT_SNAPSHOT_DIRECTORY" );
+
+  QgsConfigCache *cache = QgsConfigCache::instance();
+  QVERIFY( cache->validProjectSnapshot( path, &settings ).isEmpty() );
+
+  QVERIFY( QgsConfigCache::writeProjectSnapshot( path, settings ) );
+  const QString snapshot = QgsConfigCache::projectSnapshotPath( path, snapshotDirectory );
+  QVERIFY( QFileInfo::exists( snapshot ) );
+  QCOMPARE( cache->validProjectSnapshot( path, &settings ), snapshot );
+
+  // the snapshot is a flat copy with absolute paths
+  QgsProject copy;
+  QVERIFY( copy.read( snapshot ) );
+  QVERIFY( copy.readBoolEntry( QStringLiteral( "Paths" ), QStringLiteral( "/Absolute" ) ) );
+  QCOMPARE( copy.mapLayers().size(), 1 );
+  QVERIFY( copy.mapLayers().first()->isValid() );
+
+  // the cache loads the snapshot, which looks as if loaded from the project
+  const QgsProject *project = cache->project( path, &settings );
+  QVERIFY( project );
+  QVERIFY( project->readBoolEntry( QStringLiteral( "Paths" ), QStringLiteral( "/Absolute" ) ) );
+  QCOMPARE( project->fileName(), path );
+  QVERIFY( !project->isDirty() );
+  QgsVectorLayer *layer = qobject_cast<QgsVectorLayer *>( project->mapLayers().first() );
+  QVERIFY( layer );
+  QCOMPARE( layer->featureCount(), qobject_cast<QgsVectorLayer *>( copy.mapLayers().first() )->featureCount() );
+
+  // without a snapshot directory, the project itself is loaded
+  cache->removeEntry( path );
+  QgsServerSettings noSnapshotSettings;
+  QVERIFY( cache->validProjectSnapshot( path, &noSnapshotSettings ).isEmpty() );
+  project = cache->project( path, &noSnapshotSettings );
+  QVERIFY( project );
+  QVERIFY( !project->readBoolEntry( QStringLiteral( "Paths" ), QStringLiteral( "/Absolute" ) ) );
+  cache->removeEntry( path );
+}
+
+void TestQgsConfigCache::testSnapshotValidity()
+{
+  QTemporaryDir dir;
+  const QString path = writeProject( dir.path() );
+  const QString snapshotDirectory = QStringLiteral( "%1/snapshots" ).arg( dir.path() );
+  qputenv( "QGIS_SERVER_PROJECT_SNAPSHOT_DIRECTORY", snapshotDirectory.toUtf8() );
+  QgsServerSettings settings;
+  qunsetenv( "QGIS_SERVER_PROJECT_SNAPSHOT_DIRECTORY" );
+
+  QgsConfigCache *cache = QgsConfigCache::instance();
+  const QString snapshot = QgsConfigCache::projectSnapshotPath( path, snapshotDirectory );
+  QVERIFY( QgsConfigCache::writeProjectSnapshot( path, settings ) );
+  QCOMPARE( cache->validProjectSnapshot( path, &settings ), snapshot );
+
+  // the key lists the project and its data source files
+  QFile keyFile( QStringLiteral( "%1/%2.key" ).arg( snapshotDirectory, QFileInfo( snapshot ).completeBaseName() ) );
+  QVERIFY( keyFile.open( QIODevice::ReadOnly ) );
+  const QList<QByteArray> key = keyFile.readAll().split( '\n' );
+  keyFile.close();
+  QVERIFY( key.value( 0 ).startsWith( QFileInfo( path ).absoluteFilePath().toUtf8() + '\t' ) );
+  QVERIFY( key.value( 1 ).startsWith( QFileInfo( QStringLiteral( "%1/testlayer.shp" ).arg( dir.path() ) ).absoluteFilePath().toUtf8() + '\t' ) );
+
+  // modification times may have a resolution of a second
+  QTest::qSleep( 1100 );
+
+  // a modified data source outdates the snapshot
+  {
+    QgsVectorLayer layer( QStringLiteral( "%1/testlayer.shp" ).arg( dir.path() ), QStringLiteral( "testlayer" ), QStringLiteral( "ogr" ) );
+    QVERIFY( layer.isValid() );
+    QgsFeature feature( layer.fields() );
+    feature.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "Point (8.2035 44.9015)" ) ) );
+    QVERIFY( layer.dataProvider()->addFeature( feature ) );
+  }
+  QVERIFY( cache->validProjectSnapshot( path, &settings ).isEmpty() );
+
+  // the project is then loaded instead of the snapshot
+  const QgsProject *project = cache->project( path, &settings );
+  QVERIFY( project );
+  QVERIFY( !project->readBoolEntry( QStringLiteral( "Paths" ), QStringLiteral( "/Absolute" ) ) );
+  cache->removeEntry( path );
+
+  // until the snapshot is written again
+  QVERIFY( QgsConfigCache::writeProjectSnapshot( path, settings ) );
+  QCOMPARE( cache->validProjectSnapshot( path, &settings ), snapshot );
+
+  QTest::qSleep( 1100 );
+
+  // a modified project file outdates the snapshot
+  {
+    QgsProject modified;
+    QVERIFY( modified.read( path ) );
+    modified.setTitle( QStringLiteral( "modified" ) );
+    QVERIFY( modified.write() );
+  }
+  QVERIFY( cache->validProjectSnapshot( path, &settings ).isEmpty() );
+
+  // a snapshot without its key is never valid
+  QVERIFY( QgsConfigCache::writeProjectSnapshot( path, settings ) );
+  QCOMPARE( cache->validProjectSnapshot( path, &settings ), snapshot );
+  QVERIFY( QFile::remove( keyFile.fileName() ) );
+  QVERIFY( cache->validProjectSnapshot( path, &settings ).isEmpty() );
+}
+
+QGSTEST_MAIN( TestQgsConfigCache )
+#include "testqgsconfigcache.moc"
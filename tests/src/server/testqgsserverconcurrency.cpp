@@ -0,0 +1,176 @@
+/***************************************************************************
+     testqgsserverconcurrency.cpp
+     ----------------------------
+    Date                 : October 2020
+    Copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgstest.h"
+#include <QObject>
+#include <QSemaphore>
+#include <QString>
+
+#include <thread>
+
+//qgis includes...
+#include "qgsserver.h"
+#include "qgsserverinterfaceimpl.h"
+#include "qgsbufferserverrequest.h"
+#include "qgsbufferserverresponse.h"
+
+/**
+ * \ingroup UnitTests
+ * Unit tests for requests handled concurrently by the worker threads of
+ * a FastCGI server
+ */
+class TestQgsServerConcurrency : public QObject
+{
+    Q_OBJECT
+
+  public:
+    TestQgsServerConcurrency() = default;
+
+  private slots:
+    // will be called before the first testfunction is executed.
+    void initTestCase();
+
+    // will be called after the last testfunction was executed.
+    void cleanupTestCase();
+
+    // Each thread reads the parameters of its own request
+    void testRequestEnvironment();
+
+    // Two requests handled at the same time give the same responses as
+    // the requests handled one after the other
+    void testConcurrentRequests();
+
+  private:
+    QByteArray handle( const QString &query );
+
+    std::unique_ptr<QgsServer> mServer;
+    QString mProjectPath;
+};
+
+
+void TestQgsServerConcurrency::initTestCase()
+{
+  qputenv( "QGIS_SERVER_FCGI_WORKERS", "2" );
+
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  mProjectPath = QStringLiteral( "%1/qgis_server/test_project.qgs" ).arg( TEST_DATA_DIR );
+  mServer.reset( new QgsServer() );
+}
+
+void TestQgsServerConcurrency::cleanupTestCase()
+{
+  mServer.reset();
+  qunsetenv( "QGIS_SERVER_FCGI_WORKERS" );
+
+  QgsApplication::exitQgis();
+}
+
+QByteArray TestQgsServerConcurrency::handle( const QString &query )
+{
+  QgsBufferServerRequest request( QStringLiteral( "http://server.qgis.org/?MAP=%1&%2" ).arg( mProjectPath, query ) );
+  QgsBufferServerResponse response;
+  mServer->handleRequest( request, response );
+  return response.body();
+}
+
+void TestQgsServerConcurrency::testRequestEnvironment()
+{
+  QgsServerInterfaceImpl *serverInterface = mServer->serverInterface();
+  QSemaphore ready;
+  QSemaphore done;
+  QString first;
+  QString second;
+
+  auto worker = [ & ]( const QString & value, QString & result )
+  {
+    QMap<QString, QString> environment;
+    environment.insert( QStringLiteral( "QUERY_STRING" ), value );
+    serverInterface->setRequestEnvironment( environment );
+
+    // both threads have set their environment before reading it
+    ready.release();
+    ready.acquire( 2 );
+    ready.release( 2 );
+    result = serverInterface->getEnv( QStringLiteral( "QUERY_STRING" ) );
+
+    serverInterface->clearRequestEnvironment();
+    done.release();
+  };
+
+  std::thread firstThread( worker, QStringLiteral( "SERVICE=WMS" ), std::ref( first ) );
+  std::thread secondThread( worker, QStringLiteral( "SERVICE=WFS" ), std::ref( second ) );
+  firstThread.join();
+  secondThread.join();
+
+  QCOMPARE( done.available(), 2 );
+  QCOMPARE( first, QStringLiteral( "SERVICE=WMS" ) );
+  QCOMPARE( second, QStringLiteral( "SERVICE=WFS" ) );
+
+  // the main thread still reads the process environment
+  QCOMPARE( serverInterface->getEnv( QStringLiteral( "QUERY_STRING" ) ), QString( qgetenv( "QUERY_STRING" ) ) );
+}
+
+void TestQgsServerConcurrency::testConcurrentRequests()
+{
+  const QString getMap = QStringLiteral( "SERVICE=WMS&VERSION=1.3.0&REQUEST=GetMap&LAYERS=testlayer%20%C3%A8%C3%A9&STYLES=&CRS=EPSG:4326"
+                                         "&BBOX=44.9014,8.2034,44.9015,8.2036&WIDTH=256&HEIGHT=128&FORMAT=image/png" );
+  const QString getFeature = QStringLiteral( "SERVICE=WFS&VERSION=1.0.0&REQUEST=GetFeature&TYPENAME=testlayer&OUTPUTFORMAT=GeoJSON" );
+
+  // the responses of the requests handled one after the other
+  const QByteArray getMapReference = handle( getMap );
+  const QByteArray getFeatureReference = handle( getFeature );
+  QVERIFY( getMapReference.startsWith( "\x89PNG" ) );
+  QVERIFY( getFeatureReference.contains( "\"FeatureCollection\"" ) );
+
+  const int iterations = 10;
+  QList<QByteArray> getMapResults;
+  QList<QByteArray> getFeatureResults;
+
+  auto worker = [ & ]( const QString & query, QList<QByteArray> &results )
+  {
+    for ( int i = 0; i < iterations; ++i )
+      results << handle( query );
+  };
+
+  std::thread getMapThread( worker, getMap, std::ref( getMapResults ) );
+  std::thread getFeatureThread( worker, getFeature, std::ref( getFeatureResults ) );
+  getMapThread.join();
+  getFeatureThread.join();
+
+  QCOMPARE( getMapResults.size(), iterations );
+  QCOMPARE( getFeatureResults.size(), iterations );
+  for ( int i = 0; i < iterations; ++i )
+  {
+    QCOMPARE( getMapResults.at( i ), getMapReference );
+    QCOMPARE( getFeatureResults.at( i ), getFeatureReference );
+  }
+
+  // the same request handled by two threads at the same time
+  QList<QByteArray> firstResults;
+  QList<QByteArray> secondResults;
+  std::thread firstThread( worker, getMap, std::ref( firstResults ) );
+  std::thread secondThread( worker, getMap, std::ref( secondResults ) );
+  firstThread.join();
+  secondThread.join();
+
+  for ( int i = 0; i < iterations; ++i )
+  {
+    QCOMPARE( firstResults.at( i ), getMapReference );
+    QCOMPARE( secondResults.at( i ), getMapReference );
+  }
+}
+
+QGSTEST_MAIN( TestQgsServerConcurrency )
+#include "testqgsserverconcurrency.moc"
@@ -0,0 +1,166 @@
+/***************************************************************************
+     testqgsserverlayerpool.cpp
+     --------------------------
+    Date                 : October 2020
+    Copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgstest.h"
+#include <QObject>
+#include <QString>
+
+#include <thread>
+
+//qgis includes...
+#include "qgsproject.h"
+#include "qgsserverlayerpool.h"
+#include "qgsserversettings.h"
+#include "qgsvectordataprovider.h"
+#include "qgsvectorlayer.h"
+
+/**
+ * \ingroup UnitTests
+ * Unit tests for the copies of the layers used by concurrent requests
+ */
+class TestQgsServerLayerPool : public QObject
+{
+    Q_OBJECT
+
+  public:
+    TestQgsServerLayerPool() = default;
+
+  private slots:
+    // will be called before the first testfunction is executed.
+    void initTestCase();
+
+    // will be called after the last testfunction was executed.
+    void cleanupTestCase();
+
+    // Without concurrent requests, the layers of the project are used
+    void testDisabled();
+
+    // The copies keep the layer identity and do not share its state
+    void testCopies();
+
+    // The copies are reused by the next requests of the thread and reset for them
+    void testReuse();
+
+    // Each thread has its own copies
+    void testThreads();
+
+  private:
+    QgsServerSettings *mSettings = nullptr;
+    std::unique_ptr<QgsProject> mProject;
+    QgsVectorLayer *mLayer = nullptr;
+};
+
+
+void TestQgsServerLayerPool::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  qputenv( "QGIS_SERVER_FCGI_WORKERS", "2" );
+  mSettings = new QgsServerSettings();
+  qunsetenv( "QGIS_SERVER_FCGI_WORKERS" );
+
+  mProject.reset( new QgsProject() );
+  mLayer = new QgsVectorLayer( QStringLiteral( "%1/qgis_server/testlayer.shp" ).arg( TEST_DATA_DIR ), QStringLiteral( "testlayer" ), QStringLiteral( "ogr" ) );
+  QVERIFY( mLayer->isValid() );
+  mProject->addMapLayer( mLayer );
+}
+
+void TestQgsServerLayerPool::cleanupTestCase()
+{
+  QgsServerLayerPool::clear();
+  delete mSettings;
+  mProject.reset();
+  QgsApplication::exitQgis();
+}
+
+void TestQgsServerLayerPool::testDisabled()
+{
+  QgsServerSettings settings;
+  QVERIFY( !QgsServerLayerPool::isEnabled( settings ) );
+  QCOMPARE( QgsServerLayerPool::layer( settings, mProject.get(), mLayer ), mLayer );
+}
+
+void TestQgsServerLayerPool::testCopies()
+{
+  QVERIFY( QgsServerLayerPool::isEnabled( *mSettings ) );
+  QgsServerLayerPool::startRequest( *mSettings );
+
+  QgsVectorLayer *copy = qobject_cast<QgsVectorLayer *>( QgsServerLayerPool::layer( *mSettings, mProject.get(), mLayer ) );
+  QVERIFY( copy );
+  QVERIFY( copy != mLayer );
+  QCOMPARE( copy->id(), mLayer->id() );
+  QCOMPARE( copy->name(), mLayer->name() );
+  QCOMPARE( copy->featureCount(), mLayer->featureCount() );
+
+  // the filters, selection and edits of a request only apply to its copy
+  QVERIFY( copy->setSubsetString( QStringLiteral( "\"id\" = 1" ) ) );
+  copy->selectAll();
+  QVERIFY( copy->startEditing() );
+  QVERIFY( mLayer->subsetString().isEmpty() );
+  QVERIFY( mLayer->selectedFeatureIds().isEmpty() );
+  QVERIFY( !mLayer->isEditable() );
+
+  // the request gets the same copy, in the state it left it
+  QCOMPARE( QgsServerLayerPool::layer( *mSettings, mProject.get(), mLayer ), copy );
+  QCOMPARE( copy->subsetString(), QStringLiteral( "\"id\" = 1" ) );
+  QVERIFY( copy->isEditable() );
+}
+
+void TestQgsServerLayerPool::testReuse()
+{
+  QgsServerLayerPool::startRequest( *mSettings );
+  QgsVectorLayer *copy = qobject_cast<QgsVectorLayer *>( QgsServerLayerPool::layer( *mSettings, mProject.get(), mLayer ) );
+  QVERIFY( copy );
+  const QgsVectorDataProvider *provider = copy->dataProvider();
+
+  // the next request gets the same copy and provider, reset to the layer
+  QgsServerLayerPool::startRequest( *mSettings );
+  QCOMPARE( QgsServerLayerPool::layer( *mSettings, mProject.get(), mLayer ), copy );
+  QCOMPARE( copy->dataProvider(), provider );
+  QVERIFY( copy->subsetString().isEmpty() );
+  QVERIFY( copy->selectedFeatureIds().isEmpty() );
+  QVERIFY( !copy->isEditable() );
+
+  // the copies of another project are new
+  QgsProject other;
+  QgsVectorLayer *otherLayer = mLayer->clone();
+  other.addMapLayer( otherLayer );
+  QgsMapLayer *otherCopy = QgsServerLayerPool::layer( *mSettings, &other, otherLayer );
+  QVERIFY( otherCopy != otherLayer );
+  QCOMPARE( otherCopy->id(), otherLayer->id() );
+}
+
+void TestQgsServerLayerPool::testThreads()
+{
+  QgsServerLayerPool::startRequest( *mSettings );
+  QgsMapLayer *copy = QgsServerLayerPool::layer( *mSettings, mProject.get(), mLayer );
+
+  QString threadId;
+  bool threadCopy = false;
+  std::thread thread( [ & ]
+  {
+    QgsServerLayerPool::startRequest( *mSettings );
+    QgsMapLayer *layer = QgsServerLayerPool::layer( *mSettings, mProject.get(), mLayer );
+    threadCopy = layer != copy && layer != mLayer;
+    threadId = layer->id();
+    QgsServerLayerPool::clear();
+  } );
+  thread.join();
+
+  QVERIFY( threadCopy );
+  QCOMPARE( threadId, mLayer->id() );
+}
+
+QGSTEST_MAIN( TestQgsServerLayerPool )
+#include "testqgsserverlayerpool.moc"
@@ -0,0 +1,325 @@
+/***************************************************************************
+     testqgsservertilecache.cpp
+     --------------------------
+    Date                 : October 2020
+    Copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgstest.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QObject>
+#include <QString>
+#include <QTemporaryDir>
+
+//qgis includes...
+#include "qgsproject.h"
+#include "qgsservertilecache.h"
+#include "qgsserversettings.h"
+#include "qgsvectorlayer.h"
+
+/**
+ * \ingroup UnitTests
+ * Unit tests for the built-in tile cache of the server
+ */
+class TestQgsServerTileCache : public QObject
+{
+    Q_OBJECT
+
+  public:
+    TestQgsServerTileCache() = default;
+
+  private slots:
+    // will be called before the first testfunction is executed.
+    void initTestCase();
+
+    // will be called after the last testfunction was executed.
+    void cleanupTestCase();
+
+    // will be called before each testfunction is executed
+    void init();
+
+    // Tiles are stored and found in the memory tier
+    void testInsertAndLookup();
+
+    // The memory tier evicts the least recently used tiles
+    void testEviction();
+
+    // Tiles are stored and found in the disk tier
+    void testDiskTier();
+
+    // Removed or modified projects do not return their previous tiles
+    void testRemoveProject();
+
+    // Modified data source files do not return their previous tiles
+    void testModifiedDataSource();
+
+    // Tiles are not returned once expired
+    void testExpiry();
+
+  private:
+    //! Returns settings with the given memory tier size, disk tier directory and expiry
+    static std::unique_ptr<QgsServerSettings> settings( int size, const QString &directory = QString(), int expiry = 0 );
+
+    //! Writes a GeoJSON file of a single point at \a x into \a path
+    static void writeDataSource( const QString &path, int x );
+
+    //! Writes a project file into \a directory
+    static QString writeProject( const QString &directory );
+
+    QTemporaryDir mDir;
+    std::unique_ptr<QgsProject> mProject;
+};
+
+
+void TestQgsServerTileCache::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  mProject.reset( new QgsProject() );
+  mProject->setFileName( writeProject( mDir.path() ) );
+}
+
+void TestQgsServerTileCache::cleanupTestCase()
+{
+  mProject.reset();
+  QgsApplication::exitQgis();
+}
+
+void TestQgsServerTileCache::init()
+{
+  QgsServerTileCache::instance()->removeProject( mProject->fileName() );
+  QgsServerTileCache::instance()->clear();
+}
+
+std::unique_ptr<QgsServerSettings> TestQgsServerTileCache::settings( int size, const QString &directory, int expiry )
+{
+  qputenv( "QGIS_SERVER_TILE_CACHE_SIZE", QByteArray::number( size ) );
+  qputenv( "QGIS_SERVER_TILE_CACHE_DIRECTORY", directory.toUtf8() );
+  qputenv( "QGIS_SERVER_TILE_CACHE_EXPIRY", QByteArray::number( expiry ) );
+  std::unique_ptr<QgsServerSettings> settings( new QgsServerSettings() );
+  qunsetenv( "QGIS_SERVER_TILE_CACHE_SIZE" );
+  qunsetenv( "QGIS_SERVER_TILE_CACHE_DIRECTORY" );
+  qunsetenv( "QGIS_SERVER_TILE_CACHE_EXPIRY" );
+  return settings;
+}
+
+void TestQgsServerTileCache::writeDataSource( const QString &path, int x )
+{
+  QFile file( path );
+  QVERIFY( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+  file.write( QStringLiteral( "{\"type\": \"FeatureCollection\", \"features\": [{\"type\": \"Feature\", \"properties\": {}, "
+                              "\"geometry\": {\"type\": \"Point\", \"coordinates\": [%1, 45]}}]}" ).arg( x ).toUtf8() );
+}
+
+QString TestQgsServerTileCache::writeProject( const QString &directory )
+{
+  QgsProject project;
+  const QString path = QDir( directory ).filePath( QStringLiteral( "project.qgs" ) );
+  project.write( path );
+  return path;
+}
+
+void TestQgsServerTileCache::testInsertAndLookup()
+{
+  QgsServerTileCache *cache = QgsServerTileCache::instance();
+  const std::unique_ptr<QgsServerSettings> memory = settings( 1000 );
+  QVERIFY( QgsServerTileCache::isEnabled( *memory ) );
+  QVERIFY( !QgsServerTileCache::isEnabled( *settings( 0 ) ) );
+
+  QVERIFY( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, *memory ).isEmpty() );
+
+  cache->insertTile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, QByteArray( "tile 1/2/3" ), *memory );
+  QCOMPARE( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, *memory ), QByteArray( "tile 1/2/3" ) );
+
+  // other tiles and tile sets are not found
+  QVERIFY( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 3, 2, *memory ).isEmpty() );
+  QVERIFY( cache->tile( mProject.get(), QStringLiteral( "layer" ), 2, 2, 3, *memory ).isEmpty() );
+  QVERIFY( cache->tile( mProject.get(), QStringLiteral( "other" ), 1, 2, 3, *memory ).isEmpty() );
+
+  // nor the tiles of another project
+  QTemporaryDir otherDir;
+  QgsProject other;
+  other.setFileName( writeProject( otherDir.path() ) );
+  QVERIFY( cache->tile( &other, QStringLiteral( "layer" ), 1, 2, 3, *memory ).isEmpty() );
+
+  // a tile is replaced by a new insertion
+  cache->insertTile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, QByteArray( "new tile" ), *memory );
+  QCOMPARE( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, *memory ), QByteArray( "new tile" ) );
+
+  // empty tiles are not cached
+  cache->insertTile( mProject.get(), QStringLiteral( "layer" ), 4, 5, 6, QByteArray(), *memory );
+  QVERIFY( cache->tile( mProject.get(), QStringLiteral( "layer" ), 4, 5, 6, *memory ).isEmpty() );
+
+  // nothing is cached when both tiers are disabled
+  const std::unique_ptr<QgsServerSettings> disabled = settings( 0 );
+  cache->clear();
+  cache->insertTile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, QByteArray( "tile 1/2/3" ), *disabled );
+  QVERIFY( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, *memory ).isEmpty() );
+}
+
+void TestQgsServerTileCache::testEviction()
+{
+  QgsServerTileCache *cache = QgsServerTileCache::instance();
+  const std::unique_ptr<QgsServerSettings> memory = settings( 100 );
+  const QByteArray data( 40, 'x' );
+
+  cache->insertTile( mProject.get(), QStringLiteral( "layer" ), 0, 0, 0, data, *memory );
+  cache->insertTile( mProject.get(), QStringLiteral( "layer" ), 0, 0, 1, data, *memory );
+
+  // the first tile is used again, so the second one is evicted
+  QCOMPARE( cache->tile( mProject.get(), QStringLiteral( "layer" ), 0, 0, 0, *memory ), data );
+  cache->insertTile( mProject.get(), QStringLiteral( "layer" ), 0, 0, 2, data, *memory );
+
+  QCOMPARE( cache->tile( mProject.get(), QStringLiteral( "layer" ), 0, 0, 0, *memory ), data );
+  QVERIFY( cache->tile( mProject.get(), QStringLiteral( "layer" ), 0, 0, 1, *memory ).isEmpty() );
+  QCOMPARE( cache->tile( mProject.get(), QStringLiteral( "layer" ), 0, 0, 2, *memory ), data );
+
+  // tiles larger than the memory tier are not kept
+  cache->insertTile( mProject.get(), QStringLiteral( "layer" ), 0, 0, 3, QByteArray( 101, 'x' ), *memory );
+  QVERIFY( cache->tile( mProject.get(), QStringLiteral( "layer" ), 0, 0, 3, *memory ).isEmpty() );
+}
+
+void TestQgsServerTileCache::testDiskTier()
+{
+  QgsServerTileCache *cache = QgsServerTileCache::instance();
+  QTemporaryDir directory;
+  const std::unique_ptr<QgsServerSettings> disk = settings( 0, directory.path() );
+  QVERIFY( QgsServerTileCache::isEnabled( *disk ) );
+
+  QVERIFY( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, *disk ).isEmpty() );
+  cache->insertTile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, QByteArray( "tile 1/2/3" ), *disk );
+  cache->insertTile( mProject.get(), QStringLiteral( "other" ), 1, 2, 3, QByteArray( "other 1/2/3" ), *disk );
+
+  // one MBTiles file per tile set, in a directory per project
+  const QStringList projectDirectories = QDir( directory.path() ).entryList( QDir::Dirs | QDir::NoDotAndDotDot );
+  QCOMPARE( projectDirectories.size(), 1 );
+  QCOMPARE( QDir( QDir( directory.path() ).filePath( projectDirectories.first() ) ).entryList( QStringList() << QStringLiteral( "*.mbtiles" ) ).size(), 2 );
+
+  QCOMPARE( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, *disk ), QByteArray( "tile 1/2/3" ) );
+  QCOMPARE( cache->tile( mProject.get(), QStringLiteral( "other" ), 1, 2, 3, *disk ), QByteArray( "other 1/2/3" ) );
+  QVERIFY( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 3, 2, *disk ).isEmpty() );
+
+  // the files are read again once closed, e.g. by another server process
+  cache->removeProject( mProject->fileName() );
+  QCOMPARE( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, *disk ), QByteArray( "tile 1/2/3" ) );
+
+  // tiles read from the disk tier are kept in the memory tier
+  const std::unique_ptr<QgsServerSettings> both = settings( 1000, directory.path() );
+  QCOMPARE( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, *both ), QByteArray( "tile 1/2/3" ) );
+  const std::unique_ptr<QgsServerSettings> memory = settings( 1000 );
+  QCOMPARE( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, *memory ), QByteArray( "tile 1/2/3" ) );
+
+  // and the memory tier does not need the disk tier
+  cache->clear();
+  QVERIFY( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, *memory ).isEmpty() );
+  cache->removeProject( mProject->fileName() );
+}
+
+void TestQgsServerTileCache::testRemoveProject()
+{
+  QgsServerTileCache *cache = QgsServerTileCache::instance();
+  QTemporaryDir directory;
+  const std::unique_ptr<QgsServerSettings> memory = settings( 1000 );
+  const std::unique_ptr<QgsServerSettings> disk = settings( 0, directory.path() );
+
+  cache->insertTile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, QByteArray( "tile 1/2/3" ), *memory );
+  cache->insertTile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, QByteArray( "tile 1/2/3" ), *disk );
+
+  // the memory tier forgets the tiles of a removed project
+  cache->removeProject( mProject->fileName() );
+  QVERIFY( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, *memory ).isEmpty() );
+
+  // while the files of the disk tier are kept for the other server processes
+  const QStringList projectDirectories = QDir( directory.path() ).entryList( QDir::Dirs | QDir::NoDotAndDotDot );
+  QCOMPARE( projectDirectories.size(), 1 );
+  const QDir projectDirectory( QDir( directory.path() ).filePath( projectDirectories.first() ) );
+  QCOMPARE( projectDirectory.entryList( QStringList() << QStringLiteral( "*.mbtiles" ) ).size(), 1 );
+
+  // modification times may have a resolution of a second
+  QTest::qSleep( 1100 );
+
+  // the tiles of a modified project are outdated in both tiers
+  cache->insertTile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, QByteArray( "tile 1/2/3" ), *memory );
+  writeProject( mDir.path() );
+  QVERIFY( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, *memory ).isEmpty() );
+  QVERIFY( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, *disk ).isEmpty() );
+
+  // and the tiles of its new version are stored in another file
+  cache->insertTile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, QByteArray( "new tile" ), *disk );
+  QCOMPARE( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, *disk ), QByteArray( "new tile" ) );
+  QCOMPARE( projectDirectory.entryList( QStringList() << QStringLiteral( "*.mbtiles" ) ).size(), 2 );
+  cache->removeProject( mProject->fileName() );
+}
+
+void TestQgsServerTileCache::testModifiedDataSource()
+{
+  QgsServerTileCache *cache = QgsServerTileCache::instance();
+  QTemporaryDir directory;
+  const std::unique_ptr<QgsServerSettings> memory = settings( 1000 );
+  const std::unique_ptr<QgsServerSettings> disk = settings( 0, directory.path() );
+
+  QTemporaryDir projectDir;
+  const QString dataSource = QDir( projectDir.path() ).filePath( QStringLiteral( "points.geojson" ) );
+  writeDataSource( dataSource, 7 );
+  QgsProject project;
+  project.addMapLayer( new QgsVectorLayer( dataSource, QStringLiteral( "points" ), QStringLiteral( "ogr" ) ) );
+  project.setFileName( writeProject( projectDir.path() ) );
+
+  cache->insertTile( &project, QStringLiteral( "layer" ), 1, 2, 3, QByteArray( "tile 1/2/3" ), *memory );
+  cache->insertTile( &project, QStringLiteral( "layer" ), 1, 2, 3, QByteArray( "tile 1/2/3" ), *disk );
+  QCOMPARE( cache->tile( &project, QStringLiteral( "layer" ), 1, 2, 3, *memory ), QByteArray( "tile 1/2/3" ) );
+  QCOMPARE( cache->tile( &project, QStringLiteral( "layer" ), 1, 2, 3, *disk ), QByteArray( "tile 1/2/3" ) );
+
+  // modification times may have a resolution of a second
+  QTest::qSleep( 1100 );
+
+  // the tiles are outdated in both tiers once the data source is modified,
+  // while the project file is not
+  writeDataSource( dataSource, 8 );
+  QVERIFY( cache->tile( &project, QStringLiteral( "layer" ), 1, 2, 3, *memory ).isEmpty() );
+  QVERIFY( cache->tile( &project, QStringLiteral( "layer" ), 1, 2, 3, *disk ).isEmpty() );
+
+  cache->insertTile( &project, QStringLiteral( "layer" ), 1, 2, 3, QByteArray( "new tile" ), *disk );
+  QCOMPARE( cache->tile( &project, QStringLiteral( "layer" ), 1, 2, 3, *disk ), QByteArray( "new tile" ) );
+  cache->removeProject( project.fileName() );
+}
+
+void TestQgsServerTileCache::testExpiry()
+{
+  QgsServerTileCache *cache = QgsServerTileCache::instance();
+  QTemporaryDir directory;
+  const std::unique_ptr<QgsServerSettings> memory = settings( 1000, QString(), 1 );
+  const std::unique_ptr<QgsServerSettings> disk = settings( 0, directory.path(), 1 );
+  const std::unique_ptr<QgsServerSettings> never = settings( 1000 );
+
+  cache->insertTile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, QByteArray( "tile 1/2/3" ), *never );
+  cache->insertTile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, QByteArray( "tile 1/2/3" ), *memory );
+  cache->insertTile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, QByteArray( "tile 1/2/3" ), *disk );
+
+  // the period of one second is over in both tiers
+  QTest::qSleep( 2100 );
+  QVERIFY( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, *memory ).isEmpty() );
+  QVERIFY( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, *disk ).isEmpty() );
+
+  // while tiles without expiry are kept
+  QCOMPARE( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, *never ), QByteArray( "tile 1/2/3" ) );
+
+  // the tiles of the new period are cached again, away from its end
+  while ( QDateTime::currentMSecsSinceEpoch() % 1000 > 500 )
+    QTest::qSleep( 10 );
+  cache->insertTile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, QByteArray( "new tile" ), *disk );
+  QCOMPARE( cache->tile( mProject.get(), QStringLiteral( "layer" ), 1, 2, 3, *disk ), QByteArray( "new tile" ) );
+  cache->removeProject( mProject->fileName() );
+}
+
+QGSTEST_MAIN( TestQgsServerTileCache )
+#include "testqgsservertilecache.moc"
@@ -0,0 +1,201 @@
+/***************************************************************************
+     test_qgsserver_wms_labelcache.cpp
+     ---------------------------------
+    Date                 : October 2020
+    Copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgstest.h"
+#include "qgsproject.h"
+#include "qgsvectorlayer.h"
+#include "qgsserverinterfaceimpl.h"
+#include "qgswmslabelcache.h"
+#include "qgswmsparameters.h"
+#include "qgswmsrenderer.h"
+#include "qgswmsrendercontext.h"
+
+/**
+ * \ingroup UnitTests
+ * This is a unit test for the WMS label cache of tiled requests
+ */
+class TestQgsServerWmsLabelCache : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+
+    void metatile();
+    void metatile_negative();
+    void metatile_offset();
+    void adjacent_tiles();
+
+  private:
+    QImage renderTile( const QString &bbox );
+};
+
+void TestQgsServerWmsLabelCache::initTestCase()
+{
+  qputenv( "QGIS_SERVER_LABEL_CACHE_SIZE", "100000" );
+  qputenv( "QGIS_SERVER_LABEL_METATILE_SIZE", "4" );
+
+  QgsApplication::init();
+  QgsApplication::initQgis();
+}
+
+void TestQgsServerWmsLabelCache::cleanupTestCase()
+{
+  qunsetenv( "QGIS_SERVER_LABEL_CACHE_SIZE" );
+  qunsetenv( "QGIS_SERVER_LABEL_METATILE_SIZE" );
+
+  QgsApplication::exitQgis();
+}
+
+void TestQgsServerWmsLabelCache::init()
+{
+  QgsWms::QgsWmsLabelCache::instance()->clear();
+}
+
+void TestQgsServerWmsLabelCache::metatile()
+{
+  // tile ( 1, 2 ) of a grid of 100 x 100 tiles starting at the origin
+  const QgsWms::QgsWmsLabelCache::Metatile meta = QgsWms::QgsWmsLabelCache::metatile( QgsRectangle( 100, 200, 200, 300 ), 4 );
+  QCOMPARE( meta.extent, QgsRectangle( 0, 0, 400, 400 ) );
+  QCOMPARE( meta.column, 1 );
+  QCOMPARE( meta.row, 1 );
+
+  // the tiles of the same metatile share its identifier
+  const QgsWms::QgsWmsLabelCache::Metatile other = QgsWms::QgsWmsLabelCache::metatile( QgsRectangle( 300, 0, 400, 100 ), 4 );
+  QCOMPARE( other.extent, meta.extent );
+  QCOMPARE( other.column, 3 );
+  QCOMPARE( other.row, 3 );
+  QCOMPARE( other.id, meta.id );
+
+  // but not the tiles of the next metatile
+  const QgsWms::QgsWmsLabelCache::Metatile next = QgsWms::QgsWmsLabelCache::metatile( QgsRectangle( 400, 0, 500, 100 ), 4 );
+  QCOMPARE( next.extent, QgsRectangle( 400, 0, 800, 400 ) );
+  QCOMPARE( next.column, 0 );
+  QCOMPARE( next.row, 3 );
+  QVERIFY( next.id != meta.id );
+
+  // nor the tiles of the same place with another size
+  QVERIFY( QgsWms::QgsWmsLabelCache::metatile( QgsRectangle( 0, 0, 200, 200 ), 4 ).id != meta.id );
+}
+
+void TestQgsServerWmsLabelCache::metatile_negative()
+{
+  const QgsWms::QgsWmsLabelCache::Metatile meta = QgsWms::QgsWmsLabelCache::metatile( QgsRectangle( -300, -200, -200, -100 ), 4 );
+  QCOMPARE( meta.extent, QgsRectangle( -400, -400, 0, 0 ) );
+  QCOMPARE( meta.column, 1 );
+  QCOMPARE( meta.row, 1 );
+
+  // the tile just before the origin is the last one of its metatile
+  const QgsWms::QgsWmsLabelCache::Metatile last = QgsWms::QgsWmsLabelCache::metatile( QgsRectangle( -100, -100, 0, 0 ), 4 );
+  QCOMPARE( last.extent, meta.extent );
+  QCOMPARE( last.column, 3 );
+  QCOMPARE( last.row, 0 );
+  QCOMPARE( last.id, meta.id );
+
+  // and the tile after the origin belongs to another metatile
+  QVERIFY( QgsWms::QgsWmsLabelCache::metatile( QgsRectangle( 0, 0, 100, 100 ), 4 ).id != meta.id );
+}
+
+void TestQgsServerWmsLabelCache::metatile_offset()
+{
+  // grid of 100 x 100 tiles starting at ( 10, 20 )
+  const QgsWms::QgsWmsLabelCache::Metatile meta = QgsWms::QgsWmsLabelCache::metatile( QgsRectangle( 10, 20, 110, 120 ), 4 );
+  QCOMPARE( meta.extent, QgsRectangle( 10, 20, 410, 420 ) );
+  QCOMPARE( meta.column, 0 );
+  QCOMPARE( meta.row, 3 );
+
+  const QgsWms::QgsWmsLabelCache::Metatile other = QgsWms::QgsWmsLabelCache::metatile( QgsRectangle( 310, 320, 410, 420 ), 4 );
+  QCOMPARE( other.extent, meta.extent );
+  QCOMPARE( other.column, 3 );
+  QCOMPARE( other.row, 0 );
+  QCOMPARE( other.id, meta.id );
+
+  // the same place on the grid starting at the origin is another metatile
+  QVERIFY( QgsWms::QgsWmsLabelCache::metatile( QgsRectangle( 0, 0, 100, 100 ), 4 ).id != meta.id );
+
+  // offset grid with negative tiles
+  const QgsWms::QgsWmsLabelCache::Metatile negative = QgsWms::QgsWmsLabelCache::metatile( QgsRectangle( -90, -80, 10, 20 ), 4 );
+  QCOMPARE( negative.extent, QgsRectangle( -390, -380, 10, 20 ) );
+  QCOMPARE( negative.column, 3 );
+  QCOMPARE( negative.row, 0 );
+}
+
+QImage TestQgsServerWmsLabelCache::renderTile( const QString &bbox )
+{
+  const QString filename = QString( "%1/qgis_server/test_project.qgs" ).arg( TEST_DATA_DIR );
+  QgsProject project;
+  project.read( filename );
+
+  QUrlQuery query;
+  query.addQueryItem( "SERVICE", "WMS" );
+  query.addQueryItem( "VERSION", "1.1.1" );
+  query.addQueryItem( "REQUEST", "GetMap" );
+  query.addQueryItem( "LAYERS", "testlayer èé" );
+  query.addQueryItem( "STYLES", "" );
+  query.addQueryItem( "SRS", "EPSG:4326" );
+  query.addQueryItem( "BBOX", bbox );
+  query.addQueryItem( "WIDTH", "256" );
+  query.addQueryItem( "HEIGHT", "256" );
+  query.addQueryItem( "FORMAT", "image/png" );
+  query.addQueryItem( "TILED", "true" );
+  QgsWms::QgsWmsParameters parameters( query );
+
+  QgsCapabilitiesCache cache;
+  QgsServiceRegistry registry;
+  QgsServerSettings settings;
+  QgsServerInterfaceImpl interface( &cache, &registry, &settings );
+
+  QgsWms::QgsWmsRenderContext context( &project, &interface );
+  context.setFlag( QgsWms::QgsWmsRenderContext::UpdateExtent );
+  context.setFlag( QgsWms::QgsWmsRenderContext::UseOpacity );
+  context.setFlag( QgsWms::QgsWmsRenderContext::UseFilter );
+  context.setFlag( QgsWms::QgsWmsRenderContext::UseSelection );
+  context.setFlag( QgsWms::QgsWmsRenderContext::AddHighlightLayers );
+  context.setFlag( QgsWms::QgsWmsRenderContext::AddExternalLayers );
+  context.setFlag( QgsWms::QgsWmsRenderContext::SetAccessControl );
+  context.setParameters( parameters );
+
+  QgsWms::QgsRenderer renderer( context );
+  std::unique_ptr<QImage> image( renderer.getMap() );
+  return *image;
+}
+
+void TestQgsServerWmsLabelCache::adjacent_tiles()
+{
+  // two adjacent tiles of the same metatile, the labeled points lying on both
+  const QString left = QStringLiteral( "8.2034,44.9014,8.2035,44.9015" );
+  const QString right = QStringLiteral( "8.2035,44.9014,8.2036,44.9015" );
+  QgsWms::QgsWmsLabelCache *cache = QgsWms::QgsWmsLabelCache::instance();
+
+  const QImage leftFirst = renderTile( left );
+  QCOMPARE( cache->count(), 1 );
+  const QImage rightSecond = renderTile( right );
+  // the second tile reuses the placement of the first one
+  QCOMPARE( cache->count(), 1 );
+
+  // the tiles do not depend on the order of the requests
+  cache->clear();
+  const QImage rightFirst = renderTile( right );
+  QCOMPARE( cache->count(), 1 );
+  const QImage leftSecond = renderTile( left );
+  QCOMPARE( cache->count(), 1 );
+
+  QCOMPARE( leftSecond, leftFirst );
+  QCOMPARE( rightFirst, rightSecond );
+}
+
+QGSTEST_MAIN( TestQgsServerWmsLabelCache )
+#include "test_qgsserver_wms_labelcache.moc"
@@ -0,0 +1,176 @@
+/***************************************************************************
+     test_qgsserver_wmts_metatile.cpp
+     --------------------------------
+    Date                 : October 2020
+    Copyright            : (C) 2020 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgstest.h"
+#include "qgswmtsutils.h"
+
+#include <QColor>
+#include <QPainter>
+
+/**
+ * \ingroup UnitTests
+ * This is a unit test for the metatiles rendered for cached WMTS tiles
+ */
+class TestQgsServerWmtsMetatile : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void metatile();
+    void metatile_edge();
+    void metatile_tileSize();
+    void metatile_cut();
+
+  private:
+    QgsWmts::tileMatrixDef tileMatrix( int tileWidth, int tileHeight ) const;
+};
+
+void TestQgsServerWmtsMetatile::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+}
+
+void TestQgsServerWmtsMetatile::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+QgsWmts::tileMatrixDef TestQgsServerWmtsMetatile::tileMatrix( int tileWidth, int tileHeight ) const
+{
+  // matrix of 10 columns and 6 rows with a resolution of 2 map units per pixel
+  QgsWmts::tileMatrixDef tm;
+  tm.resolution = 2;
+  tm.col = 10;
+  tm.row = 6;
+  tm.left = 1000;
+  tm.top = 5000;
+  tm.tileWidth = tileWidth;
+  tm.tileHeight = tileHeight;
+  return tm;
+}
+
+void TestQgsServerWmtsMetatile::metatile()
+{
+  const QgsWmts::tileMatrixDef tm = tileMatrix( 256, 256 );
+
+  QgsWmts::metatileDef meta;
+  meta.size = 4;
+  meta.buffer = 16;
+  const QgsRectangle extent = QgsWmts::calculateMetatile( tm, 1, 2, meta );
+  QCOMPARE( meta.row, 0 );
+  QCOMPARE( meta.col, 0 );
+  QCOMPARE( meta.rows, 4 );
+  QCOMPARE( meta.cols, 4 );
+  QCOMPARE( meta.buffer, 16 );
+  QCOMPARE( meta.tileWidth, 256 );
+  QCOMPARE( meta.tileHeight, 256 );
+  // 4 tiles of 256 px grown by 16 px on each side, 2 map units per pixel
+  QCOMPARE( extent, QgsRectangle( 1000 - 32, 5000 - 2048 - 32, 1000 + 2048 + 32, 5000 + 32 ) );
+
+  // the tiles of the same metatile share its extent
+  QgsWmts::metatileDef other;
+  other.size = 4;
+  other.buffer = 16;
+  QCOMPARE( QgsWmts::calculateMetatile( tm, 3, 0, other ), extent );
+  QCOMPARE( other.row, meta.row );
+  QCOMPARE( other.col, meta.col );
+
+  // a negative buffer is ignored
+  QgsWmts::metatileDef noBuffer;
+  noBuffer.size = 4;
+  noBuffer.buffer = -10;
+  QCOMPARE( QgsWmts::calculateMetatile( tm, 1, 2, noBuffer ), QgsRectangle( 1000, 5000 - 2048, 1000 + 2048, 5000 ) );
+  QCOMPARE( noBuffer.buffer, 0 );
+}
+
+void TestQgsServerWmtsMetatile::metatile_edge()
+{
+  const QgsWmts::tileMatrixDef tm = tileMatrix( 256, 256 );
+
+  // the metatiles are cut at the edges of the tile matrix
+  QgsWmts::metatileDef meta;
+  meta.size = 4;
+  meta.buffer = 8;
+  const QgsRectangle extent = QgsWmts::calculateMetatile( tm, 5, 9, meta );
+  QCOMPARE( meta.row, 4 );
+  QCOMPARE( meta.col, 8 );
+  QCOMPARE( meta.rows, 2 );
+  QCOMPARE( meta.cols, 2 );
+  QCOMPARE( extent, QgsRectangle( 1000 + ( 8 * 256 - 8 ) * 2, 5000 - ( 6 * 256 + 8 ) * 2,
+                                  1000 + ( 10 * 256 + 8 ) * 2, 5000 - ( 4 * 256 - 8 ) * 2 ) );
+}
+
+void TestQgsServerWmtsMetatile::metatile_tileSize()
+{
+  // the tile size is taken from the tile matrix
+  const QgsWmts::tileMatrixDef tm = tileMatrix( 512, 128 );
+
+  QgsWmts::metatileDef meta;
+  meta.size = 2;
+  meta.buffer = 4;
+  const QgsRectangle extent = QgsWmts::calculateMetatile( tm, 3, 3, meta );
+  QCOMPARE( meta.row, 2 );
+  QCOMPARE( meta.col, 2 );
+  QCOMPARE( meta.tileWidth, 512 );
+  QCOMPARE( meta.tileHeight, 128 );
+  QCOMPARE( extent, QgsRectangle( 1000 + ( 2 * 512 - 4 ) * 2, 5000 - ( 4 * 128 + 4 ) * 2,
+                                  1000 + ( 4 * 512 + 4 ) * 2, 5000 - ( 2 * 128 - 4 ) * 2 ) );
+}
+
+void TestQgsServerWmtsMetatile::metatile_cut()
+{
+  const QgsWmts::tileMatrixDef tm = tileMatrix( 8, 4 );
+
+  QgsWmts::metatileDef meta;
+  meta.size = 3;
+  meta.buffer = 2;
+  QgsWmts::calculateMetatile( tm, 4, 4, meta );
+  QCOMPARE( meta.row, 3 );
+  QCOMPARE( meta.col, 3 );
+
+  // the metatile image, each tile filled with its own color and the buffer in black
+  QImage image( meta.cols * meta.tileWidth + 2 * meta.buffer, meta.rows * meta.tileHeight + 2 * meta.buffer, QImage::Format_ARGB32 );
+  image.fill( Qt::black );
+  QPainter painter( &image );
+  for ( int row = 0; row < meta.rows; ++row )
+  {
+    for ( int col = 0; col < meta.cols; ++col )
+    {
+      painter.fillRect( meta.buffer + col * meta.tileWidth, meta.buffer + row * meta.tileHeight,
+                        meta.tileWidth, meta.tileHeight, QColor( 10 + row * 50, 10 + col * 50, 0 ) );
+    }
+  }
+  painter.end();
+
+  for ( int row = 0; row < meta.rows; ++row )
+  {
+    for ( int col = 0; col < meta.cols; ++col )
+    {
+      const QImage tile = QgsWmts::metatileTile( image, meta, meta.row + row, meta.col + col );
+      QCOMPARE( tile.size(), QSize( 8, 4 ) );
+
+      // the tile is entirely made of its color, without any buffer
+      QImage expected( tile.size(), QImage::Format_ARGB32 );
+      expected.fill( QColor( 10 + row * 50, 10 + col * 50, 0 ) );
+      QCOMPARE( tile, expected );
+    }
+  }
+}
+
+QGSTEST_MAIN( TestQgsServerWmtsMetatile )
+#include "test_qgsserver_wmts_metatile.moc"